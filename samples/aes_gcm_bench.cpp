@@ -0,0 +1,249 @@
+#include <shoc/aes_gcm.hpp>
+#include <shoc/aligned_memory.hpp>
+#include <shoc/buffer.hpp>
+#include <shoc/buffer_inventory.hpp>
+#include <shoc/cpu_aes_gcm.hpp>
+#include <shoc/device.hpp>
+#include <shoc/logger.hpp>
+#include <shoc/memory_map.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <boost/cobalt.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <doca_log.h>
+
+namespace {
+    std::uint32_t constexpr max_tasks = 16;
+    std::uint32_t constexpr tag_size = 16;
+
+    struct slot {
+        shoc::buffer plain;
+        shoc::buffer sealed;
+        std::array<std::byte, 12> iv {};
+        shoc::coro::status_awaitable<> task;
+        bool busy = false;
+    };
+
+    /**
+     * Encrypt the data in records of record_size bytes, max_tasks at a time, a few times over and
+     * report the best run
+     */
+    auto measure(
+        shoc::aes_gcm_backend &backend,
+        shoc::aes_gcm_key const &key,
+        shoc::memory_map &plain_mmap,
+        std::span<std::byte const> plain,
+        shoc::memory_map &sealed_mmap,
+        std::span<std::byte> sealed,
+        std::size_t record_size,
+        int rounds
+    ) -> boost::cobalt::task<nlohmann::json> {
+        auto inventory = shoc::buffer_inventory { 2 * max_tasks };
+        auto slots = std::vector<slot>(max_tasks);
+        auto records = plain.size() / record_size;
+        auto best = std::chrono::nanoseconds::max();
+
+        for(auto &s : slots) {
+            s.plain = inventory.buf_get_by_data(plain_mmap, plain.first(record_size));
+            s.sealed = inventory.buf_get_by_addr(sealed_mmap, sealed.first(record_size + tag_size));
+        }
+
+        for(auto round = 0; round < rounds; ++round) {
+            auto start = std::chrono::steady_clock::now();
+
+            for(auto i = std::size_t { 0 }; i < records + max_tasks; ++i) {
+                auto &s = slots[i % max_tasks];
+
+                if(s.busy) {
+                    auto status = co_await s.task;
+                    s.busy = false;
+
+                    if(status != DOCA_SUCCESS) {
+                        throw shoc::doca_exception(status);
+                    }
+                }
+
+                if(i >= records) {
+                    continue;
+                }
+
+                // a fresh IV for every record of every round, as with real traffic
+                auto counter = static_cast<std::uint64_t>(round) << 40 | i;
+                std::memcpy(s.iv.data(), &counter, sizeof counter);
+
+                auto sealed_record = sealed.subspan((i % max_tasks) * (record_size + tag_size), record_size + tag_size);
+                shoc::buffer_inventory::buf_reuse_by_data(s.plain, plain_mmap, plain.subspan(i * record_size, record_size));
+                shoc::buffer_inventory::buf_reuse_by_addr(s.sealed, sealed_mmap, sealed_record);
+
+                s.task = backend.encrypt(s.plain, s.sealed, key, s.iv, tag_size);
+                s.busy = true;
+            }
+
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+        }
+
+        auto bytes = records * record_size;
+
+        auto result = nlohmann::json {};
+        result["records"] = records;
+        result["elapsed_us"] = best.count() / 1e3;
+        result["records_per_s"] = records * 1e9 / best.count();
+        result["data_rate_gibps"] = bytes * 1e9 / best.count() / (1 << 30);
+
+        co_return result;
+    }
+
+    auto run_benchmark(
+        shoc::progress_engine_lease engine,
+        std::size_t size,
+        std::vector<std::size_t> record_sizes,
+        std::string route,
+        std::size_t threads,
+        int rounds
+    ) -> boost::cobalt::detached try {
+        auto max_record = std::ranges::max(record_sizes);
+        size = std::max(size, max_record);
+
+        auto plain = shoc::aligned_memory { size };
+        auto sealed = shoc::aligned_memory { max_tasks * (max_record + tag_size) };
+        auto rng = std::mt19937_64 { 1 };
+
+        for(auto &b : plain.as_writable_bytes()) {
+            b = static_cast<std::byte>(rng());
+        }
+
+        auto key_bytes = std::array<std::byte, 32> {};
+        std::ranges::generate(key_bytes, [&rng] { return static_cast<std::byte>(rng()); });
+
+        auto json = nlohmann::json {};
+        auto dev = std::optional<shoc::device> {};
+        auto ctx = std::optional<shoc::shared_scoped_context<shoc::aes_gcm_context>> {};
+
+        if(route == "hardware" || route == "compare") {
+            try {
+                dev = shoc::device::find(shoc::device_capability::aes_gcm);
+                ctx = co_await shoc::aes_gcm_context::create(engine, *dev, max_tasks);
+                (*ctx)->set_route(shoc::aes_gcm_route::hardware);
+            } catch(shoc::doca_exception &ex) {
+                if(ex.doca_error() != DOCA_ERROR_NOT_FOUND) {
+                    throw;
+                }
+
+                json["hardware"]["error"] = "no device with doca_aes_gcm";
+            }
+        }
+
+        if(!dev) {
+            // the software backend doesn't need the device, only memory maps for the buffers
+            dev = shoc::device::find(shoc::device_capability::dma);
+        }
+
+        auto plain_mmap = shoc::memory_map { *dev, plain.as_writable_bytes() };
+        auto sealed_mmap = shoc::memory_map { *dev, sealed.as_writable_bytes() };
+        auto software = std::optional<shoc::cpu_aes_gcm_backend> {};
+
+        if(route == "software" || route == "compare") {
+            software.emplace(shoc::cpu_aes_gcm_config { .threads = threads });
+            json["software"]["threads"] = software->workers().threads();
+        }
+
+        {
+            auto hardware_key = ctx ? (*ctx)->load_key(key_bytes, DOCA_AES_GCM_KEY_256) : shoc::aes_gcm_key {};
+            auto software_key = software ? software->load_key(key_bytes, DOCA_AES_GCM_KEY_256) : shoc::aes_gcm_key {};
+
+            for(auto record_size : record_sizes) {
+                auto name = std::to_string(record_size);
+
+                if(ctx) {
+                    if((*ctx)->hardware_supported()) {
+                        json["hardware"][name] = co_await measure(
+                            **ctx, hardware_key,
+                            plain_mmap, plain.as_bytes(),
+                            sealed_mmap, sealed.as_writable_bytes(),
+                            record_size, rounds
+                        );
+                    } else {
+                        json["hardware"][name]["error"] = "device can't run AES-GCM tasks";
+                    }
+                }
+
+                if(software) {
+                    json["software"][name] = co_await measure(
+                        *software, software_key,
+                        plain_mmap, plain.as_bytes(),
+                        sealed_mmap, sealed.as_writable_bytes(),
+                        record_size, rounds
+                    );
+                }
+            }
+        }
+
+        if(ctx) {
+            co_await (*ctx)->stop();
+        }
+
+        std::cout << json.dump(4) << std::endl;
+    } catch(shoc::doca_exception &ex) {
+        shoc::logger->error("ecode = {}, message = {}", static_cast<int>(ex.doca_error()), ex.what());
+    }
+}
+
+auto co_main(
+    [[maybe_unused]] int argc,
+    [[maybe_unused]] char *argv[]
+) -> boost::cobalt::main {
+    shoc::set_sdk_log_level(DOCA_LOG_LEVEL_WARNING);
+    shoc::logger->set_level(spdlog::level::warn);
+
+    auto size = std::size_t { 256 } << 20;
+    auto record_sizes = std::vector<std::size_t> {};
+    auto route = std::string { "compare" };
+    auto threads = shoc::cpu_aes_gcm_config {}.threads;
+    auto rounds = 3;
+
+    for(auto arg : std::span { argv + 1, argv + argc }) {
+        auto view = std::string_view { arg };
+
+        if(view.starts_with("--route=")) {
+            route = view.substr(8);
+        } else if(view.starts_with("--size-mib=")) {
+            size = std::stoull(std::string { view.substr(11) }) << 20;
+        } else if(view.starts_with("--record=")) {
+            record_sizes.push_back(std::stoull(std::string { view.substr(9) }));
+        } else if(view.starts_with("--threads=")) {
+            threads = std::stoull(std::string { view.substr(10) });
+        } else if(view.starts_with("--rounds=")) {
+            rounds = std::stoi(std::string { view.substr(9) });
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--route=hardware|software|compare] [--size-mib=N] [--record=BYTES]... [--threads=N] [--rounds=N]\n";
+            co_return -1;
+        }
+    }
+
+    if(record_sizes.empty()) {
+        record_sizes = { 1 << 10, 4 << 10, 16 << 10, 64 << 10, 256 << 10, 1 << 20 };
+    }
+
+    auto engine = shoc::progress_engine{};
+
+    run_benchmark(&engine, size, std::move(record_sizes), route, threads, rounds);
+
+    co_await engine.run();
+
+    co_return 0;
+}
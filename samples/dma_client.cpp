@@ -3,6 +3,7 @@
 #include <shoc/buffer.hpp>
 #include <shoc/buffer_inventory.hpp>
 #include <shoc/comch/client.hpp>
+#include <shoc/coro/combinators.hpp>
 #include <shoc/dma.hpp>
 #include <shoc/memory_map.hpp>
 #include <shoc/progress_engine.hpp>
@@ -76,16 +77,24 @@ auto dma_receive(
     auto dma = co_await shoc::dma_context::create(engine, dev, slots + 1);
     auto pending = std::vector<shoc::coro::status_awaitable<>>(slots);
 
+    // one pair of buffers per slot, re-pointed to the next block whenever the slot is reused
+    auto local_bufs = inv.buf_get_blocks(local_mmap, std::span { local_mem }.first(slots * extents.block_size), extents.block_size);
+    auto remote_bufs = inv.buf_get_blocks_by_data(remote_mmap, remote_mem.first(slots * extents.block_size), extents.block_size);
+
     auto start = std::chrono::steady_clock::now();
 
-    // parallel offload in one loop: first slots iterations fill pending, after that a pending
-    // task will be awaited before another one is pushed. The last few iterations only await
-    // pending tasks and don't push new ones.
+    // parallel offload in one loop: first slots iterations fill pending, after that whichever
+    // pending task completes first is awaited and its slot reused for the next one. The last few
+    // iterations only await pending tasks and don't push new ones.
     for(auto i : std::ranges::views::iota(std::uint32_t{}, extents.block_count + slots)) {
-        auto slot = i % slots;
+        std::size_t slot = i;
+
+        if(i >= slots) {
+            slot = co_await shoc::coro::when_any(pending);
 
-        if(i > slots) {
-            auto status = co_await pending[slot];
+            auto &done = pending[slot];
+            auto status = co_await done;
+            done = {};
 
             if(status != DOCA_SUCCESS) {
                 shoc::logger->error("dma memcpy failed: {}", doca_error_get_descr(status));
@@ -96,11 +105,12 @@ auto dma_receive(
         if(i < extents.block_count) {
             auto offset = i * extents.block_size;
             auto local_block = std::span { local_mem.data() + offset, extents.block_size };
-            auto local_buf = inv.buf_get_by_addr(local_mmap, local_block);
             auto remote_block = remote_mem.subspan(offset, extents.block_size);
-            auto remote_buf = inv.buf_get_by_data(remote_mmap, remote_block);
 
-            pending[slot] = dma->memcpy(remote_buf, local_buf);
+            shoc::buffer_inventory::buf_reuse_by_addr(local_bufs[slot], local_mmap, local_block);
+            shoc::buffer_inventory::buf_reuse_by_data(remote_bufs[slot], remote_mmap, remote_block);
+
+            pending[slot] = dma->memcpy(remote_bufs[slot], local_bufs[slot]);
         }
     }
 
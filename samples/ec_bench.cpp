@@ -0,0 +1,291 @@
+#include <shoc/aligned_memory.hpp>
+#include <shoc/buffer.hpp>
+#include <shoc/buffer_inventory.hpp>
+#include <shoc/cpu_erasure_coding.hpp>
+#include <shoc/device.hpp>
+#include <shoc/erasure_coding.hpp>
+#include <shoc/gf256.hpp>
+#include <shoc/logger.hpp>
+#include <shoc/memory_map.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <boost/cobalt.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <doca_log.h>
+
+namespace {
+    std::uint32_t constexpr max_tasks = 16;
+
+    struct slot {
+        shoc::buffer data;
+        shoc::buffer rdnc;
+        shoc::coro::status_awaitable<> task;
+        bool busy = false;
+    };
+
+    /**
+     * Encode the data in stripes of data_blocks * block_size bytes, max_tasks at a time, a few
+     * times over and report the best run
+     */
+    auto measure(
+        shoc::ec_backend &backend,
+        shoc::ec_coding_matrix const &coding,
+        shoc::memory_map &data_mmap,
+        std::span<std::byte const> data,
+        shoc::memory_map &rdnc_mmap,
+        std::span<std::byte> rdnc,
+        std::size_t block_size,
+        int rounds
+    ) -> boost::cobalt::task<nlohmann::json> {
+        auto stripe_size = coding.data_block_count() * block_size;
+        auto rdnc_size = coding.rdnc_block_count() * block_size;
+        auto stripes = data.size() / stripe_size;
+
+        auto inventory = shoc::buffer_inventory { 2 * max_tasks };
+        auto slots = std::vector<slot>(max_tasks);
+        auto best = std::chrono::nanoseconds::max();
+
+        for(auto i = std::size_t { 0 }; i < max_tasks; ++i) {
+            slots[i].data = inventory.buf_get_by_data(data_mmap, data.first(stripe_size));
+            slots[i].rdnc = inventory.buf_get_by_addr(rdnc_mmap, rdnc.subspan(i * rdnc_size, rdnc_size));
+        }
+
+        for(auto round = 0; round < rounds; ++round) {
+            auto start = std::chrono::steady_clock::now();
+
+            for(auto i = std::size_t { 0 }; i < stripes + max_tasks; ++i) {
+                auto &s = slots[i % max_tasks];
+
+                if(s.busy) {
+                    auto status = co_await s.task;
+                    s.busy = false;
+
+                    if(status != DOCA_SUCCESS) {
+                        throw shoc::doca_exception(status);
+                    }
+                }
+
+                if(i >= stripes) {
+                    continue;
+                }
+
+                shoc::buffer_inventory::buf_reuse_by_data(s.data, data_mmap, data.subspan(i * stripe_size, stripe_size));
+                s.rdnc.set_data(0);
+
+                s.task = backend.create(coding, s.data, s.rdnc);
+                s.busy = true;
+            }
+
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+        }
+
+        auto bytes = stripes * stripe_size;
+
+        auto result = nlohmann::json {};
+        result["stripes"] = stripes;
+        result["elapsed_us"] = best.count() / 1e3;
+        result["stripes_per_s"] = stripes * 1e9 / best.count();
+        result["data_rate_gbps"] = bytes / static_cast<double>(best.count());
+
+        co_return result;
+    }
+
+    auto run_benchmark(
+        shoc::progress_engine_lease engine,
+        std::size_t size,
+        std::vector<std::size_t> block_sizes,
+        std::vector<std::size_t> data_block_counts,
+        std::size_t rdnc_block_count,
+        doca_ec_matrix_type matrix_type,
+        std::string route,
+        shoc::cpu_ec_config software_cfg,
+        int rounds
+    ) -> boost::cobalt::detached try {
+        auto max_rdnc = max_tasks * rdnc_block_count * std::ranges::max(block_sizes);
+        size = std::max(size, std::ranges::max(data_block_counts) * std::ranges::max(block_sizes));
+
+        auto data = shoc::aligned_memory { size };
+        auto rdnc = shoc::aligned_memory { max_rdnc };
+        auto rng = std::mt19937_64 { 1 };
+
+        for(auto &b : data.as_writable_bytes()) {
+            b = static_cast<std::byte>(rng());
+        }
+
+        auto json = nlohmann::json {};
+        auto dev = std::optional<shoc::device> {};
+        auto ctx = std::optional<shoc::shared_scoped_context<shoc::ec_context>> {};
+
+        if(route == "hardware" || route == "compare") {
+            try {
+                dev = shoc::device::find(shoc::device_capability::erasure_coding);
+                ctx = co_await shoc::ec_context::create(engine, *dev, max_tasks);
+            } catch(shoc::doca_exception &ex) {
+                if(ex.doca_error() != DOCA_ERROR_NOT_FOUND) {
+                    throw;
+                }
+
+                json["hardware"]["error"] = "no device with doca_ec";
+            }
+        }
+
+        if(!dev) {
+            // the software backend doesn't need the device, only memory maps for the buffers
+            dev = shoc::device::find(shoc::device_capability::dma);
+        }
+
+        auto data_mmap = shoc::memory_map { *dev, data.as_writable_bytes() };
+        auto rdnc_mmap = shoc::memory_map { *dev, rdnc.as_writable_bytes() };
+        auto software = std::optional<shoc::cpu_ec_backend> {};
+
+        if(route == "software" || route == "compare") {
+            software.emplace(software_cfg);
+            json["software"]["threads"] = software->workers().threads();
+            json["software"]["kernel"] = shoc::gf256_kernel_name(software_cfg.kernel);
+        }
+
+        for(auto data_block_count : data_block_counts) {
+            auto geometry = std::to_string(data_block_count) + "+" + std::to_string(rdnc_block_count);
+
+            for(auto block_size : block_sizes) {
+                auto name = std::to_string(block_size);
+
+                if(ctx) {
+                    auto coding = (*ctx)->coding_matrix(matrix_type, data_block_count, rdnc_block_count);
+
+                    json["hardware"][geometry][name] = co_await measure(
+                        **ctx, coding,
+                        data_mmap, data.as_bytes(),
+                        rdnc_mmap, rdnc.as_writable_bytes(),
+                        block_size, rounds
+                    );
+                }
+
+                if(software) {
+                    auto coding = software->coding_matrix(matrix_type, data_block_count, rdnc_block_count);
+
+                    json["software"][geometry][name] = co_await measure(
+                        *software, coding,
+                        data_mmap, data.as_bytes(),
+                        rdnc_mmap, rdnc.as_writable_bytes(),
+                        block_size, rounds
+                    );
+                }
+            }
+        }
+
+        if(ctx) {
+            co_await (*ctx)->stop();
+        }
+
+        std::cout << json.dump(4) << std::endl;
+    } catch(shoc::doca_exception &ex) {
+        shoc::logger->error("ecode = {}, message = {}", static_cast<int>(ex.doca_error()), ex.what());
+    }
+}
+
+auto co_main(
+    [[maybe_unused]] int argc,
+    [[maybe_unused]] char *argv[]
+) -> boost::cobalt::main {
+    shoc::set_sdk_log_level(DOCA_LOG_LEVEL_WARNING);
+    shoc::logger->set_level(spdlog::level::warn);
+
+    auto size = std::size_t { 256 } << 20;
+    auto block_sizes = std::vector<std::size_t> {};
+    auto data_block_counts = std::vector<std::size_t> {};
+    auto rdnc_block_count = std::size_t { 2 };
+    auto matrix_type = DOCA_EC_MATRIX_TYPE_CAUCHY;
+    auto route = std::string { "compare" };
+    auto software_cfg = shoc::cpu_ec_config {};
+    auto rounds = 3;
+
+    auto kernels = {
+        shoc::gf256_kernel::automatic,
+        shoc::gf256_kernel::scalar,
+        shoc::gf256_kernel::ssse3,
+        shoc::gf256_kernel::avx2,
+        shoc::gf256_kernel::avx512,
+        shoc::gf256_kernel::avx2_gfni,
+        shoc::gf256_kernel::avx512_gfni
+    };
+
+    auto usage = [&] {
+        std::cerr << "Usage: " << argv[0] << " [--route=hardware|software|compare] [--size-mib=N] [--block=BYTES]... [--data-blocks=K]... [--rdnc-blocks=M] [--matrix=cauchy|vandermonde] [--kernel=NAME] [--threads=N] [--rounds=N]\n";
+    };
+
+    for(auto arg : std::span { argv + 1, argv + argc }) {
+        auto view = std::string_view { arg };
+
+        if(view.starts_with("--route=")) {
+            route = view.substr(8);
+        } else if(view.starts_with("--size-mib=")) {
+            size = std::stoull(std::string { view.substr(11) }) << 20;
+        } else if(view.starts_with("--block=")) {
+            block_sizes.push_back(std::stoull(std::string { view.substr(8) }));
+        } else if(view.starts_with("--data-blocks=")) {
+            data_block_counts.push_back(std::stoull(std::string { view.substr(14) }));
+        } else if(view.starts_with("--rdnc-blocks=")) {
+            rdnc_block_count = std::stoull(std::string { view.substr(14) });
+        } else if(view == "--matrix=vandermonde") {
+            matrix_type = DOCA_EC_MATRIX_TYPE_VANDERMONDE;
+        } else if(view == "--matrix=cauchy") {
+            matrix_type = DOCA_EC_MATRIX_TYPE_CAUCHY;
+        } else if(view.starts_with("--kernel=")) {
+            auto found = std::ranges::find(kernels, view.substr(9), shoc::gf256_kernel_name);
+
+            if(found == kernels.end()) {
+                usage();
+                co_return -1;
+            }
+
+            software_cfg.kernel = *found;
+        } else if(view.starts_with("--threads=")) {
+            software_cfg.threads = std::stoull(std::string { view.substr(10) });
+        } else if(view.starts_with("--rounds=")) {
+            rounds = std::stoi(std::string { view.substr(9) });
+        } else {
+            usage();
+            co_return -1;
+        }
+    }
+
+    if(block_sizes.empty()) {
+        block_sizes = { 1 << 10, 4 << 10, 16 << 10, 64 << 10, 256 << 10 };
+    }
+
+    if(data_block_counts.empty()) {
+        data_block_counts = { 4, 8, 12 };
+    }
+
+    auto engine = shoc::progress_engine{};
+
+    run_benchmark(
+        &engine,
+        size,
+        std::move(block_sizes),
+        std::move(data_block_counts),
+        rdnc_block_count,
+        matrix_type,
+        route,
+        software_cfg,
+        rounds
+    );
+
+    co_await engine.run();
+
+    co_return 0;
+}
@@ -0,0 +1,223 @@
+#include <shoc/device.hpp>
+#include <shoc/ec_stripe_store.hpp>
+#include <shoc/erasure_coding.hpp>
+#include <shoc/logger.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <boost/cobalt.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <doca_log.h>
+
+namespace {
+    std::uint32_t constexpr max_tasks = 16;
+
+    struct scratch_file {
+        scratch_file(std::filesystem::path path):
+            path { std::move(path) },
+            fd { ::open(this->path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) }
+        {
+            if(fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "could not create " + this->path.string());
+            }
+        }
+
+        ~scratch_file() {
+            ::close(fd);
+            std::filesystem::remove(path);
+        }
+
+        std::filesystem::path path;
+        int fd;
+    };
+
+    auto rate(std::uint64_t bytes, std::chrono::nanoseconds elapsed) -> double {
+        return bytes * 1e9 / elapsed.count() / (1 << 30);
+    }
+
+    /**
+     * Write the object into shards and read it back, first with all shards and then with as many
+     * data shards missing as the code allows, a few times over, and report the best runs
+     */
+    auto measure(
+        shoc::ec_context &ctx,
+        shoc::device const &dev,
+        shoc::ec_stripe_config const &cfg,
+        std::filesystem::path const &root,
+        int object_fd,
+        int rounds
+    ) -> boost::cobalt::task<nlohmann::json> {
+        auto store = shoc::ec_stripe_store { ctx, dev, cfg };
+        auto shard_count = std::size_t { cfg.data_blocks } + cfg.rdnc_blocks;
+        auto restored = scratch_file { root / "restored" };
+
+        auto best_write = std::chrono::nanoseconds::max();
+        auto best_read = std::chrono::nanoseconds::max();
+        auto best_degraded = std::chrono::nanoseconds::max();
+        auto written = shoc::ec_stripe_stats {};
+        auto degraded = shoc::ec_stripe_stats {};
+
+        for(auto round = 0; round < rounds; ++round) {
+            {
+                auto shards = shoc::ec_shard_files::create(root, "object", shard_count);
+
+                auto start = std::chrono::steady_clock::now();
+                written = co_await store.write(object_fd, shards.fds());
+                best_write = std::min(best_write, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start));
+            }
+
+            {
+                auto shards = shoc::ec_shard_files::open(root, "object", shard_count);
+
+                auto start = std::chrono::steady_clock::now();
+                co_await store.read(shards.fds(), restored.fd);
+                best_read = std::min(best_read, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start));
+            }
+
+            // lose the first data shards, the worst case since all of their blocks are recovered
+            auto shards = shoc::ec_shard_files::open(root, "object", shard_count);
+            auto fds = std::vector<int>(shards.fds().begin(), shards.fds().end());
+            std::fill_n(fds.begin(), std::min(cfg.data_blocks, cfg.rdnc_blocks), -1);
+
+            auto start = std::chrono::steady_clock::now();
+            degraded = co_await store.read(fds, restored.fd);
+            best_degraded = std::min(best_degraded, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start));
+        }
+
+        auto result = nlohmann::json {};
+        result["stripes"] = written.stripes;
+        result["stripe_size"] = std::uint64_t { cfg.data_blocks } * cfg.block_size;
+        result["write"]["elapsed_us"] = best_write.count() / 1e3;
+        result["write"]["data_rate_gibps"] = rate(written.bytes_in, best_write);
+        result["write"]["shard_rate_gibps"] = rate(written.bytes_out, best_write);
+        result["read"]["elapsed_us"] = best_read.count() / 1e3;
+        result["read"]["data_rate_gibps"] = rate(written.bytes_in, best_read);
+        result["degraded_read"]["missing_shards"] = degraded.missing_shards;
+        result["degraded_read"]["elapsed_us"] = best_degraded.count() / 1e3;
+        result["degraded_read"]["data_rate_gibps"] = rate(written.bytes_in, best_degraded);
+        result["matrix_cache_hit_rate"] = store.matrix_cache_stats().hit_rate();
+
+        co_return result;
+    }
+
+    auto run_benchmark(
+        shoc::progress_engine_lease engine,
+        std::filesystem::path root,
+        std::size_t size,
+        std::vector<std::size_t> block_sizes,
+        shoc::ec_stripe_config cfg,
+        int rounds
+    ) -> boost::cobalt::detached try {
+        std::filesystem::create_directories(root);
+
+        auto object = scratch_file { root / "input" };
+
+        {
+            auto rng = std::mt19937_64 { 1 };
+            auto chunk = std::vector<std::uint64_t>(1 << 17);
+
+            for(auto done = std::size_t { 0 }; done < size; done += chunk.size() * sizeof chunk[0]) {
+                std::ranges::generate(chunk, rng);
+
+                auto length = std::min(size - done, chunk.size() * sizeof chunk[0]);
+
+                if(::pwrite(object.fd, chunk.data(), length, done) != static_cast<ssize_t>(length)) {
+                    throw std::system_error(errno, std::generic_category(), "could not write the input object");
+                }
+            }
+        }
+
+        auto dev = shoc::device::find(shoc::device_capability::erasure_coding);
+        auto ctx = co_await shoc::ec_context::create(engine, dev, max_tasks);
+
+        auto json = nlohmann::json {};
+        json["object_size"] = size;
+        json["data_blocks"] = cfg.data_blocks;
+        json["rdnc_blocks"] = cfg.rdnc_blocks;
+
+        for(auto block_size : block_sizes) {
+            cfg.block_size = block_size;
+            json["block_size"][std::to_string(block_size)] = co_await measure(*ctx, dev, cfg, root, object.fd, rounds);
+        }
+
+        for(auto i = std::size_t { 0 }; i < std::size_t { cfg.data_blocks } + cfg.rdnc_blocks; ++i) {
+            std::filesystem::remove_all(shoc::ec_shard_files::path(root, "object", i).parent_path());
+        }
+
+        co_await ctx->stop();
+
+        std::cout << json.dump(4) << std::endl;
+    } catch(shoc::doca_exception &ex) {
+        shoc::logger->error("ecode = {}, message = {}", static_cast<int>(ex.doca_error()), ex.what());
+    } catch(std::system_error &ex) {
+        shoc::logger->error("{}", ex.what());
+    }
+}
+
+auto co_main(
+    [[maybe_unused]] int argc,
+    [[maybe_unused]] char *argv[]
+) -> boost::cobalt::main {
+    shoc::set_sdk_log_level(DOCA_LOG_LEVEL_WARNING);
+    shoc::logger->set_level(spdlog::level::warn);
+
+    auto root = std::filesystem::temp_directory_path() / "shoc-ec-bench";
+    auto size = std::size_t { 256 } << 20;
+    auto block_sizes = std::vector<std::size_t> {};
+    auto cfg = shoc::ec_stripe_config {};
+    cfg.max_tasks = max_tasks;
+    auto rounds = 3;
+
+    for(auto arg : std::span { argv + 1, argv + argc }) {
+        auto view = std::string_view { arg };
+
+        if(view.starts_with("--dir=")) {
+            root = view.substr(6);
+        } else if(view.starts_with("--size-mib=")) {
+            size = std::stoull(std::string { view.substr(11) }) << 20;
+        } else if(view.starts_with("--block=")) {
+            block_sizes.push_back(std::stoull(std::string { view.substr(8) }));
+        } else if(view.starts_with("--data-blocks=")) {
+            cfg.data_blocks = std::stoul(std::string { view.substr(14) });
+        } else if(view.starts_with("--rdnc-blocks=")) {
+            cfg.rdnc_blocks = std::stoul(std::string { view.substr(14) });
+        } else if(view == "--io-uring") {
+            cfg.io = shoc::stream_io::io_uring;
+        } else if(view.starts_with("--rounds=")) {
+            rounds = std::stoi(std::string { view.substr(9) });
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--dir=PATH] [--size-mib=N] [--block=BYTES]... [--data-blocks=K] [--rdnc-blocks=M] [--io-uring] [--rounds=N]\n";
+            co_return -1;
+        }
+    }
+
+    if(block_sizes.empty()) {
+        block_sizes = { 4 << 10, 16 << 10, 64 << 10, 256 << 10, 1 << 20 };
+    }
+
+    auto engine = shoc::progress_engine{};
+
+    run_benchmark(&engine, root, size, std::move(block_sizes), cfg, rounds);
+
+    co_await engine.run();
+
+    co_return 0;
+}
@@ -0,0 +1,289 @@
+#include <shoc/cpu_erasure_coding.hpp>
+#include <shoc/device.hpp>
+#include <shoc/ec_stripe_store.hpp>
+#include <shoc/erasure_coding.hpp>
+#include <shoc/logger.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <boost/cobalt.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <doca_log.h>
+
+namespace {
+    std::uint32_t constexpr max_tasks = 16;
+
+    struct scratch_file {
+        scratch_file(std::filesystem::path path):
+            path { std::move(path) },
+            fd { ::open(this->path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) }
+        {
+            if(fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "could not create " + this->path.string());
+            }
+        }
+
+        ~scratch_file() {
+            ::close(fd);
+            std::filesystem::remove(path);
+        }
+
+        std::filesystem::path path;
+        int fd;
+    };
+
+    auto mode_name(shoc::ec_update_mode mode) -> char const * {
+        switch(mode) {
+            case shoc::ec_update_mode::automatic: return "automatic";
+            case shoc::ec_update_mode::delta: return "delta";
+            case shoc::ec_update_mode::full_stripe: return "full_stripe";
+        }
+
+        return "unknown";
+    }
+
+    /**
+     * Store the object, then overwrite it at random offsets, flushing every batch writes, and
+     * report what it took. The same seed gives every mode the same writes.
+     */
+    auto measure(
+        shoc::ec_backend &backend,
+        shoc::device const &dev,
+        shoc::ec_stripe_config const &cfg,
+        shoc::ec_update_mode mode,
+        std::filesystem::path const &root,
+        int object_fd,
+        std::size_t object_size,
+        std::size_t write_size,
+        std::size_t write_count,
+        std::size_t batch
+    ) -> boost::cobalt::task<nlohmann::json> {
+        auto shard_count = std::size_t { cfg.data_blocks } + cfg.rdnc_blocks;
+
+        {
+            auto store = shoc::ec_stripe_store { backend, dev, cfg };
+            auto shards = shoc::ec_shard_files::create(root, "object", shard_count);
+            co_await store.write(object_fd, shards.fds());
+        }
+
+        auto writer = shoc::ec_stripe_writer { backend, dev, cfg, mode };
+        auto shards = shoc::ec_shard_files::open(root, "object", shard_count, true);
+
+        auto rng = std::mt19937_64 { 1 };
+        auto offsets = std::uniform_int_distribution<std::size_t> { 0, object_size - write_size };
+        auto payload = std::vector<std::byte>(write_size);
+        auto total = shoc::ec_stripe_write_stats {};
+
+        auto start = std::chrono::steady_clock::now();
+
+        for(auto done = std::size_t { 0 }; done < write_count;) {
+            for(auto i = std::size_t { 0 }; i < batch && done < write_count; ++i, ++done) {
+                std::ranges::generate(payload, [&] { return static_cast<std::byte>(rng()); });
+                writer.write(offsets(rng), payload);
+            }
+
+            auto stats = co_await writer.flush(shards.fds());
+
+            total.writes += stats.writes;
+            total.stripes += stats.stripes;
+            total.delta_stripes += stats.delta_stripes;
+            total.full_stripes += stats.full_stripes;
+            total.bytes_in += stats.bytes_in;
+            total.bytes_out += stats.bytes_out;
+            total.coded_bytes += stats.coded_bytes;
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        auto result = nlohmann::json {};
+        result["writes"] = total.writes;
+        result["stripes"] = total.stripes;
+        result["delta_stripes"] = total.delta_stripes;
+        result["full_stripes"] = total.full_stripes;
+        result["elapsed_us"] = elapsed.count() / 1e3;
+        result["writes_per_s"] = total.writes * 1e9 / elapsed.count();
+        result["shard_bytes_in"] = total.bytes_in;
+        result["shard_bytes_out"] = total.bytes_out;
+        result["coded_bytes"] = total.coded_bytes;
+        result["matrix_cache_hit_rate"] = writer.matrix_cache_stats().hit_rate();
+
+        co_return result;
+    }
+
+    auto run_benchmark(
+        shoc::progress_engine_lease engine,
+        std::filesystem::path root,
+        std::size_t size,
+        std::vector<std::size_t> write_sizes,
+        std::size_t write_count,
+        std::size_t batch,
+        shoc::ec_stripe_config cfg,
+        bool software
+    ) -> boost::cobalt::detached try {
+        std::filesystem::create_directories(root);
+
+        auto object = scratch_file { root / "input" };
+
+        {
+            auto rng = std::mt19937_64 { 1 };
+            auto chunk = std::vector<std::uint64_t>(1 << 17);
+
+            for(auto done = std::size_t { 0 }; done < size; done += chunk.size() * sizeof chunk[0]) {
+                std::ranges::generate(chunk, rng);
+
+                auto length = std::min(size - done, chunk.size() * sizeof chunk[0]);
+
+                if(::pwrite(object.fd, chunk.data(), length, done) != static_cast<ssize_t>(length)) {
+                    throw std::system_error(errno, std::generic_category(), "could not write the input object");
+                }
+            }
+        }
+
+        auto dev = std::optional<shoc::device> {};
+        auto ctx = std::optional<shoc::shared_scoped_context<shoc::ec_context>> {};
+        auto cpu = std::optional<shoc::cpu_ec_backend> {};
+        shoc::ec_backend *backend;
+
+        if(software) {
+            // the software backend doesn't need the device, only memory maps for the buffers
+            dev = shoc::device::find(shoc::device_capability::dma);
+            backend = &cpu.emplace();
+        } else {
+            dev = shoc::device::find(shoc::device_capability::erasure_coding);
+            ctx = co_await shoc::ec_context::create(engine, *dev, max_tasks);
+            backend = &**ctx;
+        }
+
+        auto json = nlohmann::json {};
+        json["backend"] = software ? "software" : "hardware";
+        json["object_size"] = size;
+        json["data_blocks"] = cfg.data_blocks;
+        json["rdnc_blocks"] = cfg.rdnc_blocks;
+        json["block_size"] = cfg.block_size;
+        json["batch"] = batch;
+
+        // full_stripe first, as the baseline the others are compared with
+        auto modes = { shoc::ec_update_mode::full_stripe, shoc::ec_update_mode::delta, shoc::ec_update_mode::automatic };
+
+        for(auto write_size : write_sizes) {
+            auto name = std::to_string(write_size);
+            auto &results = json["write_size"][name];
+
+            for(auto mode : modes) {
+                auto result = co_await measure(*backend, *dev, cfg, mode, root, object.fd, size, write_size, write_count, batch);
+
+                if(mode != shoc::ec_update_mode::full_stripe) {
+                    auto const &baseline = results[mode_name(shoc::ec_update_mode::full_stripe)];
+                    auto shard_bytes = [](nlohmann::json const &r) {
+                        return r["shard_bytes_in"].get<double>() + r["shard_bytes_out"].get<double>();
+                    };
+
+                    result["shard_bytes_saved"] = 1.0 - shard_bytes(result) / shard_bytes(baseline);
+                    result["coded_bytes_saved"] = 1.0 - result["coded_bytes"].get<double>() / baseline["coded_bytes"].get<double>();
+                    result["speedup"] = baseline["elapsed_us"].get<double>() / result["elapsed_us"].get<double>();
+                }
+
+                results[mode_name(mode)] = std::move(result);
+            }
+        }
+
+        for(auto i = std::size_t { 0 }; i < std::size_t { cfg.data_blocks } + cfg.rdnc_blocks; ++i) {
+            std::filesystem::remove_all(shoc::ec_shard_files::path(root, "object", i).parent_path());
+        }
+
+        if(ctx) {
+            co_await (*ctx)->stop();
+        }
+
+        std::cout << json.dump(4) << std::endl;
+    } catch(shoc::doca_exception &ex) {
+        shoc::logger->error("ecode = {}, message = {}", static_cast<int>(ex.doca_error()), ex.what());
+    } catch(std::system_error &ex) {
+        shoc::logger->error("{}", ex.what());
+    }
+}
+
+auto co_main(
+    [[maybe_unused]] int argc,
+    [[maybe_unused]] char *argv[]
+) -> boost::cobalt::main {
+    shoc::set_sdk_log_level(DOCA_LOG_LEVEL_WARNING);
+    shoc::logger->set_level(spdlog::level::warn);
+
+    auto root = std::filesystem::temp_directory_path() / "shoc-ec-update-bench";
+    auto size = std::size_t { 64 } << 20;
+    auto write_sizes = std::vector<std::size_t> {};
+    auto write_count = std::size_t { 4096 };
+    auto batch = std::size_t { 64 };
+    auto cfg = shoc::ec_stripe_config {};
+    cfg.data_blocks = 8;
+    cfg.rdnc_blocks = 2;
+    cfg.max_tasks = max_tasks;
+    auto software = false;
+
+    for(auto arg : std::span { argv + 1, argv + argc }) {
+        auto view = std::string_view { arg };
+
+        if(view.starts_with("--dir=")) {
+            root = view.substr(6);
+        } else if(view.starts_with("--size-mib=")) {
+            size = std::stoull(std::string { view.substr(11) }) << 20;
+        } else if(view.starts_with("--write=")) {
+            write_sizes.push_back(std::stoull(std::string { view.substr(8) }));
+        } else if(view.starts_with("--writes=")) {
+            write_count = std::stoull(std::string { view.substr(9) });
+        } else if(view.starts_with("--batch=")) {
+            batch = std::stoull(std::string { view.substr(8) });
+        } else if(view.starts_with("--block=")) {
+            cfg.block_size = std::stoull(std::string { view.substr(8) });
+        } else if(view.starts_with("--data-blocks=")) {
+            cfg.data_blocks = std::stoul(std::string { view.substr(14) });
+        } else if(view.starts_with("--rdnc-blocks=")) {
+            cfg.rdnc_blocks = std::stoul(std::string { view.substr(14) });
+        } else if(view == "--route=software") {
+            software = true;
+        } else if(view == "--route=hardware") {
+            software = false;
+        } else if(view == "--io-uring") {
+            cfg.io = shoc::stream_io::io_uring;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--route=hardware|software] [--dir=PATH] [--size-mib=N] [--write=BYTES]... [--writes=N] [--batch=N] [--block=BYTES] [--data-blocks=K] [--rdnc-blocks=M] [--io-uring]\n";
+            co_return -1;
+        }
+    }
+
+    if(write_sizes.empty()) {
+        write_sizes = { 512, 4 << 10, 16 << 10, 64 << 10 };
+    }
+
+    if(batch == 0 || std::ranges::max(write_sizes) > size) {
+        std::cerr << "batch must be positive, and writes no larger than the object\n";
+        co_return -1;
+    }
+
+    auto engine = shoc::progress_engine{};
+
+    run_benchmark(&engine, root, size, std::move(write_sizes), write_count, batch, cfg, software);
+
+    co_await engine.run();
+
+    co_return 0;
+}
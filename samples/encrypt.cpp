@@ -1,6 +1,8 @@
 #include <shoc/aes_gcm.hpp>
+#include <shoc/aes_gcm_stream.hpp>
 #include <shoc/buffer.hpp>
 #include <shoc/buffer_inventory.hpp>
+#include <shoc/cpu_aes_gcm.hpp>
 #include <shoc/device.hpp>
 #include <shoc/logger.hpp>
 #include <shoc/memory_map.hpp>
@@ -11,9 +13,14 @@
 
 #include <boost/cobalt.hpp>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -52,6 +59,67 @@ auto encrypt(
     }
 }
 
+/**
+ * Encrypt the file in records of record_size bytes with per-record IVs, as described in
+ * shoc::aes_gcm_stream_format
+ */
+auto encrypt_stream(
+    shoc::progress_engine_lease engine,
+    std::string input_filename,
+    std::string output_filename,
+    std::span<std::byte const> keybytes,
+    std::uint64_t stream_id,
+    std::size_t record_size
+) -> boost::cobalt::detached {
+    auto dev = shoc::device {};
+    auto ctx = std::optional<shoc::shared_scoped_context<shoc::aes_gcm_context>> {};
+
+    try {
+        dev = shoc::device::find(shoc::device_capability::aes_gcm);
+        ctx = co_await shoc::aes_gcm_context::create(engine, dev, 16);
+    } catch(shoc::doca_exception &ex) {
+        if(ex.doca_error() != DOCA_ERROR_NOT_FOUND) {
+            throw;
+        }
+
+        // no crypto-enabled device: encrypt on the CPU, the device only maps the buffers
+        shoc::logger->info("no device with doca_aes_gcm, encrypting in software");
+        dev = shoc::device::find(shoc::device_capability::dma);
+    }
+
+    auto &backend = ctx
+        ? static_cast<shoc::aes_gcm_backend &>(**ctx)
+        : static_cast<shoc::aes_gcm_backend &>(*shoc::cpu_aes_gcm_backend::shared());
+
+    auto in_fd = ::open(input_filename.c_str(), O_RDONLY);
+    auto out_fd = ::open(output_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if(in_fd < 0 || out_fd < 0) {
+        shoc::logger->error("could not open input or output file");
+    } else {
+        auto cfg = shoc::aes_gcm_stream_config {};
+        cfg.record_size = record_size;
+
+        auto stream = shoc::aes_gcm_stream { dev, cfg };
+        auto key = backend.load_key(keybytes, keybytes.size() == 32 ? DOCA_AES_GCM_KEY_256 : DOCA_AES_GCM_KEY_128);
+        auto stats = co_await stream.encrypt(backend, key, stream_id, in_fd, out_fd);
+
+        shoc::logger->info("{} records, {} bytes in, {} bytes out", stats.records, stats.bytes_in, stats.bytes_out);
+    }
+
+    if(in_fd >= 0) {
+        ::close(in_fd);
+    }
+
+    if(out_fd >= 0) {
+        ::close(out_fd);
+    }
+
+    if(ctx) {
+        co_await (*ctx)->stop();
+    }
+}
+
 auto co_main(
     int argc,
     char *argv[]
@@ -63,6 +131,9 @@ auto co_main(
         ("i,input", "input file", cxxopts::value<std::string>())
         ("o,output", "output file", cxxopts::value<std::string>())
         ("iv", "init vector (hex)", cxxopts::value<std::string>()->default_value(""))
+        ("s,stream", "encrypt in framed records with per-record IVs instead of one IV for everything")
+        ("record-size", "plaintext bytes per record with --stream", cxxopts::value<std::size_t>()->default_value("1048576"))
+        ("stream-id", "with --stream, ID of the stream; must never be used twice with the same key", cxxopts::value<std::uint64_t>())
         ;
 
     auto cmdline = options.parse(argc, argv);
@@ -74,6 +145,27 @@ auto co_main(
         co_return -1;
     }
 
+    auto engine = shoc::progress_engine {};
+
+    if(cmdline.count("stream") > 0) {
+        if(cmdline.count("stream-id") == 0) {
+            shoc::logger->error("--stream needs a --stream-id that is unique for the key");
+            co_return -1;
+        }
+
+        encrypt_stream(
+            &engine,
+            cmdline["input"].as<std::string>(),
+            cmdline["output"].as<std::string>(),
+            std::as_bytes(std::span{key}),
+            cmdline["stream-id"].as<std::uint64_t>(),
+            cmdline["record-size"].as<std::size_t>()
+        );
+
+        co_await engine.run();
+        co_return 0;
+    }
+
     if(iv.size() == 0) {
         iv.resize(key.size(), std::uint8_t{0});
     } else if(iv.size() != key.size()) {
@@ -81,8 +173,6 @@ auto co_main(
         co_return -1;
     }
 
-    auto engine = shoc::progress_engine {};
-
     encrypt(
         &engine,
         cmdline["input"].as<std::string>(),
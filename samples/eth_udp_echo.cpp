@@ -32,10 +32,11 @@ auto handle_packets(
 ) -> boost::cobalt::promise<void> try {
     for(;;) {
         auto buf = co_await rss->receive();
+        auto view = buf.view();
 
-        std::cout << cppcodec::hex_lower::encode(buf.data()) << '\n';
+        std::cout << cppcodec::hex_lower::encode(view.data()) << '\n';
 
-        auto frame = reinterpret_cast<shoc::eth_frame*>(buf.data().data());
+        auto frame = reinterpret_cast<shoc::eth_frame*>(view.data().data());
         auto packet = frame->ipv4_payload();
         auto segment = packet->udp_payload();
 
@@ -70,7 +71,7 @@ auto handle_packets(
             packet->header_checksum(),
             segment->checksum()
         );
-        std::cout << cppcodec::hex_lower::encode(buf.data()) << '\n';
+        std::cout << cppcodec::hex_lower::encode(view.data()) << '\n';
     }
 } catch(shoc::doca_exception &e) {
     shoc::logger->info("stopped handling packets: {}", e.what());
@@ -116,7 +117,7 @@ auto partial_tap(
         .enable_timestamp = false
     };
 
-    auto packet_memory = shoc::aligned_memory { 1 << 28 };
+    auto packet_memory = shoc::aligned_memory { 1 << 28, shoc::memory_policy::hugepages() };
     auto packet_mmap = shoc::memory_map { dev, packet_memory.as_writable_bytes(), DOCA_ACCESS_FLAG_LOCAL_READ_WRITE };
     auto packet_buffer = shoc::eth_rxq_packet_buffer { packet_mmap, 0, static_cast<std::uint32_t>(packet_memory.as_bytes().size()) };
 
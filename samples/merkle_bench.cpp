@@ -0,0 +1,165 @@
+#include <shoc/aligned_memory.hpp>
+#include <shoc/device.hpp>
+#include <shoc/logger.hpp>
+#include <shoc/merkle_hasher.hpp>
+#include <shoc/progress_engine.hpp>
+#include <shoc/sha.hpp>
+
+#include <boost/cobalt.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/core.h>
+#include <nlohmann/json.hpp>
+
+#include <doca_log.h>
+
+namespace {
+    std::uint32_t constexpr max_tasks = 16;
+
+    /**
+     * Hash the data a few times over and report the best run
+     */
+    auto measure(
+        shoc::merkle_hasher &hasher,
+        std::span<std::byte const> data,
+        int rounds
+    ) -> boost::cobalt::task<nlohmann::json> {
+        auto best = std::chrono::nanoseconds::max();
+        auto tree = shoc::merkle_tree {};
+
+        for(auto i = 0; i < rounds; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            tree = co_await hasher.hash(data);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+        }
+
+        auto root = std::string {};
+
+        for(auto b : tree.root().data()) {
+            root += fmt::format("{:02x}", static_cast<unsigned>(b));
+        }
+
+        auto result = nlohmann::json {};
+        result["leaves"] = tree.leaf_count;
+        result["elapsed_us"] = best.count() / 1e3;
+        result["data_rate_gibps"] = data.size() * 1e9 / best.count() / (1 << 30);
+        result["root"] = root;
+
+        co_return result;
+    }
+
+    auto run_benchmark(
+        shoc::progress_engine_lease engine,
+        std::size_t size,
+        std::vector<std::size_t> leaf_sizes,
+        std::string route,
+        int rounds
+    ) -> boost::cobalt::detached try {
+        auto data = shoc::aligned_memory { size };
+        auto rng = std::mt19937_64 { 1 };
+
+        for(auto &b : data.as_writable_bytes()) {
+            b = static_cast<std::byte>(rng());
+        }
+
+        auto json = nlohmann::json {};
+        auto dev = std::optional<shoc::device> {};
+        auto ctx = std::optional<shoc::shared_scoped_context<shoc::sha_context>> {};
+
+        if(route == "hardware" || route == "compare") {
+            try {
+                dev = shoc::device::find(shoc::device_capability::sha);
+                ctx = co_await shoc::sha_context::create(engine, *dev, max_tasks);
+            } catch(shoc::doca_exception &ex) {
+                if(ex.doca_error() != DOCA_ERROR_NOT_FOUND) {
+                    throw;
+                }
+
+                json["hardware"]["error"] = "no device with doca_sha";
+            }
+        }
+
+        for(auto leaf_size : leaf_sizes) {
+            auto cfg = shoc::merkle_config {};
+            cfg.leaf_size = leaf_size;
+            cfg.max_tasks = max_tasks;
+
+            auto key = std::to_string(leaf_size);
+
+            if(ctx) {
+                auto hasher = shoc::merkle_hasher { **ctx, *dev, cfg };
+
+                if(hasher.on_device()) {
+                    json["hardware"][key] = co_await measure(hasher, data.as_bytes(), rounds);
+                } else {
+                    json["hardware"][key]["error"] = "device can't hash with SHA-256";
+                }
+            }
+
+            if(route == "software" || route == "compare") {
+                auto hasher = shoc::merkle_hasher { cfg };
+                json["software"][key] = co_await measure(hasher, data.as_bytes(), rounds);
+            }
+        }
+
+        if(ctx) {
+            co_await (*ctx)->stop();
+        }
+
+        std::cout << json.dump(4) << std::endl;
+    } catch(shoc::doca_exception &ex) {
+        shoc::logger->error("ecode = {}, message = {}", static_cast<int>(ex.doca_error()), ex.what());
+    }
+}
+
+auto co_main(
+    [[maybe_unused]] int argc,
+    [[maybe_unused]] char *argv[]
+) -> boost::cobalt::main {
+    shoc::set_sdk_log_level(DOCA_LOG_LEVEL_WARNING);
+    shoc::logger->set_level(spdlog::level::warn);
+
+    auto size = std::size_t { 256 } << 20;
+    auto leaf_sizes = std::vector<std::size_t> {};
+    auto route = std::string { "compare" };
+    auto rounds = 3;
+
+    for(auto arg : std::span { argv + 1, argv + argc }) {
+        auto view = std::string_view { arg };
+
+        if(view.starts_with("--route=")) {
+            route = view.substr(8);
+        } else if(view.starts_with("--size-mib=")) {
+            size = std::stoull(std::string { view.substr(11) }) << 20;
+        } else if(view.starts_with("--leaf=")) {
+            leaf_sizes.push_back(std::stoull(std::string { view.substr(7) }));
+        } else if(view.starts_with("--rounds=")) {
+            rounds = std::stoi(std::string { view.substr(9) });
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--route=hardware|software|compare] [--size-mib=N] [--leaf=BYTES]... [--rounds=N]\n";
+            co_return -1;
+        }
+    }
+
+    if(leaf_sizes.empty()) {
+        leaf_sizes = { 4 << 10, 16 << 10, 64 << 10, 256 << 10, 1 << 20 };
+    }
+
+    auto engine = shoc::progress_engine{};
+
+    run_benchmark(&engine, size, std::move(leaf_sizes), route, rounds);
+
+    co_await engine.run();
+
+    co_return 0;
+}
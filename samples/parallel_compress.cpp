@@ -1,6 +1,8 @@
 #include <shoc/aligned_memory.hpp>
 #include <shoc/buffer_inventory.hpp>
 #include <shoc/compress.hpp>
+#include <shoc/hybrid_compress.hpp>
+#include <shoc/coro/combinators.hpp>
 #include <shoc/logger.hpp>
 #include <shoc/memory_map.hpp>
 #include <shoc/progress_engine.hpp>
@@ -8,24 +10,73 @@
 #include <boost/cobalt.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <fmt/core.h>
 #include <nlohmann/json.hpp>
 
 #include <doca_log.h>
 
+/**
+ * Compress all batches with up to parallelism tasks in flight
+ *
+ * @return time taken
+ */
+template<std::uint32_t parallelism>
+auto compress_batches(
+    shoc::compress_backend &compress,
+    shoc::buffer_array &src_buffers,
+    shoc::buffer_array &dst_buffers
+) -> boost::cobalt::task<std::chrono::nanoseconds> {
+    for(auto &buf : dst_buffers) {
+        buf.set_data(0);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // keeps parallelism tasks in flight and frees whichever slot completes first, so a slow
+    // chunk does not hold up the submission of the next ones.
+    shoc::coro::bounded_inflight<shoc::compress_awaitable, parallelism> inflight;
+
+    for(auto i : std::ranges::views::iota(std::size_t { 0 }, src_buffers.size())) {
+        if(inflight.full()) {
+            auto done = co_await inflight.next();
+            shoc::logger->info("chunk in slot {} done: {}", done.slot, doca_error_get_descr(done.value));
+        }
+
+        inflight.push(compress.compress(src_buffers[i], dst_buffers[i]));
+    }
+
+    shoc::logger->info("waiting for final chunks...");
+
+    while(!inflight.empty()) {
+        co_await inflight.next();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    co_return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+}
+
 auto compress_file(
     shoc::progress_engine_lease engine,
     std::istream &in,
-    std::ostream &out
+    std::ostream &out,
+    std::string route
 ) -> boost::cobalt::detached {
     std::uint32_t batches;
     std::uint32_t batchsize;
-    std::uint32_t const parallelism = 4;
+    std::uint32_t constexpr parallelism = 4;
+    std::uint32_t constexpr hybrid_software_inflight = 8;
 
     in.read(reinterpret_cast<char *>(&batches), sizeof batches);
     in.read(reinterpret_cast<char *>(&batchsize), sizeof batchsize);
@@ -45,50 +96,61 @@ auto compress_file(
     auto mmap_dst = shoc::memory_map { dev, dst_data };
     auto buf_inv = shoc::buffer_inventory { batches * 2 };
 
-    auto src_buffers = std::vector<shoc::buffer>{};
-    auto dst_buffers = std::vector<shoc::buffer>{};
+    auto src_buffers = buf_inv.buf_get_blocks_by_data(mmap_src, src_blocks);
+    auto dst_buffers = buf_inv.buf_get_blocks(mmap_dst, dst_blocks);
+
+    auto compress = co_await shoc::compress_context::create(engine, dev, parallelism);
 
-    src_buffers.reserve(batches);
-    dst_buffers.reserve(batches);
+    // with "compare", the same data is compressed once on each route and then on both at once
+    auto routes = std::vector<std::pair<std::string, shoc::compress_route>> {};
 
-    for(auto i : std::ranges::views::iota(0u, batches)) {
-        src_buffers.push_back(buf_inv.buf_get_by_data(mmap_src, src_blocks.block(i)));
-        dst_buffers.push_back(buf_inv.buf_get_by_addr(mmap_dst, dst_blocks.block(i)));
+    if(route == "hardware" || route == "compare") {
+        routes.emplace_back("hardware", shoc::compress_route::hardware);
     }
 
-    auto compress = co_await shoc::compress_context::create(engine, dev, parallelism);
+    if(route == "software" || route == "compare") {
+        routes.emplace_back("software", shoc::compress_route::software);
+    }
 
-    auto start = std::chrono::steady_clock::now();
+    if(routes.empty() && route != "hybrid") {
+        routes.emplace_back("automatic", shoc::compress_route::automatic);
+    }
 
-    std::array<shoc::compress_awaitable, parallelism> waiters;
+    auto json = nlohmann::json{};
 
-    for(auto i : std::ranges::views::iota(0u, batches)) {
-        auto waiter_index = i % parallelism;
-        auto &waiter = waiters[waiter_index];
+    for(auto &[name, chosen] : routes) {
+        compress->set_route(shoc::compress_operation::compress_deflate, chosen);
 
-        if(i >= parallelism) {
-            shoc::logger->info("waiting for chunk {}", i - parallelism);
-            co_await waiter;
-        }
+        auto elapsed_ns = co_await compress_batches<parallelism>(*compress, src_buffers, dst_buffers);
+        auto data_rate = filesize * 1e9 / elapsed_ns.count() / (1 << 30);
 
-        waiter = compress->compress(src_buffers[i], dst_buffers[i]);
+        json[name]["elapsed_us"] = elapsed_ns.count() / 1e3;
+        json[name]["data_rate_gibps"] = data_rate;
     }
 
-    for(auto &waiter: waiters) {
-        shoc::logger->info("waiting for final chunks...");
-        co_await waiter;
-    }
+    if(route == "hybrid" || route == "compare") {
+        compress->set_route(shoc::compress_operation::compress_deflate, shoc::compress_route::automatic);
 
-    auto end = std::chrono::steady_clock::now();
+        auto cfg = shoc::hybrid_compress_config {};
+        cfg.hardware_max_inflight = parallelism;
+        cfg.software_max_inflight = hybrid_software_inflight;
 
-    co_await compress->stop();
+        // device and CPU share the work, so there have to be enough tasks in flight for both
+        auto hybrid = shoc::hybrid_compress_scheduler { *compress, nullptr, cfg };
+        auto elapsed_ns = co_await compress_batches<parallelism + hybrid_software_inflight>(hybrid, src_buffers, dst_buffers);
+        auto stats = hybrid.stats();
 
-    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
-    auto data_rate = filesize * 1e9 / elapsed_ns.count() / (1 << 30);
+        json["hybrid"]["elapsed_us"] = elapsed_ns.count() / 1e3;
+        json["hybrid"]["data_rate_gibps"] = filesize * 1e9 / elapsed_ns.count() / (1 << 30);
 
-    auto json = nlohmann::json{};
-    json["elapsed_us"] = elapsed_ns.count() / 1e3;
-    json["data_rate_gibps"] = data_rate;
+        for(auto [name, path] : { std::pair { "hardware", stats.hardware }, std::pair { "software", stats.software } }) {
+            json["hybrid"][name]["tasks"] = path.tasks;
+            json["hybrid"][name]["bytes"] = path.bytes;
+            json["hybrid"][name]["data_rate_gibps"] = path.throughput() / (1 << 30);
+        }
+    }
+
+    co_await compress->stop();
 
     std::cout << json.dump(4) << std::endl;
 
@@ -113,17 +175,30 @@ auto co_main(
     shoc::set_sdk_log_level(DOCA_LOG_LEVEL_WARNING);
     shoc::logger->set_level(spdlog::level::warn);
 
-    if(argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " INFILE [OUTFILE]\n";
+    auto files = std::vector<std::string_view> {};
+    auto route = std::string { "automatic" };
+
+    for(auto arg : std::span { argv + 1, argv + argc }) {
+        auto view = std::string_view { arg };
+
+        if(view.starts_with("--route=")) {
+            route = view.substr(8);
+        } else {
+            files.push_back(view);
+        }
+    }
+
+    if(files.empty()) {
+        std::cerr << "Usage: " << argv[0] << " INFILE [OUTFILE] [--route=automatic|hardware|software|hybrid|compare]\n";
         co_return -1;
     }
 
-    auto in  = std::ifstream(argv[1], std::ios::binary);
-    auto out = argc < 2 ? std::ofstream{} : std::ofstream(argv[2], std::ios::binary);
+    auto in  = std::ifstream(std::string { files[0] }, std::ios::binary);
+    auto out = files.size() < 2 ? std::ofstream{} : std::ofstream(std::string { files[1] }, std::ios::binary);
 
     auto engine = shoc::progress_engine{};
 
-    compress_file(&engine, in, out);
+    compress_file(&engine, in, out, route);
 
     co_await engine.run();
 } catch(shoc::doca_exception &ex) {
@@ -0,0 +1,84 @@
+#include <shoc/compress.hpp>
+#include <shoc/compress_stream.hpp>
+#include <shoc/logger.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <boost/cobalt.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+#include <doca_log.h>
+
+auto compress_file(
+    shoc::progress_engine_lease engine,
+    int in_fd,
+    int out_fd,
+    shoc::compress_stream_config cfg
+) -> boost::cobalt::detached try {
+    auto dev = shoc::device::find(shoc::device_capability::compress_deflate);
+    auto compress = co_await shoc::compress_context::create(engine, dev, cfg.max_tasks);
+    auto stream = shoc::compress_stream { dev, cfg };
+
+    auto start = std::chrono::steady_clock::now();
+    auto stats = co_await stream.run(*compress, in_fd, out_fd);
+    auto end = std::chrono::steady_clock::now();
+
+    co_await compress->stop();
+
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+
+    auto json = nlohmann::json{};
+    json["elapsed_us"] = elapsed_ns.count() / 1e3;
+    json["data_rate_gibps"] = stats.bytes_in * 1e9 / elapsed_ns.count() / (1 << 30);
+    json["chunks"] = stats.chunks;
+    json["bytes_in"] = stats.bytes_in;
+    json["bytes_out"] = stats.bytes_out;
+
+    std::cout << json.dump(4) << std::endl;
+} catch(std::exception &e) {
+    shoc::logger->error("compression failed: {}", e.what());
+}
+
+auto co_main(
+    [[maybe_unused]] int argc,
+    [[maybe_unused]] char *argv[]
+) -> boost::cobalt::main {
+    shoc::set_sdk_log_level(DOCA_LOG_LEVEL_WARNING);
+    shoc::logger->set_level(spdlog::level::warn);
+
+    if(argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " INFILE OUTFILE [--io-uring]\n";
+        co_return -1;
+    }
+
+    auto in_fd = open(argv[1], O_RDONLY);
+    auto out_fd = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if(in_fd < 0 || out_fd < 0) {
+        std::cerr << "cannot open files: " << std::strerror(errno) << '\n';
+        co_return -1;
+    }
+
+    auto cfg = shoc::compress_stream_config {};
+
+    if(argc > 3 && std::string_view { argv[3] } == "--io-uring") {
+        cfg.io = shoc::stream_io::io_uring;
+    }
+
+    auto engine = shoc::progress_engine{};
+
+    compress_file(&engine, in_fd, out_fd, cfg);
+
+    co_await engine.run();
+
+    close(in_fd);
+    close(out_fd);
+}
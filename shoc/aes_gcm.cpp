@@ -1,8 +1,14 @@
 #include "aes_gcm.hpp"
 
+#include "cpu_aes_gcm.hpp"
 #include "error.hpp"
+#include "logger.hpp"
 #include "progress_engine.hpp"
 
+#include <openssl/crypto.h>
+
+#include <algorithm>
+
 namespace shoc {
     namespace {
         auto expected_key_size(doca_aes_gcm_key_type key_type) -> std::size_t {
@@ -22,19 +28,28 @@ namespace shoc {
         std::span<std::byte const> key_data,
         doca_aes_gcm_key_type key_type
     ):
-        parent_ { parent }
+        key_type_ { key_type }
     {
-        doca_aes_gcm_key *key;
-
         enforce(expected_key_size(key_type) == key_data.size(), DOCA_ERROR_INVALID_VALUE);
 
-        enforce_success(doca_aes_gcm_key_create(
-            parent->handle(),
-            key_data.data(),
-            key_type,
-            &key
-        ));
-        handle_.reset(key);
+        if(parent != nullptr) {
+            doca_aes_gcm_key *key;
+
+            enforce_success(doca_aes_gcm_key_create(
+                parent->handle(),
+                key_data.data(),
+                key_type,
+                &key
+            ));
+            handle_.reset(key);
+            parent_ = parent;
+        }
+
+        // a key that can only ever be used on the device doesn't keep a copy of its bytes
+        if(parent == nullptr || parent->keeps_key_material()) {
+            std::ranges::copy(key_data, material_.begin());
+            material_size_ = key_data.size();
+        }
     }
 
     aes_gcm_key::aes_gcm_key(aes_gcm_key &&other) noexcept {
@@ -42,8 +57,18 @@ namespace shoc {
     }
 
     aes_gcm_key &aes_gcm_key::operator=(aes_gcm_key &&other) noexcept {
-        handle_ = std::move(other.handle_);
-        parent_ = std::exchange(other.parent_, nullptr);
+        if(this != &other) {
+            clear();
+
+            handle_ = std::move(other.handle_);
+            parent_ = std::exchange(other.parent_, nullptr);
+            material_ = other.material_;
+            material_size_ = std::exchange(other.material_size_, 0);
+            key_type_ = other.key_type_;
+
+            OPENSSL_cleanse(other.material_.data(), other.material_.size());
+        }
+
         return *this;
     }
 
@@ -52,6 +77,11 @@ namespace shoc {
     }
 
     auto aes_gcm_key::clear() -> void {
+        if(material_size_ != 0) {
+            OPENSSL_cleanse(material_.data(), material_.size());
+            material_size_ = 0;
+        }
+
         if(handle_.get() != nullptr) {
             handle_.reset(nullptr);
 
@@ -64,14 +94,32 @@ namespace shoc {
     aes_gcm_context::aes_gcm_context(
         context_parent *parent,
         device dev,
-        std::uint32_t num_tasks
+        std::uint32_t num_tasks,
+        std::shared_ptr<aes_gcm_backend> software
     ):
         context {
             parent,
             context::create_doca_handle<doca_aes_gcm_create>(dev.handle())
         },
-        dev_ { std::move(dev) }
+        dev_ { std::move(dev) },
+        software_ { std::move(software) }
     {
+        auto devinfo = dev_.as_devinfo();
+
+        hardware_supported_ =
+            doca_aes_gcm_cap_task_encrypt_is_supported(devinfo) == DOCA_SUCCESS
+            && doca_aes_gcm_cap_task_decrypt_is_supported(devinfo) == DOCA_SUCCESS;
+
+        if(!hardware_supported_) {
+            logger->info("aes_gcm_context: device doesn't support AES-GCM tasks, they run in software");
+
+            if(software_ == nullptr) {
+                software_ = cpu_aes_gcm_backend::shared();
+            }
+
+            return;
+        }
+
         enforce_success(doca_aes_gcm_task_encrypt_set_conf(
             handle(),
             plain_status_callback<doca_aes_gcm_task_encrypt_as_task>,
@@ -85,12 +133,57 @@ namespace shoc {
             plain_status_callback<doca_aes_gcm_task_decrypt_as_task>,
             num_tasks
         ));
+
+        reserve_receptables<coro::status_awaitable<>::payload_type>(2 * num_tasks);
+    }
+
+    auto aes_gcm_context::set_route(aes_gcm_route route) -> void {
+        if(route != aes_gcm_route::hardware && software_ == nullptr) {
+            software_ = cpu_aes_gcm_backend::shared();
+        }
+
+        route_ = route;
+    }
+
+    auto aes_gcm_context::set_software_threshold(std::size_t bytes) -> void {
+        if(bytes > 0 && software_ == nullptr) {
+            software_ = cpu_aes_gcm_backend::shared();
+        }
+
+        software_threshold_ = bytes;
+    }
+
+    auto aes_gcm_context::runs_on_device(buffer const &input, aes_gcm_key const &key) const -> bool {
+        switch(route_) {
+            case aes_gcm_route::hardware:
+                return true;
+            case aes_gcm_route::software:
+                return false;
+            case aes_gcm_route::automatic:
+                break;
+        }
+
+        // keys loaded while the device wasn't used have no device handle, keys loaded while
+        // everything went to the device have no raw bytes
+        return hardware_supported_
+            && key.handle() != nullptr
+            && (software_threshold_ == 0 || input.data().size() >= software_threshold_ || key.material().empty());
+    }
+
+    auto aes_gcm_context::keeps_key_material() const noexcept -> bool {
+        return !hardware_supported_
+            || route_ == aes_gcm_route::software
+            || (route_ == aes_gcm_route::automatic && software_threshold_ > 0);
     }
 
     auto aes_gcm_context::load_key(
         std::span<std::byte const> key_bytes,
         doca_aes_gcm_key_type key_type
     ) -> aes_gcm_key {
+        if(!hardware_supported_) {
+            return aes_gcm_key { nullptr, key_bytes, key_type };
+        }
+
         auto key = aes_gcm_key { this, key_bytes, key_type };
         ++loaded_keys_;
         return key;
@@ -135,6 +228,19 @@ namespace shoc {
         std::uint32_t tag_size,
         std::uint32_t aad_size
     ) -> coro::status_awaitable<> {
+        // software_ is set whenever anything can be routed away from the device
+        if(!runs_on_device(plaintext, key)) {
+            if(key.handle() != nullptr && key.material().empty()) {
+                return coro::status_awaitable<>::from_value(DOCA_ERROR_NOT_SUPPORTED);
+            }
+
+            return software_->encrypt(std::move(plaintext), std::move(dest), key, iv, tag_size, aad_size);
+        }
+
+        if(!hardware_supported_ || key.handle() == nullptr) {
+            return coro::status_awaitable<>::from_value(DOCA_ERROR_NOT_SUPPORTED);
+        }
+
         return detail::plain_status_offload<
             doca_aes_gcm_task_encrypt_alloc_init,
             doca_aes_gcm_task_encrypt_as_task
@@ -159,6 +265,19 @@ namespace shoc {
         std::uint32_t tag_size,
         std::uint32_t aad_size
     ) -> coro::status_awaitable<> {
+        // software_ is set whenever anything can be routed away from the device
+        if(!runs_on_device(encrypted, key)) {
+            if(key.handle() != nullptr && key.material().empty()) {
+                return coro::status_awaitable<>::from_value(DOCA_ERROR_NOT_SUPPORTED);
+            }
+
+            return software_->decrypt(std::move(encrypted), std::move(dest), key, iv, tag_size, aad_size);
+        }
+
+        if(!hardware_supported_ || key.handle() == nullptr) {
+            return coro::status_awaitable<>::from_value(DOCA_ERROR_NOT_SUPPORTED);
+        }
+
         return detail::plain_status_offload<
             doca_aes_gcm_task_decrypt_alloc_init,
             doca_aes_gcm_task_decrypt_as_task
@@ -9,7 +9,10 @@
 
 #include <doca_aes_gcm.h>
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <span>
 
 /**
@@ -17,10 +20,16 @@
  */
 namespace shoc {
     class aes_gcm_context;
+    class cpu_aes_gcm_backend;
 
     /**
-     * Handle to a loaded key. Must be created through a aes_gcm_context because we need to clean
+     * Handle to a loaded key. Must be created through an aes_gcm_backend because we need to clean
      * up the keys before we stop the context, and so the context has to know its keys.
+     *
+     * Besides the DOCA key object (if the key was loaded into a device), the key keeps its raw
+     * bytes if its operations may run on a software backend, so that they can be routed either
+     * way with the same key. Keys loaded into a context that sends everything to the device don't
+     * keep them. The bytes are wiped when the key is cleared.
      */
     class aes_gcm_key {
     public:
@@ -30,18 +39,35 @@ namespace shoc {
         ~aes_gcm_key();
 
         /**
-         * @return plain-DOCA handle to the loaded key. For internal use. In particular,
-         * don't modify the key through this handle, or we may end up in unexpected states.
+         * @return plain-DOCA handle to the loaded key, nullptr if the key was only loaded for
+         * software. For internal use. In particular, don't modify the key through this handle, or
+         * we may end up in unexpected states.
          */
         [[nodiscard]] auto handle() const noexcept {
             return handle_.get();
         }
 
+        /**
+         * @return raw key bytes, empty if there is no key or it can only be used on the device.
+         * For internal use by software backends.
+         */
+        [[nodiscard]] auto material() const noexcept -> std::span<std::byte const> {
+            return std::span { material_ }.first(material_size_);
+        }
+
+        [[nodiscard]] auto key_type() const noexcept {
+            return key_type_;
+        }
+
         auto clear() -> void;
 
     private:
         friend class aes_gcm_context;
+        friend class cpu_aes_gcm_backend;
 
+        /**
+         * @param parent context to load the key into, or nullptr to only keep it for software
+         */
         aes_gcm_key(
             aes_gcm_context *parent,
             std::span<std::byte const> key_data,
@@ -50,37 +76,160 @@ namespace shoc {
 
         unique_handle<doca_aes_gcm_key, doca_aes_gcm_key_destroy> handle_;
         aes_gcm_context *parent_ = nullptr;
+        std::array<std::byte, 32> material_ {};
+        std::size_t material_size_ = 0;
+        doca_aes_gcm_key_type key_type_ = DOCA_AES_GCM_KEY_256;
+    };
+
+    /**
+     * Where aes_gcm_context runs an operation
+     */
+    enum class aes_gcm_route {
+        /// on the device if it supports the task and the buffer isn't below the software
+        /// threshold, otherwise in software
+        automatic,
+        /// always on the device; fails with DOCA_ERROR_NOT_SUPPORTED if the device can't do it
+        hardware,
+        /// always in software
+        software
+    };
+
+    /**
+     * Interface of everything that encrypts and decrypts buffers with AES-GCM: aes_gcm_context on
+     * a crypto-enabled device and cpu_aes_gcm_backend on the host's cores. Code that takes an
+     * aes_gcm_backend & runs on either. Keys must be loaded through the backend (or context) that
+     * uses them; keys of an aes_gcm_context that keep their bytes (see aes_gcm_key) also work
+     * with any software backend.
+     */
+    class aes_gcm_backend {
+    public:
+        virtual ~aes_gcm_backend() = default;
+
+        /**
+         * Load a crypto key from raw bytes
+         *
+         * @param key_data key bytes
+         * @param key_type type of the key (128 bit or 256 bit)
+         */
+        [[nodiscard]] virtual auto load_key(
+            std::span<std::byte const> key_data,
+            doca_aes_gcm_key_type key_type
+        ) -> aes_gcm_key = 0;
+
+        /**
+         * Encrypt a data buffer with AES-GCM.
+         *
+         * @param plaintext input buffer with plaintext. First aad_size bytes are considered AAD and only authenticated, not encrypted.
+         * @param dest output buffer for cryptotext, needs to be at least as big as plaintext plus space for tag
+         * @param key key to use for encryption
+         * @param iv initialisation vector for the GCM cipher mode
+         * @param tag_size size of the authentication tag, either 12 or 16 bytes
+         * @param aad_size size of the additional authenticated data at the beginning of plaintext in bytes.
+         */
+        [[nodiscard]] virtual auto encrypt(
+            buffer plaintext,
+            buffer dest,
+            aes_gcm_key const &key,
+            std::span<std::byte const> iv,
+            std::uint32_t tag_size,
+            std::uint32_t aad_size = 0
+        ) -> coro::status_awaitable<> = 0;
+
+        /**
+         * Decrypt a data buffer with AES-GCM
+         *
+         * @param encrypted input buffer with ciphertext (except for the first aad_size bytes, which are considered AAD)
+         * @param dest output buffer for plaintext, needs to be as big as encrypted minus tag_size
+         * @param key key to use for decryption
+         * @param iv initialisation vector for the GCM cipher mode
+         * @param tag_size size of the authentication tag (12 or 16 bytes)
+         * @param aad_size size of the additional authenticated data at the beginning of encrypted a in bytes
+         */
+        [[nodiscard]] virtual auto decrypt(
+            buffer encrypted,
+            buffer dest,
+            aes_gcm_key const &key,
+            std::span<std::byte const> iv,
+            std::uint32_t tag_size,
+            std::uint32_t aad_size = 0
+        ) -> coro::status_awaitable<> = 0;
     };
 
     /**
      * Context for AES-GCM operations on crypto-enabled Bluefields.
+     *
+     * Operations the device can't run (e.g. on a crypto-disabled BlueField, where the tasks aren't
+     * supported) run on a software backend instead, by default the shared cpu_aes_gcm_backend.
+     * The route can be forced with set_route, and small buffers, for which the offload round trip
+     * costs more than it saves, can be sent to software with set_software_threshold.
      */
     class aes_gcm_context:
         public context<
             doca_aes_gcm,
             doca_aes_gcm_destroy,
             doca_aes_gcm_as_ctx
-        >
+        >,
+        public aes_gcm_backend
     {
     public:
         aes_gcm_context(
             context_parent *parent,
             device dev,
-            std::uint32_t num_tasks
+            std::uint32_t num_tasks,
+            std::shared_ptr<aes_gcm_backend> software
         );
 
+        /**
+         * @param engine engine that processes the completion events
+         * @param dev device on which the submitted tasks will run
+         * @param num_tasks maximum number of tasks in flight per task type
+         * @param software backend for operations that don't run on the device, the shared
+         *                 cpu_aes_gcm_backend if nullptr
+         */
         [[nodiscard]] static auto create(
             progress_engine_lease &engine,
             device dev,
-            std::uint32_t num_tasks
+            std::uint32_t num_tasks,
+            std::shared_ptr<aes_gcm_backend> software = nullptr
         ) {
-            return engine.create_context<aes_gcm_context>(std::move(dev), num_tasks);
+            return engine.create_context<aes_gcm_context>(std::move(dev), num_tasks, std::move(software));
         }
 
         [[nodiscard]] auto stop() -> context_state_awaitable override;
 
         /**
-         * Load a crypto hey from raw bytes
+         * @return whether the device can run both encryption and decryption tasks
+         */
+        [[nodiscard]] auto hardware_supported() const noexcept -> bool {
+            return hardware_supported_;
+        }
+
+        /**
+         * Choose where operations run from now on. Tasks already in flight are not affected.
+         */
+        auto set_route(aes_gcm_route route) -> void;
+
+        [[nodiscard]] auto route() const noexcept -> aes_gcm_route {
+            return route_;
+        }
+
+        /**
+         * With aes_gcm_route::automatic, run operations on input buffers smaller than bytes in
+         * software. 0 (the default) sends everything the device supports to the device.
+         */
+        auto set_software_threshold(std::size_t bytes) -> void;
+
+        [[nodiscard]] auto software_threshold() const noexcept -> std::size_t {
+            return software_threshold_;
+        }
+
+        /**
+         * Load a crypto key from raw bytes. The key is loaded into the device if it supports the
+         * tasks. Its bytes are only kept for the software backend if the current route and
+         * software threshold may send operations there, so set them before loading keys:
+         * operations that would have to run in software with a key that has only been loaded
+         * into the device fail with DOCA_ERROR_NOT_SUPPORTED under aes_gcm_route::software and
+         * stay on the device under aes_gcm_route::automatic.
          *
          * @param key_data key bytes
          * @param key_type type of the key (128 bit or 256 bit)
@@ -88,17 +237,11 @@ namespace shoc {
         [[nodiscard]] auto load_key(
             std::span<std::byte const> key_data,
             doca_aes_gcm_key_type key_type
-        ) -> aes_gcm_key;
+        ) -> aes_gcm_key override;
 
         /**
-         * Offload a task to encrypt a data buffer with AES-GCM.
-         *
-         * @param plaintext input buffer with plaintext. First aad_size bytes are considered AAD and only authenticated, not encrypted.
-         * @param dest output buffer for cryptotext, needs to be at least as big as plaintext plus space for tag
-         * @param key key to use for encryption
-         * @param iv initialisation vector for the GCM cipher mode
-         * @param tag_size size of the authentication tag, either 12 or 16 bytes
-         * @param aad_size size of the additional authenticated data at the beginning of plaintext in bytes.
+         * Offload a task to encrypt a data buffer with AES-GCM, or run it in software, see
+         * aes_gcm_backend::encrypt.
          */
         [[nodiscard]] auto encrypt(
             buffer plaintext,
@@ -107,17 +250,11 @@ namespace shoc {
             std::span<std::byte const> iv,
             std::uint32_t tag_size,
             std::uint32_t aad_size = 0
-        ) -> coro::status_awaitable<>;
+        ) -> coro::status_awaitable<> override;
 
         /**
-         * Offload a task to decrypt a data buffer with AES-GCM
-         *
-         * @param encrypted input buffer with ciphertext (except for the first aad_size bytes, which are considered AAD)
-         * @param dest output buffer for plaintext, needs to be as big as encrypted minus tag_size
-         * @param key key to use for decryption
-         * @param iv initialisation vector for the GCM cipher mode
-         * @param tag_size size of the authentication tag (12 or 16 bytes)
-         * @param aad_size size of the additional authenticated data at the beginning of encrypted a in bytes
+         * Offload a task to decrypt a data buffer with AES-GCM, or run it in software, see
+         * aes_gcm_backend::decrypt.
          */
         [[nodiscard]] auto decrypt(
             buffer encrypted,
@@ -126,7 +263,7 @@ namespace shoc {
             std::span<std::byte const> iv,
             std::uint32_t tag_size,
             std::uint32_t aad_size = 0
-        ) -> coro::status_awaitable<>;
+        ) -> coro::status_awaitable<> override;
 
     private:
         friend class aes_gcm_key;
@@ -134,7 +271,22 @@ namespace shoc {
         auto signal_key_destroyed() -> void;
         auto do_stop_if_able() -> void;
 
+        /**
+         * @return true if an operation on input should be offloaded to the device, false if it
+         * should go to software_
+         */
+        [[nodiscard]] auto runs_on_device(buffer const &input, aes_gcm_key const &key) const -> bool;
+
+        /**
+         * @return whether keys loaded now may be used in software and have to keep their bytes
+         */
+        [[nodiscard]] auto keeps_key_material() const noexcept -> bool;
+
         device dev_;
+        std::shared_ptr<aes_gcm_backend> software_;
+        bool hardware_supported_ = false;
+        aes_gcm_route route_ = aes_gcm_route::automatic;
+        std::size_t software_threshold_ = 0;
         int loaded_keys_ = 0;
         bool stop_requested_ = false;
     };
@@ -0,0 +1,101 @@
+#include "aes_gcm_key_cache.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+namespace shoc {
+    aes_gcm_key_cache::aes_gcm_key_cache(aes_gcm_backend &backend, std::size_t capacity):
+        backend_ { &backend },
+        capacity_ { capacity }
+    {
+        enforce(capacity > 0, DOCA_ERROR_INVALID_VALUE);
+    }
+
+    auto aes_gcm_key_cache::get(
+        std::string_view key_id,
+        std::span<std::byte const> key_data,
+        doca_aes_gcm_key_type key_type
+    ) -> std::shared_ptr<aes_gcm_key const> {
+        if(auto found = by_id_.find(key_id); found != by_id_.end()) {
+            return touch(found->second);
+        }
+
+        ++stats_.misses;
+        return insert(key_id, backend_->load_key(key_data, key_type));
+    }
+
+    auto aes_gcm_key_cache::get(
+        std::string_view key_id,
+        doca_aes_gcm_key_type key_type,
+        std::function<std::span<std::byte const>(std::string_view key_id)> const &fetch
+    ) -> std::shared_ptr<aes_gcm_key const> {
+        if(auto found = by_id_.find(key_id); found != by_id_.end()) {
+            return touch(found->second);
+        }
+
+        ++stats_.misses;
+        return insert(key_id, backend_->load_key(fetch(key_id), key_type));
+    }
+
+    auto aes_gcm_key_cache::find(std::string_view key_id) -> std::shared_ptr<aes_gcm_key const> {
+        if(auto found = by_id_.find(key_id); found != by_id_.end()) {
+            return touch(found->second);
+        }
+
+        ++stats_.misses;
+        return nullptr;
+    }
+
+    auto aes_gcm_key_cache::erase(std::string_view key_id) -> void {
+        if(auto found = by_id_.find(key_id); found != by_id_.end()) {
+            lru_.erase(found->second);
+            by_id_.erase(found);
+            --stats_.entries;
+        }
+    }
+
+    auto aes_gcm_key_cache::clear() -> void {
+        by_id_.clear();
+        lru_.clear();
+        stats_.entries = 0;
+    }
+
+    auto aes_gcm_key_cache::touch(lru_list::iterator it) -> std::shared_ptr<aes_gcm_key const> {
+        ++stats_.hits;
+        lru_.splice(lru_.begin(), lru_, it);
+        return it->key;
+    }
+
+    auto aes_gcm_key_cache::insert(std::string_view key_id, aes_gcm_key key) -> std::shared_ptr<aes_gcm_key const> {
+        lru_.push_front(entry { std::string { key_id }, std::make_shared<aes_gcm_key>(std::move(key)) });
+        by_id_.emplace(lru_.front().key_id, lru_.begin());
+        ++stats_.entries;
+
+        enforce_capacity();
+
+        return lru_.front().key;
+    }
+
+    auto aes_gcm_key_cache::enforce_capacity() -> void {
+        // a key that is still held elsewhere stays loaded whether we drop it or not, so only those
+        // held by nobody but the cache are worth evicting. The newest one is at the front and
+        // never a candidate.
+        auto it = lru_.end();
+
+        while(stats_.entries > capacity_ && it != std::next(lru_.begin())) {
+            --it;
+
+            if(it->key.use_count() > 1) {
+                continue;
+            }
+
+            logger->debug("aes_gcm_key_cache: unloading key {}", it->key_id);
+
+            auto victim = it++;
+            by_id_.erase(victim->key_id);
+            lru_.erase(victim);
+            --stats_.entries;
+            ++stats_.evictions;
+        }
+    }
+}
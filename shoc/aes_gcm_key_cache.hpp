@@ -0,0 +1,132 @@
+#pragma once
+
+#include "aes_gcm.hpp"
+
+#include <doca_aes_gcm.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace shoc {
+    /**
+     * Counters of an aes_gcm_key_cache
+     */
+    struct aes_gcm_key_cache_stats {
+        /// lookups that found the key loaded
+        std::uint64_t hits = 0;
+        /// lookups that had to load the key (or found nothing, for find())
+        std::uint64_t misses = 0;
+        /// keys unloaded to stay within the capacity
+        std::uint64_t evictions = 0;
+        /// number of keys currently held by the cache
+        std::size_t entries = 0;
+
+        [[nodiscard]] auto hit_rate() const noexcept -> double {
+            auto lookups = hits + misses;
+            return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+        }
+    };
+
+    /**
+     * Loaded AES-GCM keys by key ID. Loading a key creates a DOCA key object on the device, which
+     * is too expensive to do for every request when many tenants with their own keys share a
+     * context. The cache hands out shared keys and keeps up to capacity of them loaded; beyond
+     * that, least recently used keys that nobody else holds on to anymore are unloaded.
+     *
+     * A key ID stands for one key: the key bytes passed with a known ID are not looked at. To
+     * rotate or revoke a key, erase() its ID.
+     *
+     * aes_gcm_context::stop() waits until all keys of the context are destroyed, so clear the
+     * cache (or destroy it) and drop the handed-out keys before stopping the context. Like the
+     * rest of the library, this is not threadsafe.
+     */
+    class aes_gcm_key_cache {
+    public:
+        /**
+         * @param backend context or software backend the keys are loaded into
+         * @param capacity number of keys to keep loaded
+         */
+        aes_gcm_key_cache(aes_gcm_backend &backend, std::size_t capacity = 1024);
+
+        aes_gcm_key_cache(aes_gcm_key_cache const &) = delete;
+        aes_gcm_key_cache(aes_gcm_key_cache &&) = delete;
+        aes_gcm_key_cache &operator=(aes_gcm_key_cache const &) = delete;
+        aes_gcm_key_cache &operator=(aes_gcm_key_cache &&) = delete;
+
+        /**
+         * Get the key with the given ID, loading it from key_data if it isn't loaded
+         *
+         * @param key_id ID of the key
+         * @param key_data key bytes
+         * @param key_type type of the key (128 bit or 256 bit)
+         */
+        [[nodiscard]] auto get(
+            std::string_view key_id,
+            std::span<std::byte const> key_data,
+            doca_aes_gcm_key_type key_type
+        ) -> std::shared_ptr<aes_gcm_key const>;
+
+        /**
+         * Get the key with the given ID, calling fetch for the key bytes if it isn't loaded, so
+         * that e.g. a key management service is only asked on a miss
+         */
+        [[nodiscard]] auto get(
+            std::string_view key_id,
+            doca_aes_gcm_key_type key_type,
+            std::function<std::span<std::byte const>(std::string_view key_id)> const &fetch
+        ) -> std::shared_ptr<aes_gcm_key const>;
+
+        /**
+         * @return the key with the given ID, or nullptr if it isn't loaded
+         */
+        [[nodiscard]] auto find(std::string_view key_id) -> std::shared_ptr<aes_gcm_key const>;
+
+        /**
+         * Drop the key with the given ID. A key that was handed out stays loaded as long as it is
+         * held.
+         */
+        auto erase(std::string_view key_id) -> void;
+
+        /**
+         * Drop all keys.
+         */
+        auto clear() -> void;
+
+        [[nodiscard]] auto stats() const noexcept -> aes_gcm_key_cache_stats const & {
+            return stats_;
+        }
+
+        [[nodiscard]] auto capacity() const noexcept {
+            return capacity_;
+        }
+
+    private:
+        struct entry {
+            std::string key_id;
+            std::shared_ptr<aes_gcm_key> key;
+        };
+
+        using lru_list = std::list<entry>;
+
+        /**
+         * Move a found entry to the front and count the hit
+         */
+        auto touch(lru_list::iterator it) -> std::shared_ptr<aes_gcm_key const>;
+        auto insert(std::string_view key_id, aes_gcm_key key) -> std::shared_ptr<aes_gcm_key const>;
+        auto enforce_capacity() -> void;
+
+        aes_gcm_backend *backend_;
+        std::size_t capacity_;
+        std::map<std::string, lru_list::iterator, std::less<>> by_id_;
+        // most recently used first
+        lru_list lru_;
+        aes_gcm_key_cache_stats stats_;
+    };
+}
@@ -0,0 +1,344 @@
+#include "aes_gcm_stream.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+#include <endian.h>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+namespace shoc {
+    namespace aes_gcm_stream_format {
+        namespace {
+            auto store32(std::byte *out, std::uint32_t value) -> void {
+                value = htole32(value);
+                std::memcpy(out, &value, sizeof value);
+            }
+
+            auto load32(std::byte const *in) -> std::uint32_t {
+                std::uint32_t value;
+                std::memcpy(&value, in, sizeof value);
+                return le32toh(value);
+            }
+        }
+
+        auto stream_header::encode(std::span<std::byte, encoded_size> out) const -> void {
+            std::ranges::fill(out, std::byte { 0 });
+            std::memcpy(out.data(), magic.data(), magic.size());
+            store32(out.data() + 4, version);
+            store32(out.data() + 8, record_size);
+            store32(out.data() + 12, tag_size);
+            std::ranges::copy(nonce_prefix, out.begin() + 16);
+        }
+
+        auto stream_header::decode(std::span<std::byte const, encoded_size> in) -> std::optional<stream_header> {
+            if(std::memcmp(in.data(), magic.data(), magic.size()) != 0) {
+                return std::nullopt;
+            }
+
+            auto header = stream_header {};
+            header.version = load32(in.data() + 4);
+            header.record_size = load32(in.data() + 8);
+            header.tag_size = load32(in.data() + 12);
+            std::ranges::copy(in.subspan(16, nonce_prefix_size), header.nonce_prefix.begin());
+
+            return header;
+        }
+
+        auto record_header::encode(std::span<std::byte, encoded_size> out) const -> void {
+            store32(out.data(), plaintext_size);
+            store32(out.data() + 4, flags);
+        }
+
+        auto record_header::decode(std::span<std::byte const, encoded_size> in) -> record_header {
+            auto header = record_header {};
+            header.plaintext_size = load32(in.data());
+            header.flags = load32(in.data() + 4);
+
+            return header;
+        }
+
+        auto stream_nonce_prefix(std::uint64_t stream_id) -> std::array<std::byte, nonce_prefix_size> {
+            enforce(stream_id < max_streams, DOCA_ERROR_INVALID_VALUE);
+
+            auto prefix = std::array<std::byte, nonce_prefix_size> {};
+            auto id = htobe64(stream_id);
+
+            // the low 56 bits of the big-endian ID
+            std::memcpy(prefix.data(), reinterpret_cast<std::byte const *>(&id) + sizeof id - nonce_prefix_size, nonce_prefix_size);
+
+            return prefix;
+        }
+
+        auto record_iv(
+            std::span<std::byte const, nonce_prefix_size> nonce_prefix,
+            std::uint64_t index,
+            bool last
+        ) -> std::array<std::byte, iv_size> {
+            enforce(index < max_records, DOCA_ERROR_INVALID_VALUE);
+
+            auto iv = std::array<std::byte, iv_size> {};
+            auto counter = htobe32(static_cast<std::uint32_t>(index));
+
+            std::ranges::copy(nonce_prefix, iv.begin());
+            std::memcpy(iv.data() + nonce_prefix_size, &counter, sizeof counter);
+            iv.back() = static_cast<std::byte>(last ? 1 : 0);
+
+            return iv;
+        }
+    }
+
+    namespace {
+        constexpr std::size_t max_tag_size = 16;
+
+        auto valid_tag_size(std::uint32_t tag_size) -> bool {
+            return tag_size == 12 || tag_size == 16;
+        }
+
+        /**
+         * Wait for the tasks that are still in flight after a failure, since their buffers
+         * must not be reused while the device may still write to them
+         */
+        template<typename Slots>
+        auto drain(Slots &slots, std::uint64_t from, std::uint64_t to) -> boost::cobalt::task<void> {
+            for(; from < to; ++from) {
+                auto &pending = slots[from % slots.size()].task;
+
+                try {
+                    co_await pending;
+                } catch(...) {
+                }
+            }
+        }
+    }
+
+    aes_gcm_stream::aes_gcm_stream(device const &dev, aes_gcm_stream_config const &cfg):
+        cfg_ { cfg },
+        slot_count_ { std::size_t { cfg.max_tasks } + cfg.read_ahead },
+        sealed_size_ { aes_gcm_stream_format::record_header::encoded_size + cfg.record_size + max_tag_size },
+        plain_blocks_ { slot_count_, (cfg.record_size + 63) / 64 * 64, 64, cfg.memory },
+        sealed_blocks_ { slot_count_, (sealed_size_ + 63) / 64 * 64, 64, cfg.memory },
+        plain_mmap_ { dev, plain_blocks_.as_writable_bytes() },
+        sealed_mmap_ { dev, sealed_blocks_.as_writable_bytes() },
+        inventory_ { static_cast<std::uint32_t>(slot_count_ * 2) },
+        plain_buffers_ { inventory_.buf_get_blocks(plain_mmap_, plain_blocks_) },
+        sealed_buffers_ { inventory_.buf_get_blocks(sealed_mmap_, sealed_blocks_) }
+    {
+        enforce(cfg.max_tasks > 0 && cfg.read_ahead > 0, DOCA_ERROR_INVALID_VALUE);
+        // record headers have 32-bit sizes
+        enforce(cfg.record_size > 0 && cfg.record_size <= UINT32_MAX, DOCA_ERROR_INVALID_VALUE);
+        enforce(valid_tag_size(cfg.tag_size), DOCA_ERROR_INVALID_VALUE);
+    }
+
+    auto aes_gcm_stream::encrypt(
+        aes_gcm_backend &backend,
+        aes_gcm_key const &key,
+        std::uint64_t stream_id,
+        int in_fd,
+        int out_fd
+    ) -> boost::cobalt::task<aes_gcm_stream_stats> {
+        namespace format = aes_gcm_stream_format;
+
+        auto nonce_prefix = format::stream_nonce_prefix(stream_id);
+        auto in = stream_file { in_fd, cfg_.io };
+        auto out = stream_file { out_fd, cfg_.io };
+        auto stats = aes_gcm_stream_stats {};
+        auto slots = std::vector<slot>(slot_count_);
+
+        auto header = format::stream_header {};
+        header.record_size = static_cast<std::uint32_t>(cfg_.record_size);
+        header.tag_size = cfg_.tag_size;
+        header.nonce_prefix = nonce_prefix;
+
+        auto header_bytes = std::array<std::byte, format::stream_header::encoded_size> {};
+        header.encode(header_bytes);
+        co_await out.write_at(0, header_bytes);
+        stats.bytes_out = header_bytes.size();
+
+        // records [written, filled) are in the ring: [written, submitted) are being encrypted,
+        // [submitted, filled) have been read and wait for a free task.
+        auto written = std::uint64_t { 0 };
+        auto submitted = std::uint64_t { 0 };
+        auto filled = std::uint64_t { 0 };
+        auto end_of_input = false;
+        auto failure = std::exception_ptr {};
+
+        try {
+            while(written < filled || !end_of_input) {
+                while(!end_of_input && filled - written < slot_count_) {
+                    auto index = filled % slot_count_;
+                    auto block = plain_blocks_.writable_block(index).first(cfg_.record_size);
+                    auto length = co_await in.read_at(filled * cfg_.record_size, block);
+
+                    end_of_input = length < block.size();
+
+                    // an empty input still gets its (empty) last record
+                    if(length == 0 && filled > 0) {
+                        break;
+                    }
+
+                    enforce(filled < format::max_records, DOCA_ERROR_INVALID_VALUE);
+
+                    slots[index].length = length;
+                    plain_buffers_[index].set_data(length);
+                    stats.bytes_in += length;
+                    ++filled;
+                }
+
+                // the IV says whether a record is the last one, which is only known once the
+                // next one has been read, or the input has ended.
+                while(submitted < filled && submitted - written < cfg_.max_tasks && (submitted + 1 < filled || end_of_input)) {
+                    auto index = submitted % slot_count_;
+                    auto &current = slots[index];
+
+                    current.last = submitted + 1 == filled && end_of_input;
+                    current.iv = format::record_iv(header.nonce_prefix, submitted, current.last);
+
+                    // the ciphertext goes behind the space for the record header
+                    sealed_buffers_[index].set_data(0, format::record_header::encoded_size);
+                    current.task = backend.encrypt(plain_buffers_[index], sealed_buffers_[index], key, current.iv, cfg_.tag_size);
+                    ++submitted;
+                }
+
+                if(written == submitted) {
+                    continue;
+                }
+
+                // records complete in any order but are written in order, so waiting for the
+                // oldest one is all we need.
+                auto position = written % slot_count_;
+                auto &oldest = slots[position];
+                auto status = co_await oldest.task;
+
+                ++written;
+                enforce_success(status);
+
+                auto sealed_length = sealed_buffers_[position].view().data_length();
+                enforce(sealed_length == oldest.length + cfg_.tag_size, DOCA_ERROR_UNEXPECTED);
+
+                auto record = format::record_header {
+                    .plaintext_size = static_cast<std::uint32_t>(oldest.length),
+                    .flags = oldest.last ? format::record_header::flag_last : 0
+                };
+
+                auto block = sealed_blocks_.writable_block(position);
+                record.encode(block.first<format::record_header::encoded_size>());
+
+                auto framed = block.first(format::record_header::encoded_size + sealed_length);
+                co_await out.write_at(stats.bytes_out, framed);
+
+                stats.bytes_out += framed.size();
+                ++stats.records;
+            }
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        if(failure) {
+            co_await drain(slots, written, submitted);
+            std::rethrow_exception(failure);
+        }
+
+        logger->debug("aes_gcm_stream: encrypted {} records, {} bytes in, {} bytes out", stats.records, stats.bytes_in, stats.bytes_out);
+
+        co_return stats;
+    }
+
+    auto aes_gcm_stream::decrypt(
+        aes_gcm_backend &backend,
+        aes_gcm_key const &key,
+        int in_fd,
+        int out_fd
+    ) -> boost::cobalt::task<aes_gcm_stream_stats> {
+        namespace format = aes_gcm_stream_format;
+
+        auto in = stream_file { in_fd, cfg_.io };
+        auto out = stream_file { out_fd, cfg_.io };
+        auto stats = aes_gcm_stream_stats {};
+        auto slots = std::vector<slot>(cfg_.max_tasks);
+
+        auto header_bytes = std::array<std::byte, format::stream_header::encoded_size> {};
+        auto header_length = co_await in.read_at(0, header_bytes);
+        enforce(header_length == header_bytes.size(), DOCA_ERROR_INVALID_VALUE);
+
+        auto header = format::stream_header::decode(header_bytes);
+        enforce(header.has_value() && header->version == format::version, DOCA_ERROR_INVALID_VALUE);
+        enforce(header->record_size > 0 && header->record_size <= cfg_.record_size, DOCA_ERROR_INVALID_VALUE);
+        enforce(valid_tag_size(header->tag_size), DOCA_ERROR_INVALID_VALUE);
+
+        auto framed_size = format::record_header::encoded_size + header->record_size + header->tag_size;
+        stats.bytes_in = header_bytes.size();
+
+        // records [written, submitted) are being decrypted in slots record % max_tasks
+        auto written = std::uint64_t { 0 };
+        auto submitted = std::uint64_t { 0 };
+        auto seen_last = false;
+        auto failure = std::exception_ptr {};
+
+        try {
+            while(written < submitted || !seen_last) {
+                while(!seen_last && submitted - written < cfg_.max_tasks) {
+                    auto index = submitted % cfg_.max_tasks;
+                    auto &current = slots[index];
+                    auto block = sealed_blocks_.writable_block(index).first(framed_size);
+                    auto length = co_await in.read_at(stats.bytes_in, block);
+
+                    // running out of records before the last one means the stream was cut off
+                    enforce(length >= format::record_header::encoded_size, DOCA_ERROR_INVALID_VALUE);
+
+                    auto record = format::record_header::decode(block.first<format::record_header::encoded_size>());
+                    auto sealed_length = std::size_t { record.plaintext_size } + header->tag_size;
+
+                    enforce(record.is_last() || record.plaintext_size == header->record_size, DOCA_ERROR_INVALID_VALUE);
+                    enforce(record.plaintext_size <= header->record_size, DOCA_ERROR_INVALID_VALUE);
+                    enforce(length >= format::record_header::encoded_size + sealed_length, DOCA_ERROR_INVALID_VALUE);
+
+                    current.length = record.plaintext_size;
+                    current.last = record.is_last();
+                    current.iv = format::record_iv(header->nonce_prefix, submitted, current.last);
+
+                    sealed_buffers_[index].set_data(sealed_length, format::record_header::encoded_size);
+                    plain_buffers_[index].set_data(0);
+                    current.task = backend.decrypt(sealed_buffers_[index], plain_buffers_[index], key, current.iv, header->tag_size);
+
+                    stats.bytes_in += format::record_header::encoded_size + sealed_length;
+                    seen_last = current.last;
+                    ++submitted;
+                }
+
+                auto position = written % cfg_.max_tasks;
+                auto &oldest = slots[position];
+                auto status = co_await oldest.task;
+
+                ++written;
+                enforce_success(status);
+
+                auto plaintext = plain_buffers_[position].view().data<std::byte>();
+                enforce(plaintext.size() == oldest.length, DOCA_ERROR_UNEXPECTED);
+
+                co_await out.write_at(stats.bytes_out, plaintext);
+
+                stats.bytes_out += plaintext.size();
+                ++stats.records;
+            }
+
+            // nothing may follow the last record
+            auto probe = std::array<std::byte, 1> {};
+            enforce(co_await in.read_at(stats.bytes_in, probe) == 0, DOCA_ERROR_INVALID_VALUE);
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        if(failure) {
+            co_await drain(slots, written, submitted);
+            std::rethrow_exception(failure);
+        }
+
+        logger->debug("aes_gcm_stream: decrypted {} records, {} bytes in, {} bytes out", stats.records, stats.bytes_in, stats.bytes_out);
+
+        co_return stats;
+    }
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "aes_gcm.hpp"
+#include "aligned_memory.hpp"
+#include "buffer.hpp"
+#include "buffer_inventory.hpp"
+#include "device.hpp"
+#include "memory_map.hpp"
+#include "stream_file.hpp"
+
+#include <boost/cobalt/task.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace shoc {
+    /**
+     * Configuration for an aes_gcm_stream
+     */
+    struct aes_gcm_stream_config {
+        /// Size of the plaintext records the input is split into
+        std::size_t record_size = 1 << 20;
+        /// Size of the authentication tag of each record, 12 or 16 bytes
+        std::uint32_t tag_size = 16;
+        /// Maximum number of tasks in flight. Must not exceed the context's num_tasks.
+        std::uint32_t max_tasks = 16;
+        /// Number of records read ahead of the tasks in flight, at least 1: a record is only
+        /// encrypted once it is known whether it's the last one.
+        std::uint32_t read_ahead = 2;
+        /// How to do file I/O
+        stream_io io = stream_io::pread;
+        /// Where and how the record buffers are allocated
+        memory_policy memory;
+    };
+
+    /**
+     * Framed output format of aes_gcm_stream. All integers are little-endian.
+     *
+     * The stream starts with a stream header, followed by one record per record_size bytes of
+     * plaintext (at least one, so an empty input still has an authenticated end). Each record
+     * consists of a record header and plaintext_size + tag_size bytes of ciphertext and tag.
+     * All records but the last have record_size bytes of plaintext; the last one is flagged.
+     *
+     * Record i is encrypted with the 96-bit IV
+     *
+     *     nonce_prefix (7 bytes) || i (4 bytes, big-endian) || last (1 byte, 0 or 1)
+     *
+     * where nonce_prefix is the stream's ID, 56 bits big-endian. The caller picks the ID and
+     * must never use one twice with the same key, e.g. by keeping a counter with the key: two
+     * streams with the same key and ID would share IVs, which in GCM reveals the XOR of their
+     * plaintexts and the authentication key. IDs drawn at random are not good enough, since
+     * they are likely to collide long before 2^56 streams. So one key encrypts at most
+     * max_streams streams of at most max_records records each.
+     *
+     * The IVs of one stream are distinct by construction, and since index and flag are bound
+     * into the IV, records that are reordered, dropped, or cut off after a record that isn't
+     * flagged as the last fail to decrypt (the "STREAM" construction of Hoang, Reyhanitabar,
+     * Rogaway and Vizár).
+     */
+    namespace aes_gcm_stream_format {
+        constexpr auto magic = std::array<char, 4> { 'S', 'H', 'C', 'E' };
+        constexpr std::uint32_t version = 1;
+        constexpr std::size_t iv_size = 12;
+        constexpr std::size_t nonce_prefix_size = 7;
+        constexpr std::uint64_t max_records = std::uint64_t { 1 } << 32;
+        constexpr std::uint64_t max_streams = std::uint64_t { 1 } << (8 * nonce_prefix_size);
+
+        struct stream_header {
+            static constexpr std::size_t encoded_size = 32;
+
+            std::uint32_t version = aes_gcm_stream_format::version;
+            std::uint32_t record_size = 0;
+            std::uint32_t tag_size = 0;
+            std::array<std::byte, nonce_prefix_size> nonce_prefix {};
+
+            auto encode(std::span<std::byte, encoded_size> out) const -> void;
+
+            /**
+             * @return the decoded header, or nullopt if the data doesn't start with the magic
+             */
+            [[nodiscard]] static auto decode(std::span<std::byte const, encoded_size> in) -> std::optional<stream_header>;
+        };
+
+        struct record_header {
+            static constexpr std::size_t encoded_size = 8;
+            static constexpr std::uint32_t flag_last = 1;
+
+            std::uint32_t plaintext_size = 0;
+            std::uint32_t flags = 0;
+
+            [[nodiscard]] auto is_last() const noexcept -> bool {
+                return (flags & flag_last) != 0;
+            }
+
+            auto encode(std::span<std::byte, encoded_size> out) const -> void;
+            [[nodiscard]] static auto decode(std::span<std::byte const, encoded_size> in) -> record_header;
+        };
+
+        /**
+         * @return the nonce prefix of the stream with the ID stream_id, which must be below max_streams
+         */
+        [[nodiscard]] auto stream_nonce_prefix(std::uint64_t stream_id) -> std::array<std::byte, nonce_prefix_size>;
+
+        /**
+         * @return the IV of a record
+         */
+        [[nodiscard]] auto record_iv(
+            std::span<std::byte const, nonce_prefix_size> nonce_prefix,
+            std::uint64_t index,
+            bool last
+        ) -> std::array<std::byte, iv_size>;
+    }
+
+    /**
+     * Results of an aes_gcm_stream run
+     */
+    struct aes_gcm_stream_stats {
+        std::uint64_t records = 0;
+        std::uint64_t bytes_in = 0;
+        /// including headers
+        std::uint64_t bytes_out = 0;
+    };
+
+    /**
+     * Encrypts and decrypts files of arbitrary size with AES-GCM and bounded memory, e.g. objects
+     * to be stored at rest. The input is read in records into a ring of max_tasks + read_ahead
+     * record buffers; up to max_tasks of them are being encrypted or decrypted at any time while
+     * the rest are already filled for the next tasks. Records are written out in input order, in
+     * the format described in aes_gcm_stream_format.
+     *
+     * The record buffers are allocated and mapped once, on construction, so one aes_gcm_stream
+     * can be used for many files (one at a time) and with many keys, e.g. from an
+     * aes_gcm_key_cache.
+     */
+    class aes_gcm_stream {
+    public:
+        /**
+         * @param dev device the record buffers are mapped to, i.e. the one the aes_gcm_context runs on
+         *            (any device for a software backend)
+         * @param cfg record size, tag size, parallelism, I/O backend
+         */
+        aes_gcm_stream(device const &dev, aes_gcm_stream_config const &cfg = {});
+
+        /**
+         * Encrypt everything from in_fd (read from its start) to out_fd (written from its start).
+         * The file descriptors stay open and owned by the caller.
+         *
+         * Throws doca_exception if a task fails or with DOCA_ERROR_INVALID_VALUE if stream_id is
+         * out of range, and std::system_error on I/O errors.
+         *
+         * @param backend running aes_gcm_context with num_tasks >= cfg.max_tasks, or a software backend
+         * @param key key to encrypt with
+         * @param stream_id ID of the stream, below aes_gcm_stream_format::max_streams and never
+         *        used before with this key (see aes_gcm_stream_format)
+         * @param in_fd input file descriptor, must support pread
+         * @param out_fd output file descriptor, must support pwrite
+         */
+        [[nodiscard]] auto encrypt(
+            aes_gcm_backend &backend,
+            aes_gcm_key const &key,
+            std::uint64_t stream_id,
+            int in_fd,
+            int out_fd
+        ) -> boost::cobalt::task<aes_gcm_stream_stats>;
+
+        /**
+         * Decrypt a stream written by encrypt() from in_fd to out_fd. The record size and tag
+         * size are taken from the stream header; records must fit the configured record size.
+         *
+         * Throws doca_exception if a record fails to authenticate (as reported by the backend) or
+         * with DOCA_ERROR_INVALID_VALUE if the stream is malformed or truncated, and
+         * std::system_error on I/O errors. Plaintext of the records before a failing one may
+         * have been written to out_fd already.
+         */
+        [[nodiscard]] auto decrypt(
+            aes_gcm_backend &backend,
+            aes_gcm_key const &key,
+            int in_fd,
+            int out_fd
+        ) -> boost::cobalt::task<aes_gcm_stream_stats>;
+
+        [[nodiscard]] auto config() const noexcept -> aes_gcm_stream_config const & { return cfg_; }
+
+    private:
+        struct slot {
+            std::size_t length = 0;
+            bool last = false;
+            std::array<std::byte, aes_gcm_stream_format::iv_size> iv {};
+            coro::status_awaitable<> task;
+        };
+
+        aes_gcm_stream_config cfg_;
+        std::size_t slot_count_;
+        /// one record header, the largest record, and its tag
+        std::size_t sealed_size_;
+        aligned_blocks plain_blocks_;
+        aligned_blocks sealed_blocks_;
+        memory_map plain_mmap_;
+        memory_map sealed_mmap_;
+        buffer_inventory inventory_;
+        buffer_array plain_buffers_;
+        buffer_array sealed_buffers_;
+    };
+}
@@ -0,0 +1,153 @@
+#include "aligned_memory.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+namespace shoc::detail {
+    namespace {
+        constexpr auto huge_2m_size = std::size_t { 1 } << 21;
+        constexpr auto huge_1g_size = std::size_t { 1 } << 30;
+
+        auto system_page_size() -> std::size_t {
+            static auto const size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        auto page_size_of(page_kind pages) -> std::size_t {
+            switch(pages) {
+            case page_kind::huge_2m:
+                return huge_2m_size;
+            case page_kind::huge_1g:
+                return huge_1g_size;
+            default:
+                return system_page_size();
+            }
+        }
+
+        auto round_up(std::size_t size, std::size_t granularity) -> std::size_t {
+            return (size + granularity - 1) / granularity * granularity;
+        }
+
+        auto map_flags(page_kind pages) -> int {
+            auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+            switch(pages) {
+            case page_kind::huge_2m:
+                return flags | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT);
+            case page_kind::huge_1g:
+                return flags | MAP_HUGETLB | (30 << MAP_HUGE_SHIFT);
+            default:
+                return flags;
+            }
+        }
+
+        /**
+         * Bind a mapping to a NUMA node. mbind is called through syscall() so we don't need libnuma.
+         */
+        auto bind_to_node(void *base, std::size_t size, int node) -> void {
+            constexpr auto max_nodes = sizeof(unsigned long) * 8;
+
+            if(node < 0 || static_cast<std::size_t>(node) >= max_nodes) {
+                logger->warn("cannot bind memory to NUMA node {}: node number out of range", node);
+                return;
+            }
+
+            unsigned long nodemask = 1ul << node;
+
+            if(syscall(SYS_mbind, base, size, MPOL_BIND, &nodemask, max_nodes, MPOL_MF_STRICT | MPOL_MF_MOVE) != 0) {
+                logger->warn("cannot bind memory to NUMA node {}: {}", node, std::strerror(errno));
+            }
+        }
+
+        auto prefault(std::byte *base, std::size_t size, std::size_t page_size) -> void {
+            for(std::size_t offset = 0; offset < size; offset += page_size) {
+                *static_cast<std::byte volatile*>(base + offset) = std::byte{};
+            }
+        }
+
+        auto allocate_heap(std::size_t size, std::size_t alignment) -> memory_handle {
+            auto base = static_cast<std::byte*>(::operator new(size, std::align_val_t { alignment }));
+            std::memset(base, 0, size);
+
+            return memory_handle { base, memory_deleter { .pages = page_kind::heap, .alignment = alignment } };
+        }
+
+        auto map_pages(std::size_t size, std::size_t alignment, page_kind pages) -> memory_handle {
+            auto page_size = page_size_of(pages);
+
+            // mmap hands out page-aligned memory; larger alignments need some slack.
+            auto slack = alignment > page_size ? alignment : 0;
+            auto mapped_size = round_up(std::max<std::size_t>(size, 1) + slack, page_size);
+            auto base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, map_flags(pages), -1, 0);
+
+            if(base == MAP_FAILED) {
+                logger->debug("mmap of {} bytes with page size {} failed: {}", mapped_size, page_size, std::strerror(errno));
+                return nullptr;
+            }
+
+            auto aligned = static_cast<void*>(base);
+            auto space = mapped_size;
+            std::align(alignment, size, aligned, space);
+
+            auto offset = static_cast<std::size_t>(static_cast<std::byte*>(aligned) - static_cast<std::byte*>(base));
+
+            return memory_handle {
+                static_cast<std::byte*>(aligned),
+                memory_deleter { .pages = pages, .mapped_size = mapped_size, .offset = offset }
+            };
+        }
+    }
+
+    auto memory_deleter::operator()(std::byte *ptr) const noexcept -> void {
+        if(pages == page_kind::heap) {
+            ::operator delete(ptr, std::align_val_t { alignment });
+        } else if(munmap(ptr - offset, mapped_size) != 0) {
+            logger->error("munmap failed: {}", std::strerror(errno));
+        }
+    }
+
+    auto allocate_memory(std::size_t size, std::size_t alignment, memory_policy const &policy) -> memory_handle {
+        if(policy.pages == page_kind::heap && !policy.numa_node && !policy.prefault) {
+            return allocate_heap(size, alignment);
+        }
+
+        // NUMA binding and pre-faulting need a mapping of our own even with regular pages.
+        auto pages = policy.pages == page_kind::heap ? page_kind::regular : policy.pages;
+        auto memory = map_pages(size, alignment, pages);
+
+        if(memory == nullptr && pages != page_kind::regular) {
+            enforce(policy.fallback_to_regular_pages, DOCA_ERROR_NO_MEMORY);
+
+            logger->info("no hugepages available for {} bytes, falling back to regular pages", size);
+
+            pages = page_kind::regular;
+            memory = map_pages(size, alignment, pages);
+
+            if(memory != nullptr) {
+                // ask for transparent hugepages instead; it's only a hint.
+                madvise(memory.get() - memory.get_deleter().offset, memory.get_deleter().mapped_size, MADV_HUGEPAGE);
+            }
+        }
+
+        enforce(memory != nullptr, DOCA_ERROR_NO_MEMORY);
+
+        if(policy.numa_node) {
+            bind_to_node(memory.get() - memory.get_deleter().offset, memory.get_deleter().mapped_size, *policy.numa_node);
+        }
+
+        if(policy.prefault) {
+            prefault(memory.get(), size, page_size_of(pages));
+        }
+
+        return memory;
+    }
+}
@@ -4,18 +4,83 @@
 #include <cassert>
 #include <cstddef>
 #include <memory>
+#include <optional>
 #include <span>
-#include <vector>
+#include <utility>
 
 namespace shoc {
+    /**
+     * Kind of pages backing an aligned_memory
+     */
+    enum class page_kind {
+        /// regular heap memory
+        heap,
+        /// anonymous mapping with regular (usually 4K) pages
+        regular,
+        /// 2 MiB hugepages
+        huge_2m,
+        /// 1 GiB hugepages
+        huge_1g
+    };
+
+    /**
+     * Where and how the memory of an aligned_memory is allocated. The default is plain heap memory.
+     *
+     * Memory that is registered with a device (memory_map) benefits from hugepages: fewer pages
+     * mean fewer IOMMU/TLB entries and faster registration. Hugepages must be reserved by the
+     * administrator (e.g. via /proc/sys/vm/nr_hugepages); if none are available, the allocation
+     * falls back to regular pages (with transparent hugepages requested) unless that is disabled.
+     */
+    struct memory_policy {
+        /// Page size to use
+        page_kind pages = page_kind::heap;
+        /// NUMA node to bind the memory to, e.g. the one the device is attached to
+        std::optional<int> numa_node;
+        /// Touch every page on allocation, so that page faults don't happen on the data path
+        bool prefault = false;
+        /// Use regular pages if the requested hugepages can't be had; throw otherwise
+        bool fallback_to_regular_pages = true;
+
+        /**
+         * Pre-faulted hugepages, the usual choice for large device-mapped buffers
+         */
+        [[nodiscard]] static auto hugepages(page_kind kind = page_kind::huge_2m) {
+            auto policy = memory_policy {};
+            policy.pages = kind;
+            policy.prefault = true;
+            return policy;
+        }
+    };
+
+    namespace detail {
+        /**
+         * Releases memory obtained from allocate_memory
+         */
+        struct memory_deleter {
+            page_kind pages = page_kind::heap;
+            /// heap memory: alignment the memory was allocated with
+            std::size_t alignment = 0;
+            /// mapped memory: size of the mapping and offset of the aligned pointer into it
+            std::size_t mapped_size = 0;
+            std::size_t offset = 0;
+
+            auto operator()(std::byte *base) const noexcept -> void;
+        };
+
+        using memory_handle = std::unique_ptr<std::byte, memory_deleter>;
+
+        /**
+         * Allocate at least size bytes aligned on alignment according to policy
+         */
+        auto allocate_memory(std::size_t size, std::size_t alignment, memory_policy const &policy) -> memory_handle;
+    }
+
     /**
      * Many operations in DOCA will perform better when they are performed on cache-line-aligned data.
      * This class provides aligned memory, by default aligned on 64 bytes (i.e., cache lines)
      *
-     * This is built on top of std::vector, so the actual memory will be on the heap, and the anchor
-     * object is moveable.
-     * 
-     * TODO: Add hugepages support
+     * By default the memory comes from the heap; a memory_policy can request hugepages, NUMA node
+     * binding, and pre-faulting instead. The anchor object is moveable.
      */
     class aligned_memory {
     public:
@@ -24,16 +89,16 @@ namespace shoc {
         /**
          * @param size size of the alligned memory
          * @param alignment in bytes
+         * @param policy page size, NUMA node, and pre-faulting
          */
-        aligned_memory(std::size_t size, std::size_t alignment = 64):
-            memory_ { size + alignment }
-        {
-            auto base_ptr = static_cast<void*>(memory_.data());
-            auto space = memory_.size();
-            std::align(alignment, size, base_ptr, space);
+        aligned_memory(std::size_t size, std::size_t alignment = 64, memory_policy const &policy = {}):
+            memory_ { detail::allocate_memory(size, alignment, policy) },
+            aligned_ { memory_.get(), size }
+        {}
 
-            aligned_ = std::span { static_cast<std::byte*>(base_ptr), size };
-        }
+        aligned_memory(std::size_t size, memory_policy const &policy):
+            aligned_memory(size, 64, policy)
+        {}
 
         aligned_memory(aligned_memory const &) = delete;
         aligned_memory(aligned_memory &&other) {
@@ -54,6 +119,14 @@ namespace shoc {
             swap(aligned_, other.aligned_);
         }
 
+        /**
+         * @return the kind of pages actually backing the memory, which may differ from the
+         *         requested kind if hugepages were not available
+         */
+        [[nodiscard]] auto pages() const noexcept {
+            return memory_.get_deleter().pages;
+        }
+
         /**
          * @return the aligned memory as constant byte span
          */
@@ -82,7 +155,7 @@ namespace shoc {
         }
 
     private:
-        std::vector<std::byte> memory_;
+        detail::memory_handle memory_;
         std::span<std::byte> aligned_;
     };
 
@@ -102,21 +175,32 @@ namespace shoc {
          * @param block_count number of blocks
          * @param block_size size of each block, must be a multiple of alignment
          * @param alignment alignment in bytes, cache-line-aligned by default
+         * @param policy page size, NUMA node, and pre-faulting
          */
         aligned_blocks(
             std::size_t block_count,
             std::size_t block_size,
-            std::size_t alignment = 64
+            std::size_t alignment = 64,
+            memory_policy const &policy = {}
         ):
-            memory_ { block_count * block_size, alignment },
+            memory_ { block_count * block_size, alignment, policy },
             block_count_ { block_count },
             block_size_ { block_size }
         {
             assert(block_size % alignment == 0);
         }
 
+        aligned_blocks(
+            std::size_t block_count,
+            std::size_t block_size,
+            memory_policy const &policy
+        ):
+            aligned_blocks(block_count, block_size, 64, policy)
+        {}
+
         auto block_count() const { return block_count_; };
         auto block_size() const { return block_size_; };
+        auto pages() const { return memory_.pages(); }
 
         /**
          * @return the index-th block as a constant byte span
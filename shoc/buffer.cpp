@@ -20,7 +20,7 @@ namespace shoc {
         doca_buf_inc_refcount(handle_, nullptr);
     }
 
-    buffer::buffer(buffer &&other):
+    buffer::buffer(buffer &&other) noexcept:
         handle_(std::exchange(other.handle_, nullptr))
     {
     }
@@ -31,7 +31,7 @@ namespace shoc {
         return *this;
     }
 
-    auto buffer::operator=(buffer &&other) -> buffer& {
+    auto buffer::operator=(buffer &&other) noexcept -> buffer& {
         buffer copy { std::move(other) };
         swap(copy);
         return *this;
@@ -52,4 +52,39 @@ namespace shoc {
             handle_ = nullptr;
         }
     }
+
+    auto buffer::view() const -> buffer_view {
+        return buffer_view { *this };
+    }
+
+    buffer_view::buffer_view(buffer const &buf):
+        handle_ { buf.handle() }
+    {
+        refresh();
+    }
+
+    auto buffer_view::refresh() -> void {
+        void *head = nullptr;
+        void *data = nullptr;
+
+        valid_ = false;
+
+        enforce_success(doca_buf_get_head(handle_, &head));
+        enforce_success(doca_buf_get_len(handle_, &len_));
+        enforce_success(doca_buf_get_data(handle_, &data));
+        enforce_success(doca_buf_get_data_len(handle_, &data_len_));
+
+        head_ = static_cast<std::byte*>(head);
+        data_ = static_cast<std::byte*>(data);
+        valid_ = true;
+    }
+
+    auto buffer_view::set_data(std::size_t data_len, std::size_t data_offset) -> void {
+        assert(valid_);
+
+        enforce_success(doca_buf_set_data(handle_, head_ + data_offset, data_len));
+
+        data_ = head_ + data_offset;
+        data_len_ = data_len;
+    }
 }
@@ -4,12 +4,16 @@
 
 #include <doca_buf.h>
 
+#include <cassert>
+#include <cstddef>
 #include <memory>
 #include <span>
 #include <vector>
 #include <utility>
 
 namespace shoc {
+    class buffer_view;
+
     /**
      * reference-counted buffer in a DOCA memory map. It has an outer and inner memory range, one
      * for available mapped memory and one for used memory:
@@ -39,10 +43,10 @@ namespace shoc {
         ~buffer();
 
         buffer(buffer const &);
-        buffer(buffer &&);
+        buffer(buffer &&) noexcept;
 
         auto operator=(buffer const&) -> buffer&;
-        auto operator=(buffer &&) -> buffer&;
+        auto operator=(buffer &&) noexcept -> buffer&;
 
         auto swap(buffer &other) -> void {
             std::swap(handle_, other.handle_);
@@ -93,7 +97,137 @@ namespace shoc {
         auto set_data(std::size_t data_len, std::size_t data_offset = 0) -> std::span<char>;
         auto clear() -> void;
 
+        /**
+         * Snapshot of the buffer's memory and data regions for repeated access without calls into
+         * DOCA. See buffer_view.
+         */
+        [[nodiscard]] auto view() const -> buffer_view;
+
     private:
         doca_buf *handle_ = nullptr;
     };
+
+    /**
+     * Snapshot of a buffer's memory and data regions. data() and memory() on a buffer each take
+     * two calls into the DOCA library; a buffer_view makes them once, on construction, after which
+     * all accessors are inline and cannot fail. Meant for code that looks at a buffer several times
+     * per packet or block.
+     *
+     * The view does not notice changes made to the buffer behind its back, be it through
+     * buffer::set_data or by DOCA writing a task's output. Take the view after such changes, or
+     * call refresh(). Changing the data region through the view's own set_data keeps it current.
+     *
+     * The view does not hold a reference to the buffer; the buffer has to outlive it.
+     */
+    class buffer_view
+    {
+    public:
+        buffer_view() = default;
+
+        explicit buffer_view(buffer const &buf);
+
+        [[nodiscard]] auto handle() const noexcept -> doca_buf* { return handle_; }
+
+        /**
+         * data region
+         */
+        template<typename Byte = char>
+        [[nodiscard, gnu::hot]] auto data() const noexcept -> std::span<Byte>
+            requires (sizeof(Byte) == 1)
+        {
+            assert(valid_);
+            return { reinterpret_cast<Byte*>(data_), data_len_ };
+        }
+
+        /**
+         * Memory region of the full buffer (including header and footer space)
+         */
+        template<typename Byte = char>
+        [[nodiscard, gnu::hot]] auto memory() const noexcept -> std::span<Byte>
+            requires (sizeof(Byte) == 1)
+        {
+            assert(valid_);
+            return { reinterpret_cast<Byte*>(head_), len_ };
+        }
+
+        [[nodiscard, gnu::hot]] auto data_length() const noexcept -> std::size_t { assert(valid_); return data_len_; }
+        [[nodiscard, gnu::hot]] auto data_offset() const noexcept -> std::size_t { assert(valid_); return data_ - head_; }
+        [[nodiscard, gnu::hot]] auto memory_length() const noexcept -> std::size_t { assert(valid_); return len_; }
+
+        /**
+         * Space behind the data region, e.g. for appending output
+         */
+        [[nodiscard, gnu::hot]] auto tail_room() const noexcept -> std::size_t {
+            assert(valid_);
+            return len_ - data_offset() - data_len_;
+        }
+
+        /**
+         * Set the length and optionally offset of the data region within the memory region, on the
+         * buffer and in the view.
+         */
+        auto set_data(std::size_t data_len, std::size_t data_offset = 0) -> void;
+
+        /**
+         * Mark the view as stale, e.g. after handing the buffer to a task that changes it. A stale
+         * view must be refreshed before its accessors are used again.
+         */
+        auto invalidate() noexcept -> void { valid_ = false; }
+
+        /**
+         * Re-read the buffer's regions
+         */
+        auto refresh() -> void;
+
+        [[nodiscard]] auto valid() const noexcept -> bool { return valid_; }
+
+    private:
+        doca_buf *handle_ = nullptr;
+        std::byte *head_ = nullptr;
+        std::byte *data_ = nullptr;
+        std::size_t len_ = 0;
+        std::size_t data_len_ = 0;
+        bool valid_ = false;
+    };
+
+    /**
+     * Contiguous array of buffers that are acquired and released together, e.g. one buffer per
+     * block of an aligned_blocks. See buffer_inventory::buf_get_blocks.
+     *
+     * Elements can be passed to offloading functions directly. Releasing the array releases all
+     * handles in one pass.
+     */
+    class buffer_array
+    {
+    public:
+        buffer_array() = default;
+
+        explicit buffer_array(std::vector<buffer> &&buffers):
+            buffers_ { std::move(buffers) }
+        {}
+
+        [[nodiscard]] auto size() const noexcept { return buffers_.size(); }
+        [[nodiscard]] auto empty() const noexcept { return buffers_.empty(); }
+
+        [[nodiscard]] auto operator[](std::size_t index) noexcept -> buffer & { return buffers_[index]; }
+        [[nodiscard]] auto operator[](std::size_t index) const noexcept -> buffer const & { return buffers_[index]; }
+
+        [[nodiscard]] auto begin() noexcept { return buffers_.begin(); }
+        [[nodiscard]] auto end() noexcept { return buffers_.end(); }
+        [[nodiscard]] auto begin() const noexcept { return buffers_.begin(); }
+        [[nodiscard]] auto end() const noexcept { return buffers_.end(); }
+
+        [[nodiscard]] auto as_span() noexcept -> std::span<buffer> { return buffers_; }
+        [[nodiscard]] auto as_span() const noexcept -> std::span<buffer const> { return buffers_; }
+
+        /**
+         * Release all buffers
+         */
+        auto clear() noexcept -> void {
+            buffers_.clear();
+        }
+
+    private:
+        std::vector<buffer> buffers_;
+    };
 }
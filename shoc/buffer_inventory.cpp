@@ -2,6 +2,8 @@
 
 #include "error.hpp"
 #include <doca_buf_inventory.h>
+
+#include <algorithm>
 #include <cstdint>
 
 namespace shoc {
@@ -47,6 +49,75 @@ namespace shoc {
         return dest;
     }
 
+    auto buffer_inventory::start_batch(std::size_t count) const -> std::vector<buffer> {
+        enforce(count <= get_num_free_elements(), DOCA_ERROR_NO_MEMORY);
+
+        auto buffers = std::vector<buffer>{};
+        buffers.reserve(count);
+
+        return buffers;
+    }
+
+    auto buffer_inventory::buf_get_blocks(memory_map &mmap, std::span<std::byte const> memory, std::size_t block_size) -> buffer_array {
+        enforce(block_size > 0, DOCA_ERROR_INVALID_VALUE);
+
+        auto buffers = start_batch((memory.size() + block_size - 1) / block_size);
+
+        for(std::size_t offset = 0; offset < memory.size(); offset += block_size) {
+            buffers.push_back(buf_get_by_addr(mmap, memory.subspan(offset, std::min(block_size, memory.size() - offset))));
+        }
+
+        return buffer_array { std::move(buffers) };
+    }
+
+    auto buffer_inventory::buf_get_blocks_by_data(memory_map &mmap, std::span<std::byte const> memory, std::size_t block_size) -> buffer_array {
+        enforce(block_size > 0, DOCA_ERROR_INVALID_VALUE);
+
+        auto buffers = start_batch((memory.size() + block_size - 1) / block_size);
+
+        for(std::size_t offset = 0; offset < memory.size(); offset += block_size) {
+            buffers.push_back(buf_get_by_data(mmap, memory.subspan(offset, std::min(block_size, memory.size() - offset))));
+        }
+
+        return buffer_array { std::move(buffers) };
+    }
+
+    auto buffer_inventory::buf_get_batch_by_addr(memory_map &mmap, std::span<std::span<std::byte const> const> regions) -> buffer_array {
+        auto buffers = start_batch(regions.size());
+
+        for(auto region : regions) {
+            buffers.push_back(buf_get_by_addr(mmap, region));
+        }
+
+        return buffer_array { std::move(buffers) };
+    }
+
+    auto buffer_inventory::buf_get_batch_by_data(memory_map &mmap, std::span<std::span<std::byte const> const> regions) -> buffer_array {
+        auto buffers = start_batch(regions.size());
+
+        for(auto region : regions) {
+            buffers.push_back(buf_get_by_data(mmap, region));
+        }
+
+        return buffer_array { std::move(buffers) };
+    }
+
+    auto buffer_inventory::buf_reuse_by_args(buffer &buf, memory_map &mmap, void const *addr, std::size_t len, void const *data, std::size_t data_len) -> void {
+        enforce_success(doca_buf_inventory_buf_reuse_by_args(
+            buf.handle(),
+            mmap.handle(),
+            const_cast<void*>(addr), len,
+            const_cast<void*>(data), data_len));
+    }
+
+    auto buffer_inventory::buf_reuse_by_addr(buffer &buf, memory_map &mmap, void const *addr, std::size_t len) -> void {
+        enforce_success(doca_buf_inventory_buf_reuse_by_addr(buf.handle(), mmap.handle(), const_cast<void*>(addr), len));
+    }
+
+    auto buffer_inventory::buf_reuse_by_data(buffer &buf, memory_map &mmap, void const *data, std::size_t data_len) -> void {
+        enforce_success(doca_buf_inventory_buf_reuse_by_data(buf.handle(), mmap.handle(), const_cast<void*>(data), data_len));
+    }
+
     auto buffer_inventory::get_num_elements() const -> std::uint32_t {
         std::uint32_t dest;
         enforce_success(doca_buf_inventory_get_num_elements(handle_.get(), &dest));
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "aligned_memory.hpp"
 #include "buffer.hpp"
 #include "common/raw_memory.hpp"
 #include "device.hpp"
@@ -9,7 +10,9 @@
 #include <doca_buf.h>
 #include <doca_buf_inventory.h>
 
+#include <cstddef>
 #include <cstdint>
+#include <span>
 #include <vector>
 
 namespace shoc {
@@ -30,6 +33,52 @@ namespace shoc {
 
         [[nodiscard]] auto buf_dup(buffer const &src) -> buffer;
 
+        /**
+         * Get one buffer per block of memory, i.e. for [memory[0], memory[block_size]),
+         * [memory[block_size], memory[2 * block_size]), and so on. The buffers' data regions are
+         * empty, as for output buffers. If memory.size() is not a multiple of block_size, the last
+         * block is shorter.
+         *
+         * DOCA has no batch call for this, so the buffers are still acquired one by one; what this
+         * saves is the caller's loop and the vector growing. The inventory is checked for enough
+         * free elements first, so if it would run out, no buffer is acquired.
+         */
+        [[nodiscard]] auto buf_get_blocks(memory_map &mmap, std::span<std::byte const> memory, std::size_t block_size) -> buffer_array;
+
+        /**
+         * Like buf_get_blocks, but with the data regions covering the whole blocks, as for source
+         * buffers.
+         */
+        [[nodiscard]] auto buf_get_blocks_by_data(memory_map &mmap, std::span<std::byte const> memory, std::size_t block_size) -> buffer_array;
+
+        [[nodiscard]] auto buf_get_blocks(memory_map &mmap, aligned_blocks const &blocks) -> buffer_array {
+            return buf_get_blocks(mmap, blocks.as_bytes(), blocks.block_size());
+        }
+
+        [[nodiscard]] auto buf_get_blocks_by_data(memory_map &mmap, aligned_blocks const &blocks) -> buffer_array {
+            return buf_get_blocks_by_data(mmap, blocks.as_bytes(), blocks.block_size());
+        }
+
+        /**
+         * Get one buffer per memory region, with empty data regions. Like buf_get_blocks, one by
+         * one, and none if the inventory doesn't have enough free elements.
+         */
+        [[nodiscard]] auto buf_get_batch_by_addr(memory_map &mmap, std::span<std::span<std::byte const> const> regions) -> buffer_array;
+
+        /**
+         * Get one buffer per memory region, with the data regions covering the whole regions.
+         */
+        [[nodiscard]] auto buf_get_batch_by_data(memory_map &mmap, std::span<std::span<std::byte const> const> regions) -> buffer_array;
+
+        /**
+         * Re-point an existing buffer to different memory instead of releasing it and getting a new
+         * one. The buffer must not be shared, i.e. no copies of it may exist, and must come from
+         * a buffer_inventory.
+         */
+        static auto buf_reuse_by_args(buffer &buf, memory_map &mmap, void const *addr, std::size_t len, void const *data, std::size_t data_len) -> void;
+        static auto buf_reuse_by_addr(buffer &buf, memory_map &mmap, void const *addr, std::size_t len) -> void;
+        static auto buf_reuse_by_data(buffer &buf, memory_map &mmap, void const *data, std::size_t data_len) -> void;
+
 #define DOCORO_BUFINV_ACCESSORS(byte_type) \
         [[nodiscard]] auto buf_get_by_args(memory_map &mmap, std::span<byte_type const> mem, std::span<byte_type const> data) -> buffer { \
             return buf_get_by_args(mmap, mem.data(), mem.size(), data.data(), data.size()); \
@@ -39,6 +88,12 @@ namespace shoc {
         } \
         [[nodiscard]] auto buf_get_by_data(memory_map &mmap, std::span<byte_type const> data) -> buffer { \
             return buf_get_by_data(mmap, data.data(), data.size()); \
+        } \
+        static auto buf_reuse_by_addr(buffer &buf, memory_map &mmap, std::span<byte_type const> mem) -> void { \
+            buf_reuse_by_addr(buf, mmap, mem.data(), mem.size()); \
+        } \
+        static auto buf_reuse_by_data(buffer &buf, memory_map &mmap, std::span<byte_type const> data) -> void { \
+            buf_reuse_by_data(buf, mmap, data.data(), data.size()); \
         }
 
         DOCORO_BUFINV_ACCESSORS(char)
@@ -50,6 +105,11 @@ namespace shoc {
         [[nodiscard]] auto get_num_free_elements() const -> std::uint32_t;
 
     private:
+        /**
+         * Make sure count buffers can be had, and get the vector to put them in
+         */
+        [[nodiscard]] auto start_batch(std::size_t count) const -> std::vector<buffer>;
+
         unique_handle<doca_buf_inventory, doca_buf_inventory_destroy> handle_;
     };
 }
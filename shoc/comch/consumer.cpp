@@ -23,6 +23,8 @@ namespace shoc::comch {
             &consumer::post_recv_task_completion_callback,
             max_tasks
         ));
+
+        reserve_receptables<consumer_recv_awaitable::payload_type>(max_tasks);
     }
 
     auto consumer::post_recv(buffer &dest) -> consumer_recv_awaitable {
@@ -34,7 +36,7 @@ namespace shoc::comch {
             return consumer_recv_awaitable::from_error(err);
         }
 
-        auto result = consumer_recv_awaitable::create_space();
+        auto result = consumer_recv_awaitable::create_space(engine()->receptables());
         auto receptable = result.receptable_ptr();
         doca_data task_user_data = { .ptr = receptable };
         auto base_task = doca_comch_consumer_task_post_recv_as_task(task);
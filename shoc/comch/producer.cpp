@@ -22,6 +22,8 @@ namespace shoc::comch {
             &plain_status_callback<&doca_comch_producer_task_send_as_task>,
             max_tasks
         ));
+
+        reserve_receptables<coro::status_awaitable<>::payload_type>(max_tasks);
     }
 
     auto producer::send(
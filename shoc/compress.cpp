@@ -1,5 +1,6 @@
 #include "compress.hpp"
 
+#include "cpu_compress.hpp"
 #include "error.hpp"
 #include "logger.hpp"
 
@@ -9,40 +10,89 @@ namespace shoc {
     compress_context::compress_context(
         progress_engine *parent,
         device dev,
-        std::uint32_t max_tasks
+        std::uint32_t max_tasks,
+        std::shared_ptr<compress_backend> software
     ):
         context {
             parent,
             context::create_doca_handle<doca_compress_create>(dev.handle())
         },
-        dev_ { std::move(dev) }
+        dev_ { std::move(dev) },
+        software_ { std::move(software) }
     {
-        enforce(dev_.has_capability(device_capability::compress_deflate), DOCA_ERROR_NOT_SUPPORTED);
+        auto devinfo = dev_.as_devinfo();
 
-        enforce_success(doca_compress_task_compress_deflate_set_conf(
-            handle(),
-            &compress_context::task_completion_callback<doca_compress_task_compress_deflate>,
-            &compress_context::task_completion_callback<doca_compress_task_compress_deflate>,
-            max_tasks
-        ));
-        enforce_success(doca_compress_task_decompress_deflate_set_conf(
-            handle(),
-            &compress_context::task_completion_callback<doca_compress_task_decompress_deflate>,
-            &compress_context::task_completion_callback<doca_compress_task_decompress_deflate>,
-            max_tasks
-        ));
-        enforce_success(doca_compress_task_decompress_lz4_block_set_conf(
-            handle(),
-            &compress_context::task_completion_callback<doca_compress_task_decompress_lz4_block>,
-            &compress_context::task_completion_callback<doca_compress_task_decompress_lz4_block>,
-            max_tasks
-        ));
-        enforce_success(doca_compress_task_decompress_lz4_stream_set_conf(
-            handle(),
-            &compress_context::task_completion_callback<doca_compress_task_decompress_lz4_stream>,
-            &compress_context::task_completion_callback<doca_compress_task_decompress_lz4_stream>,
-            max_tasks
-        ));
+        hardware_ops_ = {
+            doca_compress_cap_task_compress_deflate_is_supported(devinfo) == DOCA_SUCCESS,
+            doca_compress_cap_task_decompress_deflate_is_supported(devinfo) == DOCA_SUCCESS,
+            doca_compress_cap_task_decompress_lz4_block_is_supported(devinfo) == DOCA_SUCCESS,
+            doca_compress_cap_task_decompress_lz4_stream_is_supported(devinfo) == DOCA_SUCCESS
+        };
+
+        // only task types the device supports can be configured
+        auto task_types = std::uint32_t { 0 };
+
+        if(hardware_supports(compress_operation::compress_deflate)) {
+            enforce_success(doca_compress_task_compress_deflate_set_conf(
+                handle(),
+                &compress_context::task_completion_callback<doca_compress_task_compress_deflate>,
+                &compress_context::task_completion_callback<doca_compress_task_compress_deflate>,
+                max_tasks
+            ));
+            ++task_types;
+        }
+
+        if(hardware_supports(compress_operation::decompress_deflate)) {
+            enforce_success(doca_compress_task_decompress_deflate_set_conf(
+                handle(),
+                &compress_context::task_completion_callback<doca_compress_task_decompress_deflate>,
+                &compress_context::task_completion_callback<doca_compress_task_decompress_deflate>,
+                max_tasks
+            ));
+            ++task_types;
+        }
+
+        if(hardware_supports(compress_operation::decompress_lz4_block)) {
+            enforce_success(doca_compress_task_decompress_lz4_block_set_conf(
+                handle(),
+                &compress_context::task_completion_callback<doca_compress_task_decompress_lz4_block>,
+                &compress_context::task_completion_callback<doca_compress_task_decompress_lz4_block>,
+                max_tasks
+            ));
+            ++task_types;
+        }
+
+        if(hardware_supports(compress_operation::decompress_lz4_stream)) {
+            enforce_success(doca_compress_task_decompress_lz4_stream_set_conf(
+                handle(),
+                &compress_context::task_completion_callback<doca_compress_task_decompress_lz4_stream>,
+                &compress_context::task_completion_callback<doca_compress_task_decompress_lz4_stream>,
+                max_tasks
+            ));
+            ++task_types;
+        }
+
+        if(task_types < hardware_ops_.size()) {
+            logger->info("compress_context: device supports {} of 4 compression task types, the rest run in software", task_types);
+
+            if(software_ == nullptr) {
+                software_ = cpu_compress_backend::shared();
+            }
+        }
+
+        reserve_receptables<compress_awaitable::payload_type>(task_types * max_tasks);
+    }
+
+    auto compress_context::supports(compress_operation op) const noexcept -> bool {
+        return !runs_on_device(op) || hardware_supports(op);
+    }
+
+    auto compress_context::set_route(compress_operation op, compress_route route) -> void {
+        if(route == compress_route::software && software_ == nullptr) {
+            software_ = cpu_compress_backend::shared();
+        }
+
+        routes_[static_cast<std::size_t>(op)] = route;
     }
 
     auto compress_context::compress(
@@ -50,12 +100,21 @@ namespace shoc {
         buffer &dest,
         compress_checksums *checksums
     ) -> compress_awaitable {
+        // software_ is set whenever an operation is routed away from the device
+        if(!runs_on_device(compress_operation::compress_deflate)) {
+            return software_->compress(src, dest, checksums);
+        }
+
+        if(!hardware_supports(compress_operation::compress_deflate)) {
+            return compress_awaitable::from_value(DOCA_ERROR_NOT_SUPPORTED);
+        }
+
         return detail::status_offload<
             doca_compress_task_compress_deflate_alloc_init,
             doca_compress_task_compress_deflate_as_task
         >(
             engine(),
-            compress_awaitable::create_space(checksums),
+            compress_awaitable::create_space(engine()->receptables(), checksums),
             handle(),
             src.handle(),
             dest.handle()
@@ -67,12 +126,20 @@ namespace shoc {
         buffer &dest,
         compress_checksums *checksums
     ) -> compress_awaitable {
+        if(!runs_on_device(compress_operation::decompress_deflate)) {
+            return software_->decompress(src, dest, checksums);
+        }
+
+        if(!hardware_supports(compress_operation::decompress_deflate)) {
+            return compress_awaitable::from_value(DOCA_ERROR_NOT_SUPPORTED);
+        }
+
         return detail::status_offload<
             doca_compress_task_decompress_deflate_alloc_init,
             doca_compress_task_decompress_deflate_as_task
         >(
             engine(),
-            compress_awaitable::create_space(checksums),
+            compress_awaitable::create_space(engine()->receptables(), checksums),
             handle(),
             src.handle(),
             dest.handle()
@@ -84,12 +151,20 @@ namespace shoc {
         buffer &dest,
         compress_checksums *checksums
     ) -> compress_awaitable {
+        if(!runs_on_device(compress_operation::decompress_lz4_block)) {
+            return software_->decompress_lz4_block(src, dest, checksums);
+        }
+
+        if(!hardware_supports(compress_operation::decompress_lz4_block)) {
+            return compress_awaitable::from_value(DOCA_ERROR_NOT_SUPPORTED);
+        }
+
         return detail::status_offload<
             doca_compress_task_decompress_lz4_block_alloc_init,
             doca_compress_task_decompress_lz4_block_as_task
         >(
             engine(),
-            compress_awaitable::create_space(checksums),
+            compress_awaitable::create_space(engine()->receptables(), checksums),
             handle(),
             src.handle(),
             dest.handle()
@@ -103,12 +178,20 @@ namespace shoc {
         buffer &dest,
         compress_checksums *checksums
     ) -> compress_awaitable {
+        if(!runs_on_device(compress_operation::decompress_lz4_stream)) {
+            return software_->decompress_lz4_stream(has_block_checksum, are_blocks_independent, src, dest, checksums);
+        }
+
+        if(!hardware_supports(compress_operation::decompress_lz4_stream)) {
+            return compress_awaitable::from_value(DOCA_ERROR_NOT_SUPPORTED);
+        }
+
         return detail::status_offload<
             doca_compress_task_decompress_lz4_stream_alloc_init,
             doca_compress_task_decompress_lz4_stream_as_task
         >(
             engine(),
-            compress_awaitable::create_space(checksums),
+            compress_awaitable::create_space(engine()->receptables(), checksums),
             handle(),
             static_cast<std::uint8_t>(has_block_checksum),
             static_cast<std::uint8_t>(are_blocks_independent),
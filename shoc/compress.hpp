@@ -10,7 +10,10 @@
 
 #include <doca_compress.h>
 
+#include <array>
+#include <cstddef>
 #include <functional>
+#include <memory>
 
 namespace shoc {
     // compile-time lookup table for task-specific helper functions
@@ -73,22 +76,92 @@ namespace shoc {
 
     using compress_awaitable = coro::status_awaitable<compress_checksums>;
 
+    /**
+     * The operations a compress_backend offers
+     */
+    enum class compress_operation {
+        compress_deflate,
+        decompress_deflate,
+        decompress_lz4_block,
+        decompress_lz4_stream
+    };
+
+    /**
+     * Where compress_context runs an operation
+     */
+    enum class compress_route {
+        /// on the device if it supports the operation, otherwise in software
+        automatic,
+        /// always on the device; fails with DOCA_ERROR_NOT_SUPPORTED if the device can't do it
+        hardware,
+        /// always in software
+        software
+    };
+
+    /**
+     * Interface of everything that (de)compresses buffers: compress_context on a device and
+     * cpu_compress_backend on the host's cores. Code that takes a compress_backend & runs on
+     * either. All operations return immediately and complete through the awaitable on the
+     * calling thread.
+     */
+    class compress_backend {
+    public:
+        virtual ~compress_backend() = default;
+
+        /**
+         * @return whether op can be run through this backend
+         */
+        [[nodiscard]] virtual auto supports(compress_operation op) const noexcept -> bool = 0;
+
+        virtual auto compress(
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable = 0;
+
+        virtual auto decompress(
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable = 0;
+
+        virtual auto decompress_lz4_block(
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable = 0;
+
+        virtual auto decompress_lz4_stream(
+            bool has_block_checksum,
+            bool are_blocks_independent,
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable = 0;
+    };
+
     /**
      * Context for compression tasks.
+     *
+     * Operations the device doesn't support (e.g. deflate compression on a BlueField-3) run on a
+     * software backend instead, by default the shared cpu_compress_backend. The choice is made
+     * per operation and can be overridden with set_route, e.g. to compare both in a benchmark.
      */
     class compress_context:
         public context<
             doca_compress,
             doca_compress_destroy,
             doca_compress_as_ctx
-        >
+        >,
+        public compress_backend
     {
     public:
         /// For internal use
         compress_context(
             progress_engine *parent,
             device dev,
-            std::uint32_t max_tasks
+            std::uint32_t max_tasks,
+            std::shared_ptr<compress_backend> software
         );
 
         /**
@@ -97,13 +170,37 @@ namespace shoc {
          * @param engine engine that processes the completion events
          * @param dev device on which the submitted tasks will run
          * @param max_tasks The maximum number of tasks that can be supplied to this context at the same time per task type
+         * @param software backend for operations that don't run on the device, the shared
+         *                 cpu_compress_backend if nullptr
          */
         [[nodiscard]] static auto create(
             progress_engine_lease engine,
             device dev,
-            std::uint32_t max_tasks = 32
+            std::uint32_t max_tasks = 32,
+            std::shared_ptr<compress_backend> software = nullptr
         ) {
-            return engine.create_context<compress_context>(std::move(dev), max_tasks);
+            return engine.create_context<compress_context>(std::move(dev), max_tasks, std::move(software));
+        }
+
+        /**
+         * @return whether op runs on the device (with compress_route::automatic) or in software
+         */
+        [[nodiscard]] auto supports(compress_operation op) const noexcept -> bool override;
+
+        /**
+         * @return whether the device can run op
+         */
+        [[nodiscard]] auto hardware_supports(compress_operation op) const noexcept -> bool {
+            return hardware_ops_[static_cast<std::size_t>(op)];
+        }
+
+        /**
+         * Choose where op runs from now on. Tasks already in flight are not affected.
+         */
+        auto set_route(compress_operation op, compress_route route) -> void;
+
+        [[nodiscard]] auto route(compress_operation op) const noexcept -> compress_route {
+            return routes_[static_cast<std::size_t>(op)];
         }
 
         /**
@@ -119,7 +216,7 @@ namespace shoc {
             buffer const &src,
             buffer &dest,
             compress_checksums *checksums = nullptr
-        ) -> compress_awaitable;
+        ) -> compress_awaitable override;
 
         /**
          * Decompress the data in src, write the results to dest. Returns immediately; the result of the call is an awaitable that'll be completed
@@ -134,7 +231,7 @@ namespace shoc {
             buffer const &src,
             buffer &dest,
             compress_checksums *checksums = nullptr
-        ) -> compress_awaitable;
+        ) -> compress_awaitable override;
 
         /**
          * Decompress the data in src, write the results to dest. Returns immediately; the result of the call is an awaitable that'll be completed
@@ -149,7 +246,7 @@ namespace shoc {
             buffer const &src,
             buffer &dest,
             compress_checksums *checksums = nullptr
-        ) -> compress_awaitable;
+        ) -> compress_awaitable override;
 
         /**
          * Decompress the data in src, write the results to dest. Returns immediately; the result of the call is an awaitable that'll be completed
@@ -168,7 +265,7 @@ namespace shoc {
             buffer const &src,
             buffer &dest,
             compress_checksums *checksums = nullptr
-        ) -> compress_awaitable;
+        ) -> compress_awaitable override;
 
     private:
         template<typename TaskType>
@@ -193,6 +290,17 @@ namespace shoc {
             dest->resume();
         }
 
+        /**
+         * @return true if op should be offloaded to the device, false if it should go to software_
+         */
+        [[nodiscard]] auto runs_on_device(compress_operation op) const noexcept -> bool {
+            auto chosen = routes_[static_cast<std::size_t>(op)];
+            return chosen == compress_route::hardware || (chosen == compress_route::automatic && hardware_supports(op));
+        }
+
         device dev_;
+        std::shared_ptr<compress_backend> software_;
+        std::array<bool, 4> hardware_ops_ {};
+        std::array<compress_route, 4> routes_ {};
     };
 }
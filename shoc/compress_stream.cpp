@@ -0,0 +1,482 @@
+#include "compress_stream.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+#include <endian.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <system_error>
+#include <vector>
+
+namespace shoc {
+    namespace compress_stream_format {
+        namespace {
+            auto store32(std::byte *out, std::uint32_t value) -> void {
+                value = htole32(value);
+                std::memcpy(out, &value, sizeof value);
+            }
+
+            auto store64(std::byte *out, std::uint64_t value) -> void {
+                value = htole64(value);
+                std::memcpy(out, &value, sizeof value);
+            }
+
+            auto load32(std::byte const *in) -> std::uint32_t {
+                std::uint32_t value;
+                std::memcpy(&value, in, sizeof value);
+                return le32toh(value);
+            }
+
+            auto load64(std::byte const *in) -> std::uint64_t {
+                std::uint64_t value;
+                std::memcpy(&value, in, sizeof value);
+                return le64toh(value);
+            }
+        }
+
+        auto stream_header::encode(std::span<std::byte, encoded_size> out) const -> void {
+            std::memcpy(out.data(), magic.data(), magic.size());
+            store32(out.data() + 4, version);
+            store64(out.data() + 8, chunk_size);
+        }
+
+        auto stream_header::decode(std::span<std::byte const, encoded_size> in) -> std::optional<stream_header> {
+            if(std::memcmp(in.data(), magic.data(), magic.size()) != 0) {
+                return std::nullopt;
+            }
+
+            auto header = stream_header {};
+            header.version = load32(in.data() + 4);
+            header.chunk_size = load64(in.data() + 8);
+
+            return header;
+        }
+
+        auto frame_header::encode(std::span<std::byte, encoded_size> out) const -> void {
+            store32(out.data(), compressed_size);
+            store32(out.data() + 4, uncompressed_size);
+            store32(out.data() + 8, crc);
+            store32(out.data() + 12, adler);
+        }
+
+        auto frame_header::decode(std::span<std::byte const, encoded_size> in) -> frame_header {
+            auto header = frame_header {};
+            header.compressed_size = load32(in.data());
+            header.uncompressed_size = load32(in.data() + 4);
+            header.crc = load32(in.data() + 8);
+            header.adler = load32(in.data() + 12);
+
+            return header;
+        }
+
+        auto index_entry::encode(std::span<std::byte, encoded_size> out) const -> void {
+            store64(out.data(), offset);
+            store32(out.data() + 8, compressed_size);
+            store32(out.data() + 12, uncompressed_size);
+            store32(out.data() + 16, crc);
+            store32(out.data() + 20, adler);
+        }
+
+        auto index_entry::decode(std::span<std::byte const, encoded_size> in) -> index_entry {
+            auto entry = index_entry {};
+            entry.offset = load64(in.data());
+            entry.compressed_size = load32(in.data() + 8);
+            entry.uncompressed_size = load32(in.data() + 12);
+            entry.crc = load32(in.data() + 16);
+            entry.adler = load32(in.data() + 20);
+
+            return entry;
+        }
+
+        auto stream_footer::encode(std::span<std::byte, encoded_size> out) const -> void {
+            store64(out.data(), index_offset);
+            store64(out.data() + 8, chunk_count);
+            std::memcpy(out.data() + 16, index_magic.data(), index_magic.size());
+            store32(out.data() + 20, version);
+        }
+
+        auto stream_footer::decode(std::span<std::byte const, encoded_size> in) -> std::optional<stream_footer> {
+            if(std::memcmp(in.data() + 16, index_magic.data(), index_magic.size()) != 0) {
+                return std::nullopt;
+            }
+
+            auto footer = stream_footer {};
+            footer.index_offset = load64(in.data());
+            footer.chunk_count = load64(in.data() + 8);
+
+            return footer;
+        }
+    }
+
+    namespace {
+        /**
+         * Worst-case size of a deflated chunk: incompressible data ends up in stored blocks,
+         * which cost 5 bytes per 64 KiB, plus some leeway for the device's block headers.
+         */
+        auto max_deflated_size(std::size_t chunk_size) -> std::size_t {
+            return chunk_size + chunk_size / 64 + 1024;
+        }
+
+        /**
+         * Staging blocks are cache-line aligned, so their size has to be a multiple of that
+         */
+        auto staging_block_size(std::size_t size) -> std::size_t {
+            return (size + 63) / 64 * 64;
+        }
+
+        /**
+         * Blocking read of exactly out.size() bytes, for the reader's metadata
+         */
+        auto read_exactly(int fd, std::uint64_t offset, std::span<std::byte> out) -> void {
+            while(!out.empty()) {
+                auto n = ::pread(fd, out.data(), out.size(), static_cast<off_t>(offset));
+
+                if(n < 0 && errno == EINTR) {
+                    continue;
+                } else if(n < 0) {
+                    throw std::system_error(errno, std::system_category(), "compress_stream_reader: read failed");
+                }
+
+                enforce(n > 0, DOCA_ERROR_INVALID_VALUE);
+
+                offset += static_cast<std::uint64_t>(n);
+                out = out.subspan(static_cast<std::size_t>(n));
+            }
+        }
+
+        auto read_stream_header(int fd) -> compress_stream_format::stream_header {
+            namespace format = compress_stream_format;
+
+            auto bytes = std::array<std::byte, format::stream_header::encoded_size> {};
+            read_exactly(fd, 0, bytes);
+
+            auto header = format::stream_header::decode(bytes);
+
+            enforce(header.has_value() && header->version == format::version, DOCA_ERROR_INVALID_VALUE);
+            enforce(header->chunk_size > 0 && header->chunk_size <= UINT32_MAX, DOCA_ERROR_INVALID_VALUE);
+
+            return *header;
+        }
+
+        /**
+         * Read and validate the chunk index through the footer at the end of the file
+         */
+        auto read_index(int fd, compress_stream_format::stream_header const &header) -> std::vector<compress_stream_format::index_entry> {
+            namespace format = compress_stream_format;
+
+            struct stat st;
+
+            if(::fstat(fd, &st) != 0) {
+                throw std::system_error(errno, std::system_category(), "compress_stream_reader: fstat failed");
+            }
+
+            auto file_size = static_cast<std::uint64_t>(st.st_size);
+            auto data_start = format::stream_header::encoded_size;
+
+            enforce(file_size >= data_start + format::frame_header::encoded_size + format::stream_footer::encoded_size, DOCA_ERROR_INVALID_VALUE);
+
+            auto footer_bytes = std::array<std::byte, format::stream_footer::encoded_size> {};
+            read_exactly(fd, file_size - footer_bytes.size(), footer_bytes);
+
+            auto footer = format::stream_footer::decode(footer_bytes);
+            enforce(footer.has_value(), DOCA_ERROR_INVALID_VALUE);
+
+            auto index_end = file_size - footer_bytes.size();
+            enforce(footer->index_offset <= index_end, DOCA_ERROR_INVALID_VALUE);
+            enforce((index_end - footer->index_offset) / format::index_entry::encoded_size == footer->chunk_count, DOCA_ERROR_INVALID_VALUE);
+            enforce((index_end - footer->index_offset) % format::index_entry::encoded_size == 0, DOCA_ERROR_INVALID_VALUE);
+
+            auto bytes = std::vector<std::byte>(index_end - footer->index_offset);
+            read_exactly(fd, footer->index_offset, bytes);
+
+            auto index = std::vector<format::index_entry>();
+            index.reserve(footer->chunk_count);
+
+            auto max_compressed = max_deflated_size(header.chunk_size);
+
+            for(auto pos = std::size_t { 0 }; pos < bytes.size(); pos += format::index_entry::encoded_size) {
+                auto entry = format::index_entry::decode(std::span { bytes }.subspan(pos).first<format::index_entry::encoded_size>());
+
+                // every chunk but the last is full, and no frame reaches into the index
+                enforce(entry.uncompressed_size == header.chunk_size || pos + format::index_entry::encoded_size == bytes.size(), DOCA_ERROR_INVALID_VALUE);
+                enforce(entry.uncompressed_size <= header.chunk_size && entry.compressed_size <= max_compressed, DOCA_ERROR_INVALID_VALUE);
+                enforce(entry.offset >= data_start && entry.offset + entry.compressed_size <= footer->index_offset, DOCA_ERROR_INVALID_VALUE);
+
+                index.push_back(entry);
+            }
+
+            return index;
+        }
+
+        auto uncompressed_size(std::span<compress_stream_format::index_entry const> index) -> std::uint64_t {
+            auto total = std::uint64_t { 0 };
+
+            for(auto const &entry : index) {
+                total += entry.uncompressed_size;
+            }
+
+            return total;
+        }
+    }
+
+    compress_stream::compress_stream(device const &dev, compress_stream_config const &cfg):
+        cfg_ { cfg },
+        slot_count_ { std::size_t { cfg.max_tasks } + cfg.read_ahead },
+        dst_chunk_size_ { max_deflated_size(cfg.chunk_size) },
+        src_blocks_ { slot_count_, staging_block_size(cfg.chunk_size), 64, cfg.memory },
+        dst_blocks_ { slot_count_, staging_block_size(dst_chunk_size_), 64, cfg.memory },
+        src_mmap_ { dev, src_blocks_.as_writable_bytes() },
+        dst_mmap_ { dev, dst_blocks_.as_writable_bytes() },
+        inventory_ { static_cast<std::uint32_t>(slot_count_ * 2) },
+        src_buffers_ { inventory_.buf_get_blocks(src_mmap_, src_blocks_) },
+        dst_buffers_ { inventory_.buf_get_blocks(dst_mmap_, dst_blocks_) }
+    {
+        enforce(cfg.max_tasks > 0 && cfg.chunk_size > 0, DOCA_ERROR_INVALID_VALUE);
+        // frame headers have 32-bit sizes
+        enforce(dst_chunk_size_ <= UINT32_MAX, DOCA_ERROR_INVALID_VALUE);
+    }
+
+    auto compress_stream::run(compress_backend &ctx, int in_fd, int out_fd) -> boost::cobalt::task<compress_stream_stats> {
+        namespace format = compress_stream_format;
+
+        auto in = stream_file { in_fd, cfg_.io };
+        auto out = stream_file { out_fd, cfg_.io };
+        auto stats = compress_stream_stats {};
+        auto slots = std::vector<slot>(slot_count_);
+        auto index = std::vector<format::index_entry>();
+
+        auto header = format::stream_header {};
+        header.chunk_size = cfg_.chunk_size;
+
+        auto header_bytes = std::array<std::byte, format::stream_header::encoded_size> {};
+        header.encode(header_bytes);
+        co_await out.write_at(0, header_bytes);
+        stats.bytes_out = header_bytes.size();
+
+        // chunks [written, filled) are in the ring: [written, submitted) are being compressed,
+        // [submitted, filled) have been read and wait for a free task.
+        auto written = std::uint64_t { 0 };
+        auto submitted = std::uint64_t { 0 };
+        auto filled = std::uint64_t { 0 };
+        auto end_of_input = false;
+        auto failure = std::exception_ptr {};
+
+        try {
+            while(written < filled || !end_of_input) {
+                while(!end_of_input && filled - written < slot_count_) {
+                    auto index = filled % slot_count_;
+                    auto block = src_blocks_.writable_block(index).first(cfg_.chunk_size);
+                    auto length = co_await in.read_at(filled * cfg_.chunk_size, block);
+
+                    end_of_input = length < block.size();
+
+                    if(length == 0) {
+                        break;
+                    }
+
+                    slots[index].length = length;
+                    src_buffers_[index].set_data(length);
+                    stats.bytes_in += length;
+                    ++filled;
+                }
+
+                while(submitted < filled && submitted - written < cfg_.max_tasks) {
+                    auto index = submitted % slot_count_;
+                    auto &current = slots[index];
+
+                    dst_buffers_[index].set_data(0);
+                    current.task = ctx.compress(src_buffers_[index], dst_buffers_[index], &current.checksums);
+                    ++submitted;
+                }
+
+                if(written == submitted) {
+                    continue;
+                }
+
+                // chunks complete in any order but are written in order, so waiting for the
+                // oldest one is all we need.
+                auto position = written % slot_count_;
+                auto &oldest = slots[position];
+                auto status = co_await oldest.task;
+
+                ++written;
+                enforce_success(status);
+
+                auto view = dst_buffers_[position].view();
+                auto frame = format::frame_header {
+                    .compressed_size = static_cast<std::uint32_t>(view.data_length()),
+                    .uncompressed_size = static_cast<std::uint32_t>(oldest.length),
+                    .crc = oldest.checksums.crc,
+                    .adler = oldest.checksums.adler
+                };
+
+                auto frame_bytes = std::array<std::byte, format::frame_header::encoded_size> {};
+                frame.encode(frame_bytes);
+
+                auto &entry = index.emplace_back();
+                entry.offset = stats.bytes_out + frame_bytes.size();
+                entry.compressed_size = frame.compressed_size;
+                entry.uncompressed_size = frame.uncompressed_size;
+                entry.crc = frame.crc;
+                entry.adler = frame.adler;
+
+                co_await out.write_at(stats.bytes_out, frame_bytes);
+                co_await out.write_at(entry.offset, view.data<std::byte>());
+
+                stats.bytes_out += frame_bytes.size() + view.data_length();
+                ++stats.chunks;
+            }
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        if(failure) {
+            // the buffers must not be reused while the device may still write to them
+            for(; written < submitted; ++written) {
+                auto &pending = slots[written % slot_count_].task;
+
+                try {
+                    co_await pending;
+                } catch(...) {
+                }
+            }
+
+            std::rethrow_exception(failure);
+        }
+
+        auto end_bytes = std::array<std::byte, format::frame_header::encoded_size> {};
+        format::frame_header {}.encode(end_bytes);
+        co_await out.write_at(stats.bytes_out, end_bytes);
+        stats.bytes_out += end_bytes.size();
+
+        auto footer = format::stream_footer {};
+        footer.index_offset = stats.bytes_out;
+        footer.chunk_count = index.size();
+
+        auto trailer = std::vector<std::byte>(index.size() * format::index_entry::encoded_size + format::stream_footer::encoded_size);
+        auto trailer_span = std::span { trailer };
+
+        for(auto i = std::size_t { 0 }; i < index.size(); ++i) {
+            index[i].encode(trailer_span.subspan(i * format::index_entry::encoded_size).first<format::index_entry::encoded_size>());
+        }
+
+        footer.encode(trailer_span.last<format::stream_footer::encoded_size>());
+        co_await out.write_at(stats.bytes_out, trailer);
+        stats.bytes_out += trailer.size();
+
+        logger->debug("compress_stream: {} chunks, {} bytes in, {} bytes out", stats.chunks, stats.bytes_in, stats.bytes_out);
+
+        co_return stats;
+    }
+
+    compress_stream_reader::compress_stream_reader(device const &dev, int fd, compress_stream_reader_config const &cfg):
+        fd_ { fd },
+        cfg_ { cfg },
+        header_ { read_stream_header(fd) },
+        index_ { read_index(fd, header_) },
+        size_ { uncompressed_size(index_) },
+        src_chunk_size_ { max_deflated_size(header_.chunk_size) },
+        src_blocks_ { cfg.max_tasks, staging_block_size(src_chunk_size_), 64, cfg.memory },
+        dst_blocks_ { cfg.max_tasks, staging_block_size(header_.chunk_size), 64, cfg.memory },
+        src_mmap_ { dev, src_blocks_.as_writable_bytes() },
+        dst_mmap_ { dev, dst_blocks_.as_writable_bytes() },
+        inventory_ { cfg.max_tasks * 2 },
+        src_buffers_ { inventory_.buf_get_blocks(src_mmap_, src_blocks_) },
+        dst_buffers_ { inventory_.buf_get_blocks(dst_mmap_, dst_blocks_) }
+    {
+        enforce(cfg.max_tasks > 0, DOCA_ERROR_INVALID_VALUE);
+
+        logger->debug("compress_stream_reader: {} chunks of {} bytes, {} bytes uncompressed", index_.size(), header_.chunk_size, size_);
+    }
+
+    auto compress_stream_reader::read(
+        compress_backend &ctx,
+        std::uint64_t offset,
+        std::span<std::byte> out
+    ) -> boost::cobalt::task<std::size_t> {
+        if(offset >= size_ || out.empty()) {
+            co_return 0;
+        }
+
+        auto length = static_cast<std::size_t>(std::min<std::uint64_t>(out.size(), size_ - offset));
+        auto end = offset + length;
+        auto first = offset / header_.chunk_size;
+        auto last = (end - 1) / header_.chunk_size;
+
+        auto file = stream_file { fd_, cfg_.io };
+        auto slots = std::vector<slot>(cfg_.max_tasks);
+
+        // chunks [done, submitted) are being decompressed in slots chunk % max_tasks
+        auto submitted = first;
+        auto done = first;
+        auto failure = std::exception_ptr {};
+
+        try {
+            while(done <= last) {
+                while(submitted <= last && submitted - done < cfg_.max_tasks) {
+                    auto position = submitted % cfg_.max_tasks;
+                    auto const &entry = index_[submitted];
+                    auto &current = slots[position];
+                    auto src = src_blocks_.writable_block(position).first(entry.compressed_size);
+
+                    auto count = co_await file.read_at(entry.offset, src);
+                    enforce(count == src.size(), DOCA_ERROR_IO_FAILED);
+
+                    src_buffers_[position].set_data(entry.compressed_size);
+                    dst_buffers_[position].set_data(0);
+                    current.chunk = submitted;
+                    current.task = ctx.decompress(src_buffers_[position], dst_buffers_[position], &current.checksums);
+                    ++submitted;
+                }
+
+                // the chunks end up in out independently of each other, but waiting in order keeps
+                // the bookkeeping to two counters.
+                auto position = done % cfg_.max_tasks;
+                auto &oldest = slots[position];
+                auto status = co_await oldest.task;
+
+                ++done;
+                enforce_success(status);
+
+                auto const &entry = index_[oldest.chunk];
+                auto view = dst_buffers_[position].view();
+
+                enforce(view.data_length() == entry.uncompressed_size, DOCA_ERROR_IO_FAILED);
+
+                if(cfg_.verify_checksums) {
+                    enforce(oldest.checksums.crc == entry.crc && oldest.checksums.adler == entry.adler, DOCA_ERROR_IO_FAILED);
+                }
+
+                auto chunk_start = oldest.chunk * header_.chunk_size;
+                auto from = std::max(offset, chunk_start);
+                auto to = std::min(end, chunk_start + entry.uncompressed_size);
+                auto data = view.data<std::byte>().subspan(from - chunk_start, to - from);
+
+                std::ranges::copy(data, out.begin() + static_cast<std::ptrdiff_t>(from - offset));
+            }
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        if(failure) {
+            for(; done < submitted; ++done) {
+                auto &pending = slots[done % cfg_.max_tasks].task;
+
+                try {
+                    co_await pending;
+                } catch(...) {
+                }
+            }
+
+            std::rethrow_exception(failure);
+        }
+
+        co_return length;
+    }
+}
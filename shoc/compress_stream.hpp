@@ -0,0 +1,265 @@
+#pragma once
+
+#include "aligned_memory.hpp"
+#include "buffer.hpp"
+#include "buffer_inventory.hpp"
+#include "compress.hpp"
+#include "device.hpp"
+#include "memory_map.hpp"
+#include "stream_file.hpp"
+
+#include <boost/cobalt/task.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace shoc {
+    /**
+     * Configuration for a compress_stream
+     */
+    struct compress_stream_config {
+        /// Size of the uncompressed chunks the input is split into
+        std::size_t chunk_size = 1 << 20;
+        /// Maximum number of compression tasks in flight. Must not exceed the context's max_tasks.
+        std::uint32_t max_tasks = 16;
+        /// Number of chunks read ahead of the tasks in flight, so that a finished task can be
+        /// followed up without waiting for input (2 for double buffering, 3 for triple buffering)
+        std::uint32_t read_ahead = 2;
+        /// How to do file I/O
+        stream_io io = stream_io::pread;
+        /// Where and how the chunk buffers are allocated
+        memory_policy memory;
+    };
+
+    /**
+     * Framed output format of compress_stream. All integers are little-endian.
+     *
+     * The stream starts with a stream header, followed by one frame per chunk, and ends with a
+     * frame header whose compressed_size and uncompressed_size are both zero. Each frame consists
+     * of a frame header and compressed_size bytes of raw deflate data, which decompress to
+     * uncompressed_size bytes; all chunks but the last have the stream's chunk_size. Frames can be
+     * decompressed independently of each other.
+     *
+     * The end frame is followed by the chunk index, one index entry per frame, and a footer that
+     * locates the index. A reader that wants random access reads the footer from the end of the
+     * file, then the index, and from there on only the frames it needs (see
+     * compress_stream_reader). A reader that streams through the file can stop at the end frame.
+     */
+    namespace compress_stream_format {
+        constexpr auto magic = std::array<char, 4> { 'S', 'H', 'C', 'Z' };
+        constexpr auto index_magic = std::array<char, 4> { 'S', 'H', 'C', 'X' };
+        constexpr std::uint32_t version = 1;
+
+        struct stream_header {
+            static constexpr std::size_t encoded_size = 16;
+
+            std::uint32_t version = compress_stream_format::version;
+            std::uint64_t chunk_size = 0;
+
+            auto encode(std::span<std::byte, encoded_size> out) const -> void;
+
+            /**
+             * @return the decoded header, or nullopt if the data doesn't start with the magic
+             */
+            [[nodiscard]] static auto decode(std::span<std::byte const, encoded_size> in) -> std::optional<stream_header>;
+        };
+
+        struct frame_header {
+            static constexpr std::size_t encoded_size = 16;
+
+            std::uint32_t compressed_size = 0;
+            std::uint32_t uncompressed_size = 0;
+            /// checksums of the uncompressed data as reported by the device
+            std::uint32_t crc = 0;
+            std::uint32_t adler = 0;
+
+            [[nodiscard]] auto is_end() const noexcept -> bool {
+                return compressed_size == 0 && uncompressed_size == 0;
+            }
+
+            auto encode(std::span<std::byte, encoded_size> out) const -> void;
+            [[nodiscard]] static auto decode(std::span<std::byte const, encoded_size> in) -> frame_header;
+        };
+
+        /**
+         * Location and checksums of a frame. The uncompressed data of chunk i starts at
+         * i * chunk_size.
+         */
+        struct index_entry {
+            static constexpr std::size_t encoded_size = 24;
+
+            /// file offset of the frame's compressed data (i.e. behind its frame header)
+            std::uint64_t offset = 0;
+            std::uint32_t compressed_size = 0;
+            std::uint32_t uncompressed_size = 0;
+            std::uint32_t crc = 0;
+            std::uint32_t adler = 0;
+
+            auto encode(std::span<std::byte, encoded_size> out) const -> void;
+            [[nodiscard]] static auto decode(std::span<std::byte const, encoded_size> in) -> index_entry;
+        };
+
+        /**
+         * Last bytes of the file
+         */
+        struct stream_footer {
+            static constexpr std::size_t encoded_size = 24;
+
+            /// file offset of the first index entry
+            std::uint64_t index_offset = 0;
+            std::uint64_t chunk_count = 0;
+
+            auto encode(std::span<std::byte, encoded_size> out) const -> void;
+
+            /**
+             * @return the decoded footer, or nullopt if the data doesn't end with the index magic
+             */
+            [[nodiscard]] static auto decode(std::span<std::byte const, encoded_size> in) -> std::optional<stream_footer>;
+        };
+    }
+
+    /**
+     * Results of a compress_stream run
+     */
+    struct compress_stream_stats {
+        std::uint64_t chunks = 0;
+        std::uint64_t bytes_in = 0;
+        /// including headers
+        std::uint64_t bytes_out = 0;
+    };
+
+    /**
+     * Compresses files of arbitrary size with bounded memory. The input is read in chunks of a
+     * fixed size into a ring of max_tasks + read_ahead chunk buffers; up to max_tasks of them are
+     * being compressed at any time while the rest are already filled for the next tasks. Compressed
+     * chunks are written out in input order, framed as described in compress_stream_format.
+     *
+     * The chunk buffers are allocated and mapped once, on construction, so one compress_stream can
+     * be used for many files (one at a time).
+     */
+    class compress_stream {
+    public:
+        /**
+         * @param dev device the chunk buffers are mapped to, i.e. the one the compress_context runs on
+         * @param cfg chunk size, parallelism, I/O backend
+         */
+        compress_stream(device const &dev, compress_stream_config const &cfg = {});
+
+        /**
+         * Compress everything from in_fd (read from its start) to out_fd (written from its start).
+         * The file descriptors stay open and owned by the caller.
+         *
+         * Throws doca_exception if a task fails and std::system_error on I/O errors.
+         *
+         * @param ctx compression backend, e.g. a running compress_context with max_tasks >= cfg.max_tasks
+         * @param in_fd input file descriptor, must support pread (i.e. be a regular file or block device)
+         * @param out_fd output file descriptor, must support pwrite
+         */
+        [[nodiscard]] auto run(compress_backend &ctx, int in_fd, int out_fd) -> boost::cobalt::task<compress_stream_stats>;
+
+        [[nodiscard]] auto config() const noexcept -> compress_stream_config const & { return cfg_; }
+
+    private:
+        struct slot {
+            std::size_t length = 0;
+            compress_checksums checksums;
+            compress_awaitable task;
+        };
+
+        compress_stream_config cfg_;
+        std::size_t slot_count_;
+        std::size_t dst_chunk_size_;
+        aligned_blocks src_blocks_;
+        aligned_blocks dst_blocks_;
+        memory_map src_mmap_;
+        memory_map dst_mmap_;
+        buffer_inventory inventory_;
+        buffer_array src_buffers_;
+        buffer_array dst_buffers_;
+    };
+
+    /**
+     * Configuration for a compress_stream_reader
+     */
+    struct compress_stream_reader_config {
+        /// Maximum number of decompression tasks in flight. Must not exceed the context's max_tasks.
+        std::uint32_t max_tasks = 16;
+        /// Compare the CRC and Adler-32 checksums of each decompressed chunk with the ones recorded
+        /// in the index
+        bool verify_checksums = true;
+        /// How to read the compressed frames
+        stream_io io = stream_io::pread;
+        /// Where and how the chunk buffers are allocated
+        memory_policy memory;
+    };
+
+    /**
+     * Random access to files written by compress_stream. Uses the chunk index to decompress only
+     * the chunks that cover a requested byte range, several of them in parallel.
+     *
+     * The header, footer and index are read on construction; the chunk buffers are allocated and
+     * mapped then, too. Since reads share these buffers, only one read may be in progress at a
+     * time.
+     */
+    class compress_stream_reader {
+    public:
+        /**
+         * @param dev device the chunk buffers are mapped to, i.e. the one the compress_context runs on
+         * @param fd file descriptor of the compressed file. Stays open and owned by the caller.
+         * @param cfg parallelism and verification
+         *
+         * Throws doca_exception with DOCA_ERROR_INVALID_VALUE if the file has no valid header,
+         * footer or index, and std::system_error on I/O errors.
+         */
+        compress_stream_reader(device const &dev, int fd, compress_stream_reader_config const &cfg = {});
+
+        /**
+         * @return size of the uncompressed data
+         */
+        [[nodiscard]] auto size() const noexcept -> std::uint64_t { return size_; }
+        [[nodiscard]] auto chunk_size() const noexcept -> std::uint64_t { return header_.chunk_size; }
+
+        [[nodiscard]] auto index() const noexcept -> std::span<compress_stream_format::index_entry const> {
+            return index_;
+        }
+
+        /**
+         * Decompress the uncompressed bytes [offset, offset + out.size()) into out. Reads fewer
+         * bytes only if the range extends past the end of the data.
+         *
+         * Throws doca_exception if a task fails or with DOCA_ERROR_IO_FAILED if a checksum doesn't
+         * match, and std::system_error on I/O errors.
+         *
+         * @param ctx compression backend, e.g. a running compress_context with max_tasks >= cfg.max_tasks
+         * @param offset start of the range in the uncompressed data
+         * @param out destination of the uncompressed data
+         * @return number of bytes read
+         */
+        [[nodiscard]] auto read(compress_backend &ctx, std::uint64_t offset, std::span<std::byte> out) -> boost::cobalt::task<std::size_t>;
+
+    private:
+        struct slot {
+            std::uint64_t chunk = 0;
+            compress_checksums checksums;
+            compress_awaitable task;
+        };
+
+        int fd_;
+        compress_stream_reader_config cfg_;
+        compress_stream_format::stream_header header_;
+        std::vector<compress_stream_format::index_entry> index_;
+        std::uint64_t size_;
+        std::size_t src_chunk_size_;
+        aligned_blocks src_blocks_;
+        aligned_blocks dst_blocks_;
+        memory_map src_mmap_;
+        memory_map dst_mmap_;
+        buffer_inventory inventory_;
+        buffer_array src_buffers_;
+        buffer_array dst_buffers_;
+    };
+}
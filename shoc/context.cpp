@@ -61,6 +61,14 @@ namespace shoc {
         engine()->connect(this);        
     }
 
+    auto context_base::reserve_receptables(std::size_t size, std::size_t count) -> void {
+        engine()->receptables().reserve(this, size, count);
+    }
+
+    auto context_base::release_receptables() noexcept -> void {
+        engine()->receptables().release(this);
+    }
+
     auto context_state_awaitable::await_ready() const noexcept -> bool {
         // depending on the concrete context, doca_ctx_start will go either into DOCA_CTX_STATE_STARTING,
         // in which case this awaitable has to suspend and wait for an async event to continue, or
@@ -172,6 +172,19 @@ namespace shoc {
 
         auto connect_to_engine() -> void;
 
+        /**
+         * Reserve space for count receptables of type T in the engine's receptable pool. The
+         * reservation adds to those of the other contexts on the engine and is dropped when this
+         * context stops.
+         */
+        template<typename T>
+        auto reserve_receptables(std::size_t count) -> void {
+            reserve_receptables(sizeof(T), count);
+        }
+
+        auto reserve_receptables(std::size_t size, std::size_t count) -> void;
+        auto release_receptables() noexcept -> void;
+
         template<std::derived_from<context_base> BaseContext>
         friend class dependent_contexts;
         friend class context_state_awaitable;
@@ -274,6 +287,7 @@ namespace shoc {
 
                 auto coro = std::exchange(obj->coro_stop_, nullptr);
                 obj->handle_.reset(nullptr);
+                obj->release_receptables();
                 // may delete obj if coro is nullptr and there's no coroutine holding on to
                 // this context anymore, so we can't use it after this.
                 obj->parent_->signal_stopped_child(obj);
@@ -0,0 +1,336 @@
+#pragma once
+
+#include "value_awaitable.hpp"
+
+#include <shoc/error.hpp>
+
+#include <array>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Combinators for waiting on several offloaded tasks at once.
+ *
+ * Awaiting tasks strictly in submission order causes head-of-line blocking when they complete
+ * out of order. when_any() resumes the waiting coroutine as soon as any one of a range of
+ * awaitables completes, when_all() once all of them have. Neither allocates: they register
+ * themselves as completion observer with the awaitables' receptables, and the awaitable objects
+ * themselves live in the waiting coroutine's frame.
+ *
+ * Empty (default-constructed) awaitables in the range are ignored, so a fixed-size array of
+ * awaitables can be used as a ring of task slots. bounded_inflight wraps that pattern:
+ *
+ * shoc::coro::bounded_inflight<shoc::compress_awaitable, 4> inflight;
+ *
+ * for(auto i : ...) {
+ *     if(inflight.full()) {
+ *         auto done = co_await inflight.next();
+ *         // done.slot, done.value
+ *     }
+ *
+ *     inflight.push(compress->compress(src[i], dst[i]));
+ * }
+ */
+namespace shoc::coro {
+    /**
+     * Awaitables that keep their result in a value_receptable (value_awaitable, status_awaitable)
+     */
+    template<typename Awaitable>
+    concept receptable_awaitable = requires(Awaitable &awaitable, completion_observer *observer) {
+        awaitable.receptable_ptr()->set_observer(observer, std::size_t {});
+        awaitable.receptable_ptr()->clear_observer();
+        { awaitable.receptable_ptr()->has_value() } -> std::convertible_to<bool>;
+        awaitable.await_resume();
+    };
+
+    template<typename Range>
+    concept receptable_awaitable_range =
+        std::ranges::random_access_range<Range>
+        && std::ranges::sized_range<Range>
+        && receptable_awaitable<std::ranges::range_value_t<Range>>;
+
+    namespace detail {
+        /**
+         * Common parts of when_any and when_all: attaching to and detaching from all receptables
+         * in the range that are still waiting for a result.
+         */
+        template<receptable_awaitable_range Range>
+        class range_observer:
+            protected completion_observer
+        {
+        protected:
+            explicit range_observer(Range &range):
+                range_ { range }
+            {}
+
+            range_observer(range_observer const &) = delete;
+            range_observer(range_observer &&) = delete;
+            range_observer &operator=(range_observer const &) = delete;
+            range_observer &operator=(range_observer &&) = delete;
+
+            ~range_observer() {
+                detach();
+            }
+
+            [[nodiscard]] auto size() -> std::size_t {
+                return std::ranges::size(range_);
+            }
+
+            /**
+             * @return the receptable of the i-th awaitable, nullptr if it is empty
+             */
+            [[nodiscard]] auto receptable(std::size_t i) {
+                return std::ranges::begin(range_)[i].receptable_ptr();
+            }
+
+            auto attach(std::coroutine_handle<> waiter) -> void {
+                waiter_ = waiter;
+
+                for(std::size_t i = 0; i < size(); ++i) {
+                    auto r = receptable(i);
+
+                    if(r != nullptr && !r->has_value()) {
+                        r->set_observer(this, i);
+                    }
+                }
+
+                attached_ = true;
+            }
+
+            auto detach() noexcept -> void {
+                if(!attached_) {
+                    return;
+                }
+
+                for(std::size_t i = 0; i < size(); ++i) {
+                    if(auto r = receptable(i); r != nullptr) {
+                        r->clear_observer();
+                    }
+                }
+
+                attached_ = false;
+            }
+
+            Range &range_;
+            std::coroutine_handle<> waiter_;
+            bool attached_ = false;
+        };
+    }
+
+    /**
+     * Awaitable that resumes the waiting coroutine as soon as one of the awaitables in a range
+     * has its result. co_await yields the index of that awaitable, which can then be co_awaited
+     * without suspending. Completed awaitables must be replaced or reset before waiting on the
+     * range again, or they will be reported again right away.
+     *
+     * Throws DOCA_ERROR_EMPTY if all awaitables in the range are empty.
+     */
+    template<receptable_awaitable_range Range>
+    class [[nodiscard]] when_any_awaitable:
+        private detail::range_observer<Range>
+    {
+        using base = detail::range_observer<Range>;
+
+    public:
+        explicit when_any_awaitable(Range &range):
+            base { range }
+        {}
+
+        auto await_ready() -> bool {
+            bool any_participant = false;
+
+            for(std::size_t i = 0; i < base::size(); ++i) {
+                auto r = base::receptable(i);
+
+                if(r == nullptr) {
+                    continue;
+                }
+
+                if(r->has_value()) {
+                    completed_ = i;
+                    return true;
+                }
+
+                any_participant = true;
+            }
+
+            enforce(any_participant, DOCA_ERROR_EMPTY);
+            return false;
+        }
+
+        auto await_suspend(std::coroutine_handle<> handle) -> void {
+            base::attach(handle);
+        }
+
+        [[nodiscard]] auto await_resume() const noexcept -> std::size_t {
+            return completed_;
+        }
+
+    private:
+        auto on_completion(std::size_t tag) -> void override {
+            completed_ = tag;
+
+            // detach before resuming so that later completions don't resume the waiter again.
+            base::detach();
+            base::waiter_.resume();
+        }
+
+        std::size_t completed_ = 0;
+    };
+
+    /**
+     * Awaitable that resumes the waiting coroutine once all awaitables in a range have their
+     * results. The results themselves are obtained by co_awaiting the individual awaitables
+     * afterwards, which does not suspend anymore.
+     */
+    template<receptable_awaitable_range Range>
+    class [[nodiscard]] when_all_awaitable:
+        private detail::range_observer<Range>
+    {
+        using base = detail::range_observer<Range>;
+
+    public:
+        explicit when_all_awaitable(Range &range):
+            base { range }
+        {}
+
+        auto await_ready() -> bool {
+            remaining_ = 0;
+
+            for(std::size_t i = 0; i < base::size(); ++i) {
+                if(auto r = base::receptable(i); r != nullptr && !r->has_value()) {
+                    ++remaining_;
+                }
+            }
+
+            return remaining_ == 0;
+        }
+
+        auto await_suspend(std::coroutine_handle<> handle) -> void {
+            base::attach(handle);
+        }
+
+        auto await_resume() const noexcept -> void {}
+
+    private:
+        auto on_completion(std::size_t tag) -> void override {
+            base::receptable(tag)->clear_observer();
+
+            if(--remaining_ == 0) {
+                base::attached_ = false;
+                base::waiter_.resume();
+            }
+        }
+
+        std::size_t remaining_ = 0;
+    };
+
+    /**
+     * Wait for the first of a range of awaitables to complete. See when_any_awaitable.
+     */
+    template<receptable_awaitable_range Range>
+    [[nodiscard]] auto when_any(Range &range) {
+        return when_any_awaitable<Range> { range };
+    }
+
+    /**
+     * Wait for all of a range of awaitables to complete. See when_all_awaitable.
+     */
+    template<receptable_awaitable_range Range>
+    [[nodiscard]] auto when_all(Range &range) {
+        return when_all_awaitable<Range> { range };
+    }
+
+    /**
+     * Result of bounded_inflight::next(): the slot that completed and its result.
+     */
+    template<typename T>
+    struct inflight_completion {
+        std::size_t slot;
+        T value;
+    };
+
+    /**
+     * Fixed number of slots for in-flight tasks, to keep an accelerator's queue filled without
+     * waiting for tasks in submission order. push() puts a task into a free slot, next() waits
+     * for whichever task completes first and frees its slot.
+     */
+    template<receptable_awaitable Awaitable, std::size_t N>
+    class bounded_inflight {
+    public:
+        static_assert(N > 0);
+
+        using result_type = std::remove_cvref_t<decltype(std::declval<Awaitable&>().await_resume())>;
+
+        [[nodiscard]] static constexpr auto capacity() noexcept { return N; }
+        [[nodiscard]] auto size() const noexcept { return count_; }
+        [[nodiscard]] auto empty() const noexcept { return count_ == 0; }
+        [[nodiscard]] auto full() const noexcept { return count_ == N; }
+
+        /**
+         * Put an awaitable into a free slot. Throws DOCA_ERROR_FULL if there is none.
+         *
+         * @return index of the slot, reported back by next() when the awaitable completes
+         */
+        auto push(Awaitable &&awaitable) -> std::size_t {
+            enforce(!full(), DOCA_ERROR_FULL);
+
+            for(std::size_t i = 0; i < N; ++i) {
+                if(slots_[i].receptable_ptr() == nullptr) {
+                    slots_[i] = std::move(awaitable);
+                    ++count_;
+                    return i;
+                }
+            }
+
+            throw doca_exception(DOCA_ERROR_UNEXPECTED);
+        }
+
+        /**
+         * Wait for the first in-flight awaitable to complete. co_await yields an
+         * inflight_completion with the slot index and the awaitable's result, or rethrows
+         * the awaitable's exception. Either way, the slot is free afterwards.
+         *
+         * Throws DOCA_ERROR_EMPTY if nothing is in flight.
+         */
+        [[nodiscard]] auto next() {
+            return next_awaitable { this };
+        }
+
+    private:
+        class [[nodiscard]] next_awaitable {
+        public:
+            explicit next_awaitable(bounded_inflight *parent):
+                parent_ { parent },
+                any_ { parent->slots_ }
+            {}
+
+            auto await_ready() -> bool {
+                return any_.await_ready();
+            }
+
+            auto await_suspend(std::coroutine_handle<> handle) -> void {
+                any_.await_suspend(handle);
+            }
+
+            auto await_resume() -> inflight_completion<result_type> {
+                auto slot = any_.await_resume();
+                auto done = std::exchange(parent_->slots_[slot], Awaitable {});
+                --parent_->count_;
+
+                return { slot, done.await_resume() };
+            }
+
+        private:
+            bounded_inflight *parent_;
+            when_any_awaitable<std::array<Awaitable, N>> any_;
+        };
+
+        std::array<Awaitable, N> slots_;
+        std::size_t count_ = 0;
+    };
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "combinators.hpp"
+
+#include <shoc/error.hpp>
+
+#include <boost/asio/cancellation_signal.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/cobalt/this_thread.hpp>
+#include <boost/system/system_error.hpp>
+
+#include <chrono>
+#include <coroutine>
+#include <memory>
+#include <optional>
+#include <utility>
+
+/**
+ * Deadlines and cancellation for awaitables, e.g.
+ *
+ * auto status = co_await shoc::coro::with_timeout(ctx->receive(buf), 500us);
+ *
+ * If the deadline passes before the task completes, co_await throws a doca_exception with
+ * DOCA_ERROR_TIME_OUT. If the waiting coroutine is cancelled through its Boost.Cobalt/asio
+ * cancellation slot (e.g. by losing a cobalt::race), co_await throws a boost::system::system_error
+ * with boost::asio::error::operation_aborted.
+ *
+ * Either way the task itself keeps running, since DOCA has no way of taking a submitted task back.
+ * Its receptable is orphaned: it owns itself from then on and is reclaimed when DOCA finally
+ * completes the task (or flushes it when the context stops), and the task's result is discarded.
+ * Data buffers passed to the task must still be kept alive until then.
+ */
+namespace shoc::coro {
+    template<typename Awaitable>
+    concept orphanable_awaitable = receptable_awaitable<Awaitable> && requires(Awaitable &awaitable) {
+        awaitable.orphan();
+    };
+
+    /**
+     * Wrapper around an awaitable that stops waiting when a deadline passes or the waiting
+     * coroutine is cancelled. See with_timeout, with_deadline, and cancellable.
+     */
+    template<orphanable_awaitable Awaitable>
+    class [[nodiscard]] deadline_awaitable:
+        private completion_observer
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        deadline_awaitable(Awaitable &&inner, std::optional<clock::time_point> deadline):
+            inner_ { std::move(inner) },
+            deadline_ { deadline }
+        {}
+
+        deadline_awaitable(deadline_awaitable const &) = delete;
+        deadline_awaitable(deadline_awaitable &&) = delete;
+        deadline_awaitable &operator=(deadline_awaitable const &) = delete;
+        deadline_awaitable &operator=(deadline_awaitable &&) = delete;
+
+        ~deadline_awaitable() {
+            if(state_ == nullptr) {
+                return;
+            }
+
+            state_->finished = true;
+            cancellation_slot_.clear();
+
+            if(suspended_) {
+                // the waiting coroutine was destroyed while it waited, the task is still out there.
+                inner_.orphan();
+            }
+        }
+
+        auto await_ready() -> bool {
+            if(inner_.await_ready()) {
+                return true;
+            }
+
+            // nothing to wait for if the deadline has passed already
+            if(deadline_ && *deadline_ <= clock::now()) {
+                outcome_ = outcome::timed_out;
+                inner_.orphan();
+                return true;
+            }
+
+            return false;
+        }
+
+        template<typename Promise>
+        auto await_suspend(std::coroutine_handle<Promise> handle) -> void {
+            auto executor = boost::cobalt::this_thread::get_executor();
+
+            inner_.receptable_ptr()->set_observer(this, 0);
+            state_ = std::make_shared<wait_state>();
+            waiter_ = handle;
+            suspended_ = true;
+
+            if(deadline_) {
+                timer_.emplace(executor, *deadline_);
+                timer_->async_wait([this, state = state_](boost::system::error_code) {
+                    if(!state->finished) {
+                        give_up(outcome::timed_out);
+                    }
+                });
+            }
+
+            if constexpr(requires { handle.promise().get_cancellation_slot(); }) {
+                auto slot = handle.promise().get_cancellation_slot();
+
+                if(slot.is_connected()) {
+                    cancellation_slot_ = slot;
+
+                    // don't resume from within the cancellation signal's emit(); go through the
+                    // executor like asio operations do.
+                    slot.assign([this, executor, state = state_](boost::asio::cancellation_type) {
+                        boost::asio::post(executor, [this, state] {
+                            if(!state->finished) {
+                                give_up(outcome::cancelled);
+                            }
+                        });
+                    });
+                }
+            }
+        }
+
+        [[nodiscard]]
+        auto await_resume() {
+            switch(outcome_) {
+            case outcome::timed_out:
+                throw doca_exception(DOCA_ERROR_TIME_OUT);
+            case outcome::cancelled:
+                throw boost::system::system_error(boost::asio::error::operation_aborted);
+            default:
+                return inner_.await_resume();
+            }
+        }
+
+    private:
+        enum class outcome {
+            pending,
+            timed_out,
+            cancelled
+        };
+
+        /**
+         * Shared with the timer and cancellation handlers, which may run after the awaitable is
+         * gone.
+         */
+        struct wait_state {
+            bool finished = false;
+        };
+
+        auto finish() -> void {
+            state_->finished = true;
+            suspended_ = false;
+            cancellation_slot_.clear();
+
+            if(timer_) {
+                timer_->cancel();
+            }
+        }
+
+        auto on_completion([[maybe_unused]] std::size_t tag) -> void override {
+            finish();
+            inner_.receptable_ptr()->clear_observer();
+            waiter_.resume();
+        }
+
+        auto give_up(outcome reason) -> void {
+            finish();
+            outcome_ = reason;
+            inner_.orphan();
+            waiter_.resume();
+        }
+
+        Awaitable inner_;
+        std::optional<clock::time_point> deadline_;
+        std::optional<boost::asio::steady_timer> timer_;
+        boost::asio::cancellation_slot cancellation_slot_;
+        std::shared_ptr<wait_state> state_;
+        std::coroutine_handle<> waiter_;
+        outcome outcome_ = outcome::pending;
+        bool suspended_ = false;
+    };
+
+    /**
+     * Wait for an awaitable for at most timeout, then throw a doca_exception with
+     * DOCA_ERROR_TIME_OUT. The wait can also be cancelled through the waiting coroutine's
+     * cancellation slot.
+     */
+    template<orphanable_awaitable Awaitable, typename Rep, typename Period>
+    [[nodiscard]] auto with_timeout(Awaitable awaitable, std::chrono::duration<Rep, Period> timeout) {
+        return deadline_awaitable<Awaitable> {
+            std::move(awaitable),
+            std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout)
+        };
+    }
+
+    /**
+     * Like with_timeout, but with an absolute deadline.
+     */
+    template<orphanable_awaitable Awaitable>
+    [[nodiscard]] auto with_deadline(Awaitable awaitable, std::chrono::steady_clock::time_point deadline) {
+        return deadline_awaitable<Awaitable> { std::move(awaitable), deadline };
+    }
+
+    /**
+     * Wait for an awaitable without a deadline, but such that the wait can be cancelled through
+     * the waiting coroutine's cancellation slot.
+     */
+    template<orphanable_awaitable Awaitable>
+    [[nodiscard]] auto cancellable(Awaitable awaitable) {
+        return deadline_awaitable<Awaitable> { std::move(awaitable), std::nullopt };
+    }
+}
@@ -14,5 +14,10 @@ namespace shoc::coro {
 
         virtual auto set_exception(std::exception_ptr ex) -> void = 0;
         virtual auto set_error(doca_error_t err) -> void = 0;
+
+        /**
+         * Resume the coroutine waiting for the result, if any
+         */
+        virtual auto resume() -> void = 0;
     };
 }
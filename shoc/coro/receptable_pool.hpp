@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace shoc::coro {
+    /**
+     * Allocation counters of a receptable_pool. In the steady state, heap_allocations should
+     * not grow anymore; every receptable is then served from the free lists.
+     */
+    struct receptable_pool_stats {
+        /// number of receptables served from a free list
+        std::uint64_t pooled_allocations = 0;
+        /// number of times the pool had to go to the heap (chunk refills and oversized receptables)
+        std::uint64_t heap_allocations = 0;
+        /// receptables currently handed out
+        std::size_t in_use = 0;
+        /// total number of pooled receptable slots across all size classes
+        std::size_t capacity = 0;
+    };
+
+    /**
+     * Slab/free-list allocator for receptables.
+     *
+     * Every offloaded task needs a receptable that lives until the task's completion callback has
+     * run and the waiting coroutine has picked up the result. Allocating those on the heap puts the
+     * allocator on the hot path at high task rates, so the progress engine owns one of these pools
+     * and recycles receptable memory through it.
+     *
+     * Receptable types differ in size (they may carry additional-data pointers or arbitrary
+     * payloads), so memory is handed out in size classes of block_granularity bytes. Each size
+     * class has an intrusive free list; when it runs dry, a chunk of several blocks is allocated
+     * at once. Receptables larger than the largest size class fall back to plain heap allocation.
+     *
+     * Like the progress engine itself, this is not threadsafe. The pool must outlive all
+     * receptables allocated from it.
+     */
+    class receptable_pool {
+    public:
+        static constexpr std::size_t block_granularity = 64;
+        static constexpr std::size_t size_class_count = 8;
+        static constexpr std::size_t max_block_size = block_granularity * size_class_count;
+        static constexpr std::size_t default_chunk_blocks = 16;
+
+        receptable_pool() = default;
+
+        receptable_pool(receptable_pool const &) = delete;
+        receptable_pool(receptable_pool &&) = delete;
+        receptable_pool &operator=(receptable_pool const &) = delete;
+        receptable_pool &operator=(receptable_pool &&) = delete;
+
+        ~receptable_pool() {
+            for(auto chunk : chunks_) {
+                ::operator delete(chunk, std::align_val_t { block_granularity });
+            }
+        }
+
+        /**
+         * Make sure count receptables of type T can be allocated for owner without going to the
+         * heap. Reservations add up: every owner (usually a context) gets its own share of the
+         * pool on top of everybody else's, and repeated reservations by the same owner add to
+         * its share as well.
+         */
+        template<typename T>
+        auto reserve(void const *owner, std::size_t count) -> void {
+            reserve(owner, sizeof(T), count);
+        }
+
+        auto reserve(void const *owner, std::size_t size, std::size_t count) -> void {
+            if(size > max_block_size || count == 0) {
+                return;
+            }
+
+            auto cls = size_class(size);
+            auto existing = std::ranges::find_if(reservations_, [&](reservation const &r) {
+                return r.owner == owner && r.cls == cls;
+            });
+
+            if(existing != reservations_.end()) {
+                existing->count += count;
+            } else {
+                reservations_.push_back({ owner, cls, count });
+            }
+
+            reserved_[cls] += count;
+
+            if(capacities_[cls] < reserved_[cls]) {
+                refill(cls, reserved_[cls] - capacities_[cls]);
+            }
+        }
+
+        /**
+         * Drop all reservations of owner, e.g. when a context stops. The memory stays in the
+         * pool and counts towards later reservations.
+         */
+        auto release(void const *owner) noexcept -> void {
+            std::erase_if(reservations_, [&](reservation const &r) {
+                if(r.owner != owner) {
+                    return false;
+                }
+
+                reserved_[r.cls] -= r.count;
+                return true;
+            });
+        }
+
+        /**
+         * Allocate raw memory for a receptable of the given size.
+         */
+        [[nodiscard]]
+        auto allocate(std::size_t size) -> void* {
+            if(size > max_block_size) {
+                ++stats_.heap_allocations;
+                ++stats_.in_use;
+                return ::operator new(size, std::align_val_t { block_granularity });
+            }
+
+            auto cls = size_class(size);
+
+            if(free_lists_[cls] == nullptr) {
+                refill(cls, default_chunk_blocks);
+            }
+
+            auto block = std::exchange(free_lists_[cls], free_lists_[cls]->next);
+            ++stats_.pooled_allocations;
+            ++stats_.in_use;
+
+            return block;
+        }
+
+        /**
+         * Return memory obtained from allocate(size) to the pool.
+         */
+        auto deallocate(void *ptr, std::size_t size) noexcept -> void {
+            --stats_.in_use;
+
+            if(size > max_block_size) {
+                ::operator delete(ptr, std::align_val_t { block_granularity });
+                return;
+            }
+
+            auto cls = size_class(size);
+            free_lists_[cls] = ::new(ptr) free_block { free_lists_[cls] };
+        }
+
+        [[nodiscard]]
+        auto stats() const noexcept -> receptable_pool_stats const & {
+            return stats_;
+        }
+
+    private:
+        struct free_block {
+            free_block *next;
+        };
+
+        struct reservation {
+            void const *owner;
+            std::size_t cls;
+            std::size_t count;
+        };
+
+        [[nodiscard]]
+        static constexpr auto size_class(std::size_t size) noexcept -> std::size_t {
+            return size == 0 ? 0 : (size - 1) / block_granularity;
+        }
+
+        auto refill(std::size_t cls, std::size_t block_count) -> void {
+            auto block_size = (cls + 1) * block_granularity;
+            auto chunk = static_cast<std::byte*>(::operator new(block_size * block_count, std::align_val_t { block_granularity }));
+
+            chunks_.push_back(chunk);
+            ++stats_.heap_allocations;
+            stats_.capacity += block_count;
+            capacities_[cls] += block_count;
+
+            for(std::size_t i = 0; i < block_count; ++i) {
+                free_lists_[cls] = ::new(chunk + i * block_size) free_block { free_lists_[cls] };
+            }
+        }
+
+        std::array<free_block*, size_class_count> free_lists_ {};
+        std::array<std::size_t, size_class_count> capacities_ {};
+        std::array<std::size_t, size_class_count> reserved_ {};
+        std::vector<reservation> reservations_;
+        std::vector<void*> chunks_;
+        receptable_pool_stats stats_;
+    };
+
+    /**
+     * Deleter for receptables that may or may not come from a receptable_pool. Without a pool, the
+     * receptable is assumed to be allocated with plain new.
+     *
+     * The deleter only holds a plain pointer to the pool, so the pool must outlive every
+     * receptable allocated from it. For the progress engine's pool, this means that awaitables of
+     * offloaded tasks must not outlive the engine.
+     */
+    template<typename Receptable>
+    struct receptable_deleter {
+        receptable_pool *pool = nullptr;
+
+        auto operator()(Receptable *ptr) const noexcept -> void {
+            if(pool != nullptr) {
+                ptr->~Receptable();
+                pool->deallocate(ptr, sizeof(Receptable));
+            } else {
+                delete ptr;
+            }
+        }
+    };
+
+    template<typename Receptable>
+    using pooled_receptable = std::unique_ptr<Receptable, receptable_deleter<Receptable>>;
+
+    /**
+     * Create a receptable, from a pool if one is given and on the heap otherwise.
+     */
+    template<typename Receptable, typename... Args>
+    [[nodiscard]]
+    auto make_receptable(receptable_pool *pool, Args&&... args) -> pooled_receptable<Receptable> {
+        static_assert(alignof(Receptable) <= receptable_pool::block_granularity);
+
+        if(pool == nullptr) {
+            return pooled_receptable<Receptable> { new Receptable(std::forward<Args>(args)...) };
+        }
+
+        auto mem = pool->allocate(sizeof(Receptable));
+
+        try {
+            auto obj = ::new(mem) Receptable(std::forward<Args>(args)...);
+            return pooled_receptable<Receptable> { obj, receptable_deleter<Receptable> { pool } };
+        } catch(...) {
+            pool->deallocate(mem, sizeof(Receptable));
+            throw;
+        }
+    }
+}
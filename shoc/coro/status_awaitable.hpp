@@ -1,5 +1,6 @@
 #pragma once
 
+#include "receptable_pool.hpp"
 #include "value_awaitable.hpp"
 
 #include <shoc/common/overload.hpp>
@@ -100,6 +101,13 @@ namespace shoc::coro {
             return additional_data_;
         }
 
+        /**
+         * Forget the additional data buffer so that a late result is not written into it.
+         */
+        auto drop_additional_data() noexcept -> void {
+            additional_data_ = {};
+        }
+
     private:
         additional_data_reference<AdditionalData> additional_data_;
     };
@@ -126,17 +134,26 @@ namespace shoc::coro {
 
         [[nodiscard]]
         static auto create_space(AdditionalData *additional_data_buffer = nullptr) {
-            return status_awaitable { std::make_unique<payload_type>(additional_data_buffer) };
+            return status_awaitable { make_receptable<payload_type>(nullptr, additional_data_buffer) };
+        }
+
+        /**
+         * Like create_space(additional_data_buffer), but takes the receptable from a pool instead
+         * of the heap. Used on the task offloading path.
+         */
+        [[nodiscard]]
+        static auto create_space(receptable_pool &pool, AdditionalData *additional_data_buffer = nullptr) {
+            return status_awaitable { make_receptable<payload_type>(&pool, additional_data_buffer) };
         }
 
         [[nodiscard]]
         static auto from_value(doca_error_t status) {
-            return status_awaitable { std::make_unique<payload_type>(status) };
+            return status_awaitable { make_receptable<payload_type>(nullptr, status) };
         }
 
         [[nodiscard]]
         static auto from_exception(std::exception_ptr ex) {
-            return status_awaitable { std::make_unique<payload_type>(ex) };
+            return status_awaitable { make_receptable<payload_type>(nullptr, ex) };
         }
 
         [[nodiscard]]
@@ -144,6 +161,17 @@ namespace shoc::coro {
             return dest_.get();
         }
 
+        /**
+         * Stop caring about the result. The receptable is left to clean up after itself when the
+         * task completes, the additional data buffer will not be written to anymore, and the
+         * awaitable is empty afterwards. Used when a waiting coroutine times out or is cancelled.
+         */
+        auto orphan() -> void {
+            enforce(dest_ != nullptr, DOCA_ERROR_EMPTY);
+            dest_->drop_additional_data();
+            orphan_receptable(std::move(dest_));
+        }
+
         [[nodiscard]]
         auto await_ready() const noexcept -> bool {
             enforce(dest_ != nullptr, DOCA_ERROR_EMPTY);
@@ -162,10 +190,10 @@ namespace shoc::coro {
         }
 
     private:
-        status_awaitable(std::unique_ptr<payload_type> &&dest):
+        status_awaitable(pooled_receptable<payload_type> &&dest):
             dest_ { std::move(dest) }
         {}
 
-        std::unique_ptr<payload_type> dest_;
+        pooled_receptable<payload_type> dest_;
     };
 }
\ No newline at end of file
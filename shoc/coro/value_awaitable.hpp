@@ -1,6 +1,7 @@
 #pragma once
 
 #include "error_receptable.hpp"
+#include "receptable_pool.hpp"
 
 #include <shoc/common/overload.hpp>
 #include <shoc/error.hpp>
@@ -8,11 +9,26 @@
 
 #include <cassert>
 #include <coroutine>
+#include <cstddef>
 #include <memory>
 #include <utility>
 #include <variant>
 
 namespace shoc::coro {
+    /**
+     * Alternative to a waiting coroutine: something that wants to be told when a receptable
+     * has been filled, such as the when_all/when_any combinators that watch several receptables
+     * on behalf of a single coroutine. The tag is whatever was passed to set_observer, usually
+     * the index of the receptable in a range.
+     */
+    class completion_observer {
+    public:
+        virtual auto on_completion(std::size_t tag) -> void = 0;
+
+    protected:
+        ~completion_observer() = default;
+    };
+
     /**
      * Meeting point for waiting coroutines and result-providing event callbacks. Generally
      * a pointer to this will be provided as task_user_data to offloaded tasks.
@@ -28,6 +44,11 @@ namespace shoc::coro {
         public error_receptable
     {
     public:
+        /**
+         * Destroys an orphaned receptable, see orphan()
+         */
+        using orphan_disposer = void(*)(value_receptable *self, receptable_pool *pool);
+
         value_receptable() = default;
         value_receptable(Payload &&value):
             value_ { std::move(value) }
@@ -59,17 +80,60 @@ namespace shoc::coro {
         }
 
         auto set_waiter(std::coroutine_handle<> waiter) -> void {
-            if(waiter_ != nullptr) {
+            if(waiter_ != nullptr || observer_ != nullptr) {
                 throw doca_exception(DOCA_ERROR_IN_USE);
             }
 
             waiter_ = waiter;
         }
 
-        auto resume() const {
+        /**
+         * Register an observer to be notified instead of a waiting coroutine. Only one of
+         * waiter and observer can be set at a time.
+         */
+        auto set_observer(completion_observer *observer, std::size_t tag) -> void {
+            if(waiter_ != nullptr || observer_ != nullptr) {
+                throw doca_exception(DOCA_ERROR_IN_USE);
+            }
+
+            observer_ = observer;
+            observer_tag_ = tag;
+        }
+
+        auto clear_observer() noexcept -> void {
+            observer_ = nullptr;
+        }
+
+        /**
+         * Give up on the result: nobody will wait for it anymore, but DOCA still references the
+         * receptable through a task's user data. From here on, the receptable owns itself and is
+         * destroyed by dispose when the result comes in through resume().
+         */
+        auto orphan(receptable_pool *pool, orphan_disposer dispose) noexcept -> void {
+            waiter_ = nullptr;
+            observer_ = nullptr;
+            orphan_pool_ = pool;
+            dispose_ = dispose;
+        }
+
+        [[nodiscard]]
+        auto orphaned() const noexcept -> bool {
+            return dispose_ != nullptr;
+        }
+
+        auto resume() -> void override {
             shoc::logger->trace("attempting to resume coroutine");
 
-            if(waiter_ != nullptr) {
+            if(dispose_ != nullptr) {
+                shoc::logger->trace("disposing of orphaned receptable");
+                dispose_(this, orphan_pool_);
+            } else if(observer_ != nullptr) {
+                try {
+                    observer_->on_completion(observer_tag_);
+                } catch(std::exception &e) {
+                    logger->warn("Client fiber threw exception: {}", e.what());
+                }
+            } else if(waiter_ != nullptr) {
                 try {
                     shoc::logger->trace("resuming coro {}", waiter_.address());
 
@@ -103,8 +167,33 @@ namespace shoc::coro {
     private:
         std::variant<std::monostate, std::exception_ptr, Payload> value_;
         std::coroutine_handle<> waiter_;
+        completion_observer *observer_ = nullptr;
+        std::size_t observer_tag_ = 0;
+        receptable_pool *orphan_pool_ = nullptr;
+        orphan_disposer dispose_ = nullptr;
     };
 
+    /**
+     * Hand ownership of a receptable over to the receptable itself, see value_receptable::orphan().
+     * If the result is already there, the receptable is simply destroyed.
+     */
+    template<typename Receptable>
+    auto orphan_receptable(pooled_receptable<Receptable> &&owner) -> void {
+        if(owner->has_value()) {
+            owner.reset();
+            return;
+        }
+
+        auto pool = owner.get_deleter().pool;
+
+        owner.release()->orphan(
+            pool,
+            [](auto *self, receptable_pool *pool) {
+                receptable_deleter<Receptable> { pool }(static_cast<Receptable*>(self));
+            }
+        );
+    }
+
     /**
      * Awaitable that allows a single coroutine to wait for a single value.
      *
@@ -125,7 +214,7 @@ namespace shoc::coro {
 
         value_awaitable() = default;
 
-        value_awaitable(std::unique_ptr<payload_type> &&dest):
+        value_awaitable(pooled_receptable<payload_type> &&dest):
             dest_ { std::move(dest) }
         {}
 
@@ -140,21 +229,29 @@ namespace shoc::coro {
          * Create a value_awaitable referencing an empty value_receptable.
          */
         static auto create_space() {
-            return value_awaitable { std::make_unique<payload_type>() } ;
+            return value_awaitable { make_receptable<payload_type>(nullptr) } ;
+        }
+
+        /**
+         * Create a value_awaitable referencing an empty value_receptable that is allocated from
+         * a receptable pool (usually the progress engine's), so no heap allocation is necessary.
+         */
+        static auto create_space(receptable_pool &pool) {
+            return value_awaitable { make_receptable<payload_type>(&pool) } ;
         }
 
         /**
          * create a value_awaitable from an existing value (so that coroutines will not have to wait)
          */
         static auto from_value(T &&val) {
-            return value_awaitable(std::make_unique<payload_type>(std::move(val)));
+            return value_awaitable(make_receptable<payload_type>(nullptr, std::move(val)));
         }
 
         /**
          * Create a value_awaitable that will throw an exception upon value retrieval
          */
         static auto from_exception(std::exception_ptr ex) {
-            return value_awaitable(std::make_unique<payload_type>(ex));
+            return value_awaitable(make_receptable<payload_type>(nullptr, ex));
         }
 
         /**
@@ -164,6 +261,16 @@ namespace shoc::coro {
             return from_exception(std::make_exception_ptr(doca_exception { err }));
         }
 
+        /**
+         * Stop caring about the result. The receptable is left to clean up after itself when the
+         * task completes, and the awaitable is empty afterwards. Used when a waiting coroutine
+         * times out or is cancelled.
+         */
+        auto orphan() -> void {
+            enforce(dest_ != nullptr, DOCA_ERROR_EMPTY);
+            orphan_receptable(std::move(dest_));
+        }
+
         auto await_ready() const noexcept -> bool {
             enforce(dest_ != nullptr, DOCA_ERROR_EMPTY);
 
@@ -183,6 +290,6 @@ namespace shoc::coro {
         }
 
     private:
-        std::unique_ptr<payload_type> dest_;
+        pooled_receptable<payload_type> dest_;
     };
 }
@@ -0,0 +1,244 @@
+#include "cpu_aes_gcm.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace shoc {
+    namespace {
+        using gcm_result = detail::cpu_work_result;
+
+        /**
+         * Everything a worker needs, copied out of the caller's objects so that neither the key
+         * nor the IV have to outlive the submission. The copy of the key is wiped with the job.
+         */
+        struct gcm_job {
+            gcm_job() = default;
+            gcm_job(gcm_job const &) = default;
+            gcm_job(gcm_job &&) = default;
+            gcm_job &operator=(gcm_job const &) = default;
+            gcm_job &operator=(gcm_job &&) = default;
+
+            ~gcm_job() {
+                OPENSSL_cleanse(key.data(), key.size());
+            }
+
+            bool encrypting = true;
+            std::array<std::byte, 32> key {};
+            std::size_t key_size = 0;
+            std::vector<std::byte> iv;
+            std::uint32_t tag_size = 0;
+            std::uint32_t aad_size = 0;
+            std::span<std::byte const> in;
+            std::span<std::byte> out;
+        };
+
+        struct cipher_ctx_deleter {
+            auto operator()(EVP_CIPHER_CTX *ctx) const noexcept -> void {
+                EVP_CIPHER_CTX_free(ctx);
+            }
+        };
+
+        auto gcm_cipher(std::size_t key_size) -> EVP_CIPHER const * {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            // explicitly fetched ciphers skip the provider lookup that EVP_aes_*_gcm() costs on
+            // every init, which shows with small records
+            static auto const aes_128 = EVP_CIPHER_fetch(nullptr, "AES-128-GCM", nullptr);
+            static auto const aes_256 = EVP_CIPHER_fetch(nullptr, "AES-256-GCM", nullptr);
+#else
+            static auto const aes_128 = EVP_aes_128_gcm();
+            static auto const aes_256 = EVP_aes_256_gcm();
+#endif
+
+            return key_size == 128 / 8 ? aes_128 : aes_256;
+        }
+
+        /**
+         * Per-thread cipher context, reused for every operation on the thread
+         */
+        auto cipher_context() -> EVP_CIPHER_CTX * {
+            thread_local auto ctx = std::unique_ptr<EVP_CIPHER_CTX, cipher_ctx_deleter> { EVP_CIPHER_CTX_new() };
+            enforce(ctx != nullptr, DOCA_ERROR_NO_MEMORY);
+            return ctx.get();
+        }
+
+        /**
+         * EVP_CipherUpdate in pieces that fit its int lengths. out == nullptr feeds AAD.
+         */
+        auto cipher_update(EVP_CIPHER_CTX *ctx, std::span<std::byte const> in, std::byte *out) -> bool {
+            constexpr auto max_piece = std::size_t { 1 } << 30;
+
+            while(!in.empty()) {
+                auto piece = in.first(std::min(in.size(), max_piece));
+                auto written = 0;
+
+                if(EVP_CipherUpdate(
+                    ctx,
+                    reinterpret_cast<unsigned char *>(out),
+                    &written,
+                    reinterpret_cast<unsigned char const *>(piece.data()),
+                    static_cast<int>(piece.size())
+                ) != 1) {
+                    return false;
+                }
+
+                in = in.subspan(piece.size());
+
+                if(out != nullptr) {
+                    out += written;
+                }
+            }
+
+            return true;
+        }
+
+        auto run_gcm(gcm_job const &job) -> gcm_result {
+            if(job.aad_size > job.in.size() || (!job.encrypting && job.in.size() - job.aad_size < job.tag_size)) {
+                return { DOCA_ERROR_INVALID_VALUE, 0 };
+            }
+
+            auto aad = job.in.first(job.aad_size);
+            auto body = job.in.subspan(job.aad_size, job.in.size() - job.aad_size - (job.encrypting ? 0 : job.tag_size));
+            auto produced = aad.size() + body.size() + (job.encrypting ? job.tag_size : 0);
+
+            if(produced > job.out.size()) {
+                return { DOCA_ERROR_TOO_BIG, 0 };
+            }
+
+            auto ctx = cipher_context();
+            auto enc = job.encrypting ? 1 : 0;
+            auto key = reinterpret_cast<unsigned char const *>(job.key.data());
+            auto iv = reinterpret_cast<unsigned char const *>(job.iv.data());
+            auto out_body = job.out.data() + aad.size();
+
+            auto ok = EVP_CipherInit_ex(ctx, gcm_cipher(job.key_size), nullptr, nullptr, nullptr, enc) == 1
+                && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, static_cast<int>(job.iv.size()), nullptr) == 1
+                && EVP_CipherInit_ex(ctx, nullptr, nullptr, key, iv, enc) == 1
+                && cipher_update(ctx, aad, nullptr)
+                && cipher_update(ctx, body, out_body);
+
+            if(!ok) {
+                return { DOCA_ERROR_UNEXPECTED, 0 };
+            }
+
+            // the AAD goes through unchanged, as with the device
+            std::memmove(job.out.data(), aad.data(), aad.size());
+
+            auto final_written = 0;
+
+            if(job.encrypting) {
+                auto tag = out_body + body.size();
+
+                if(
+                    EVP_CipherFinal_ex(ctx, reinterpret_cast<unsigned char *>(tag), &final_written) != 1
+                    || EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, static_cast<int>(job.tag_size), tag) != 1
+                ) {
+                    return { DOCA_ERROR_UNEXPECTED, 0 };
+                }
+            } else {
+                // EVP_CTRL_GCM_SET_TAG takes a non-const pointer but only reads from it
+                auto tag = const_cast<std::byte *>(job.in.data() + job.in.size() - job.tag_size);
+
+                if(
+                    EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, static_cast<int>(job.tag_size), tag) != 1
+                    || EVP_CipherFinal_ex(ctx, reinterpret_cast<unsigned char *>(out_body + body.size()), &final_written) != 1
+                ) {
+                    // don't leave unauthenticated plaintext behind
+                    OPENSSL_cleanse(job.out.data(), produced);
+                    return { DOCA_ERROR_INVALID_VALUE, 0 };
+                }
+            }
+
+            return { DOCA_SUCCESS, produced };
+        }
+    }
+
+    cpu_aes_gcm_backend::cpu_aes_gcm_backend(cpu_aes_gcm_config const &cfg):
+        cfg_ { cfg },
+        workers_ { cpu_worker_pool::shared_or_own(cfg.threads) }
+    {
+        enforce(gcm_cipher(128 / 8) != nullptr && gcm_cipher(256 / 8) != nullptr, DOCA_ERROR_NOT_SUPPORTED);
+
+        logger->debug("cpu_aes_gcm_backend: {} worker threads, {}", workers_->threads(), OpenSSL_version(OPENSSL_VERSION));
+    }
+
+    auto cpu_aes_gcm_backend::shared() -> std::shared_ptr<cpu_aes_gcm_backend> {
+        static auto instance = std::make_shared<cpu_aes_gcm_backend>();
+        return instance;
+    }
+
+    auto cpu_aes_gcm_backend::load_key(
+        std::span<std::byte const> key_data,
+        doca_aes_gcm_key_type key_type
+    ) -> aes_gcm_key {
+        return aes_gcm_key { nullptr, key_data, key_type };
+    }
+
+    auto cpu_aes_gcm_backend::encrypt(
+        buffer plaintext,
+        buffer dest,
+        aes_gcm_key const &key,
+        std::span<std::byte const> iv,
+        std::uint32_t tag_size,
+        std::uint32_t aad_size
+    ) -> coro::status_awaitable<> {
+        return submit(true, plaintext, dest, key, iv, tag_size, aad_size);
+    }
+
+    auto cpu_aes_gcm_backend::decrypt(
+        buffer encrypted,
+        buffer dest,
+        aes_gcm_key const &key,
+        std::span<std::byte const> iv,
+        std::uint32_t tag_size,
+        std::uint32_t aad_size
+    ) -> coro::status_awaitable<> {
+        return submit(false, encrypted, dest, key, iv, tag_size, aad_size);
+    }
+
+    auto cpu_aes_gcm_backend::submit(
+        bool encrypting,
+        buffer const &src,
+        buffer const &dest,
+        aes_gcm_key const &key,
+        std::span<std::byte const> iv,
+        std::uint32_t tag_size,
+        std::uint32_t aad_size
+    ) -> coro::status_awaitable<> {
+        if(key.material().empty() || iv.empty() || iv.size() > INT_MAX || (tag_size != 12 && tag_size != 16)) {
+            return coro::status_awaitable<>::from_value(DOCA_ERROR_INVALID_VALUE);
+        }
+
+        auto result = coro::status_awaitable<>::create_space();
+        auto receptable = result.receptable_ptr();
+
+        auto output = detail::cpu_work_output::after_data(dest);
+
+        auto job = gcm_job {};
+        job.encrypting = encrypting;
+        std::ranges::copy(key.material(), job.key.begin());
+        job.key_size = key.material().size();
+        job.iv.assign(iv.begin(), iv.end());
+        job.tag_size = tag_size;
+        job.aad_size = aad_size;
+        job.in = src.view().data<std::byte const>();
+        job.out = output.free_space;
+
+        detail::offload_to_cpu(*workers_, receptable, output, [job = std::move(job)] {
+            return run_gcm(job);
+        });
+
+        return result;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "aes_gcm.hpp"
+#include "buffer.hpp"
+#include "cpu_offload.hpp"
+
+#include <cstddef>
+#include <memory>
+
+namespace shoc {
+    /**
+     * Configuration for a cpu_aes_gcm_backend
+     */
+    struct cpu_aes_gcm_config {
+        /// Number of worker threads of a pool of its own; 0 shares cpu_worker_pool::shared()
+        std::size_t threads = 0;
+    };
+
+    /**
+     * Software implementation of AES-GCM through OpenSSL's EVP interface, which uses AES-NI (or
+     * VAES on CPUs that have it) and carry-less multiplication for GHASH. For hosts without a
+     * crypto-enabled BlueField, CI, and small buffers for which the offload doesn't pay off.
+     *
+     * The work runs on a cpu_worker_pool and completes through the same status awaitable
+     * as the device's tasks, on the executor of the thread that submitted the operation. Output
+     * is laid out like the device's: the aad_size bytes of AAD are copied to dest unchanged,
+     * followed by the ciphertext (or plaintext) and, when encrypting, the tag. It is appended to
+     * dest's data region. A decryption that fails to authenticate completes with
+     * DOCA_ERROR_INVALID_VALUE and leaves dest as it was.
+     *
+     * The buffers belong to the worker until the operation completes and must not be touched in
+     * the meantime; the key must outlive the operation.
+     */
+    class cpu_aes_gcm_backend:
+        public aes_gcm_backend
+    {
+    public:
+        explicit cpu_aes_gcm_backend(cpu_aes_gcm_config const &cfg = {});
+
+        /**
+         * Waits for the operations in flight if the worker pool is the backend's own
+         */
+        ~cpu_aes_gcm_backend() override = default;
+
+        cpu_aes_gcm_backend(cpu_aes_gcm_backend const &) = delete;
+        cpu_aes_gcm_backend(cpu_aes_gcm_backend &&) = delete;
+        cpu_aes_gcm_backend &operator=(cpu_aes_gcm_backend const &) = delete;
+        cpu_aes_gcm_backend &operator=(cpu_aes_gcm_backend &&) = delete;
+
+        /**
+         * Process-wide backend with the default configuration, created on first use. This is
+         * what aes_gcm_context falls back to.
+         */
+        [[nodiscard]] static auto shared() -> std::shared_ptr<cpu_aes_gcm_backend>;
+
+        [[nodiscard]] auto config() const noexcept -> cpu_aes_gcm_config const & { return cfg_; }
+        [[nodiscard]] auto workers() const noexcept -> cpu_worker_pool & { return *workers_; }
+
+        [[nodiscard]] auto load_key(
+            std::span<std::byte const> key_data,
+            doca_aes_gcm_key_type key_type
+        ) -> aes_gcm_key override;
+
+        [[nodiscard]] auto encrypt(
+            buffer plaintext,
+            buffer dest,
+            aes_gcm_key const &key,
+            std::span<std::byte const> iv,
+            std::uint32_t tag_size,
+            std::uint32_t aad_size = 0
+        ) -> coro::status_awaitable<> override;
+
+        [[nodiscard]] auto decrypt(
+            buffer encrypted,
+            buffer dest,
+            aes_gcm_key const &key,
+            std::span<std::byte const> iv,
+            std::uint32_t tag_size,
+            std::uint32_t aad_size = 0
+        ) -> coro::status_awaitable<> override;
+
+    private:
+        auto submit(
+            bool encrypting,
+            buffer const &src,
+            buffer const &dest,
+            aes_gcm_key const &key,
+            std::span<std::byte const> iv,
+            std::uint32_t tag_size,
+            std::uint32_t aad_size
+        ) -> coro::status_awaitable<>;
+
+        cpu_aes_gcm_config cfg_;
+        std::shared_ptr<cpu_worker_pool> workers_;
+    };
+}
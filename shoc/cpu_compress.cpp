@@ -0,0 +1,304 @@
+#include "cpu_compress.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+#include <lz4.h>
+#include <lz4frame.h>
+
+// next_in as pointer to const
+#define ZLIB_CONST
+#include <zlib.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace shoc {
+    namespace {
+        using codec_result = detail::cpu_work_result;
+
+        struct codec_outcome: detail::cpu_work_result {
+            compress_checksums sums;
+        };
+
+        /**
+         * Per-thread zlib streams, so that the workers don't allocate zlib state for every chunk
+         */
+        class zlib_streams {
+        public:
+            zlib_streams(int deflate_level):
+                deflate_level_ { deflate_level }
+            {
+                // windowBits < 0: raw deflate without zlib header, as the device produces and expects
+                enforce(deflateInit2(&deflater_, deflate_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK, DOCA_ERROR_NO_MEMORY);
+
+                if(inflateInit2(&inflater_, -15) != Z_OK) {
+                    deflateEnd(&deflater_);
+                    throw doca_exception(DOCA_ERROR_NO_MEMORY);
+                }
+            }
+
+            ~zlib_streams() {
+                deflateEnd(&deflater_);
+                inflateEnd(&inflater_);
+            }
+
+            zlib_streams(zlib_streams const &) = delete;
+            zlib_streams &operator=(zlib_streams const &) = delete;
+
+            [[nodiscard]] auto deflate_level() const noexcept { return deflate_level_; }
+
+            auto deflate(std::span<std::byte const> in, std::span<std::byte> out) -> codec_result {
+                deflater_.next_in = reinterpret_cast<Bytef const *>(in.data());
+                deflater_.avail_in = static_cast<uInt>(in.size());
+                deflater_.next_out = reinterpret_cast<Bytef *>(out.data());
+                deflater_.avail_out = static_cast<uInt>(out.size());
+
+                auto rc = ::deflate(&deflater_, Z_FINISH);
+                auto result = codec_result { DOCA_SUCCESS, out.size() - deflater_.avail_out };
+
+                if(rc != Z_STREAM_END) {
+                    // the only way Z_FINISH can fall short with all input present is a full output buffer
+                    result.status = DOCA_ERROR_TOO_BIG;
+                }
+
+                deflateReset(&deflater_);
+                return result;
+            }
+
+            auto inflate(std::span<std::byte const> in, std::span<std::byte> out) -> codec_result {
+                inflater_.next_in = reinterpret_cast<Bytef const *>(in.data());
+                inflater_.avail_in = static_cast<uInt>(in.size());
+                inflater_.next_out = reinterpret_cast<Bytef *>(out.data());
+                inflater_.avail_out = static_cast<uInt>(out.size());
+
+                auto rc = ::inflate(&inflater_, Z_FINISH);
+                auto result = codec_result { DOCA_SUCCESS, out.size() - inflater_.avail_out };
+
+                if(rc == Z_BUF_ERROR && inflater_.avail_out == 0) {
+                    result.status = DOCA_ERROR_TOO_BIG;
+                } else if(rc != Z_STREAM_END) {
+                    // corrupt or truncated input
+                    result.status = DOCA_ERROR_INVALID_VALUE;
+                }
+
+                inflateReset(&inflater_);
+                return result;
+            }
+
+        private:
+            int deflate_level_;
+            z_stream deflater_ {};
+            z_stream inflater_ {};
+        };
+
+        /**
+         * Per-thread LZ4 frame decompression context
+         */
+        class lz4_frame_decoder {
+        public:
+            lz4_frame_decoder() {
+                enforce(!LZ4F_isError(LZ4F_createDecompressionContext(&dctx_, LZ4F_VERSION)), DOCA_ERROR_NO_MEMORY);
+            }
+
+            ~lz4_frame_decoder() {
+                LZ4F_freeDecompressionContext(dctx_);
+            }
+
+            lz4_frame_decoder(lz4_frame_decoder const &) = delete;
+            lz4_frame_decoder &operator=(lz4_frame_decoder const &) = delete;
+
+            auto decode(std::span<std::byte const> in, std::span<std::byte> out) -> codec_result {
+                auto consumed = std::size_t { 0 };
+                auto result = codec_result {};
+
+                for(;;) {
+                    auto src_size = in.size() - consumed;
+                    auto dst_size = out.size() - result.produced;
+                    auto hint = LZ4F_decompress(
+                        dctx_,
+                        out.data() + result.produced,
+                        &dst_size,
+                        in.data() + consumed,
+                        &src_size,
+                        nullptr
+                    );
+
+                    consumed += src_size;
+                    result.produced += dst_size;
+
+                    if(LZ4F_isError(hint)) {
+                        result.status = DOCA_ERROR_INVALID_VALUE;
+                        break;
+                    } else if(hint == 0) {
+                        // end of frame
+                        break;
+                    } else if(src_size == 0 && dst_size == 0) {
+                        // no progress: either the output is full or the input ends mid-frame
+                        result.status = result.produced == out.size() ? DOCA_ERROR_TOO_BIG : DOCA_ERROR_INVALID_VALUE;
+                        break;
+                    }
+                }
+
+                if(result.status != DOCA_SUCCESS) {
+                    LZ4F_resetDecompressionContext(dctx_);
+                }
+
+                return result;
+            }
+
+        private:
+            LZ4F_dctx *dctx_ = nullptr;
+        };
+
+        auto run_codec(
+            compress_operation op,
+            int deflate_level,
+            std::span<std::byte const> in,
+            std::span<std::byte> out
+        ) -> codec_result {
+            // zlib and liblz4 count in 32 bits
+            if(in.size() > INT_MAX) {
+                return { DOCA_ERROR_INVALID_VALUE, 0 };
+            }
+
+            out = out.first(std::min<std::size_t>(out.size(), INT_MAX));
+
+            switch(op) {
+                case compress_operation::compress_deflate:
+                case compress_operation::decompress_deflate: {
+                    thread_local auto streams = std::optional<zlib_streams> {};
+
+                    if(!streams || streams->deflate_level() != deflate_level) {
+                        streams.reset();
+                        streams.emplace(deflate_level);
+                    }
+
+                    return op == compress_operation::compress_deflate
+                        ? streams->deflate(in, out)
+                        : streams->inflate(in, out);
+                }
+
+                case compress_operation::decompress_lz4_block: {
+                    auto n = LZ4_decompress_safe(
+                        reinterpret_cast<char const *>(in.data()),
+                        reinterpret_cast<char *>(out.data()),
+                        static_cast<int>(in.size()),
+                        static_cast<int>(out.size())
+                    );
+
+                    // liblz4 doesn't tell a short output buffer from corrupt input
+                    return n < 0
+                        ? codec_result { DOCA_ERROR_INVALID_VALUE, 0 }
+                        : codec_result { DOCA_SUCCESS, static_cast<std::size_t>(n) };
+                }
+
+                case compress_operation::decompress_lz4_stream: {
+                    thread_local auto decoder = lz4_frame_decoder {};
+                    return decoder.decode(in, out);
+                }
+            }
+
+            return { DOCA_ERROR_NOT_SUPPORTED, 0 };
+        }
+
+        auto checksums_of(std::span<std::byte const> data) -> compress_checksums {
+            auto bytes = reinterpret_cast<Bytef const *>(data.data());
+            auto result = compress_checksums {};
+
+            result.crc = static_cast<std::uint32_t>(crc32_z(0, bytes, data.size()));
+            result.adler = static_cast<std::uint32_t>(adler32_z(1, bytes, data.size()));
+
+            return result;
+        }
+    }
+
+    cpu_compress_backend::cpu_compress_backend(cpu_compress_config const &cfg):
+        cfg_ { cfg },
+        workers_ { cpu_worker_pool::shared_or_own(cfg.threads) }
+    {
+        enforce(cfg.deflate_level >= 1 && cfg.deflate_level <= 9, DOCA_ERROR_INVALID_VALUE);
+
+        logger->debug("cpu_compress_backend: {} worker threads, deflate level {}", workers_->threads(), cfg.deflate_level);
+    }
+
+    auto cpu_compress_backend::shared() -> std::shared_ptr<cpu_compress_backend> {
+        static auto instance = std::make_shared<cpu_compress_backend>();
+        return instance;
+    }
+
+    auto cpu_compress_backend::compress(
+        buffer const &src,
+        buffer &dest,
+        compress_checksums *checksums
+    ) -> compress_awaitable {
+        return submit(compress_operation::compress_deflate, src, dest, checksums);
+    }
+
+    auto cpu_compress_backend::decompress(
+        buffer const &src,
+        buffer &dest,
+        compress_checksums *checksums
+    ) -> compress_awaitable {
+        return submit(compress_operation::decompress_deflate, src, dest, checksums);
+    }
+
+    auto cpu_compress_backend::decompress_lz4_block(
+        buffer const &src,
+        buffer &dest,
+        compress_checksums *checksums
+    ) -> compress_awaitable {
+        return submit(compress_operation::decompress_lz4_block, src, dest, checksums);
+    }
+
+    auto cpu_compress_backend::decompress_lz4_stream(
+        [[maybe_unused]] bool has_block_checksum,
+        [[maybe_unused]] bool are_blocks_independent,
+        buffer const &src,
+        buffer &dest,
+        compress_checksums *checksums
+    ) -> compress_awaitable {
+        return submit(compress_operation::decompress_lz4_stream, src, dest, checksums);
+    }
+
+    auto cpu_compress_backend::submit(
+        compress_operation op,
+        buffer const &src,
+        buffer &dest,
+        compress_checksums *checksums
+    ) -> compress_awaitable {
+        auto result = compress_awaitable::create_space(checksums);
+        auto receptable = result.receptable_ptr();
+
+        auto output = detail::cpu_work_output::after_data(dest);
+        auto in = src.view().data<std::byte const>();
+        auto out = output.free_space;
+        auto want_checksums = checksums != nullptr;
+        auto level = cfg_.deflate_level;
+
+        detail::offload_to_cpu(
+            *workers_,
+            receptable,
+            output,
+            [=] {
+                auto outcome = codec_outcome { run_codec(op, level, in, out), {} };
+
+                if(want_checksums && outcome.status == DOCA_SUCCESS) {
+                    outcome.sums = checksums_of(op == compress_operation::compress_deflate ? in : out.first(outcome.produced));
+                }
+
+                return outcome;
+            },
+            [](auto *receptable, codec_outcome const &outcome) {
+                if(receptable->additional_data()) {
+                    receptable->additional_data().overwrite(compress_checksums { outcome.sums });
+                }
+            }
+        );
+
+        return result;
+    }
+}
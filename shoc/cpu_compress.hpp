@@ -0,0 +1,105 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "compress.hpp"
+#include "cpu_offload.hpp"
+
+#include <cstddef>
+#include <memory>
+
+namespace shoc {
+    /**
+     * Configuration for a cpu_compress_backend
+     */
+    struct cpu_compress_config {
+        /// Number of worker threads of a pool of its own; 0 shares cpu_worker_pool::shared()
+        std::size_t threads = 0;
+        /// zlib level for compression, from 1 (fastest) to 9 (smallest)
+        int deflate_level = 1;
+    };
+
+    /**
+     * Software implementation of the compress operations: raw deflate through zlib, LZ4 blocks
+     * and frames through liblz4. The work runs on a cpu_worker_pool; the submitting
+     * thread only collects the results, which are delivered through the same compress_awaitable
+     * and compress_checksums as the device's. CRC and Adler checksums (of the uncompressed data)
+     * are only computed if the caller asks for them. xxh is always 0; liblz4 checks the frame's
+     * content checksum itself.
+     *
+     * Completions are posted to the executor of the thread that submitted the operation, so the
+     * awaitable has to be co_awaited there, as with any task on a progress engine.
+     *
+     * Output is appended to dest's data region, like the device does. The buffers belong to the
+     * worker until the operation completes and must not be touched in the meantime.
+     */
+    class cpu_compress_backend:
+        public compress_backend
+    {
+    public:
+        explicit cpu_compress_backend(cpu_compress_config const &cfg = {});
+
+        /**
+         * Waits for the operations in flight if the worker pool is the backend's own
+         */
+        ~cpu_compress_backend() override = default;
+
+        cpu_compress_backend(cpu_compress_backend const &) = delete;
+        cpu_compress_backend(cpu_compress_backend &&) = delete;
+        cpu_compress_backend &operator=(cpu_compress_backend const &) = delete;
+        cpu_compress_backend &operator=(cpu_compress_backend &&) = delete;
+
+        /**
+         * Process-wide backend with the default configuration, created on first use. This is
+         * what compress_context falls back to.
+         */
+        [[nodiscard]] static auto shared() -> std::shared_ptr<cpu_compress_backend>;
+
+        [[nodiscard]] auto supports([[maybe_unused]] compress_operation op) const noexcept -> bool override {
+            return true;
+        }
+
+        [[nodiscard]] auto config() const noexcept -> cpu_compress_config const & { return cfg_; }
+        [[nodiscard]] auto workers() const noexcept -> cpu_worker_pool & { return *workers_; }
+
+        auto compress(
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable override;
+
+        auto decompress(
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable override;
+
+        auto decompress_lz4_block(
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable override;
+
+        /**
+         * has_block_checksum and are_blocks_independent are hints for the device; liblz4 reads
+         * the frame descriptor instead.
+         */
+        auto decompress_lz4_stream(
+            bool has_block_checksum,
+            bool are_blocks_independent,
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable override;
+
+    private:
+        auto submit(
+            compress_operation op,
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums
+        ) -> compress_awaitable;
+
+        cpu_compress_config cfg_;
+        std::shared_ptr<cpu_worker_pool> workers_;
+    };
+}
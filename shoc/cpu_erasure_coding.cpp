@@ -0,0 +1,118 @@
+#include "cpu_erasure_coding.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+#include <span>
+#include <vector>
+
+namespace shoc {
+    cpu_ec_backend::cpu_ec_backend(cpu_ec_config const &cfg):
+        cfg_ { cfg },
+        workers_ { cpu_worker_pool::shared_or_own(cfg.threads) }
+    {
+        enforce(gf256_kernel_supported(cfg.kernel), DOCA_ERROR_NOT_SUPPORTED);
+
+        logger->debug("cpu_ec_backend: {} worker threads, {} kernel", workers_->threads(), gf256_kernel_name(cfg.kernel));
+    }
+
+    auto cpu_ec_backend::shared() -> std::shared_ptr<cpu_ec_backend> {
+        static auto instance = std::make_shared<cpu_ec_backend>();
+        return instance;
+    }
+
+    auto cpu_ec_backend::coding_matrix(
+        doca_ec_matrix_type type,
+        std::size_t data_block_count,
+        std::size_t rdnc_block_count
+    ) const -> ec_coding_matrix {
+        return ec_coding_matrix(nullptr, type, data_block_count, rdnc_block_count);
+    }
+
+    auto cpu_ec_backend::update_matrix(
+        ec_coding_matrix const &coding_matrix,
+        std::span<std::uint32_t const> update_indices
+    ) const -> ec_update_matrix {
+        return ec_update_matrix(nullptr, coding_matrix, update_indices);
+    }
+
+    auto cpu_ec_backend::recover_matrix(
+        ec_coding_matrix const &coding_matrix,
+        std::span<std::uint32_t const> missing_indices
+    ) const -> ec_recover_matrix {
+        return ec_recover_matrix(nullptr, coding_matrix, missing_indices);
+    }
+
+    auto cpu_ec_backend::create(
+        ec_coding_matrix const &coding_matrix,
+        buffer const &original_data_blocks,
+        buffer &rdnc_blocks
+    ) -> coro::status_awaitable<> {
+        return submit(coding_matrix.coefficients(), original_data_blocks, rdnc_blocks);
+    }
+
+    auto cpu_ec_backend::recover(
+        ec_recover_matrix const &recover_matrix,
+        buffer const &available_blocks,
+        buffer &recovered_data_blocks
+    ) -> coro::status_awaitable<> {
+        return submit(recover_matrix.coefficients(), available_blocks, recovered_data_blocks);
+    }
+
+    auto cpu_ec_backend::update(
+        ec_update_matrix const &update_matrix,
+        buffer const &original_updated_and_rdnc_blocks,
+        buffer &updated_rdnc_blocks
+    ) -> coro::status_awaitable<> {
+        return submit(update_matrix.coefficients(), original_updated_and_rdnc_blocks, updated_rdnc_blocks);
+    }
+
+    auto cpu_ec_backend::submit(
+        gf256_matrix const &matrix,
+        buffer const &src,
+        buffer const &dest
+    ) -> coro::status_awaitable<> {
+        auto in = src.view().data<std::byte const>();
+        auto output = detail::cpu_work_output::after_data(dest);
+        auto free_space = output.free_space;
+
+        // same geometry rules as on the device
+        if(in.empty() || matrix.cols() == 0 || in.size() % matrix.cols() != 0 || in.size() / matrix.cols() % 64 != 0) {
+            return coro::status_awaitable<>::from_value(DOCA_ERROR_INVALID_VALUE);
+        }
+
+        auto block_size = in.size() / matrix.cols();
+
+        if(free_space.size() < matrix.rows() * block_size) {
+            return coro::status_awaitable<>::from_value(DOCA_ERROR_TOO_BIG);
+        }
+
+        auto result = coro::status_awaitable<>::create_space();
+        auto receptable = result.receptable_ptr();
+
+        detail::offload_to_cpu(*workers_, receptable, output, [
+            &matrix,
+            in,
+            out = free_space.first(matrix.rows() * block_size),
+            block_size,
+            kernel = cfg_.kernel
+        ] {
+            auto inputs = std::vector<std::byte const *>(matrix.cols());
+            auto outputs = std::vector<std::byte *>(matrix.rows());
+
+            for(auto c = std::size_t { 0 }; c < inputs.size(); ++c) {
+                inputs[c] = in.data() + c * block_size;
+            }
+
+            for(auto r = std::size_t { 0 }; r < outputs.size(); ++r) {
+                outputs[r] = out.data() + r * block_size;
+            }
+
+            matrix.apply(inputs, outputs, block_size, kernel);
+
+            return detail::cpu_work_result { DOCA_SUCCESS, out.size() };
+        });
+
+        return result;
+    }
+}
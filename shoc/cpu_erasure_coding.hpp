@@ -0,0 +1,102 @@
+#pragma once
+
+#include "cpu_offload.hpp"
+#include "erasure_coding.hpp"
+#include "gf256.hpp"
+
+#include <cstddef>
+#include <memory>
+
+namespace shoc {
+    /**
+     * Configuration for a cpu_ec_backend
+     */
+    struct cpu_ec_config {
+        /// Number of worker threads of a pool of its own; 0 shares cpu_worker_pool::shared()
+        std::size_t threads = 0;
+        gf256_kernel kernel = gf256_kernel::automatic;
+    };
+
+    /**
+     * Reed-Solomon erasure coding in software, for hosts without an EC-capable BlueField, CI,
+     * and benchmarks against the offload. Matrices follow ISA-L's conventions (see
+     * gf256_matrix::encoding), and the blocks are multiplied with the table lookup or GFNI
+     * kernels of gf256_matrix::apply.
+     *
+     * Buffers are laid out as for ec_context; every task works on one buffer of consecutive
+     * blocks whose size must be a multiple of 64 bytes. The result is appended to the data
+     * region of the destination buffer. Matrices made by an ec_context work here, too.
+     *
+     * The work runs on a cpu_worker_pool and completes through the same status awaitable
+     * as the device's tasks, on the executor of the thread that submitted it. The buffers and
+     * the matrix belong to the worker until the task completes.
+     */
+    class cpu_ec_backend:
+        public ec_backend
+    {
+    public:
+        explicit cpu_ec_backend(cpu_ec_config const &cfg = {});
+
+        /**
+         * Waits for the tasks in flight if the worker pool is the backend's own
+         */
+        ~cpu_ec_backend() override = default;
+
+        cpu_ec_backend(cpu_ec_backend const &) = delete;
+        cpu_ec_backend(cpu_ec_backend &&) = delete;
+        cpu_ec_backend &operator=(cpu_ec_backend const &) = delete;
+        cpu_ec_backend &operator=(cpu_ec_backend &&) = delete;
+
+        /**
+         * Process-wide backend with the default configuration, created on first use
+         */
+        [[nodiscard]] static auto shared() -> std::shared_ptr<cpu_ec_backend>;
+
+        [[nodiscard]] auto config() const noexcept -> cpu_ec_config const & { return cfg_; }
+        [[nodiscard]] auto workers() const noexcept -> cpu_worker_pool & { return *workers_; }
+
+        auto create(
+            ec_coding_matrix const &coding_matrix,
+            buffer const &original_data_blocks,
+            buffer &rdnc_blocks
+        ) -> coro::status_awaitable<> override;
+
+        auto recover(
+            ec_recover_matrix const &recover_matrix,
+            buffer const &available_blocks,
+            buffer &recovered_data_blocks
+        ) -> coro::status_awaitable<> override;
+
+        auto update(
+            ec_update_matrix const &update_matrix,
+            buffer const &original_updated_and_rdnc_blocks,
+            buffer &updated_rdnc_blocks
+        ) -> coro::status_awaitable<> override;
+
+        [[nodiscard]] auto coding_matrix(
+            doca_ec_matrix_type type,
+            std::size_t data_block_count,
+            std::size_t rdnc_block_count
+        ) const -> ec_coding_matrix override;
+
+        [[nodiscard]] auto update_matrix(
+            ec_coding_matrix const &coding_matrix,
+            std::span<std::uint32_t const> update_indices
+        ) const -> ec_update_matrix override;
+
+        [[nodiscard]] auto recover_matrix(
+            ec_coding_matrix const &coding_matrix,
+            std::span<std::uint32_t const> missing_indices
+        ) const -> ec_recover_matrix override;
+
+    private:
+        auto submit(
+            gf256_matrix const &matrix,
+            buffer const &src,
+            buffer const &dest
+        ) -> coro::status_awaitable<>;
+
+        cpu_ec_config cfg_;
+        std::shared_ptr<cpu_worker_pool> workers_;
+    };
+}
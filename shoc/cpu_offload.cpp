@@ -0,0 +1,30 @@
+#include "cpu_offload.hpp"
+
+#include "logger.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace shoc {
+    cpu_worker_pool::cpu_worker_pool(std::size_t threads):
+        threads_ { threads },
+        pool_ { threads }
+    {
+        enforce(threads > 0, DOCA_ERROR_INVALID_VALUE);
+
+        logger->debug("cpu_worker_pool: {} worker threads", threads);
+    }
+
+    cpu_worker_pool::~cpu_worker_pool() {
+        pool_.join();
+    }
+
+    auto cpu_worker_pool::shared() -> std::shared_ptr<cpu_worker_pool> {
+        static auto instance = std::make_shared<cpu_worker_pool>(std::max(1u, std::thread::hardware_concurrency()));
+        return instance;
+    }
+
+    auto cpu_worker_pool::shared_or_own(std::size_t threads) -> std::shared_ptr<cpu_worker_pool> {
+        return threads == 0 ? shared() : std::make_shared<cpu_worker_pool>(threads);
+    }
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "error.hpp"
+
+#include <doca_buf.h>
+#include <doca_error.h>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/cobalt/this_thread.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <utility>
+
+namespace shoc {
+    /**
+     * Worker threads for the software backends (cpu_compress_backend, cpu_sha_backend,
+     * cpu_aes_gcm_backend, cpu_ec_backend). By default they all share one pool with a thread per
+     * core, so that a process that falls back to software for several kinds of work doesn't end
+     * up with a pool per backend and several times more busy threads than cores.
+     */
+    class cpu_worker_pool {
+    public:
+        explicit cpu_worker_pool(std::size_t threads);
+
+        /**
+         * Waits for the work in flight
+         */
+        ~cpu_worker_pool();
+
+        cpu_worker_pool(cpu_worker_pool const &) = delete;
+        cpu_worker_pool(cpu_worker_pool &&) = delete;
+        cpu_worker_pool &operator=(cpu_worker_pool const &) = delete;
+        cpu_worker_pool &operator=(cpu_worker_pool &&) = delete;
+
+        /**
+         * Process-wide pool with one thread per core, created on first use
+         */
+        [[nodiscard]] static auto shared() -> std::shared_ptr<cpu_worker_pool>;
+
+        /**
+         * @return the shared pool if threads is 0, otherwise a pool of threads threads of its own
+         */
+        [[nodiscard]] static auto shared_or_own(std::size_t threads) -> std::shared_ptr<cpu_worker_pool>;
+
+        [[nodiscard]] auto threads() const noexcept -> std::size_t { return threads_; }
+
+        template<typename Handler>
+        auto post(Handler &&handler) -> void {
+            boost::asio::post(pool_, std::forward<Handler>(handler));
+        }
+
+    private:
+        std::size_t threads_;
+        boost::asio::thread_pool pool_;
+    };
+
+    namespace detail {
+        /**
+         * What a piece of offloaded work reports back: its status and the number of bytes it
+         * appended to the destination buffer's data region
+         */
+        struct cpu_work_result {
+            doca_error_t status = DOCA_SUCCESS;
+            std::size_t produced = 0;
+        };
+
+        /**
+         * The part of a destination buffer behind its data region, which the work writes to, and
+         * what is needed to extend the data region over it afterwards. Buffers are only looked
+         * at on the submitting thread; the worker sees plain memory.
+         */
+        struct cpu_work_output {
+            doca_buf *handle = nullptr;
+            void *data = nullptr;
+            std::size_t length = 0;
+            std::span<std::byte> free_space;
+
+            [[nodiscard]] static auto after_data(buffer const &dest) -> cpu_work_output {
+                auto view = dest.view();
+
+                return {
+                    dest.handle(),
+                    static_cast<void *>(view.data<std::byte>().data()),
+                    view.data_length(),
+                    view.memory<std::byte>().subspan(view.data_offset() + view.data_length())
+                };
+            }
+        };
+
+        /**
+         * Run work() on a worker thread and complete receptable with its status on the executor
+         * of the calling thread, the way the device's tasks complete. On success, the data region
+         * of output is extended by the bytes the work produced. work returns cpu_work_result or
+         * something derived from it, which is handed to on_complete(receptable, result) before
+         * the waiter is resumed, e.g. to deliver additional data.
+         */
+        template<typename Receptable, typename Work, typename OnComplete>
+        auto offload_to_cpu(
+            cpu_worker_pool &workers,
+            Receptable *receptable,
+            cpu_work_output output,
+            Work &&work,
+            OnComplete &&on_complete
+        ) -> void {
+            workers.post([
+                receptable,
+                output,
+                completion_executor = boost::cobalt::this_thread::get_executor(),
+                work = std::forward<Work>(work),
+                on_complete = std::forward<OnComplete>(on_complete)
+            ]() mutable {
+                auto outcome = decltype(work()) {};
+
+                // nothing may escape into the thread pool
+                try {
+                    outcome = work();
+                } catch(doca_exception &e) {
+                    outcome.status = e.doca_error();
+                } catch(...) {
+                    outcome.status = DOCA_ERROR_UNEXPECTED;
+                }
+
+                boost::asio::post(completion_executor, [
+                    receptable,
+                    output,
+                    outcome = std::move(outcome),
+                    on_complete = std::move(on_complete)
+                ]() mutable {
+                    auto status = outcome.status;
+
+                    if(status == DOCA_SUCCESS && output.handle != nullptr) {
+                        status = doca_buf_set_data(output.handle, output.data, output.length + outcome.produced);
+                    }
+
+                    receptable->emplace_value(status);
+                    on_complete(receptable, outcome);
+                    receptable->resume();
+                });
+            });
+        }
+
+        template<typename Receptable, typename Work>
+        auto offload_to_cpu(
+            cpu_worker_pool &workers,
+            Receptable *receptable,
+            cpu_work_output output,
+            Work &&work
+        ) -> void {
+            offload_to_cpu(workers, receptable, output, std::forward<Work>(work), [](Receptable *, auto const &) {});
+        }
+    }
+}
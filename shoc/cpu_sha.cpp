@@ -0,0 +1,723 @@
+#include "cpu_sha.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace shoc {
+    namespace {
+        constexpr auto sha1_init = std::array<std::uint32_t, 5> {
+            0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+        };
+
+        constexpr auto sha256_init = std::array<std::uint32_t, 8> {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+
+        constexpr auto sha512_init = std::array<std::uint64_t, 8> {
+            0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+            0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+        };
+
+        alignas(16) constexpr auto k256 = std::array<std::uint32_t, 64> {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+        constexpr auto k512 = std::array<std::uint64_t, 80> {
+            0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+            0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+            0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+            0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+            0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+            0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+            0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+            0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+            0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+            0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+            0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+            0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+            0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+            0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+            0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+            0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817
+        };
+
+        auto load_be32(std::byte const *p) noexcept -> std::uint32_t {
+            auto value = std::uint32_t {};
+            std::memcpy(&value, p, sizeof(value));
+            return __builtin_bswap32(value);
+        }
+
+        auto load_be64(std::byte const *p) noexcept -> std::uint64_t {
+            auto value = std::uint64_t {};
+            std::memcpy(&value, p, sizeof(value));
+            return __builtin_bswap64(value);
+        }
+
+        auto store_be32(std::byte *p, std::uint32_t value) noexcept -> void {
+            value = __builtin_bswap32(value);
+            std::memcpy(p, &value, sizeof(value));
+        }
+
+        auto store_be64(std::byte *p, std::uint64_t value) noexcept -> void {
+            value = __builtin_bswap64(value);
+            std::memcpy(p, &value, sizeof(value));
+        }
+
+        auto sha1_blocks_scalar(std::uint32_t *h, std::byte const *data, std::size_t blocks) -> void {
+            for(; blocks > 0; --blocks, data += 64) {
+                auto w = std::array<std::uint32_t, 80> {};
+
+                for(auto t = 0; t < 16; ++t) {
+                    w[t] = load_be32(data + 4 * t);
+                }
+
+                for(auto t = 16; t < 80; ++t) {
+                    w[t] = std::rotl(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+                }
+
+                auto a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+                for(auto t = 0; t < 80; ++t) {
+                    auto f = std::uint32_t {};
+                    auto k = std::uint32_t {};
+
+                    if(t < 20) {
+                        f = (b & c) | (~b & d);
+                        k = 0x5a827999;
+                    } else if(t < 40) {
+                        f = b ^ c ^ d;
+                        k = 0x6ed9eba1;
+                    } else if(t < 60) {
+                        f = (b & c) | (b & d) | (c & d);
+                        k = 0x8f1bbcdc;
+                    } else {
+                        f = b ^ c ^ d;
+                        k = 0xca62c1d6;
+                    }
+
+                    auto temp = std::rotl(a, 5) + f + e + k + w[t];
+                    e = d;
+                    d = c;
+                    c = std::rotl(b, 30);
+                    b = a;
+                    a = temp;
+                }
+
+                h[0] += a;
+                h[1] += b;
+                h[2] += c;
+                h[3] += d;
+                h[4] += e;
+            }
+        }
+
+        auto sha256_blocks_scalar(std::uint32_t *h, std::byte const *data, std::size_t blocks) -> void {
+            for(; blocks > 0; --blocks, data += 64) {
+                auto w = std::array<std::uint32_t, 64> {};
+
+                for(auto t = 0; t < 16; ++t) {
+                    w[t] = load_be32(data + 4 * t);
+                }
+
+                for(auto t = 16; t < 64; ++t) {
+                    auto s0 = std::rotr(w[t - 15], 7) ^ std::rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+                    auto s1 = std::rotr(w[t - 2], 17) ^ std::rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+                    w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+                }
+
+                auto a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+
+                for(auto t = 0; t < 64; ++t) {
+                    auto s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+                    auto ch = (e & f) ^ (~e & g);
+                    auto t1 = hh + s1 + ch + k256[t] + w[t];
+                    auto s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+                    auto maj = (a & b) ^ (a & c) ^ (b & c);
+                    auto t2 = s0 + maj;
+
+                    hh = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+
+                h[0] += a;
+                h[1] += b;
+                h[2] += c;
+                h[3] += d;
+                h[4] += e;
+                h[5] += f;
+                h[6] += g;
+                h[7] += hh;
+            }
+        }
+
+        auto sha512_blocks_scalar(std::uint64_t *h, std::byte const *data, std::size_t blocks) -> void {
+            for(; blocks > 0; --blocks, data += 128) {
+                auto w = std::array<std::uint64_t, 80> {};
+
+                for(auto t = 0; t < 16; ++t) {
+                    w[t] = load_be64(data + 8 * t);
+                }
+
+                for(auto t = 16; t < 80; ++t) {
+                    auto s0 = std::rotr(w[t - 15], 1) ^ std::rotr(w[t - 15], 8) ^ (w[t - 15] >> 7);
+                    auto s1 = std::rotr(w[t - 2], 19) ^ std::rotr(w[t - 2], 61) ^ (w[t - 2] >> 6);
+                    w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+                }
+
+                auto a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+
+                for(auto t = 0; t < 80; ++t) {
+                    auto s1 = std::rotr(e, 14) ^ std::rotr(e, 18) ^ std::rotr(e, 41);
+                    auto ch = (e & f) ^ (~e & g);
+                    auto t1 = hh + s1 + ch + k512[t] + w[t];
+                    auto s0 = std::rotr(a, 28) ^ std::rotr(a, 34) ^ std::rotr(a, 39);
+                    auto maj = (a & b) ^ (a & c) ^ (b & c);
+                    auto t2 = s0 + maj;
+
+                    hh = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+
+                h[0] += a;
+                h[1] += b;
+                h[2] += c;
+                h[3] += d;
+                h[4] += e;
+                h[5] += f;
+                h[6] += g;
+                h[7] += hh;
+            }
+        }
+
+#if defined(__x86_64__)
+        [[gnu::target("sha,sse4.1")]]
+        auto sha256_blocks_sha_ni(std::uint32_t *h, std::byte const *data, std::size_t blocks) -> void {
+            auto const byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+            // the instructions want the state as ABEF and CDGH
+            auto tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(h)), 0xb1);
+            auto state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(h + 4)), 0x1b);
+            auto state0 = _mm_alignr_epi8(tmp, state1, 8);
+            state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+            for(; blocks > 0; --blocks, data += 64) {
+                auto const abef = state0;
+                auto const cdgh = state1;
+                __m128i w[4];
+
+                for(auto i = 0; i < 16; ++i) {
+                    auto &wi = w[i % 4];
+
+                    if(i < 4) {
+                        wi = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(data + 16 * i)), byte_swap);
+                    } else {
+                        // w[i - 4] is still in wi
+                        auto sum = _mm_add_epi32(
+                            _mm_sha256msg1_epu32(wi, w[(i - 3) % 4]),
+                            _mm_alignr_epi8(w[(i - 1) % 4], w[(i - 2) % 4], 4)
+                        );
+                        wi = _mm_sha256msg2_epu32(sum, w[(i - 1) % 4]);
+                    }
+
+                    auto msg = _mm_add_epi32(wi, _mm_load_si128(reinterpret_cast<__m128i const *>(k256.data() + 4 * i)));
+                    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+                }
+
+                state0 = _mm_add_epi32(state0, abef);
+                state1 = _mm_add_epi32(state1, cdgh);
+            }
+
+            tmp = _mm_shuffle_epi32(state0, 0x1b);
+            state1 = _mm_shuffle_epi32(state1, 0xb1);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(h), _mm_blend_epi16(tmp, state1, 0xf0));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(h + 4), _mm_alignr_epi8(state1, tmp, 8));
+        }
+
+        [[gnu::target("avx2")]]
+        inline auto rotr8x32(__m256i x, int n) -> __m256i {
+            return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+        }
+
+        /**
+         * SHA-256 of eight messages at once, one per 32-bit lane
+         */
+        [[gnu::target("avx2")]]
+        auto sha256_blocks_avx2_x8(
+            std::array<std::uint32_t *, 8> const &h,
+            std::array<std::byte const *, 8> const &data,
+            std::size_t blocks
+        ) -> void {
+            // rows of eight lanes, transposed into the vector registers
+            alignas(32) std::uint32_t rows[16][8];
+            __m256i state[8];
+
+            for(auto j = 0; j < 8; ++j) {
+                for(auto lane = 0; lane < 8; ++lane) {
+                    rows[j][lane] = h[lane][j];
+                }
+
+                state[j] = _mm256_load_si256(reinterpret_cast<__m256i const *>(rows[j]));
+            }
+
+            for(auto offset = std::size_t { 0 }; offset < 64 * blocks; offset += 64) {
+                __m256i w[16];
+
+                for(auto t = 0; t < 16; ++t) {
+                    for(auto lane = 0; lane < 8; ++lane) {
+                        rows[t][lane] = load_be32(data[lane] + offset + 4 * t);
+                    }
+
+                    w[t] = _mm256_load_si256(reinterpret_cast<__m256i const *>(rows[t]));
+                }
+
+                auto a = state[0], b = state[1], c = state[2], d = state[3];
+                auto e = state[4], f = state[5], g = state[6], hh = state[7];
+
+                for(auto t = 0; t < 64; ++t) {
+                    if(t >= 16) {
+                        auto w15 = w[(t - 15) % 16];
+                        auto w2 = w[(t - 2) % 16];
+                        auto s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8x32(w15, 7), rotr8x32(w15, 18)), _mm256_srli_epi32(w15, 3));
+                        auto s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8x32(w2, 17), rotr8x32(w2, 19)), _mm256_srli_epi32(w2, 10));
+                        w[t % 16] = _mm256_add_epi32(_mm256_add_epi32(w[t % 16], s0), _mm256_add_epi32(w[(t - 7) % 16], s1));
+                    }
+
+                    auto s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8x32(e, 6), rotr8x32(e, 11)), rotr8x32(e, 25));
+                    auto ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+                    auto t1 = _mm256_add_epi32(
+                        _mm256_add_epi32(hh, s1),
+                        _mm256_add_epi32(_mm256_add_epi32(ch, _mm256_set1_epi32(static_cast<int>(k256[t]))), w[t % 16])
+                    );
+                    auto s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8x32(a, 2), rotr8x32(a, 13)), rotr8x32(a, 22));
+                    auto maj = _mm256_xor_si256(_mm256_and_si256(a, _mm256_xor_si256(b, c)), _mm256_and_si256(b, c));
+                    auto t2 = _mm256_add_epi32(s0, maj);
+
+                    hh = g;
+                    g = f;
+                    f = e;
+                    e = _mm256_add_epi32(d, t1);
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = _mm256_add_epi32(t1, t2);
+                }
+
+                state[0] = _mm256_add_epi32(state[0], a);
+                state[1] = _mm256_add_epi32(state[1], b);
+                state[2] = _mm256_add_epi32(state[2], c);
+                state[3] = _mm256_add_epi32(state[3], d);
+                state[4] = _mm256_add_epi32(state[4], e);
+                state[5] = _mm256_add_epi32(state[5], f);
+                state[6] = _mm256_add_epi32(state[6], g);
+                state[7] = _mm256_add_epi32(state[7], hh);
+            }
+
+            for(auto j = 0; j < 8; ++j) {
+                _mm256_store_si256(reinterpret_cast<__m256i *>(rows[j]), state[j]);
+
+                for(auto lane = 0; lane < 8; ++lane) {
+                    h[lane][j] = rows[j][lane];
+                }
+            }
+        }
+
+        auto cpu_has_sha_ni() noexcept -> bool {
+            unsigned eax, ebx, ecx, edx;
+            return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) != 0
+                && (ebx & bit_SHA) != 0
+                && __builtin_cpu_supports("sse4.1");
+        }
+
+        auto cpu_has_avx2() noexcept -> bool {
+            return __builtin_cpu_supports("avx2");
+        }
+#else
+        auto cpu_has_sha_ni() noexcept -> bool { return false; }
+        auto cpu_has_avx2() noexcept -> bool { return false; }
+#endif
+
+        struct cpu_features {
+            bool sha_ni = cpu_has_sha_ni();
+            bool avx2 = cpu_has_avx2();
+        };
+
+        auto features() -> cpu_features const & {
+            static auto const instance = cpu_features {};
+            return instance;
+        }
+
+        /**
+         * @return the kernel automatic stands for, for a single message or for many
+         */
+        auto resolve(sha_kernel kernel, bool many) -> sha_kernel {
+            if(kernel != sha_kernel::automatic) {
+                enforce(sha_kernel_supported(kernel), DOCA_ERROR_NOT_SUPPORTED);
+                return kernel;
+            }
+
+            // one SHA-NI stream keeps up with eight AVX2 lanes, so multi-buffer only pays off without it
+            if(features().sha_ni) {
+                return sha_kernel::sha_ni;
+            } else if(many && features().avx2) {
+                return sha_kernel::avx2_multi_buffer;
+            } else {
+                return sha_kernel::scalar;
+            }
+        }
+
+        auto sha256_blocks(sha_kernel kernel, std::uint32_t *h, std::byte const *data, std::size_t blocks) -> void {
+#if defined(__x86_64__)
+            if(kernel == sha_kernel::sha_ni) {
+                sha256_blocks_sha_ni(h, data, blocks);
+                return;
+            }
+#else
+            static_cast<void>(kernel);
+#endif
+            sha256_blocks_scalar(h, data, blocks);
+        }
+
+#if defined(__x86_64__)
+        struct sha256_work {
+            std::uint32_t *h = nullptr;
+            std::byte const *data = nullptr;
+            std::size_t blocks = 0;
+        };
+
+        /**
+         * Runs SHA-256 jobs through the eight lanes of the AVX2 kernel. Each lane works on one job
+         * until it runs out, then takes the next one; every kernel call covers as many blocks as
+         * the shortest job in the lanes has left.
+         */
+        auto sha256_many_avx2(std::span<sha256_work const> jobs) -> void {
+            auto lanes = std::array<sha256_work, 8> {};
+            auto next = jobs.begin();
+
+            for(;;) {
+                auto active = 0;
+                auto step = std::numeric_limits<std::size_t>::max();
+                auto busy = std::size_t { 0 };
+
+                for(auto i = std::size_t { 0 }; i < lanes.size(); ++i) {
+                    while(lanes[i].blocks == 0 && next != jobs.end()) {
+                        lanes[i] = *next++;
+                    }
+
+                    if(lanes[i].blocks > 0) {
+                        ++active;
+                        step = std::min(step, lanes[i].blocks);
+                        busy = i;
+                    }
+                }
+
+                if(active == 0) {
+                    break;
+                }
+
+                if(active == 1) {
+                    // nothing left to share the kernel with
+                    sha256_blocks_scalar(lanes[busy].h, lanes[busy].data, lanes[busy].blocks);
+                    lanes[busy].blocks = 0;
+                    continue;
+                }
+
+                // idle lanes hash the data of a busy one into a scratch state
+                auto scratch = std::array<std::array<std::uint32_t, 8>, 8> {};
+                auto h = std::array<std::uint32_t *, 8> {};
+                auto data = std::array<std::byte const *, 8> {};
+
+                for(auto i = std::size_t { 0 }; i < lanes.size(); ++i) {
+                    auto idle = lanes[i].blocks == 0;
+                    h[i] = idle ? scratch[i].data() : lanes[i].h;
+                    data[i] = idle ? lanes[busy].data : lanes[i].data;
+                }
+
+                sha256_blocks_avx2_x8(h, data, step);
+
+                for(auto &l : lanes) {
+                    if(l.blocks > 0) {
+                        l.data += 64 * step;
+                        l.blocks -= step;
+                    }
+                }
+            }
+        }
+#endif
+    }
+
+    auto sha_digest_size(doca_sha_algorithm algorithm) -> std::size_t {
+        switch(algorithm) {
+            case DOCA_SHA_ALGORITHM_SHA1:
+                return 20;
+            case DOCA_SHA_ALGORITHM_SHA256:
+                return 32;
+            case DOCA_SHA_ALGORITHM_SHA512:
+                return 64;
+        }
+
+        throw doca_exception(DOCA_ERROR_INVALID_VALUE);
+    }
+
+    auto sha_block_size(doca_sha_algorithm algorithm) -> std::size_t {
+        return algorithm == DOCA_SHA_ALGORITHM_SHA512 ? 128 : 64;
+    }
+
+    auto sha_kernel_supported(sha_kernel kernel) noexcept -> bool {
+        switch(kernel) {
+            case sha_kernel::automatic:
+            case sha_kernel::scalar:
+                return true;
+            case sha_kernel::sha_ni:
+                return features().sha_ni;
+            case sha_kernel::avx2_multi_buffer:
+                return features().avx2;
+        }
+
+        return false;
+    }
+
+    cpu_sha_state::cpu_sha_state(doca_sha_algorithm algorithm):
+        algorithm_ { algorithm }
+    {
+        // validates the algorithm
+        static_cast<void>(sha_digest_size(algorithm));
+        reset();
+    }
+
+    auto cpu_sha_state::reset() -> void {
+        length_ = 0;
+
+        switch(algorithm_) {
+            case DOCA_SHA_ALGORITHM_SHA1:
+                std::ranges::copy(sha1_init, h32_.begin());
+                break;
+            case DOCA_SHA_ALGORITHM_SHA256:
+                h32_ = sha256_init;
+                break;
+            case DOCA_SHA_ALGORITHM_SHA512:
+                h64_ = sha512_init;
+                break;
+        }
+    }
+
+    auto cpu_sha_state::absorb(std::span<std::byte const> blocks, sha_kernel kernel) -> void {
+        auto block_size = sha_block_size(algorithm_);
+        enforce(blocks.size() % block_size == 0, DOCA_ERROR_INVALID_VALUE);
+
+        auto count = blocks.size() / block_size;
+
+        switch(algorithm_) {
+            case DOCA_SHA_ALGORITHM_SHA1:
+                sha1_blocks_scalar(h32_.data(), blocks.data(), count);
+                break;
+            case DOCA_SHA_ALGORITHM_SHA256:
+                sha256_blocks(resolve(kernel, false), h32_.data(), blocks.data(), count);
+                break;
+            case DOCA_SHA_ALGORITHM_SHA512:
+                sha512_blocks_scalar(h64_.data(), blocks.data(), count);
+                break;
+        }
+
+        length_ += blocks.size();
+    }
+
+    auto cpu_sha_state::finish(std::span<std::byte const> tail) -> sha_digest {
+        auto block_size = sha_block_size(algorithm_);
+        auto whole = tail.size() - tail.size() % block_size;
+
+        absorb(tail.first(whole));
+        tail = tail.subspan(whole);
+
+        // message, 0x80, zeros, and the message length in bits at the end of the last block
+        auto length_field = algorithm_ == DOCA_SHA_ALGORITHM_SHA512 ? 16 : 8;
+        auto padding = std::array<std::byte, 256> {};
+        auto padded_size = tail.size() + 1 + length_field <= block_size ? block_size : 2 * block_size;
+        auto bits = (length_ + tail.size()) * 8;
+
+        std::ranges::copy(tail, padding.begin());
+        padding[tail.size()] = std::byte { 0x80 };
+        store_be64(padding.data() + padded_size - 8, bits);
+
+        absorb(std::span { padding }.first(padded_size));
+
+        auto digest = sha_digest {};
+        digest.size = sha_digest_size(algorithm_);
+
+        if(algorithm_ == DOCA_SHA_ALGORITHM_SHA512) {
+            for(auto i = 0; i < 8; ++i) {
+                store_be64(digest.bytes.data() + 8 * i, h64_[i]);
+            }
+        } else {
+            for(auto i = std::size_t { 0 }; i < digest.size / 4; ++i) {
+                store_be32(digest.bytes.data() + 4 * i, h32_[i]);
+            }
+        }
+
+        return digest;
+    }
+
+    auto sha_absorb_many(std::span<sha_absorb_job const> jobs, sha_kernel kernel) -> void {
+        kernel = resolve(kernel, true);
+
+#if defined(__x86_64__)
+        if(kernel == sha_kernel::avx2_multi_buffer) {
+            auto sha256_jobs = std::vector<sha256_work> {};
+
+            for(auto const &job : jobs) {
+                if(job.state->algorithm_ == DOCA_SHA_ALGORITHM_SHA256) {
+                    enforce(job.blocks.size() % 64 == 0, DOCA_ERROR_INVALID_VALUE);
+                    sha256_jobs.push_back({ job.state->h32_.data(), job.blocks.data(), job.blocks.size() / 64 });
+                    job.state->length_ += job.blocks.size();
+                } else {
+                    job.state->absorb(job.blocks, sha_kernel::scalar);
+                }
+            }
+
+            sha256_many_avx2(sha256_jobs);
+            return;
+        }
+#endif
+
+        for(auto const &job : jobs) {
+            job.state->absorb(job.blocks, kernel == sha_kernel::avx2_multi_buffer ? sha_kernel::scalar : kernel);
+        }
+    }
+
+    auto sha_hash(doca_sha_algorithm algorithm, std::span<std::byte const> data) -> sha_digest {
+        auto state = cpu_sha_state { algorithm };
+        return state.finish(data);
+    }
+
+    cpu_sha_backend::cpu_sha_backend(cpu_sha_config const &cfg):
+        cfg_ { cfg },
+        workers_ { cpu_worker_pool::shared_or_own(cfg.threads) }
+    {
+        enforce(cfg.max_batch > 0, DOCA_ERROR_INVALID_VALUE);
+        enforce(sha_kernel_supported(cfg.kernel), DOCA_ERROR_NOT_SUPPORTED);
+
+        logger->debug(
+            "cpu_sha_backend: {} worker threads, SHA-NI {}, AVX2 {}",
+            workers_->threads(),
+            features().sha_ni,
+            features().avx2
+        );
+    }
+
+    cpu_sha_backend::~cpu_sha_backend() {
+        // the workers use this backend's queue; the pool may outlive it
+        auto lock = std::unique_lock { mutex_ };
+        idle_.wait(lock, [this] { return active_workers_ == 0; });
+    }
+
+    auto cpu_sha_backend::shared() -> std::shared_ptr<cpu_sha_backend> {
+        static auto instance = std::make_shared<cpu_sha_backend>();
+        return instance;
+    }
+
+    auto cpu_sha_backend::absorb(cpu_sha_state &state, std::span<std::byte const> blocks) -> coro::status_awaitable<> {
+        if(blocks.size() % sha_block_size(state.algorithm()) != 0) {
+            return coro::status_awaitable<>::from_value(DOCA_ERROR_INVALID_VALUE);
+        }
+
+        auto result = coro::status_awaitable<>::create_space();
+        auto start_worker = false;
+
+        {
+            auto lock = std::scoped_lock { mutex_ };
+
+            queue_.push_back({ { &state, blocks }, result.receptable_ptr(), boost::cobalt::this_thread::get_executor() });
+
+            // a busy worker picks the job up on its next round
+            if(active_workers_ < workers_->threads()) {
+                ++active_workers_;
+                start_worker = true;
+            }
+        }
+
+        if(start_worker) {
+            workers_->post([this] { drain(); });
+        }
+
+        return result;
+    }
+
+    auto cpu_sha_backend::drain() -> void {
+        auto batch = std::vector<job> {};
+        auto work = std::vector<sha_absorb_job> {};
+
+        for(;;) {
+            batch.clear();
+            work.clear();
+
+            {
+                auto lock = std::scoped_lock { mutex_ };
+
+                if(queue_.empty()) {
+                    if(--active_workers_ == 0) {
+                        idle_.notify_all();
+                    }
+
+                    return;
+                }
+
+                auto count = std::min(queue_.size(), cfg_.max_batch);
+                std::move(queue_.begin(), queue_.begin() + count, std::back_inserter(batch));
+                queue_.erase(queue_.begin(), queue_.begin() + count);
+            }
+
+            for(auto const &j : batch) {
+                work.push_back(j.work);
+            }
+
+            auto status = DOCA_SUCCESS;
+
+            // nothing may escape into the thread pool
+            try {
+                sha_absorb_many(work, cfg_.kernel);
+            } catch(doca_exception &e) {
+                status = e.doca_error();
+            } catch(...) {
+                status = DOCA_ERROR_UNEXPECTED;
+            }
+
+            for(auto const &j : batch) {
+                boost::asio::post(j.executor, [receptable = j.receptable, status] {
+                    receptable->emplace_value(status);
+                    receptable->resume();
+                });
+            }
+        }
+    }
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "coro/status_awaitable.hpp"
+#include "cpu_offload.hpp"
+
+#include <doca_sha.h>
+
+#include <boost/cobalt/this_thread.hpp>
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace shoc {
+    /**
+     * Digest of up to 512 bits
+     */
+    struct sha_digest {
+        std::array<std::byte, 64> bytes {};
+        std::size_t size = 0;
+
+        [[nodiscard]] auto data() const noexcept -> std::span<std::byte const> {
+            return std::span { bytes }.first(size);
+        }
+
+        friend auto operator==(sha_digest const &lhs, sha_digest const &rhs) noexcept -> bool {
+            return std::ranges::equal(lhs.data(), rhs.data());
+        }
+    };
+
+    /**
+     * @return digest length of the algorithm in bytes
+     */
+    [[nodiscard]] auto sha_digest_size(doca_sha_algorithm algorithm) -> std::size_t;
+
+    /**
+     * @return block length of the algorithm in bytes, i.e. the granularity in which it consumes data
+     */
+    [[nodiscard]] auto sha_block_size(doca_sha_algorithm algorithm) -> std::size_t;
+
+    /**
+     * Implementations of the SHA block functions
+     */
+    enum class sha_kernel {
+        /// the fastest one the CPU supports
+        automatic,
+        /// portable C++
+        scalar,
+        /// x86 SHA extensions, one message at a time (SHA-256 only)
+        sha_ni,
+        /// AVX2, eight SHA-256 messages at a time in the lanes of the vector registers
+        avx2_multi_buffer
+    };
+
+    /**
+     * @return whether the kernel can run on this CPU
+     */
+    [[nodiscard]] auto sha_kernel_supported(sha_kernel kernel) noexcept -> bool;
+
+    class cpu_sha_state;
+
+    /**
+     * One independent piece of work for sha_absorb_many
+     */
+    struct sha_absorb_job {
+        cpu_sha_state *state;
+        /// whole blocks
+        std::span<std::byte const> blocks;
+    };
+
+    /**
+     * Absorbs data into many independent states. With the multi-buffer kernel, SHA-256 jobs are
+     * hashed eight at a time, which pays off when the CPU lacks SHA extensions and there are
+     * many messages to hash, e.g. the chunks of a deduplication pipeline. Lanes whose job runs
+     * out are refilled with the next job, so the jobs don't need to be of the same length.
+     * Jobs must not share a state.
+     */
+    auto sha_absorb_many(std::span<sha_absorb_job const> jobs, sha_kernel kernel = sha_kernel::automatic) -> void;
+
+    /**
+     * Running state of a hash in software. Data is absorbed in whole blocks; the caller keeps any
+     * rest until finish(), as sha_stream does.
+     */
+    class cpu_sha_state {
+    public:
+        explicit cpu_sha_state(doca_sha_algorithm algorithm = DOCA_SHA_ALGORITHM_SHA256);
+
+        [[nodiscard]] auto algorithm() const noexcept { return algorithm_; }
+
+        /**
+         * @return number of bytes absorbed so far
+         */
+        [[nodiscard]] auto length() const noexcept { return length_; }
+
+        /**
+         * Start over with a new message
+         */
+        auto reset() -> void;
+
+        /**
+         * @param blocks data whose size is a multiple of sha_block_size(algorithm())
+         */
+        auto absorb(std::span<std::byte const> blocks, sha_kernel kernel = sha_kernel::automatic) -> void;
+
+        /**
+         * Absorb the last bytes of the message, pad it and produce the digest. The state has to
+         * be reset() before it can be used again.
+         *
+         * @param tail remaining data of any length
+         */
+        [[nodiscard]] auto finish(std::span<std::byte const> tail) -> sha_digest;
+
+    private:
+        friend auto sha_absorb_many(std::span<sha_absorb_job const> jobs, sha_kernel kernel) -> void;
+
+        doca_sha_algorithm algorithm_;
+        std::uint64_t length_ = 0;
+        /// SHA-1 (first five words) and SHA-256
+        std::array<std::uint32_t, 8> h32_ {};
+        /// SHA-512
+        std::array<std::uint64_t, 8> h64_ {};
+    };
+
+    /**
+     * @return the digest of data, computed on the calling thread
+     */
+    [[nodiscard]] auto sha_hash(doca_sha_algorithm algorithm, std::span<std::byte const> data) -> sha_digest;
+
+    /**
+     * Configuration for a cpu_sha_backend
+     */
+    struct cpu_sha_config {
+        /// Number of worker threads of a pool of its own; 0 shares cpu_worker_pool::shared()
+        std::size_t threads = 0;
+        /// Maximum number of queued jobs a worker takes on at once
+        std::size_t max_batch = 64;
+        sha_kernel kernel = sha_kernel::automatic;
+    };
+
+    /**
+     * Hashes on a cpu_worker_pool, with at most as many jobs running as the pool has threads.
+     * Jobs submitted while the workers are busy queue up and
+     * are then taken on in batches through sha_absorb_many, so many streams hashed concurrently
+     * (e.g. one sha_stream per chunk) fill the lanes of the multi-buffer kernel.
+     *
+     * Completions are posted to the executor of the thread that submitted the job, as with
+     * cpu_compress_backend.
+     */
+    class cpu_sha_backend {
+    public:
+        explicit cpu_sha_backend(cpu_sha_config const &cfg = {});
+
+        /**
+         * Waits for the jobs in flight
+         */
+        ~cpu_sha_backend();
+
+        cpu_sha_backend(cpu_sha_backend const &) = delete;
+        cpu_sha_backend(cpu_sha_backend &&) = delete;
+        cpu_sha_backend &operator=(cpu_sha_backend const &) = delete;
+        cpu_sha_backend &operator=(cpu_sha_backend &&) = delete;
+
+        /**
+         * Process-wide backend with the default configuration, created on first use
+         */
+        [[nodiscard]] static auto shared() -> std::shared_ptr<cpu_sha_backend>;
+
+        [[nodiscard]] auto config() const noexcept -> cpu_sha_config const & { return cfg_; }
+        [[nodiscard]] auto workers() const noexcept -> cpu_worker_pool & { return *workers_; }
+
+        /**
+         * Absorb blocks into state on a worker thread. Neither may be touched until the
+         * awaitable completes.
+         */
+        auto absorb(cpu_sha_state &state, std::span<std::byte const> blocks) -> coro::status_awaitable<>;
+
+    private:
+        struct job {
+            sha_absorb_job work;
+            coro::status_awaitable<>::payload_type *receptable;
+            boost::cobalt::executor executor;
+        };
+
+        auto drain() -> void;
+
+        cpu_sha_config cfg_;
+        std::mutex mutex_;
+        std::vector<job> queue_;
+        std::size_t active_workers_ = 0;
+        std::condition_variable idle_;
+        std::shared_ptr<cpu_worker_pool> workers_;
+    };
+}
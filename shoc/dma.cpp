@@ -27,6 +27,8 @@ namespace shoc {
             plain_status_callback<doca_dma_task_memcpy_as_task>,
             max_tasks
         ));
+
+        reserve_receptables<coro::status_awaitable<>::payload_type>(max_tasks);
     }
 
     auto dma_context::memcpy(
@@ -0,0 +1,91 @@
+#include "ec_matrix_cache.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace shoc {
+    ec_matrix_cache::ec_matrix_cache(
+        ec_backend &backend,
+        doca_ec_matrix_type type,
+        std::size_t data_block_count,
+        std::size_t rdnc_block_count,
+        std::size_t capacity
+    ):
+        backend_ { &backend },
+        coding_matrix_ { backend.coding_matrix(type, data_block_count, rdnc_block_count) },
+        capacity_ { capacity }
+    {
+        enforce(capacity > 0, DOCA_ERROR_INVALID_VALUE);
+    }
+
+    auto ec_matrix_cache::recover_matrix(
+        std::span<std::uint32_t const> missing_indices
+    ) -> std::shared_ptr<ec_recover_matrix const> {
+        return lookup(matrix_kind::recover, missing_indices).recover;
+    }
+
+    auto ec_matrix_cache::update_matrix(
+        std::span<std::uint32_t const> update_indices
+    ) -> std::shared_ptr<ec_update_matrix const> {
+        return lookup(matrix_kind::update, update_indices).update;
+    }
+
+    auto ec_matrix_cache::clear() -> void {
+        by_key_.clear();
+        lru_.clear();
+        stats_.entries = 0;
+    }
+
+    auto ec_matrix_cache::lookup(matrix_kind kind, std::span<std::uint32_t const> indices) -> entry & {
+        auto id = key { kind, { indices.begin(), indices.end() } };
+        std::ranges::sort(id.indices);
+
+        if(auto found = by_key_.find(id); found != by_key_.end()) {
+            ++stats_.hits;
+            lru_.splice(lru_.begin(), lru_, found->second);
+            return lru_.front();
+        }
+
+        ++stats_.misses;
+
+        // build before inserting, so that invalid indices don't leave an empty entry behind
+        auto built = entry { std::move(id), nullptr, nullptr };
+
+        if(kind == matrix_kind::recover) {
+            built.recover = std::make_shared<ec_recover_matrix const>(
+                backend_->recover_matrix(coding_matrix_, built.id.indices)
+            );
+        } else {
+            built.update = std::make_shared<ec_update_matrix const>(
+                backend_->update_matrix(coding_matrix_, built.id.indices)
+            );
+        }
+
+        lru_.push_front(std::move(built));
+        by_key_.emplace(lru_.front().id, lru_.begin());
+        ++stats_.entries;
+
+        enforce_capacity();
+
+        return lru_.front();
+    }
+
+    auto ec_matrix_cache::enforce_capacity() -> void {
+        // the newest entry is at the front and never the victim. A dropped matrix lives on with
+        // whoever still holds it.
+        while(stats_.entries > capacity_) {
+            auto victim = std::prev(lru_.end());
+
+            logger->debug("ec_matrix_cache: dropping matrix for {} indices", victim->id.indices.size());
+
+            by_key_.erase(victim->id);
+            lru_.erase(victim);
+            --stats_.entries;
+            ++stats_.evictions;
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "erasure_coding.hpp"
+
+#include <doca_erasure_coding.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace shoc {
+    /**
+     * Counters of an ec_matrix_cache
+     */
+    struct ec_matrix_cache_stats {
+        /// lookups that found the matrix built
+        std::uint64_t hits = 0;
+        /// lookups that had to build the matrix
+        std::uint64_t misses = 0;
+        /// matrices dropped to stay within the capacity
+        std::uint64_t evictions = 0;
+        /// number of matrices currently held by the cache
+        std::size_t entries = 0;
+
+        [[nodiscard]] auto hit_rate() const noexcept -> double {
+            auto lookups = hits + misses;
+            return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+        }
+    };
+
+    /**
+     * The coding matrix of one stripe geometry together with the recover and update matrices
+     * derived from it, by index set. Building a recover or update matrix inverts or rearranges
+     * the coding matrix, on the device through the SDK; while a failed node is rebuilt, every
+     * stripe needs the matrix for the same few sets of missing blocks, so building it per stripe
+     * would throttle recovery. The cache hands out shared matrices and keeps up to capacity of
+     * them; beyond that, the least recently used ones are dropped. A matrix that was handed out
+     * stays valid as long as it is held.
+     *
+     * Index sets are keys regardless of their order: a matrix is built for the indices sorted in
+     * ascending order, so blocks are recovered, and old/new block pairs of an update are laid
+     * out, in ascending index order, whatever order they were asked for in.
+     *
+     * For an ec_context, clear the cache (or destroy it) and drop the handed-out matrices before
+     * stopping the context. Like the rest of the library, this is not threadsafe.
+     */
+    class ec_matrix_cache {
+    public:
+        /**
+         * @param backend context or software backend the matrices are built for; must outlive
+         *        the cache
+         * @param type encoding matrix type
+         * @param data_block_count number of data blocks per stripe
+         * @param rdnc_block_count number of redundancy blocks per stripe
+         * @param capacity number of recover and update matrices to keep
+         */
+        ec_matrix_cache(
+            ec_backend &backend,
+            doca_ec_matrix_type type,
+            std::size_t data_block_count,
+            std::size_t rdnc_block_count,
+            std::size_t capacity = 64
+        );
+
+        ec_matrix_cache(ec_matrix_cache const &) = delete;
+        ec_matrix_cache(ec_matrix_cache &&) = delete;
+        ec_matrix_cache &operator=(ec_matrix_cache const &) = delete;
+        ec_matrix_cache &operator=(ec_matrix_cache &&) = delete;
+
+        [[nodiscard]] auto coding_matrix() const noexcept -> ec_coding_matrix const & {
+            return coding_matrix_;
+        }
+
+        /**
+         * Get the recover matrix for a set of missing block indices, building it if necessary
+         *
+         * @param missing_indices indices of the missing blocks, in [0, data + rdnc block count)
+         */
+        [[nodiscard]] auto recover_matrix(
+            std::span<std::uint32_t const> missing_indices
+        ) -> std::shared_ptr<ec_recover_matrix const>;
+
+        /**
+         * Get the update matrix for a set of updated data block indices, building it if
+         * necessary
+         *
+         * @param update_indices indices of the updated data blocks, in [0, data block count)
+         */
+        [[nodiscard]] auto update_matrix(
+            std::span<std::uint32_t const> update_indices
+        ) -> std::shared_ptr<ec_update_matrix const>;
+
+        /**
+         * Drop all recover and update matrices. The coding matrix stays.
+         */
+        auto clear() -> void;
+
+        [[nodiscard]] auto stats() const noexcept -> ec_matrix_cache_stats const & {
+            return stats_;
+        }
+
+        [[nodiscard]] auto capacity() const noexcept {
+            return capacity_;
+        }
+
+    private:
+        enum class matrix_kind {
+            recover,
+            update
+        };
+
+        struct key {
+            matrix_kind kind;
+            std::vector<std::uint32_t> indices;
+
+            auto operator<=>(key const &) const = default;
+        };
+
+        struct entry {
+            key id;
+            std::shared_ptr<ec_recover_matrix const> recover;
+            std::shared_ptr<ec_update_matrix const> update;
+        };
+
+        using lru_list = std::list<entry>;
+
+        /**
+         * Find the entry for the sorted indices and move it to the front, or build it there
+         */
+        auto lookup(matrix_kind kind, std::span<std::uint32_t const> indices) -> entry &;
+        auto enforce_capacity() -> void;
+
+        ec_backend *backend_;
+        ec_coding_matrix coding_matrix_;
+        std::size_t capacity_;
+        std::map<key, lru_list::iterator> by_key_;
+        // most recently used first
+        lru_list lru_;
+        ec_matrix_cache_stats stats_;
+    };
+}
@@ -0,0 +1,812 @@
+#include "ec_stripe_store.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+
+namespace shoc {
+    namespace ec_stripe_format {
+        namespace {
+            auto store32(std::byte *out, std::uint32_t value) -> void {
+                value = htole32(value);
+                std::memcpy(out, &value, sizeof value);
+            }
+
+            auto store64(std::byte *out, std::uint64_t value) -> void {
+                value = htole64(value);
+                std::memcpy(out, &value, sizeof value);
+            }
+
+            auto load32(std::byte const *in) -> std::uint32_t {
+                std::uint32_t value;
+                std::memcpy(&value, in, sizeof value);
+                return le32toh(value);
+            }
+
+            auto load64(std::byte const *in) -> std::uint64_t {
+                std::uint64_t value;
+                std::memcpy(&value, in, sizeof value);
+                return le64toh(value);
+            }
+        }
+
+        auto shard_header::same_object(shard_header const &other) const noexcept -> bool {
+            return version == other.version
+                && data_blocks == other.data_blocks
+                && rdnc_blocks == other.rdnc_blocks
+                && block_size == other.block_size
+                && matrix_type == other.matrix_type
+                && object_size == other.object_size;
+        }
+
+        auto shard_header::encode(std::span<std::byte, encoded_size> out) const -> void {
+            std::ranges::fill(out, std::byte { 0 });
+            std::memcpy(out.data(), magic.data(), magic.size());
+            store32(out.data() + 4, version);
+            store32(out.data() + 8, shard_index);
+            store32(out.data() + 12, data_blocks);
+            store32(out.data() + 16, rdnc_blocks);
+            store32(out.data() + 20, block_size);
+            store32(out.data() + 24, matrix_type);
+            store64(out.data() + 32, object_size);
+        }
+
+        auto shard_header::decode(std::span<std::byte const, encoded_size> in) -> std::optional<shard_header> {
+            if(std::memcmp(in.data(), magic.data(), magic.size()) != 0) {
+                return std::nullopt;
+            }
+
+            auto header = shard_header {};
+            header.version = load32(in.data() + 4);
+            header.shard_index = load32(in.data() + 8);
+            header.data_blocks = load32(in.data() + 12);
+            header.rdnc_blocks = load32(in.data() + 16);
+            header.block_size = load32(in.data() + 20);
+            header.matrix_type = load32(in.data() + 24);
+            header.object_size = load64(in.data() + 32);
+
+            return header;
+        }
+    }
+
+    namespace {
+        auto validated(ec_stripe_config const &cfg) -> ec_stripe_config const & {
+            enforce(cfg.data_blocks > 0 && cfg.rdnc_blocks > 0 && cfg.max_tasks > 0, DOCA_ERROR_INVALID_VALUE);
+            // shard headers have 32-bit block sizes
+            enforce(cfg.block_size > 0 && cfg.block_size % 64 == 0 && cfg.block_size <= UINT32_MAX, DOCA_ERROR_INVALID_VALUE);
+
+            return cfg;
+        }
+
+        /**
+         * Wait for the tasks that are still in flight after a failure, since their buffers
+         * must not be reused while the device may still write to them
+         */
+        template<typename Slots>
+        auto drain(Slots &slots, std::uint64_t from, std::uint64_t to) -> boost::cobalt::task<void> {
+            for(; from < to; ++from) {
+                auto &pending = slots[from % slots.size()].task;
+
+                try {
+                    co_await pending;
+                } catch(...) {
+                }
+            }
+        }
+
+        auto open_shards(std::span<int const> fds, stream_io io) -> std::vector<std::unique_ptr<stream_file>> {
+            auto shards = std::vector<std::unique_ptr<stream_file>>(fds.size());
+
+            for(auto i = std::size_t { 0 }; i < fds.size(); ++i) {
+                if(fds[i] >= 0) {
+                    shards[i] = std::make_unique<stream_file>(fds[i], io);
+                }
+            }
+
+            return shards;
+        }
+
+        /**
+         * Read the shard headers. Those of missing shards, and those that don't decode or belong
+         * to another shard index, are nullopt.
+         */
+        auto read_headers(
+            std::vector<std::unique_ptr<stream_file>> const &shards,
+            std::uint64_t &bytes_in
+        ) -> boost::cobalt::task<std::vector<std::optional<ec_stripe_format::shard_header>>> {
+            namespace format = ec_stripe_format;
+
+            auto headers = std::vector<std::optional<format::shard_header>>(shards.size());
+
+            for(auto i = std::size_t { 0 }; i < shards.size(); ++i) {
+                if(shards[i] == nullptr) {
+                    continue;
+                }
+
+                auto header_bytes = std::array<std::byte, format::shard_header::encoded_size> {};
+                auto length = co_await shards[i]->read_at(0, header_bytes);
+                bytes_in += length;
+
+                if(length == header_bytes.size()) {
+                    if(auto header = format::shard_header::decode(header_bytes); header && header->shard_index == i) {
+                        headers[i] = header;
+                    }
+                }
+            }
+
+            co_return headers;
+        }
+
+        auto same_geometry(ec_stripe_format::shard_header const &header, ec_stripe_config const &cfg) -> bool {
+            return header.data_blocks == cfg.data_blocks
+                && header.rdnc_blocks == cfg.rdnc_blocks
+                && header.block_size == cfg.block_size
+                && header.matrix_type == static_cast<std::uint32_t>(cfg.matrix_type);
+        }
+
+        /**
+         * Copy the parts of the extents that fall into a block, in order
+         */
+        template<typename Extents>
+        auto patch(Extents const &extents, std::uint64_t block_offset, std::span<std::byte> block) -> void {
+            for(auto const &e : extents) {
+                auto begin = std::max(e.offset, block_offset);
+                auto end = std::min(e.offset + e.data.size(), block_offset + block.size());
+
+                if(begin < end) {
+                    std::copy(
+                        e.data.begin() + (begin - e.offset),
+                        e.data.begin() + (end - e.offset),
+                        block.begin() + (begin - block_offset)
+                    );
+                }
+            }
+        }
+
+        /**
+         * @return whether the extents touch the block [begin, end), and whether they cover it
+         */
+        template<typename Extents>
+        auto coverage(Extents const &extents, std::uint64_t begin, std::uint64_t end) -> std::pair<bool, bool> {
+            auto parts = std::vector<std::pair<std::uint64_t, std::uint64_t>> {};
+
+            for(auto const &e : extents) {
+                auto from = std::max(e.offset, begin);
+                auto to = std::min(e.offset + e.data.size(), end);
+
+                if(from < to) {
+                    parts.emplace_back(from, to);
+                }
+            }
+
+            std::ranges::sort(parts);
+
+            auto covered = begin;
+
+            for(auto [from, to] : parts) {
+                if(from > covered) {
+                    break;
+                }
+
+                covered = std::max(covered, to);
+            }
+
+            return { !parts.empty(), covered >= end };
+        }
+    }
+
+    ec_stripe_store::ec_stripe_store(ec_backend &backend, device const &dev, ec_stripe_config const &cfg):
+        backend_ { &backend },
+        cfg_ { validated(cfg) },
+        block_count_ { std::size_t { cfg_.data_blocks } + cfg_.rdnc_blocks },
+        matrices_ { backend, cfg_.matrix_type, cfg_.data_blocks, cfg_.rdnc_blocks, cfg_.matrix_cache_capacity },
+        data_stripes_ { cfg_.max_tasks, cfg_.data_blocks * cfg_.block_size, 64, cfg_.memory },
+        rdnc_stripes_ { cfg_.max_tasks, cfg_.rdnc_blocks * cfg_.block_size, 64, cfg_.memory },
+        data_mmap_ { dev, data_stripes_.as_writable_bytes() },
+        rdnc_mmap_ { dev, rdnc_stripes_.as_writable_bytes() },
+        inventory_ { cfg_.max_tasks * 2 },
+        data_buffers_ { inventory_.buf_get_blocks(data_mmap_, data_stripes_) },
+        rdnc_buffers_ { inventory_.buf_get_blocks(rdnc_mmap_, rdnc_stripes_) }
+    {
+    }
+
+    auto ec_stripe_store::write(int in_fd, std::span<int const> shard_fds) -> boost::cobalt::task<ec_stripe_stats> {
+        namespace format = ec_stripe_format;
+
+        enforce(shard_fds.size() == block_count_, DOCA_ERROR_INVALID_VALUE);
+        enforce(std::ranges::all_of(shard_fds, [](int fd) { return fd >= 0; }), DOCA_ERROR_INVALID_VALUE);
+
+        auto in = stream_file { in_fd, cfg_.io };
+        auto shards = open_shards(shard_fds, cfg_.io);
+        auto stats = ec_stripe_stats {};
+        auto slots = std::vector<slot>(cfg_.max_tasks);
+        auto stripe_size = std::uint64_t { cfg_.data_blocks } * cfg_.block_size;
+
+        // stripes [written, submitted) are being encoded
+        auto written = std::uint64_t { 0 };
+        auto submitted = std::uint64_t { 0 };
+        auto end_of_input = false;
+        auto failure = std::exception_ptr {};
+
+        try {
+            while(written < submitted || !end_of_input) {
+                while(!end_of_input && submitted - written < cfg_.max_tasks) {
+                    auto index = submitted % cfg_.max_tasks;
+                    auto stripe = data_stripes_.writable_block(index);
+                    auto length = co_await in.read_at(submitted * stripe_size, stripe);
+
+                    end_of_input = length < stripe.size();
+
+                    if(length == 0) {
+                        break;
+                    }
+
+                    // the last stripe is padded with zeroes; the header says where the object ends
+                    std::fill(stripe.begin() + length, stripe.end(), std::byte { 0 });
+                    stats.bytes_in += length;
+
+                    data_buffers_[index].set_data(stripe.size());
+                    rdnc_buffers_[index].set_data(0);
+
+                    slots[index].stripe = submitted;
+                    slots[index].task = backend_->create(matrices_.coding_matrix(), data_buffers_[index], rdnc_buffers_[index]);
+                    ++submitted;
+                }
+
+                if(written == submitted) {
+                    continue;
+                }
+
+                auto index = written % cfg_.max_tasks;
+                auto &oldest = slots[index];
+                auto status = co_await oldest.task;
+
+                ++written;
+                enforce_success(status);
+
+                auto offset = format::shard_header::encoded_size + oldest.stripe * cfg_.block_size;
+                auto data = data_stripes_.block(index);
+                auto rdnc = rdnc_stripes_.block(index);
+
+                for(auto i = std::size_t { 0 }; i < block_count_; ++i) {
+                    auto block = i < cfg_.data_blocks
+                        ? data.subspan(i * cfg_.block_size, cfg_.block_size)
+                        : rdnc.subspan((i - cfg_.data_blocks) * cfg_.block_size, cfg_.block_size);
+
+                    co_await shards[i]->write_at(offset, block);
+                }
+
+                stats.bytes_out += block_count_ * cfg_.block_size;
+                ++stats.stripes;
+            }
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        if(failure) {
+            co_await drain(slots, written, submitted);
+            std::rethrow_exception(failure);
+        }
+
+        // the headers go last, once the object size is known, so that a shard set that was cut
+        // short by an error doesn't look complete
+        auto header = format::shard_header {};
+        header.data_blocks = cfg_.data_blocks;
+        header.rdnc_blocks = cfg_.rdnc_blocks;
+        header.block_size = static_cast<std::uint32_t>(cfg_.block_size);
+        header.matrix_type = static_cast<std::uint32_t>(cfg_.matrix_type);
+        header.object_size = stats.bytes_in;
+
+        auto header_bytes = std::array<std::byte, format::shard_header::encoded_size> {};
+
+        for(auto i = std::size_t { 0 }; i < block_count_; ++i) {
+            header.shard_index = static_cast<std::uint32_t>(i);
+            header.encode(header_bytes);
+            co_await shards[i]->write_at(0, header_bytes);
+        }
+
+        stats.bytes_out += block_count_ * header_bytes.size();
+
+        logger->debug("ec_stripe_store: wrote {} stripes, {} bytes in, {} bytes out", stats.stripes, stats.bytes_in, stats.bytes_out);
+
+        co_return stats;
+    }
+
+    auto ec_stripe_store::read(std::span<int const> shard_fds, int out_fd) -> boost::cobalt::task<ec_stripe_stats> {
+        namespace format = ec_stripe_format;
+
+        enforce(shard_fds.size() == block_count_, DOCA_ERROR_INVALID_VALUE);
+
+        auto out = stream_file { out_fd, cfg_.io };
+        auto shards = open_shards(shard_fds, cfg_.io);
+        auto stats = ec_stripe_stats {};
+        auto headers = co_await read_headers(shards, stats.bytes_in);
+
+        // a shard left over from another object must not outvote the object's own shards
+        auto agreeing = [&](format::shard_header const &candidate) {
+            return std::ranges::count_if(headers, [&](auto const &other) {
+                return other && other->same_object(candidate);
+            });
+        };
+
+        auto reference = std::optional<format::shard_header> {};
+        auto votes = std::ptrdiff_t { 0 };
+
+        for(auto const &header : headers) {
+            if(header && agreeing(*header) > votes) {
+                reference = header;
+                votes = agreeing(*header);
+            }
+        }
+
+        enforce(votes >= static_cast<std::ptrdiff_t>(cfg_.data_blocks), DOCA_ERROR_IO_FAILED);
+        enforce(same_geometry(*reference, cfg_), DOCA_ERROR_INVALID_VALUE);
+
+        // the first data_blocks shards that are there are the ones we read; the rest counts as
+        // missing for the recover matrix
+        auto chosen = std::vector<std::uint32_t> {};
+        auto missing = std::vector<std::uint32_t> {};
+
+        for(auto i = std::uint32_t { 0 }; i < block_count_; ++i) {
+            auto present = headers[i] && headers[i]->same_object(*reference);
+
+            if(!present) {
+                ++stats.missing_shards;
+            }
+
+            if(present && chosen.size() < cfg_.data_blocks) {
+                chosen.push_back(i);
+            } else {
+                missing.push_back(i);
+            }
+        }
+
+        if(stats.missing_shards > 0) {
+            logger->info("ec_stripe_store: {} of {} shards missing", stats.missing_shards, block_count_);
+        }
+
+        // recovered blocks come out in ascending order of the missing indices, so the missing
+        // data blocks are the first ones
+        auto needs_recovery = chosen.back() >= cfg_.data_blocks;
+        auto matrix = needs_recovery ? matrices_.recover_matrix(missing) : nullptr;
+
+        auto source_of = [&](std::uint32_t data_block) -> std::pair<bool, std::size_t> {
+            if(auto found = std::ranges::find(chosen, data_block); found != chosen.end()) {
+                return { true, static_cast<std::size_t>(found - chosen.begin()) };
+            }
+
+            return { false, static_cast<std::size_t>(std::ranges::find(missing, data_block) - missing.begin()) };
+        };
+
+        auto stripe_size = std::uint64_t { cfg_.data_blocks } * cfg_.block_size;
+        auto stripe_count = reference->stripe_count();
+        auto slots = std::vector<slot>(cfg_.max_tasks);
+
+        auto written = std::uint64_t { 0 };
+        auto submitted = std::uint64_t { 0 };
+        auto failure = std::exception_ptr {};
+
+        try {
+            while(written < stripe_count) {
+                while(submitted < stripe_count && submitted - written < cfg_.max_tasks) {
+                    auto index = submitted % cfg_.max_tasks;
+                    auto available = data_stripes_.writable_block(index);
+                    auto offset = format::shard_header::encoded_size + submitted * cfg_.block_size;
+
+                    for(auto position = std::size_t { 0 }; position < chosen.size(); ++position) {
+                        auto block = available.subspan(position * cfg_.block_size, cfg_.block_size);
+                        auto length = co_await shards[chosen[position]]->read_at(offset, block);
+
+                        // a shard that ends early has lost data, not just padding
+                        enforce(length == block.size(), DOCA_ERROR_IO_FAILED);
+                        stats.bytes_in += length;
+                    }
+
+                    slots[index].stripe = submitted;
+
+                    if(needs_recovery) {
+                        data_buffers_[index].set_data(available.size());
+                        rdnc_buffers_[index].set_data(0);
+                        slots[index].task = backend_->recover(*matrix, data_buffers_[index], rdnc_buffers_[index]);
+                    } else {
+                        slots[index].task = coro::status_awaitable<>::from_value(DOCA_SUCCESS);
+                    }
+
+                    ++submitted;
+                }
+
+                auto index = written % cfg_.max_tasks;
+                auto &oldest = slots[index];
+                auto status = co_await oldest.task;
+
+                ++written;
+                enforce_success(status);
+
+                if(needs_recovery) {
+                    ++stats.recovered_stripes;
+                }
+
+                auto available = data_stripes_.block(index);
+                auto recovered = rdnc_stripes_.block(index);
+                auto stripe_offset = oldest.stripe * stripe_size;
+
+                for(auto j = std::uint32_t { 0 }; j < cfg_.data_blocks; ++j) {
+                    auto block_offset = stripe_offset + std::uint64_t { j } * cfg_.block_size;
+
+                    if(block_offset >= reference->object_size) {
+                        break;
+                    }
+
+                    auto [from_available, position] = source_of(j);
+                    auto block = (from_available ? available : recovered).subspan(position * cfg_.block_size, cfg_.block_size);
+                    auto length = std::min<std::uint64_t>(block.size(), reference->object_size - block_offset);
+
+                    co_await out.write_at(block_offset, block.first(length));
+                    stats.bytes_out += length;
+                }
+
+                ++stats.stripes;
+            }
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        if(failure) {
+            co_await drain(slots, written, submitted);
+            std::rethrow_exception(failure);
+        }
+
+        logger->debug("ec_stripe_store: read {} stripes, {} recovered", stats.stripes, stats.recovered_stripes);
+
+        co_return stats;
+    }
+
+    ec_stripe_writer::ec_stripe_writer(
+        ec_backend &backend,
+        device const &dev,
+        ec_stripe_config const &cfg,
+        ec_update_mode mode
+    ):
+        backend_ { &backend },
+        cfg_ { validated(cfg) },
+        mode_ { mode },
+        block_count_ { std::size_t { cfg_.data_blocks } + cfg_.rdnc_blocks },
+        matrices_ { backend, cfg_.matrix_type, cfg_.data_blocks, cfg_.rdnc_blocks, cfg_.matrix_cache_capacity },
+        in_stripes_ { cfg_.max_tasks, (2 * std::size_t { cfg_.data_blocks } + cfg_.rdnc_blocks) * cfg_.block_size, 64, cfg_.memory },
+        out_stripes_ { cfg_.max_tasks, cfg_.rdnc_blocks * cfg_.block_size, 64, cfg_.memory },
+        in_mmap_ { dev, in_stripes_.as_writable_bytes() },
+        out_mmap_ { dev, out_stripes_.as_writable_bytes() },
+        inventory_ { cfg_.max_tasks * 2 },
+        in_buffers_ { inventory_.buf_get_blocks(in_mmap_, in_stripes_) },
+        out_buffers_ { inventory_.buf_get_blocks(out_mmap_, out_stripes_) }
+    {
+    }
+
+    auto ec_stripe_writer::write(std::uint64_t offset, std::span<std::byte const> data) -> void {
+        enforce(offset <= UINT64_MAX - data.size(), DOCA_ERROR_INVALID_VALUE);
+
+        if(data.empty()) {
+            return;
+        }
+
+        auto stripe_size = std::uint64_t { cfg_.data_blocks } * cfg_.block_size;
+
+        ++pending_writes_;
+        pending_bytes_ += data.size();
+
+        while(!data.empty()) {
+            auto in_stripe = offset % stripe_size;
+            auto length = std::min<std::uint64_t>(data.size(), stripe_size - in_stripe);
+
+            pending_[offset / stripe_size].push_back(extent { in_stripe, { data.begin(), data.begin() + length } });
+
+            data = data.subspan(length);
+            offset += length;
+        }
+    }
+
+    auto ec_stripe_writer::flush(std::span<int const> shard_fds) -> boost::cobalt::task<ec_stripe_write_stats> {
+        enforce(shard_fds.size() == block_count_, DOCA_ERROR_INVALID_VALUE);
+        enforce(!flushing_, DOCA_ERROR_BAD_STATE);
+
+        auto stripes = std::exchange(pending_, {});
+        auto stats = ec_stripe_write_stats {};
+        stats.writes = std::exchange(pending_writes_, 0);
+        pending_bytes_ = 0;
+
+        if(stripes.empty()) {
+            co_return stats;
+        }
+
+        flushing_ = true;
+
+        auto failure = std::exception_ptr {};
+
+        try {
+            co_await apply(stripes, shard_fds, stats);
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        flushing_ = false;
+
+        if(failure) {
+            std::rethrow_exception(failure);
+        }
+
+        logger->debug(
+            "ec_stripe_writer: {} writes to {} stripes, {} updated, {} encoded again",
+            stats.writes, stats.stripes, stats.delta_stripes, stats.full_stripes
+        );
+
+        co_return stats;
+    }
+
+    auto ec_stripe_writer::apply(
+        stripe_map const &stripes,
+        std::span<int const> shard_fds,
+        ec_stripe_write_stats &stats
+    ) -> boost::cobalt::task<void> {
+        namespace format = ec_stripe_format;
+
+        enforce(std::ranges::all_of(shard_fds, [](int fd) { return fd >= 0; }), DOCA_ERROR_IO_FAILED);
+
+        auto shards = open_shards(shard_fds, cfg_.io);
+        auto headers = co_await read_headers(shards, stats.bytes_in);
+
+        // a stripe can only be updated consistently with all of its blocks
+        for(auto const &header : headers) {
+            enforce(header && headers.front() && header->same_object(*headers.front()), DOCA_ERROR_IO_FAILED);
+        }
+
+        enforce(same_geometry(*headers.front(), cfg_), DOCA_ERROR_INVALID_VALUE);
+
+        // nothing is changed if any write goes past the end of the object
+        auto stripe_size = std::uint64_t { cfg_.data_blocks } * cfg_.block_size;
+        auto const &[last_stripe, last_extents] = *stripes.rbegin();
+
+        for(auto const &e : last_extents) {
+            enforce(last_stripe * stripe_size + e.offset + e.data.size() <= headers.front()->object_size, DOCA_ERROR_INVALID_VALUE);
+        }
+
+        auto slots = std::vector<slot>(cfg_.max_tasks);
+        auto next = stripes.begin();
+
+        // stripes [written, submitted) are being coded
+        auto written = std::uint64_t { 0 };
+        auto submitted = std::uint64_t { 0 };
+        auto failure = std::exception_ptr {};
+
+        try {
+            while(written < submitted || next != stripes.end()) {
+                while(next != stripes.end() && submitted - written < cfg_.max_tasks) {
+                    auto index = submitted % cfg_.max_tasks;
+
+                    co_await submit(slots[index], index, *next, shards, stats);
+
+                    ++next;
+                    ++submitted;
+                }
+
+                auto index = written % cfg_.max_tasks;
+                auto &oldest = slots[index];
+                auto status = co_await oldest.task;
+
+                ++written;
+                oldest.matrix.reset();
+                enforce_success(status);
+
+                auto offset = format::shard_header::encoded_size + oldest.stripe * cfg_.block_size;
+                auto in = in_stripes_.block(index);
+                auto out = out_stripes_.block(index);
+
+                for(auto position = std::size_t { 0 }; position < oldest.changed.size(); ++position) {
+                    // the new version of a changed block follows the old one in an update
+                    auto block = oldest.delta
+                        ? in.subspan((2 * position + 1) * cfg_.block_size, cfg_.block_size)
+                        : in.subspan(oldest.changed[position] * cfg_.block_size, cfg_.block_size);
+
+                    co_await shards[oldest.changed[position]]->write_at(offset, block);
+                }
+
+                for(auto r = std::size_t { 0 }; r < cfg_.rdnc_blocks; ++r) {
+                    co_await shards[cfg_.data_blocks + r]->write_at(offset, out.subspan(r * cfg_.block_size, cfg_.block_size));
+                }
+
+                stats.bytes_out += (oldest.changed.size() + cfg_.rdnc_blocks) * cfg_.block_size;
+                ++stats.stripes;
+            }
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        if(failure) {
+            co_await drain(slots, written, submitted);
+            std::rethrow_exception(failure);
+        }
+    }
+
+    auto ec_stripe_writer::submit(
+        slot &s,
+        std::size_t index,
+        stripe_map::value_type const &stripe,
+        shard_list const &shards,
+        ec_stripe_write_stats &stats
+    ) -> boost::cobalt::task<void> {
+        auto const &[stripe_index, extents] = stripe;
+        auto block_size = cfg_.block_size;
+        auto offset = ec_stripe_format::shard_header::encoded_size + stripe_index * block_size;
+        auto in = in_stripes_.writable_block(index);
+
+        auto read_block = [&](std::size_t shard, std::span<std::byte> block) -> boost::cobalt::task<void> {
+            auto length = co_await shards[shard]->read_at(offset, block);
+
+            // a shard that ends early has lost data, not just padding
+            enforce(length == block.size(), DOCA_ERROR_IO_FAILED);
+            stats.bytes_in += length;
+        };
+
+        // re-encoding needs every data block that isn't overwritten entirely, an update the
+        // old versions of the changed ones and the old redundancy blocks
+        auto covered = std::vector<bool>(cfg_.data_blocks);
+        auto full_stripe_reads = std::size_t { 0 };
+
+        s.stripe = stripe_index;
+        s.changed.clear();
+
+        for(auto j = std::uint32_t { 0 }; j < cfg_.data_blocks; ++j) {
+            auto [touched, whole] = coverage(extents, std::uint64_t { j } * block_size, std::uint64_t { j + 1 } * block_size);
+
+            if(touched) {
+                s.changed.push_back(j);
+            }
+
+            covered[j] = whole;
+            full_stripe_reads += whole ? 0 : 1;
+        }
+
+        s.delta = mode_ == ec_update_mode::delta
+            || (mode_ == ec_update_mode::automatic && s.changed.size() + cfg_.rdnc_blocks < full_stripe_reads);
+
+        if(s.delta) {
+            for(auto position = std::size_t { 0 }; position < s.changed.size(); ++position) {
+                auto block_index = s.changed[position];
+                auto old_block = in.subspan(2 * position * block_size, block_size);
+                auto new_block = in.subspan((2 * position + 1) * block_size, block_size);
+
+                co_await read_block(block_index, old_block);
+                std::ranges::copy(old_block, new_block.begin());
+                patch(extents, std::uint64_t { block_index } * block_size, new_block);
+            }
+
+            auto rdnc = in.subspan(2 * s.changed.size() * block_size, cfg_.rdnc_blocks * block_size);
+
+            for(auto r = std::size_t { 0 }; r < cfg_.rdnc_blocks; ++r) {
+                co_await read_block(cfg_.data_blocks + r, rdnc.subspan(r * block_size, block_size));
+            }
+
+            // s.changed is sorted, so the matrix expects the blocks in the order they are in
+            s.matrix = matrices_.update_matrix(s.changed);
+
+            in_buffers_[index].set_data((2 * s.changed.size() + cfg_.rdnc_blocks) * block_size);
+            out_buffers_[index].set_data(0);
+            s.task = backend_->update(*s.matrix, in_buffers_[index], out_buffers_[index]);
+
+            ++stats.delta_stripes;
+        } else {
+            for(auto j = std::size_t { 0 }; j < cfg_.data_blocks; ++j) {
+                auto block = in.subspan(j * block_size, block_size);
+
+                if(!covered[j]) {
+                    co_await read_block(j, block);
+                }
+
+                patch(extents, j * block_size, block);
+            }
+
+            in_buffers_[index].set_data(cfg_.data_blocks * block_size);
+            out_buffers_[index].set_data(0);
+            s.task = backend_->create(matrices_.coding_matrix(), in_buffers_[index], out_buffers_[index]);
+
+            ++stats.full_stripes;
+        }
+
+        stats.coded_bytes += in_buffers_[index].view().data_length();
+    }
+
+    ec_shard_files::ec_shard_files(ec_shard_files &&other) noexcept:
+        fds_ { std::move(other.fds_) }
+    {
+        other.fds_.clear();
+    }
+
+    ec_shard_files &ec_shard_files::operator=(ec_shard_files &&other) noexcept {
+        if(this != &other) {
+            close();
+            fds_ = std::move(other.fds_);
+            other.fds_.clear();
+        }
+
+        return *this;
+    }
+
+    ec_shard_files::~ec_shard_files() {
+        close();
+    }
+
+    auto ec_shard_files::path(
+        std::filesystem::path const &root,
+        std::string_view object,
+        std::size_t shard_index
+    ) -> std::filesystem::path {
+        return root / ("node-" + std::to_string(shard_index)) / object;
+    }
+
+    auto ec_shard_files::create(
+        std::filesystem::path const &root,
+        std::string_view object,
+        std::size_t shard_count
+    ) -> ec_shard_files {
+        auto files = ec_shard_files {};
+
+        for(auto i = std::size_t { 0 }; i < shard_count; ++i) {
+            auto shard_path = path(root, object, i);
+            std::filesystem::create_directories(shard_path.parent_path());
+
+            auto fd = ::open(shard_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+            if(fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "ec_shard_files: could not create " + shard_path.string());
+            }
+
+            files.fds_.push_back(fd);
+        }
+
+        return files;
+    }
+
+    auto ec_shard_files::open(
+        std::filesystem::path const &root,
+        std::string_view object,
+        std::size_t shard_count,
+        bool writable
+    ) -> ec_shard_files {
+        auto files = ec_shard_files {};
+
+        for(auto i = std::size_t { 0 }; i < shard_count; ++i) {
+            auto shard_path = path(root, object, i);
+            auto fd = ::open(shard_path.c_str(), writable ? O_RDWR : O_RDONLY);
+
+            if(fd < 0 && errno != ENOENT) {
+                throw std::system_error(errno, std::generic_category(), "ec_shard_files: could not open " + shard_path.string());
+            }
+
+            files.fds_.push_back(fd);
+        }
+
+        return files;
+    }
+
+    auto ec_shard_files::close() -> void {
+        for(auto fd : fds_) {
+            if(fd >= 0) {
+                ::close(fd);
+            }
+        }
+
+        fds_.clear();
+    }
+}
@@ -0,0 +1,394 @@
+#pragma once
+
+#include "aligned_memory.hpp"
+#include "buffer.hpp"
+#include "buffer_inventory.hpp"
+#include "device.hpp"
+#include "ec_matrix_cache.hpp"
+#include "erasure_coding.hpp"
+#include "memory_map.hpp"
+#include "stream_file.hpp"
+
+#include <boost/cobalt/task.hpp>
+
+#include <doca_erasure_coding.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace shoc {
+    /**
+     * Configuration for an ec_stripe_store
+     */
+    struct ec_stripe_config {
+        /// Number of data blocks per stripe (k)
+        std::uint32_t data_blocks = 4;
+        /// Number of redundancy blocks per stripe (m), i.e. how many shards may go missing
+        std::uint32_t rdnc_blocks = 2;
+        /// Size of one block, a multiple of 64 bytes. A stripe holds data_blocks * block_size
+        /// bytes of the object.
+        std::size_t block_size = 64 << 10;
+        /// Encoding matrix type
+        doca_ec_matrix_type matrix_type = DOCA_EC_MATRIX_TYPE_CAUCHY;
+        /// Maximum number of stripes being encoded or recovered at the same time. Must not
+        /// exceed the context's max_tasks.
+        std::uint32_t max_tasks = 8;
+        /// How to do file I/O
+        stream_io io = stream_io::pread;
+        /// Where and how the stripe buffers are allocated
+        memory_policy memory;
+        /// Number of recover matrices to keep, see ec_matrix_cache
+        std::size_t matrix_cache_capacity = 64;
+    };
+
+    /**
+     * On-disk format of the shards written by ec_stripe_store. All integers are little-endian.
+     *
+     * Every shard starts with a shard header that describes the whole object, followed by one
+     * block per stripe: shard i holds block i of every stripe, where blocks [0, data_blocks) are
+     * the object's data (the last stripe zero-padded) and the rest are redundancy blocks. Block s
+     * of a shard starts at shard_header::encoded_size + s * block_size.
+     */
+    namespace ec_stripe_format {
+        constexpr auto magic = std::array<char, 4> { 'S', 'H', 'E', 'C' };
+        constexpr std::uint32_t version = 1;
+
+        struct shard_header {
+            static constexpr std::size_t encoded_size = 64;
+
+            std::uint32_t version = ec_stripe_format::version;
+            std::uint32_t shard_index = 0;
+            std::uint32_t data_blocks = 0;
+            std::uint32_t rdnc_blocks = 0;
+            std::uint32_t block_size = 0;
+            std::uint32_t matrix_type = 0;
+            std::uint64_t object_size = 0;
+
+            /**
+             * @return whether both shards belong to the same object, i.e. everything but the
+             * shard index matches
+             */
+            [[nodiscard]] auto same_object(shard_header const &other) const noexcept -> bool;
+
+            [[nodiscard]] auto stripe_count() const noexcept -> std::uint64_t {
+                auto stripe_size = std::uint64_t { data_blocks } * block_size;
+                return stripe_size == 0 ? 0 : (object_size + stripe_size - 1) / stripe_size;
+            }
+
+            auto encode(std::span<std::byte, encoded_size> out) const -> void;
+
+            /**
+             * @return the decoded header, or nullopt if the data doesn't start with the magic
+             */
+            [[nodiscard]] static auto decode(std::span<std::byte const, encoded_size> in) -> std::optional<shard_header>;
+        };
+    }
+
+    /**
+     * Results of an ec_stripe_store run
+     */
+    struct ec_stripe_stats {
+        std::uint64_t stripes = 0;
+        /// object bytes read (write) or shard bytes read (read)
+        std::uint64_t bytes_in = 0;
+        /// shard bytes written (write) or object bytes written (read), including headers
+        std::uint64_t bytes_out = 0;
+        /// stripes whose data had to be recovered
+        std::uint64_t recovered_stripes = 0;
+        /// shards that were missing or didn't belong to the object
+        std::uint32_t missing_shards = 0;
+    };
+
+    /**
+     * Stores objects of arbitrary size erasure-coded across data_blocks + rdnc_blocks shard files,
+     * e.g. one per storage node, so that any rdnc_blocks of them may be lost. The object is cut
+     * into stripes of data_blocks blocks; for each stripe, ec_backend::create computes the
+     * redundancy blocks, and each block goes to its own shard, in the format described in
+     * ec_stripe_format.
+     *
+     * Up to max_tasks stripes are in the ring at any time, so reading and writing overlap with
+     * the device's work. Reading back recovers the data of missing shards through
+     * ec_backend::recover; the recover matrix depends only on which blocks are missing, so it is
+     * taken from an ec_matrix_cache.
+     *
+     * Missing shards are detected, corrupted ones are not: blocks carry no checksums.
+     */
+    class ec_stripe_store {
+    public:
+        /**
+         * @param backend running ec_context with max_tasks >= cfg.max_tasks, or a
+         *        cpu_ec_backend; must outlive the store
+         * @param dev device the stripe buffers are mapped to, i.e. the one an ec_context runs on
+         * @param cfg geometry, parallelism, I/O backend
+         */
+        ec_stripe_store(ec_backend &backend, device const &dev, ec_stripe_config const &cfg = {});
+
+        /**
+         * Erasure-code everything from in_fd (read from its start) into the shards. The file
+         * descriptors stay open and owned by the caller.
+         *
+         * Throws doca_exception if a task fails and std::system_error on I/O errors.
+         *
+         * @param in_fd input file descriptor, must support pread
+         * @param shard_fds data_blocks + rdnc_blocks shard file descriptors, must support pwrite
+         */
+        [[nodiscard]] auto write(int in_fd, std::span<int const> shard_fds) -> boost::cobalt::task<ec_stripe_stats>;
+
+        /**
+         * Reassemble an object from its shards to out_fd. Shards whose descriptor is negative,
+         * or whose header is missing or belongs to another object, count as missing; as long as
+         * no more than rdnc_blocks are, their data is recovered.
+         *
+         * Throws doca_exception with DOCA_ERROR_IO_FAILED if too many shards are missing, with
+         * DOCA_ERROR_INVALID_VALUE if the object was stored with another geometry, or if a task
+         * fails, and std::system_error on I/O errors.
+         *
+         * @param shard_fds data_blocks + rdnc_blocks shard file descriptors, in shard order
+         * @param out_fd output file descriptor, must support pwrite
+         */
+        [[nodiscard]] auto read(std::span<int const> shard_fds, int out_fd) -> boost::cobalt::task<ec_stripe_stats>;
+
+        [[nodiscard]] auto config() const noexcept -> ec_stripe_config const & { return cfg_; }
+
+        [[nodiscard]] auto matrix_cache() noexcept -> ec_matrix_cache & { return matrices_; }
+
+        [[nodiscard]] auto matrix_cache_stats() const noexcept -> ec_matrix_cache_stats const & {
+            return matrices_.stats();
+        }
+
+    private:
+        struct slot {
+            std::uint64_t stripe = 0;
+            coro::status_awaitable<> task;
+        };
+
+        ec_backend *backend_;
+        ec_stripe_config cfg_;
+        std::size_t block_count_;
+        ec_matrix_cache matrices_;
+
+        /// data blocks of a stripe when writing, available blocks when reading
+        aligned_blocks data_stripes_;
+        /// redundancy blocks when writing, recovered blocks when reading
+        aligned_blocks rdnc_stripes_;
+        memory_map data_mmap_;
+        memory_map rdnc_mmap_;
+        buffer_inventory inventory_;
+        buffer_array data_buffers_;
+        buffer_array rdnc_buffers_;
+    };
+
+    /**
+     * How an ec_stripe_writer brings the redundancy blocks of a changed stripe up to date
+     */
+    enum class ec_update_mode {
+        /// whichever of the two reads fewer blocks from the shards
+        automatic,
+        /// from the old and new versions of the changed data blocks and the old redundancy
+        /// blocks, through ec_backend::update
+        delta,
+        /// by encoding the whole stripe again through ec_backend::create
+        full_stripe
+    };
+
+    /**
+     * Results of an ec_stripe_writer flush
+     */
+    struct ec_stripe_write_stats {
+        /// queued writes that were applied
+        std::uint64_t writes = 0;
+        /// stripes that were changed
+        std::uint64_t stripes = 0;
+        /// stripes whose redundancy was updated from the changes
+        std::uint64_t delta_stripes = 0;
+        /// stripes that were encoded again
+        std::uint64_t full_stripes = 0;
+        /// shard bytes read, including headers
+        std::uint64_t bytes_in = 0;
+        /// shard bytes written
+        std::uint64_t bytes_out = 0;
+        /// bytes of blocks handed to the backend
+        std::uint64_t coded_bytes = 0;
+    };
+
+    /**
+     * Overwrites parts of an object stored by ec_stripe_store in place. Changing a few bytes of a
+     * stripe changes one data block, but encoding the stripe again needs all of its data blocks.
+     * Since the code is linear, the new redundancy blocks can instead be computed from the old
+     * and new versions of the changed blocks and the old redundancy blocks (ec_backend::update),
+     * which reads changed + rdnc_blocks blocks rather than the data_blocks that aren't entirely
+     * overwritten. The update matrices depend only on which blocks changed and are taken from
+     * an ec_matrix_cache.
+     *
+     * Writes are queued and applied by flush(). Writes to the same stripe that were queued
+     * since the last flush, e.g. by concurrent requests, are applied together, so the stripe's
+     * blocks are read, coded and written once for all of them; where they overlap, later writes
+     * win. Up to max_tasks stripes are in the ring at any time.
+     *
+     * Writes can't change the size of the object, and all shards must be there: degraded
+     * stripes are for ec_stripe_store::read to recover. There is no journal, so a stripe whose
+     * data blocks were written but whose redundancy blocks weren't, because of an error or a
+     * crash, is inconsistent.
+     */
+    class ec_stripe_writer {
+    public:
+        /**
+         * @param backend running ec_context with max_tasks >= cfg.max_tasks, or a
+         *        cpu_ec_backend; must outlive the writer
+         * @param dev device the stripe buffers are mapped to, i.e. the one an ec_context runs on
+         * @param cfg geometry the object was stored with, parallelism, I/O backend
+         * @param mode how to compute the new redundancy blocks
+         */
+        ec_stripe_writer(
+            ec_backend &backend,
+            device const &dev,
+            ec_stripe_config const &cfg = {},
+            ec_update_mode mode = ec_update_mode::automatic
+        );
+
+        /**
+         * Queue an overwrite of the object's bytes [offset, offset + data.size()). The data is
+         * copied.
+         */
+        auto write(std::uint64_t offset, std::span<std::byte const> data) -> void;
+
+        /**
+         * Apply the queued writes to the shards. The queue is emptied even if this fails; writes
+         * queued while it runs are left for the next flush.
+         *
+         * Throws doca_exception with DOCA_ERROR_IO_FAILED if a shard is missing or belongs to
+         * another object, with DOCA_ERROR_INVALID_VALUE if the object was stored with another
+         * geometry or a write goes past its end, with DOCA_ERROR_BAD_STATE if another flush is
+         * running, or if a task fails, and std::system_error on I/O errors.
+         *
+         * @param shard_fds data_blocks + rdnc_blocks shard file descriptors, in shard order,
+         *        must support pread and pwrite (see ec_shard_files::open)
+         */
+        [[nodiscard]] auto flush(std::span<int const> shard_fds) -> boost::cobalt::task<ec_stripe_write_stats>;
+
+        [[nodiscard]] auto pending_stripes() const noexcept { return pending_.size(); }
+        [[nodiscard]] auto pending_bytes() const noexcept { return pending_bytes_; }
+
+        [[nodiscard]] auto config() const noexcept -> ec_stripe_config const & { return cfg_; }
+        [[nodiscard]] auto mode() const noexcept { return mode_; }
+
+        [[nodiscard]] auto matrix_cache() noexcept -> ec_matrix_cache & { return matrices_; }
+
+        [[nodiscard]] auto matrix_cache_stats() const noexcept -> ec_matrix_cache_stats const & {
+            return matrices_.stats();
+        }
+
+    private:
+        /**
+         * Queued bytes of one stripe, at an offset into the stripe's data
+         */
+        struct extent {
+            std::uint64_t offset;
+            std::vector<std::byte> data;
+        };
+
+        using stripe_map = std::map<std::uint64_t, std::vector<extent>>;
+        using shard_list = std::vector<std::unique_ptr<stream_file>>;
+
+        struct slot {
+            std::uint64_t stripe = 0;
+            bool delta = false;
+            std::vector<std::uint32_t> changed;
+            // held until the task is done, the cache may drop it in the meantime
+            std::shared_ptr<ec_update_matrix const> matrix;
+            coro::status_awaitable<> task;
+        };
+
+        auto apply(stripe_map const &stripes, std::span<int const> shard_fds, ec_stripe_write_stats &stats) -> boost::cobalt::task<void>;
+
+        /**
+         * Read what a stripe's new redundancy is computed from, patch in the queued writes, and
+         * submit the task
+         */
+        auto submit(
+            slot &s,
+            std::size_t index,
+            stripe_map::value_type const &stripe,
+            shard_list const &shards,
+            ec_stripe_write_stats &stats
+        ) -> boost::cobalt::task<void>;
+
+        ec_backend *backend_;
+        ec_stripe_config cfg_;
+        ec_update_mode mode_;
+        std::size_t block_count_;
+        ec_matrix_cache matrices_;
+        stripe_map pending_;
+        std::size_t pending_bytes_ = 0;
+        std::uint64_t pending_writes_ = 0;
+        bool flushing_ = false;
+
+        /// old and new changed blocks and old redundancy blocks, or all data blocks
+        aligned_blocks in_stripes_;
+        /// new redundancy blocks
+        aligned_blocks out_stripes_;
+        memory_map in_mmap_;
+        memory_map out_mmap_;
+        buffer_inventory inventory_;
+        buffer_array in_buffers_;
+        buffer_array out_buffers_;
+    };
+
+    /**
+     * The shard files of one object in a directory tree that simulates storage nodes: shard i
+     * lives in root/node-<i>/<object>. Closes the files on destruction.
+     */
+    class ec_shard_files {
+    public:
+        ec_shard_files() = default;
+        ec_shard_files(ec_shard_files &&other) noexcept;
+        ec_shard_files &operator=(ec_shard_files &&other) noexcept;
+        ~ec_shard_files();
+
+        /**
+         * Create (or truncate) the shard files, and the node directories as needed. Throws
+         * std::system_error on errors.
+         */
+        [[nodiscard]] static auto create(
+            std::filesystem::path const &root,
+            std::string_view object,
+            std::size_t shard_count
+        ) -> ec_shard_files;
+
+        /**
+         * Open the shard files for reading, or for reading and writing if writable is set, as
+         * ec_stripe_writer::flush needs. Shards that don't exist get descriptor -1, so they
+         * count as missing in ec_stripe_store::read. Throws std::system_error on other errors.
+         */
+        [[nodiscard]] static auto open(
+            std::filesystem::path const &root,
+            std::string_view object,
+            std::size_t shard_count,
+            bool writable = false
+        ) -> ec_shard_files;
+
+        /**
+         * @return the path of one shard file
+         */
+        [[nodiscard]] static auto path(
+            std::filesystem::path const &root,
+            std::string_view object,
+            std::size_t shard_index
+        ) -> std::filesystem::path;
+
+        [[nodiscard]] auto fds() const noexcept -> std::span<int const> { return fds_; }
+
+        auto close() -> void;
+
+    private:
+        std::vector<int> fds_;
+    };
+}
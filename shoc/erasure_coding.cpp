@@ -2,60 +2,212 @@
 
 #include "progress_engine.hpp"
 
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include <vector>
+
 namespace shoc {
+    namespace {
+        auto enforce_indices(std::span<std::uint32_t const> indices, std::size_t limit) -> void {
+            auto seen = std::vector<bool>(limit);
+
+            for(auto index : indices) {
+                enforce(index < limit && !seen[index], DOCA_ERROR_INVALID_VALUE);
+                seen[index] = true;
+            }
+        }
+
+        /**
+         * Row i of the systematic generator matrix, i.e. the coefficients that make block i
+         * out of the data blocks
+         */
+        auto generator_row(gf256_matrix const &coding, std::size_t i) -> std::vector<std::uint8_t> {
+            auto k = coding.cols();
+
+            if(i >= k) {
+                auto row = coding.row(i - k);
+                return { row.begin(), row.end() };
+            }
+
+            auto row = std::vector<std::uint8_t>(k);
+            row[i] = 1;
+            return row;
+        }
+
+        /**
+         * The available blocks are the first data_block_count ones that aren't missing. Their
+         * rows of the generator matrix map the data to them, so the inverse maps them back to
+         * the data, and a missing block is its generator row times that inverse.
+         */
+        auto recover_coefficients(
+            gf256_matrix const &coding,
+            std::span<std::uint32_t const> missing_indices
+        ) -> std::optional<gf256_matrix> {
+            auto k = coding.cols();
+            auto block_count = k + coding.rows();
+            auto available = std::vector<std::uint8_t> {};
+
+            for(auto i = std::size_t { 0 }; i < block_count && available.size() < k * k; ++i) {
+                if(std::ranges::find(missing_indices, i) == missing_indices.end()) {
+                    auto row = generator_row(coding, i);
+                    available.insert(available.end(), row.begin(), row.end());
+                }
+            }
+
+            if(available.size() < k * k) {
+                return std::nullopt;
+            }
+
+            auto decode = gf256_matrix { k, k, std::move(available) }.inverse();
+
+            if(!decode) {
+                return std::nullopt;
+            }
+
+            auto coefficients = std::vector<std::uint8_t>(missing_indices.size() * k);
+
+            for(auto m = std::size_t { 0 }; m < missing_indices.size(); ++m) {
+                auto row = generator_row(coding, missing_indices[m]);
+
+                for(auto j = std::size_t { 0 }; j < k; ++j) {
+                    auto sum = std::uint8_t { 0 };
+
+                    for(auto l = std::size_t { 0 }; l < k; ++l) {
+                        sum ^= gf256::mul(row[l], decode->at(l, j));
+                    }
+
+                    coefficients[m * k + j] = sum;
+                }
+            }
+
+            return gf256_matrix { missing_indices.size(), k, std::move(coefficients) };
+        }
+
+        /**
+         * The coefficients in the layout doca_ec_matrix_create_from_raw takes: one row per data
+         * block, holding its coefficient for each redundancy block
+         */
+        auto raw_coefficients(gf256_matrix const &coding) -> std::vector<std::uint8_t> {
+            auto raw = std::vector<std::uint8_t>(coding.cols() * coding.rows());
+
+            for(auto d = std::size_t { 0 }; d < coding.cols(); ++d) {
+                for(auto r = std::size_t { 0 }; r < coding.rows(); ++r) {
+                    raw[d * coding.rows() + r] = coding.at(r, d);
+                }
+            }
+
+            return raw;
+        }
+
+        auto update_coefficients(
+            gf256_matrix const &coding,
+            std::span<std::uint32_t const> update_indices
+        ) -> gf256_matrix {
+            auto rdnc_count = coding.rows();
+            auto cols = 2 * update_indices.size() + rdnc_count;
+            auto coefficients = std::vector<std::uint8_t>(rdnc_count * cols);
+
+            for(auto r = std::size_t { 0 }; r < rdnc_count; ++r) {
+                for(auto u = std::size_t { 0 }; u < update_indices.size(); ++u) {
+                    coefficients[r * cols + 2 * u] = coding.at(r, update_indices[u]);
+                    coefficients[r * cols + 2 * u + 1] = coding.at(r, update_indices[u]);
+                }
+
+                coefficients[r * cols + 2 * update_indices.size() + r] = 1;
+            }
+
+            return gf256_matrix { rdnc_count, cols, std::move(coefficients) };
+        }
+    }
+
     ec_coding_matrix::ec_coding_matrix(
-        ec_context const &ctx,
+        ec_context const *ctx,
         doca_ec_matrix_type type,
         std::size_t data_block_count,
         std::size_t rdnc_block_count
-    ) {
-        doca_ec_matrix *matrix;
-
-        enforce_success(doca_ec_matrix_create(
-            ctx.handle(),
-            type,
-            data_block_count,
-            rdnc_block_count,
-            &matrix
-        ));
+    ):
+        type_ { type },
+        coefficients_ { gf256_matrix::encoding(type, data_block_count, rdnc_block_count) }
+    {
+        if(ctx != nullptr) {
+            // the device gets the coefficients the CPU backend uses rather than generating its
+            // own, so that both produce the same redundancy blocks
+            auto raw = raw_coefficients(coefficients_);
+            doca_ec_matrix *matrix;
+
+            enforce_success(doca_ec_matrix_create_from_raw(
+                ctx->handle(),
+                raw.data(),
+                data_block_count,
+                rdnc_block_count,
+                &matrix
+            ));
 
-        handle_.reset(matrix);
+            handle_.reset(matrix);
+        }
     }
 
     ec_update_matrix::ec_update_matrix(
-        ec_context const &ctx,
+        ec_context const *ctx,
         ec_coding_matrix const &coding_matrix,
         std::span<std::uint32_t const> update_indices
-    ) {
-        doca_ec_matrix *matrix;
+    ):
+        update_indices_(update_indices.begin(), update_indices.end())
+    {
+        enforce_indices(update_indices, coding_matrix.data_block_count());
+        coefficients_ = update_coefficients(coding_matrix.coefficients(), update_indices);
 
-        enforce_success(doca_ec_matrix_create_update(
-            ctx.handle(),
-            coding_matrix.handle(),
-            const_cast<std::uint32_t*>(update_indices.data()),
-            update_indices.size(),
-            &matrix
-        ));
+        if(ctx != nullptr) {
+            enforce(coding_matrix.handle() != nullptr, DOCA_ERROR_INVALID_VALUE);
 
-        handle_.reset(matrix);
+            doca_ec_matrix *matrix;
+
+            enforce_success(doca_ec_matrix_create_update(
+                ctx->handle(),
+                coding_matrix.handle(),
+                const_cast<std::uint32_t*>(update_indices.data()),
+                update_indices.size(),
+                &matrix
+            ));
+
+            handle_.reset(matrix);
+        }
     }
 
     ec_recover_matrix::ec_recover_matrix(
-        ec_context const &ctx,
+        ec_context const *ctx,
         ec_coding_matrix const &coding_matrix,
         std::span<std::uint32_t const> missing_indices
-    ) {
-        doca_ec_matrix *matrix;
+    ):
+        missing_indices_(missing_indices.begin(), missing_indices.end())
+    {
+        enforce_indices(missing_indices, coding_matrix.data_block_count() + coding_matrix.rdnc_block_count());
 
-        enforce_success(doca_ec_matrix_create_recover(
-            ctx.handle(),
-            coding_matrix.handle(),
-            const_cast<std::uint32_t*>(missing_indices.data()),
-            missing_indices.size(),
-            &matrix
-        ));
+        auto coefficients = recover_coefficients(coding_matrix.coefficients(), missing_indices);
+
+        if(ctx != nullptr) {
+            enforce(coding_matrix.handle() != nullptr, DOCA_ERROR_INVALID_VALUE);
+
+            doca_ec_matrix *matrix;
+
+            enforce_success(doca_ec_matrix_create_recover(
+                ctx->handle(),
+                coding_matrix.handle(),
+                const_cast<std::uint32_t*>(missing_indices.data()),
+                missing_indices.size(),
+                &matrix
+            ));
 
-        handle_.reset(matrix);
+            handle_.reset(matrix);
+        } else {
+            // there is no device to fall back to
+            enforce(coefficients.has_value(), DOCA_ERROR_INVALID_VALUE);
+        }
+
+        if(coefficients) {
+            coefficients_ = std::move(*coefficients);
+        }
     }
 
     ec_context::ec_context(
@@ -91,6 +243,8 @@ namespace shoc {
             plain_status_callback<doca_ec_task_recover_as_task>,
             max_tasks
         ));
+
+        reserve_receptables<coro::status_awaitable<>::payload_type>(3 * max_tasks);
     }
 
     auto ec_context::create(
@@ -98,6 +252,10 @@ namespace shoc {
         buffer const &original_data_blocks,
         buffer &rdnc_blocks
     ) -> coro::status_awaitable<> {
+        if(coding_matrix.handle() == nullptr) {
+            return coro::status_awaitable<>::from_value(DOCA_ERROR_INVALID_VALUE);
+        }
+
         return detail::plain_status_offload<
             doca_ec_task_create_allocate_init,
             doca_ec_task_create_as_task
@@ -115,6 +273,10 @@ namespace shoc {
         buffer const &available_blocks,
         buffer &recovered_data_blocks
     ) -> coro::status_awaitable<> {
+        if(recover_matrix.handle() == nullptr) {
+            return coro::status_awaitable<>::from_value(DOCA_ERROR_INVALID_VALUE);
+        }
+
         return detail::plain_status_offload<
             doca_ec_task_recover_allocate_init,
             doca_ec_task_recover_as_task
@@ -132,6 +294,10 @@ namespace shoc {
         buffer const &original_updated_and_rdnc_blocks,
         buffer &updated_rdnc_blocks
     ) -> coro::status_awaitable<> {
+        if(update_matrix.handle() == nullptr) {
+            return coro::status_awaitable<>::from_value(DOCA_ERROR_INVALID_VALUE);
+        }
+
         return detail::plain_status_offload<
             doca_ec_task_update_allocate_init,
             doca_ec_task_update_as_task
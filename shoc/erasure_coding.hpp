@@ -4,39 +4,64 @@
 #include "context.hpp"
 #include "coro/status_awaitable.hpp"
 #include "device.hpp"
+#include "gf256.hpp"
 #include "progress_engine.hpp"
 #include "unique_handle.hpp"
 
 #include <doca_erasure_coding.h>
 
+#include <cstdint>
+#include <span>
 #include <string>
+#include <vector>
 
 /**
  * Erasure coding functionality, see https://docs.nvidia.com/doca/sdk/doca+erasure+coding/index.html
  */
 namespace shoc {
+    class cpu_ec_backend;
     class ec_context;
 
     /**
      * Encoding matrix to create redundancy blocks. Needed to create
      * corresponding update/recover matrices.
+     *
+     * Besides the DOCA matrix, every matrix carries its coefficients for the CPU backend, so
+     * matrices made by an ec_context work with a cpu_ec_backend, too. The DOCA matrix is made
+     * from these coefficients (see gf256_matrix::encoding) rather than by the SDK's generator for
+     * the type. Matrices made by a cpu_ec_backend have no DOCA handle.
      */
     class ec_coding_matrix {
     public:
         friend class ec_context;
+        friend class cpu_ec_backend;
 
+        /**
+         * @return the DOCA matrix, or nullptr if the matrix was made by a software backend
+         */
         [[nodiscard]]
         auto handle() const noexcept { return handle_.get(); }
 
+        [[nodiscard]] auto type() const noexcept { return type_; }
+        [[nodiscard]] auto data_block_count() const noexcept { return coefficients_.cols(); }
+        [[nodiscard]] auto rdnc_block_count() const noexcept { return coefficients_.rows(); }
+
+        /**
+         * @return the redundancy rows of the encoding, see gf256_matrix::encoding
+         */
+        [[nodiscard]] auto coefficients() const noexcept -> gf256_matrix const & { return coefficients_; }
+
     private:
         ec_coding_matrix(
-            ec_context const &ctx,
+            ec_context const *ctx,
             doca_ec_matrix_type type,
             std::size_t data_block_count,
             std::size_t rdnc_block_count
         );
 
         unique_handle<doca_ec_matrix, doca_ec_matrix_destroy> handle_;
+        doca_ec_matrix_type type_;
+        gf256_matrix coefficients_;
     };
 
     /**
@@ -46,18 +71,30 @@ namespace shoc {
     class ec_recover_matrix {
     public:
         friend class ec_context;
+        friend class cpu_ec_backend;
 
         [[nodiscard]]
         auto handle() const noexcept { return handle_.get(); }
 
+        [[nodiscard]] auto missing_indices() const noexcept -> std::span<std::uint32_t const> { return missing_indices_; }
+
+        /**
+         * @return one row per missing block, in the order of missing_indices(), to be applied
+         * to the data_block_count available blocks. Empty if the recovery can't be done in
+         * software, i.e. the matrix can only be used on the device.
+         */
+        [[nodiscard]] auto coefficients() const noexcept -> gf256_matrix const & { return coefficients_; }
+
     private:
         ec_recover_matrix(
-            ec_context const &ctx,
+            ec_context const *ctx,
             ec_coding_matrix const &coding_matrix,
             std::span<std::uint32_t const> missing_indices
         );
 
         unique_handle<doca_ec_matrix, doca_ec_matrix_destroy> handle_;
+        std::vector<std::uint32_t> missing_indices_;
+        gf256_matrix coefficients_;
     };
 
     /**
@@ -68,18 +105,126 @@ namespace shoc {
     class ec_update_matrix {
     public:
         friend class ec_context;
+        friend class cpu_ec_backend;
 
         [[nodiscard]]
         auto handle() const noexcept { return handle_.get(); }
 
+        [[nodiscard]] auto update_indices() const noexcept -> std::span<std::uint32_t const> { return update_indices_; }
+
+        /**
+         * @return one row per redundancy block, to be applied to the blocks of an update (see
+         * ec_backend::update): the old and new version of a data block get the same
+         * coefficient, since their sum is the change, and each old redundancy block is taken
+         * over as it is.
+         */
+        [[nodiscard]] auto coefficients() const noexcept -> gf256_matrix const & { return coefficients_; }
+
     private:
         ec_update_matrix(
-            ec_context const &ctx,
+            ec_context const *ctx,
             ec_coding_matrix const &coding_matrix,
             std::span<std::uint32_t const> update_indices
         );
 
         unique_handle<doca_ec_matrix, doca_ec_matrix_destroy> handle_;
+        std::vector<std::uint32_t> update_indices_;
+        gf256_matrix coefficients_;
+    };
+
+    /**
+     * Interface of the erasure coding implementations: ec_context on the device and
+     * cpu_ec_backend in software. Both produce the same blocks for the same matrices, since the
+     * device's coding matrices are built from the coefficients the CPU uses.
+     */
+    class ec_backend {
+    public:
+        virtual ~ec_backend() = default;
+
+        /**
+         * Create an erasure encoding for the provided data
+         * 
+         * @param coding_matrix [in] EC encoding matrix
+         * @param original_data_blocks [in] payload data for which redundancy blocks need to be calculated
+         * @param rdnc_blocks [out] destination buffer for the redundancy blocks
+         */
+        virtual auto create(
+            ec_coding_matrix const &coding_matrix,
+            buffer const &original_data_blocks,
+            buffer &rdnc_blocks
+        ) -> coro::status_awaitable<> = 0;
+
+        /**
+         * Recover missing data blocks
+         * 
+         * Available data blocks need to be written into the available_blocks buffer in ascending
+         * order, skipping missing blocks. The number of provided available payload/redundancy
+         * blocks must equal the number of original payload blocks so that their geometry matches
+         * the recovery matrix. if mor than the required number of redundancy blocks are available,
+         * leave out the superfluous ones.
+         * 
+         * E.g., in a scenario with 4 payload blocks and 3 redundancy blocks, if blocks 1 and 3
+         * are missing, available_blocks should conatain the concatenation of payload blocks
+         * 0 and 2 and the first two redundancy blocks.
+         *
+         * recovered_data_blocks receives one block per missing index, in the order in which
+         * the indices were passed to recover_matrix().
+         * 
+         * @param recover_matrix [in] EC recovery matrix
+         * @param available_blocks [in] Available data and redundancy blocks
+         * @param recovered_data_blocks [out] Destinatin buffer for recovered data blocks
+         */
+        virtual auto recover(
+            ec_recover_matrix const &recover_matrix,
+            buffer const &available_blocks,
+            buffer &recovered_data_blocks
+        ) -> coro::status_awaitable<> = 0;
+
+        /**
+         * Recalculate the redundancy blocks after some data blocks changed
+         *
+         * original_updated_and_rdnc_blocks holds, for each index the update matrix was made
+         * for, the original and the updated version of the data block, followed by the original
+         * redundancy blocks.
+         *
+         * @param update_matrix [in] EC update matrix
+         * @param original_updated_and_rdnc_blocks [in] old and new data blocks, old redundancy blocks
+         * @param updated_rdnc_blocks [out] destination buffer for the new redundancy blocks
+         */
+        virtual auto update(
+            ec_update_matrix const &update_matrix,
+            buffer const &original_updated_and_rdnc_blocks,
+            buffer &updated_rdnc_blocks
+        ) -> coro::status_awaitable<> = 0;
+
+        /**
+         * Create an encoding matrix for a given EC geometry
+         * 
+         * @param type Type of the Encoding (DOCA_EC_MATRIX_TYPE_CAUCHY or DOCA_EC_MATRIX_TYPE_VANDERMONDE)
+         * @param data_block_count number of payload data blocks
+         * @param rdnc_block_count number of redundancy blocks
+         */
+        [[nodiscard]] virtual auto coding_matrix(
+            doca_ec_matrix_type type,
+            std::size_t data_block_count,
+            std::size_t rdnc_block_count
+        ) const -> ec_coding_matrix = 0;
+
+        [[nodiscard]] virtual auto update_matrix(
+            ec_coding_matrix const &coding_matrix,
+            std::span<std::uint32_t const> update_indices
+        ) const -> ec_update_matrix = 0;
+
+        /**
+         * Create a recovery matrix.
+         * 
+         * @param coding_matrix The encoding matrix of the EC, provided by coding_matrix()
+         * @param missing_indices List of indices of missing payload/redundancy blocks.
+         */
+        [[nodiscard]] virtual auto recover_matrix(
+            ec_coding_matrix const &coding_matrix,
+            std::span<std::uint32_t const> missing_indices
+        ) const -> ec_recover_matrix = 0;
     };
 
     /**
@@ -104,7 +249,8 @@ namespace shoc {
             doca_ec,
             doca_ec_destroy,
             doca_ec_as_ctx
-        >
+        >,
+        public ec_backend
     {
     public:
         ec_context(
@@ -122,83 +268,49 @@ namespace shoc {
         }
 
         /**
-         * Create an erasure encoding for the provided data
-         * 
-         * @param coding_matrix [in] EC encoding matrix
-         * @param original_data_blocks [in] payload data for which redundancy blocks need to be calculated
-         * @param rdnc_blocks [out] destination buffer for the redundancy blocks
+         * Matrices made by a software backend can't be used here.
          */
         auto create(
             ec_coding_matrix const &coding_matrix,
             buffer const &original_data_blocks,
             buffer &rdnc_blocks
-        ) -> coro::status_awaitable<>;
+        ) -> coro::status_awaitable<> override;
 
-        /**
-         * Recover missing data blocks
-         * 
-         * Available data blocks need to be written into the available_blocks buffer in ascending
-         * order, skipping missing blocks. The number of provided available payload/redundancy
-         * blocks must equal the number of original payload blocks so that their geometry matches
-         * the recovery matrix. if mor than the required number of redundancy blocks are available,
-         * leave out the superfluous ones.
-         * 
-         * E.g., in a scenario with 4 payload blocks and 3 redundancy blocks, if blocks 1 and 3
-         * are missing, available_blocks should conatain the concatenation of payload blocks
-         * 0 and 2 and the first two redundancy blocks.
-         * 
-         * @param recover_matrix [in] EC recovery matrix
-         * @param available_blocks [in] Available data and redundancy blocks
-         * @param recovered_data_blocks [out] Destinatin buffer for recovered data blocks
-         */
         auto recover(
             ec_recover_matrix const &recover_matrix,
             buffer const &available_blocks,
             buffer &recovered_data_blocks
-        ) -> coro::status_awaitable<>;
+        ) -> coro::status_awaitable<> override;
 
         auto update(
             ec_update_matrix const &update_matrix,
             buffer const &original_updated_and_rdnc_blocks,
             buffer &updated_rdnc_blocks
-        ) -> coro::status_awaitable<>;
+        ) -> coro::status_awaitable<> override;
 
-        /**
-         * Create an encoding matrix for a given EC geometry
-         * 
-         * @param type Type of the Encoding (DOCA_EC_MATRIX_TYPE_CAUCHY or DOCA_EC_MATRIX_TYPE_VANDERMONDE)
-         * @param data_block_count number of payload data blocks
-         * @param rdnc_block_count number of redundancy blocks
-         */
         [[nodiscard]]
         auto coding_matrix(
             doca_ec_matrix_type type,
             std::size_t data_block_count,
             std::size_t rdnc_block_count
-        ) const {
-            return ec_coding_matrix(*this, type, data_block_count, rdnc_block_count);
+        ) const -> ec_coding_matrix override {
+            return ec_coding_matrix(this, type, data_block_count, rdnc_block_count);
         }
 
         [[nodiscard]]
         auto update_matrix(
             ec_coding_matrix const &coding_matrix,
             std::span<std::uint32_t const> update_indices
-        ) const {
-            return ec_update_matrix(*this, coding_matrix, update_indices);
+        ) const -> ec_update_matrix override {
+            return ec_update_matrix(this, coding_matrix, update_indices);
         }
 
-        /**
-         * Create a recovery matrix.
-         * 
-         * @param coding_matrix The encoding matrix of the EC, provided by ec_context::coding_matrix
-         * @param missing_indices List of indices of missing payload/redundancy blocks.
-         */
         [[nodiscard]]
         auto recover_matrix(
             ec_coding_matrix const &coding_matrix,
             std::span<std::uint32_t const> missing_indices
-        ) const {
-            return ec_recover_matrix(*this, coding_matrix, missing_indices);
+        ) const -> ec_recover_matrix override {
+            return ec_recover_matrix(this, coding_matrix, missing_indices);
         }
 
     private:
@@ -47,6 +47,8 @@ namespace shoc {
             plain_status_callback<doca_eth_txq_task_lso_send_as_doca_task>,
             max_tasks
         ));
+
+        reserve_receptables<coro::status_awaitable<>::payload_type>(2 * max_tasks);
     }
 
     auto eth_txq::send(buffer &pkt) -> coro::status_awaitable<> {
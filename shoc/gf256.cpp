@@ -0,0 +1,500 @@
+#include "gf256.hpp"
+
+#include "error.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace shoc {
+    namespace {
+        struct log_tables {
+            std::array<std::uint8_t, 256> log {};
+            /// twice the period, so that exp[log a + log b] needs no modulo
+            std::array<std::uint8_t, 510> exp {};
+
+            constexpr log_tables() {
+                auto x = 1u;
+
+                for(auto i = 0u; i < 255; ++i) {
+                    exp[i] = exp[i + 255] = static_cast<std::uint8_t>(x);
+                    log[x] = static_cast<std::uint8_t>(i);
+
+                    x <<= 1;
+
+                    if(x & 0x100) {
+                        x ^= 0x11d;
+                    }
+                }
+            }
+        };
+
+        constexpr auto tables = log_tables {};
+
+        /**
+         * Multiplication with a constant is linear over GF(2): bit i of c * x is the parity of
+         * x and the mask of the input bits that contribute to it. gf2p8affineqb wants the mask
+         * of output bit i in byte 7 - i.
+         */
+        auto affine_matrix(std::uint8_t c) noexcept -> std::uint64_t {
+            auto matrix = std::uint64_t { 0 };
+
+            for(auto i = 0; i < 8; ++i) {
+                auto mask = std::uint64_t { 0 };
+
+                for(auto j = 0; j < 8; ++j) {
+                    if((gf256::mul(c, static_cast<std::uint8_t>(1u << j)) >> i) & 1) {
+                        mask |= std::uint64_t { 1 } << j;
+                    }
+                }
+
+                matrix |= mask << (8 * (7 - i));
+            }
+
+            return matrix;
+        }
+
+        struct apply_args {
+            std::size_t rows;
+            std::size_t cols;
+            std::uint8_t const *tables;
+            std::uint64_t const *affine;
+            std::byte const * const *inputs;
+            std::byte * const *outputs;
+        };
+
+        auto apply_scalar(apply_args const &args, std::size_t begin, std::size_t end) -> void {
+            for(auto r = std::size_t { 0 }; r < args.rows; ++r) {
+                auto out = reinterpret_cast<std::uint8_t *>(args.outputs[r]);
+                std::fill(out + begin, out + end, 0);
+
+                for(auto c = std::size_t { 0 }; c < args.cols; ++c) {
+                    auto in = reinterpret_cast<std::uint8_t const *>(args.inputs[c]);
+                    auto table = args.tables + 32 * (r * args.cols + c);
+
+                    for(auto i = begin; i < end; ++i) {
+                        out[i] ^= table[in[i] & 0x0f] ^ table[16 + (in[i] >> 4)];
+                    }
+                }
+            }
+        }
+
+#if defined(__x86_64__)
+        // The vector kernels compute up to four output rows per pass, so every input vector is
+        // loaded once per group of rows, as in ISA-L's ec_encode_data.
+
+        template<std::size_t Rows>
+        [[gnu::target("ssse3")]]
+        auto apply_rows_ssse3(apply_args const &args, std::size_t row0, std::size_t length) -> void {
+            auto const low_mask = _mm_set1_epi8(0x0f);
+
+            for(auto offset = std::size_t { 0 }; offset < length; offset += 16) {
+                __m128i acc[Rows];
+
+                for(auto &a : acc) {
+                    a = _mm_setzero_si128();
+                }
+
+                for(auto c = std::size_t { 0 }; c < args.cols; ++c) {
+                    auto x = _mm_loadu_si128(reinterpret_cast<__m128i const *>(args.inputs[c] + offset));
+                    auto lo = _mm_and_si128(x, low_mask);
+                    auto hi = _mm_and_si128(_mm_srli_epi64(x, 4), low_mask);
+
+                    for(auto r = std::size_t { 0 }; r < Rows; ++r) {
+                        auto table = args.tables + 32 * ((row0 + r) * args.cols + c);
+                        auto t_lo = _mm_loadu_si128(reinterpret_cast<__m128i const *>(table));
+                        auto t_hi = _mm_loadu_si128(reinterpret_cast<__m128i const *>(table + 16));
+
+                        acc[r] = _mm_xor_si128(acc[r], _mm_xor_si128(_mm_shuffle_epi8(t_lo, lo), _mm_shuffle_epi8(t_hi, hi)));
+                    }
+                }
+
+                for(auto r = std::size_t { 0 }; r < Rows; ++r) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(args.outputs[row0 + r] + offset), acc[r]);
+                }
+            }
+        }
+
+        template<std::size_t Rows>
+        [[gnu::target("avx2")]]
+        auto apply_rows_avx2(apply_args const &args, std::size_t row0, std::size_t length) -> void {
+            auto const low_mask = _mm256_set1_epi8(0x0f);
+
+            for(auto offset = std::size_t { 0 }; offset < length; offset += 32) {
+                __m256i acc[Rows];
+
+                for(auto &a : acc) {
+                    a = _mm256_setzero_si256();
+                }
+
+                for(auto c = std::size_t { 0 }; c < args.cols; ++c) {
+                    auto x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(args.inputs[c] + offset));
+                    auto lo = _mm256_and_si256(x, low_mask);
+                    auto hi = _mm256_and_si256(_mm256_srli_epi64(x, 4), low_mask);
+
+                    for(auto r = std::size_t { 0 }; r < Rows; ++r) {
+                        auto table = args.tables + 32 * ((row0 + r) * args.cols + c);
+                        auto t_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(table)));
+                        auto t_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(table + 16)));
+
+                        acc[r] = _mm256_xor_si256(acc[r], _mm256_xor_si256(_mm256_shuffle_epi8(t_lo, lo), _mm256_shuffle_epi8(t_hi, hi)));
+                    }
+                }
+
+                for(auto r = std::size_t { 0 }; r < Rows; ++r) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(args.outputs[row0 + r] + offset), acc[r]);
+                }
+            }
+        }
+
+        template<std::size_t Rows>
+        [[gnu::target("avx512f,avx512bw")]]
+        auto apply_rows_avx512(apply_args const &args, std::size_t row0, std::size_t length) -> void {
+            auto const low_mask = _mm512_set1_epi8(0x0f);
+
+            for(auto offset = std::size_t { 0 }; offset < length; offset += 64) {
+                __m512i acc[Rows];
+
+                for(auto &a : acc) {
+                    a = _mm512_setzero_si512();
+                }
+
+                for(auto c = std::size_t { 0 }; c < args.cols; ++c) {
+                    auto x = _mm512_loadu_si512(args.inputs[c] + offset);
+                    auto lo = _mm512_and_si512(x, low_mask);
+                    // the masked forms, since GCC 12 warns about the undefined vectors of the unmasked ones
+                    auto hi = _mm512_and_si512(_mm512_maskz_srli_epi64(0xff, x, 4), low_mask);
+
+                    for(auto r = std::size_t { 0 }; r < Rows; ++r) {
+                        auto table = args.tables + 32 * ((row0 + r) * args.cols + c);
+                        auto t_lo = _mm512_maskz_broadcast_i32x4(0xffff, _mm_loadu_si128(reinterpret_cast<__m128i const *>(table)));
+                        auto t_hi = _mm512_maskz_broadcast_i32x4(0xffff, _mm_loadu_si128(reinterpret_cast<__m128i const *>(table + 16)));
+
+                        acc[r] = _mm512_xor_si512(acc[r], _mm512_xor_si512(_mm512_shuffle_epi8(t_lo, lo), _mm512_shuffle_epi8(t_hi, hi)));
+                    }
+                }
+
+                for(auto r = std::size_t { 0 }; r < Rows; ++r) {
+                    _mm512_storeu_si512(args.outputs[row0 + r] + offset, acc[r]);
+                }
+            }
+        }
+
+        template<std::size_t Rows>
+        [[gnu::target("avx2,gfni")]]
+        auto apply_rows_avx2_gfni(apply_args const &args, std::size_t row0, std::size_t length) -> void {
+            for(auto offset = std::size_t { 0 }; offset < length; offset += 32) {
+                __m256i acc[Rows];
+
+                for(auto &a : acc) {
+                    a = _mm256_setzero_si256();
+                }
+
+                for(auto c = std::size_t { 0 }; c < args.cols; ++c) {
+                    auto x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(args.inputs[c] + offset));
+
+                    for(auto r = std::size_t { 0 }; r < Rows; ++r) {
+                        auto matrix = _mm256_set1_epi64x(static_cast<long long>(args.affine[(row0 + r) * args.cols + c]));
+                        acc[r] = _mm256_xor_si256(acc[r], _mm256_gf2p8affine_epi64_epi8(x, matrix, 0));
+                    }
+                }
+
+                for(auto r = std::size_t { 0 }; r < Rows; ++r) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(args.outputs[row0 + r] + offset), acc[r]);
+                }
+            }
+        }
+
+        template<std::size_t Rows>
+        [[gnu::target("avx512f,avx512bw,gfni")]]
+        auto apply_rows_avx512_gfni(apply_args const &args, std::size_t row0, std::size_t length) -> void {
+            for(auto offset = std::size_t { 0 }; offset < length; offset += 64) {
+                __m512i acc[Rows];
+
+                for(auto &a : acc) {
+                    a = _mm512_setzero_si512();
+                }
+
+                for(auto c = std::size_t { 0 }; c < args.cols; ++c) {
+                    auto x = _mm512_loadu_si512(args.inputs[c] + offset);
+
+                    for(auto r = std::size_t { 0 }; r < Rows; ++r) {
+                        auto matrix = _mm512_set1_epi64(static_cast<long long>(args.affine[(row0 + r) * args.cols + c]));
+                        acc[r] = _mm512_xor_si512(acc[r], _mm512_gf2p8affine_epi64_epi8(x, matrix, 0));
+                    }
+                }
+
+                for(auto r = std::size_t { 0 }; r < Rows; ++r) {
+                    _mm512_storeu_si512(args.outputs[row0 + r] + offset, acc[r]);
+                }
+            }
+        }
+
+        /**
+         * Runs a row kernel over all rows in groups of four
+         */
+        template<template<std::size_t> typename Kernel>
+        auto apply_vector(apply_args const &args, std::size_t length) -> void {
+            for(auto row0 = std::size_t { 0 }; row0 < args.rows; row0 += 4) {
+                switch(std::min<std::size_t>(args.rows - row0, 4)) {
+                case 1: Kernel<1>::run(args, row0, length); break;
+                case 2: Kernel<2>::run(args, row0, length); break;
+                case 3: Kernel<3>::run(args, row0, length); break;
+                default: Kernel<4>::run(args, row0, length); break;
+                }
+            }
+        }
+
+        template<std::size_t Rows> struct ssse3_kernel { static auto run(apply_args const &a, std::size_t r, std::size_t l) { apply_rows_ssse3<Rows>(a, r, l); } };
+        template<std::size_t Rows> struct avx2_kernel { static auto run(apply_args const &a, std::size_t r, std::size_t l) { apply_rows_avx2<Rows>(a, r, l); } };
+        template<std::size_t Rows> struct avx512_kernel { static auto run(apply_args const &a, std::size_t r, std::size_t l) { apply_rows_avx512<Rows>(a, r, l); } };
+        template<std::size_t Rows> struct avx2_gfni_kernel { static auto run(apply_args const &a, std::size_t r, std::size_t l) { apply_rows_avx2_gfni<Rows>(a, r, l); } };
+        template<std::size_t Rows> struct avx512_gfni_kernel { static auto run(apply_args const &a, std::size_t r, std::size_t l) { apply_rows_avx512_gfni<Rows>(a, r, l); } };
+
+        struct cpu_features {
+            bool ssse3 = __builtin_cpu_supports("ssse3");
+            bool avx2 = __builtin_cpu_supports("avx2");
+            bool avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+            bool gfni = __builtin_cpu_supports("gfni");
+        };
+#else
+        struct cpu_features {
+            bool ssse3 = false;
+            bool avx2 = false;
+            bool avx512 = false;
+            bool gfni = false;
+        };
+#endif
+
+        auto features() -> cpu_features const & {
+            static auto const instance = cpu_features {};
+            return instance;
+        }
+
+        auto resolve(gf256_kernel kernel) -> gf256_kernel {
+            if(kernel != gf256_kernel::automatic) {
+                enforce(gf256_kernel_supported(kernel), DOCA_ERROR_NOT_SUPPORTED);
+                return kernel;
+            }
+
+            for(auto candidate : {
+                gf256_kernel::avx512_gfni,
+                gf256_kernel::avx2_gfni,
+                gf256_kernel::avx512,
+                gf256_kernel::avx2,
+                gf256_kernel::ssse3
+            }) {
+                if(gf256_kernel_supported(candidate)) {
+                    return candidate;
+                }
+            }
+
+            return gf256_kernel::scalar;
+        }
+    }
+
+    auto gf256_kernel_supported(gf256_kernel kernel) noexcept -> bool {
+        auto const &cpu = features();
+
+        switch(kernel) {
+        case gf256_kernel::automatic:
+        case gf256_kernel::scalar:
+            return true;
+        case gf256_kernel::ssse3:
+            return cpu.ssse3;
+        case gf256_kernel::avx2:
+            return cpu.avx2;
+        case gf256_kernel::avx512:
+            return cpu.avx512;
+        case gf256_kernel::avx2_gfni:
+            return cpu.avx2 && cpu.gfni;
+        case gf256_kernel::avx512_gfni:
+            return cpu.avx512 && cpu.gfni;
+        }
+
+        return false;
+    }
+
+    auto gf256_kernel_name(gf256_kernel kernel) noexcept -> std::string_view {
+        switch(kernel) {
+        case gf256_kernel::automatic: return "automatic";
+        case gf256_kernel::scalar: return "scalar";
+        case gf256_kernel::ssse3: return "ssse3";
+        case gf256_kernel::avx2: return "avx2";
+        case gf256_kernel::avx512: return "avx512";
+        case gf256_kernel::avx2_gfni: return "avx2_gfni";
+        case gf256_kernel::avx512_gfni: return "avx512_gfni";
+        }
+
+        return "unknown";
+    }
+
+    namespace gf256 {
+        auto mul(std::uint8_t a, std::uint8_t b) noexcept -> std::uint8_t {
+            if(a == 0 || b == 0) {
+                return 0;
+            }
+
+            return tables.exp[tables.log[a] + tables.log[b]];
+        }
+
+        auto inv(std::uint8_t a) noexcept -> std::uint8_t {
+            return tables.exp[255 - tables.log[a]];
+        }
+    }
+
+    gf256_matrix::gf256_matrix(std::size_t rows, std::size_t cols, std::vector<std::uint8_t> coefficients):
+        rows_ { rows },
+        cols_ { cols },
+        coefficients_ { std::move(coefficients) },
+        nibble_tables_(32 * rows * cols),
+        affine_(rows * cols)
+    {
+        enforce(coefficients_.size() == rows * cols, DOCA_ERROR_INVALID_VALUE);
+
+        for(auto i = std::size_t { 0 }; i < coefficients_.size(); ++i) {
+            auto c = coefficients_[i];
+            auto table = nibble_tables_.data() + 32 * i;
+
+            for(auto n = 0; n < 16; ++n) {
+                table[n] = gf256::mul(c, static_cast<std::uint8_t>(n));
+                table[16 + n] = gf256::mul(c, static_cast<std::uint8_t>(n << 4));
+            }
+
+            affine_[i] = affine_matrix(c);
+        }
+    }
+
+    auto gf256_matrix::encoding(
+        doca_ec_matrix_type type,
+        std::size_t data_block_count,
+        std::size_t rdnc_block_count
+    ) -> gf256_matrix {
+        // Cauchy rows need distinct field elements for all block indices
+        enforce(data_block_count > 0 && rdnc_block_count > 0 && data_block_count + rdnc_block_count <= 256, DOCA_ERROR_INVALID_VALUE);
+
+        auto k = data_block_count;
+        auto coefficients = std::vector<std::uint8_t>(rdnc_block_count * k);
+
+        if(type == DOCA_EC_MATRIX_TYPE_CAUCHY) {
+            for(auto i = std::size_t { 0 }; i < rdnc_block_count; ++i) {
+                for(auto j = std::size_t { 0 }; j < k; ++j) {
+                    coefficients[i * k + j] = gf256::inv(static_cast<std::uint8_t>((k + i) ^ j));
+                }
+            }
+        } else if(type == DOCA_EC_MATRIX_TYPE_VANDERMONDE) {
+            auto generator = std::uint8_t { 1 };
+
+            for(auto i = std::size_t { 0 }; i < rdnc_block_count; ++i) {
+                auto p = std::uint8_t { 1 };
+
+                for(auto j = std::size_t { 0 }; j < k; ++j) {
+                    coefficients[i * k + j] = p;
+                    p = gf256::mul(p, generator);
+                }
+
+                generator = gf256::mul(generator, 2);
+            }
+        } else {
+            throw doca_exception(DOCA_ERROR_INVALID_VALUE);
+        }
+
+        return gf256_matrix { rdnc_block_count, k, std::move(coefficients) };
+    }
+
+    auto gf256_matrix::inverse() const -> std::optional<gf256_matrix> {
+        enforce(rows_ == cols_, DOCA_ERROR_INVALID_VALUE);
+
+        // Gauss-Jordan on a copy, mirrored on the identity
+        auto n = rows_;
+        auto a = coefficients_;
+        auto b = std::vector<std::uint8_t>(n * n);
+
+        for(auto i = std::size_t { 0 }; i < n; ++i) {
+            b[i * n + i] = 1;
+        }
+
+        for(auto col = std::size_t { 0 }; col < n; ++col) {
+            auto pivot = col;
+
+            while(pivot < n && a[pivot * n + col] == 0) {
+                ++pivot;
+            }
+
+            if(pivot == n) {
+                return std::nullopt;
+            }
+
+            if(pivot != col) {
+                std::swap_ranges(a.begin() + pivot * n, a.begin() + (pivot + 1) * n, a.begin() + col * n);
+                std::swap_ranges(b.begin() + pivot * n, b.begin() + (pivot + 1) * n, b.begin() + col * n);
+            }
+
+            auto scale = gf256::inv(a[col * n + col]);
+
+            for(auto j = std::size_t { 0 }; j < n; ++j) {
+                a[col * n + j] = gf256::mul(a[col * n + j], scale);
+                b[col * n + j] = gf256::mul(b[col * n + j], scale);
+            }
+
+            for(auto i = std::size_t { 0 }; i < n; ++i) {
+                auto factor = a[i * n + col];
+
+                if(i == col || factor == 0) {
+                    continue;
+                }
+
+                for(auto j = std::size_t { 0 }; j < n; ++j) {
+                    a[i * n + j] ^= gf256::mul(factor, a[col * n + j]);
+                    b[i * n + j] ^= gf256::mul(factor, b[col * n + j]);
+                }
+            }
+        }
+
+        return gf256_matrix { n, n, std::move(b) };
+    }
+
+    auto gf256_matrix::apply(
+        std::span<std::byte const * const> inputs,
+        std::span<std::byte * const> outputs,
+        std::size_t length,
+        gf256_kernel kernel
+    ) const -> void {
+        enforce(inputs.size() == cols_ && outputs.size() == rows_, DOCA_ERROR_INVALID_VALUE);
+
+        auto args = apply_args {
+            .rows = rows_,
+            .cols = cols_,
+            .tables = nibble_tables_.data(),
+            .affine = affine_.data(),
+            .inputs = inputs.data(),
+            .outputs = outputs.data()
+        };
+
+        auto vector_length = std::size_t { 0 };
+
+#if defined(__x86_64__)
+        vector_length = length - length % 64;
+
+        switch(resolve(kernel)) {
+        case gf256_kernel::ssse3: apply_vector<ssse3_kernel>(args, vector_length); break;
+        case gf256_kernel::avx2: apply_vector<avx2_kernel>(args, vector_length); break;
+        case gf256_kernel::avx512: apply_vector<avx512_kernel>(args, vector_length); break;
+        case gf256_kernel::avx2_gfni: apply_vector<avx2_gfni_kernel>(args, vector_length); break;
+        case gf256_kernel::avx512_gfni: apply_vector<avx512_gfni_kernel>(args, vector_length); break;
+        default: vector_length = 0; break;
+        }
+#else
+        resolve(kernel);
+#endif
+
+        if(vector_length < length) {
+            apply_scalar(args, vector_length, length);
+        }
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <doca_erasure_coding.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/**
+ * Arithmetic in GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11d), the field of
+ * Reed-Solomon erasure codes, and vectorized kernels for multiplying a matrix with a set of
+ * blocks.
+ */
+namespace shoc {
+    /**
+     * Implementations of gf256_matrix::apply
+     */
+    enum class gf256_kernel {
+        /// the fastest one the CPU supports
+        automatic,
+        /// portable C++, one byte at a time through the nibble tables
+        scalar,
+        /// split nibble table lookups with pshufb, 16 bytes at a time
+        ssse3,
+        /// split nibble table lookups with vpshufb, 32 bytes at a time
+        avx2,
+        /// split nibble table lookups with vpshufb, 64 bytes at a time (AVX-512BW)
+        avx512,
+        /// one affine transformation per multiplication (GFNI), 32 bytes at a time
+        avx2_gfni,
+        /// one affine transformation per multiplication (GFNI), 64 bytes at a time
+        avx512_gfni
+    };
+
+    /**
+     * @return whether the kernel can run on this CPU
+     */
+    [[nodiscard]] auto gf256_kernel_supported(gf256_kernel kernel) noexcept -> bool;
+
+    /**
+     * @return the name of the kernel, e.g. for benchmark output
+     */
+    [[nodiscard]] auto gf256_kernel_name(gf256_kernel kernel) noexcept -> std::string_view;
+
+    namespace gf256 {
+        [[nodiscard]] auto mul(std::uint8_t a, std::uint8_t b) noexcept -> std::uint8_t;
+
+        /**
+         * @return the multiplicative inverse of a, which must not be 0
+         */
+        [[nodiscard]] auto inv(std::uint8_t a) noexcept -> std::uint8_t;
+    }
+
+    /**
+     * Matrix over GF(2^8) in row-major order, together with the lookup tables the kernels
+     * multiply with, which are built once on construction.
+     */
+    class gf256_matrix {
+    public:
+        gf256_matrix() = default;
+
+        gf256_matrix(std::size_t rows, std::size_t cols, std::vector<std::uint8_t> coefficients);
+
+        /**
+         * The redundancy rows of a systematic encoding matrix, rdnc_block_count rows of
+         * data_block_count coefficients, generated as ISA-L does (gf_gen_cauchy1_matrix and
+         * gf_gen_rs_matrix): entry (i, j) is 1 / ((k + i) ^ j) for Cauchy matrices and
+         * (2^i)^j for Vandermonde matrices.
+         */
+        [[nodiscard]] static auto encoding(
+            doca_ec_matrix_type type,
+            std::size_t data_block_count,
+            std::size_t rdnc_block_count
+        ) -> gf256_matrix;
+
+        [[nodiscard]] auto rows() const noexcept { return rows_; }
+        [[nodiscard]] auto cols() const noexcept { return cols_; }
+        [[nodiscard]] auto coefficients() const noexcept -> std::span<std::uint8_t const> { return coefficients_; }
+
+        [[nodiscard]] auto row(std::size_t r) const noexcept -> std::span<std::uint8_t const> {
+            return coefficients().subspan(r * cols_, cols_);
+        }
+
+        [[nodiscard]] auto at(std::size_t r, std::size_t c) const noexcept -> std::uint8_t {
+            return coefficients_[r * cols_ + c];
+        }
+
+        /**
+         * @return the inverse of a square matrix, or nullopt if it is singular
+         */
+        [[nodiscard]] auto inverse() const -> std::optional<gf256_matrix>;
+
+        /**
+         * outputs[r] = sum over c of at(r, c) * inputs[c], byte by byte
+         *
+         * @param inputs cols() blocks of length bytes
+         * @param outputs rows() blocks of length bytes, must not overlap the inputs
+         * @param length block length; the vector kernels work in 64-byte steps and finish the
+         *        rest in scalar code
+         */
+        auto apply(
+            std::span<std::byte const * const> inputs,
+            std::span<std::byte * const> outputs,
+            std::size_t length,
+            gf256_kernel kernel = gf256_kernel::automatic
+        ) const -> void;
+
+    private:
+        std::size_t rows_ = 0;
+        std::size_t cols_ = 0;
+        std::vector<std::uint8_t> coefficients_;
+        /// per coefficient: the products with 0x00..0x0f, then with 0x00, 0x10, ..., 0xf0
+        std::vector<std::uint8_t> nibble_tables_;
+        /// per coefficient: the 8x8 bit matrix of the multiplication, for gf2p8affineqb
+        std::vector<std::uint64_t> affine_;
+    };
+}
@@ -0,0 +1,270 @@
+#include "hybrid_compress.hpp"
+
+#include "cpu_compress.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace shoc {
+    namespace {
+        auto start(
+            compress_backend &backend,
+            compress_operation op,
+            bool has_block_checksum,
+            bool are_blocks_independent,
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums
+        ) -> compress_awaitable {
+            switch(op) {
+                case compress_operation::compress_deflate:
+                    return backend.compress(src, dest, checksums);
+                case compress_operation::decompress_deflate:
+                    return backend.decompress(src, dest, checksums);
+                case compress_operation::decompress_lz4_block:
+                    return backend.decompress_lz4_block(src, dest, checksums);
+                case compress_operation::decompress_lz4_stream:
+                    return backend.decompress_lz4_stream(has_block_checksum, are_blocks_independent, src, dest, checksums);
+            }
+
+            return compress_awaitable::from_value(DOCA_ERROR_NOT_SUPPORTED);
+        }
+    }
+
+    hybrid_compress_scheduler::hybrid_compress_scheduler(
+        compress_context &hardware,
+        std::shared_ptr<compress_backend> software,
+        hybrid_compress_config const &cfg
+    ):
+        hybrid_compress_scheduler(
+            static_cast<compress_backend &>(hardware),
+            software != nullptr ? std::move(software) : cpu_compress_backend::shared(),
+            cfg
+        )
+    {
+        context_ = &hardware;
+    }
+
+    hybrid_compress_scheduler::hybrid_compress_scheduler(
+        compress_backend &hardware,
+        std::shared_ptr<compress_backend> software,
+        hybrid_compress_config const &cfg
+    ):
+        hardware_ { &hardware },
+        software_ { std::move(software) },
+        cfg_ { cfg },
+        paths_ {{
+            { .backend = hardware_, .max_inflight = cfg.hardware_max_inflight, .stats = {}, .queued_bytes = 0, .busy_since = {}, .last_completion = {} },
+            { .backend = software_.get(), .max_inflight = cfg.software_max_inflight, .stats = {}, .queued_bytes = 0, .busy_since = {}, .last_completion = {} }
+        }}
+    {
+        enforce(software_ != nullptr, DOCA_ERROR_INVALID_VALUE);
+        enforce(cfg.smoothing > 0 && cfg.smoothing <= 1 && cfg.initial_rate > 0, DOCA_ERROR_INVALID_VALUE);
+        enforce(cfg.hardware_max_inflight > 0 && cfg.software_max_inflight > 0, DOCA_ERROR_INVALID_VALUE);
+
+        for(auto &p : paths_) {
+            p.stats.rate = cfg.initial_rate;
+        }
+    }
+
+    auto hybrid_compress_scheduler::stats() const -> hybrid_compress_stats {
+        auto now = clock::now();
+        auto snapshot = [now](path const &p) {
+            auto result = p.stats;
+
+            // include the busy period that is still going on
+            if(result.inflight > 0) {
+                result.busy_time += std::chrono::duration_cast<std::chrono::nanoseconds>(now - p.busy_since);
+            }
+
+            return result;
+        };
+
+        return { snapshot(paths_[hardware_path]), snapshot(paths_[software_path]), waiting_.size() };
+    }
+
+    auto hybrid_compress_scheduler::choose(compress_operation op, std::size_t bytes) const -> std::optional<path_index> {
+        auto const &hw = paths_[hardware_path];
+        auto const &sw = paths_[software_path];
+        auto hw_full = hw.stats.inflight >= hw.max_inflight;
+        auto sw_full = sw.stats.inflight >= sw.max_inflight;
+
+        if(!hardware_supports(op)) {
+            return sw_full ? std::nullopt : std::optional { software_path };
+        }
+
+        if(!software_->supports(op)) {
+            return hw_full ? std::nullopt : std::optional { hardware_path };
+        }
+
+        if(hw_full && sw_full) {
+            return std::nullopt;
+        }
+
+        if(hw_full != sw_full) {
+            return hw_full ? software_path : hardware_path;
+        }
+
+        // predicted time until the task would be done on each path
+        auto finish = [bytes](path const &p) {
+            return static_cast<double>(p.queued_bytes + bytes) / p.stats.rate;
+        };
+
+        return finish(sw) < finish(hw) ? software_path : hardware_path;
+    }
+
+    auto hybrid_compress_scheduler::record_completion(
+        path &p,
+        std::size_t bytes,
+        clock::time_point submitted,
+        bool success
+    ) -> void {
+        auto now = clock::now();
+
+        --p.stats.inflight;
+        p.queued_bytes -= bytes;
+
+        if(p.stats.inflight == 0) {
+            p.stats.busy_time += std::chrono::duration_cast<std::chrono::nanoseconds>(now - p.busy_since);
+        }
+
+        if(!success) {
+            ++p.stats.failed;
+            return;
+        }
+
+        p.stats.bytes += bytes;
+
+        // with several tasks in flight, the time since the previous completion is what a task
+        // costs the path; with an idle path, it's the task's latency.
+        auto interval = std::chrono::duration_cast<std::chrono::nanoseconds>(now - std::max(p.last_completion, submitted));
+        p.last_completion = now;
+
+        if(interval.count() > 0) {
+            auto sample = bytes * 1e9 / interval.count();
+            p.stats.rate += cfg_.smoothing * (sample - p.stats.rate);
+        }
+    }
+
+    auto hybrid_compress_scheduler::track(
+        path_index index,
+        compress_operation op,
+        lz4_stream_flags flags,
+        buffer const &src,
+        buffer &dest,
+        compress_awaitable::payload_type *receptable,
+        bool want_checksums
+    ) -> boost::cobalt::detached {
+        auto &p = paths_[index];
+        auto bytes = src.view().data_length();
+        auto submitted = clock::now();
+        auto checksums = compress_checksums {};
+        auto sums = want_checksums ? &checksums : nullptr;
+
+        if(p.stats.inflight == 0) {
+            p.busy_since = submitted;
+        }
+
+        ++p.stats.inflight;
+        ++p.stats.tasks;
+        p.queued_bytes += bytes;
+
+        auto status = DOCA_ERROR_UNKNOWN;
+        auto failure = std::exception_ptr {};
+
+        try {
+            auto task = start(*p.backend, op, flags.has_block_checksum, flags.are_blocks_independent, src, dest, sums);
+            status = co_await task;
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        record_completion(p, bytes, submitted, failure == nullptr && status == DOCA_SUCCESS);
+
+        // hand the slot on before the caller, who might submit more, gets to run
+        start_waiting();
+
+        if(failure) {
+            receptable->set_exception(failure);
+        } else {
+            receptable->emplace_value(status);
+
+            if(receptable->additional_data()) {
+                receptable->additional_data().overwrite(std::move(checksums));
+            }
+        }
+
+        receptable->resume();
+    }
+
+    auto hybrid_compress_scheduler::submit(
+        compress_operation op,
+        lz4_stream_flags flags,
+        buffer const &src,
+        buffer &dest,
+        compress_checksums *checksums
+    ) -> compress_awaitable {
+        auto result = compress_awaitable::create_space(checksums);
+        auto task = waiting_task { op, flags, &src, &dest, result.receptable_ptr(), checksums != nullptr };
+
+        // behind tasks that are already waiting, so that they aren't starved
+        auto index = waiting_.empty() ? choose(op, src.view().data_length()) : std::nullopt;
+
+        if(index) {
+            track(*index, op, flags, src, dest, task.receptable, task.want_checksums);
+        } else {
+            waiting_.push_back(task);
+        }
+
+        return result;
+    }
+
+    auto hybrid_compress_scheduler::start_waiting() -> void {
+        while(!waiting_.empty()) {
+            auto next = waiting_.front();
+            auto index = choose(next.op, next.src->view().data_length());
+
+            if(!index) {
+                break;
+            }
+
+            waiting_.pop_front();
+            track(*index, next.op, next.flags, *next.src, *next.dest, next.receptable, next.want_checksums);
+        }
+    }
+
+    auto hybrid_compress_scheduler::compress(
+        buffer const &src,
+        buffer &dest,
+        compress_checksums *checksums
+    ) -> compress_awaitable {
+        return submit(compress_operation::compress_deflate, {}, src, dest, checksums);
+    }
+
+    auto hybrid_compress_scheduler::decompress(
+        buffer const &src,
+        buffer &dest,
+        compress_checksums *checksums
+    ) -> compress_awaitable {
+        return submit(compress_operation::decompress_deflate, {}, src, dest, checksums);
+    }
+
+    auto hybrid_compress_scheduler::decompress_lz4_block(
+        buffer const &src,
+        buffer &dest,
+        compress_checksums *checksums
+    ) -> compress_awaitable {
+        return submit(compress_operation::decompress_lz4_block, {}, src, dest, checksums);
+    }
+
+    auto hybrid_compress_scheduler::decompress_lz4_stream(
+        bool has_block_checksum,
+        bool are_blocks_independent,
+        buffer const &src,
+        buffer &dest,
+        compress_checksums *checksums
+    ) -> compress_awaitable {
+        return submit(compress_operation::decompress_lz4_stream, { has_block_checksum, are_blocks_independent }, src, dest, checksums);
+    }
+}
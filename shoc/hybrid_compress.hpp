@@ -0,0 +1,228 @@
+#pragma once
+
+#include "buffer.hpp"
+#include "compress.hpp"
+
+#include <boost/cobalt/detached.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <thread>
+
+namespace shoc {
+    /**
+     * Configuration for a hybrid_compress_scheduler
+     */
+    struct hybrid_compress_config {
+        /// Most tasks in flight on the device; must not exceed the context's max_tasks
+        std::uint32_t hardware_max_inflight = 16;
+        /// Most tasks in flight in software
+        std::uint32_t software_max_inflight = std::max(1u, std::thread::hardware_concurrency());
+        /// Weight of a new throughput sample in the moving average, in (0, 1]
+        double smoothing = 0.125;
+        /// Throughput assumed for a path before its first completion, in bytes per second
+        double initial_rate = 1e9;
+    };
+
+    /**
+     * Counters for one path of a hybrid_compress_scheduler
+     */
+    struct compress_path_stats {
+        std::uint64_t tasks = 0;
+        std::uint64_t failed = 0;
+        /// source bytes of the successful tasks
+        std::uint64_t bytes = 0;
+        std::uint32_t inflight = 0;
+        /// time during which at least one task was in flight on this path
+        std::chrono::nanoseconds busy_time { 0 };
+        /// current throughput estimate the scheduler works with, in bytes per second
+        double rate = 0;
+
+        /**
+         * @return measured throughput while busy, in bytes per second
+         */
+        [[nodiscard]] auto throughput() const noexcept -> double {
+            return busy_time.count() > 0 ? bytes * 1e9 / busy_time.count() : 0;
+        }
+    };
+
+    struct hybrid_compress_stats {
+        compress_path_stats hardware;
+        compress_path_stats software;
+        /// tasks held back until a path they can go to has room
+        std::size_t waiting = 0;
+    };
+
+    /**
+     * Splits compression work between a compress_context's device and a software backend so that
+     * both are kept busy. The device's throughput is fixed, but the host's cores are usually idle
+     * while it works, so together they get through a chunk stream faster than either alone.
+     *
+     * Each task goes to the path on which it is predicted to finish first, given the bytes that
+     * are already queued there and the path's throughput as measured from recent completions.
+     * In the steady state this splits the stream in proportion to the paths' throughputs and
+     * adapts when either of them changes, e.g. because other work competes for the cores. A path
+     * that has reached its configured queue depth gets no further tasks while the other one has
+     * room; when neither has, tasks wait in submission order until one completes, so the device
+     * never gets more than hardware_max_inflight tasks. Operations the device doesn't support
+     * always go to software.
+     *
+     * Leave the context's routes on compress_route::automatic; the scheduler makes the choice.
+     * Both backends and the scheduler have to outlive the tasks in flight. Not threadsafe; use
+     * from the thread of the context's progress engine.
+     */
+    class hybrid_compress_scheduler:
+        public compress_backend
+    {
+    public:
+        /**
+         * @param hardware running compression context
+         * @param software backend for the CPU path, the shared cpu_compress_backend if nullptr
+         * @param cfg queue depths and estimator settings
+         */
+        hybrid_compress_scheduler(
+            compress_context &hardware,
+            std::shared_ptr<compress_backend> software = nullptr,
+            hybrid_compress_config const &cfg = {}
+        );
+
+        /**
+         * Split the work between any two backends. The first one takes the device's role;
+         * operations it doesn't support go to software.
+         *
+         * @param hardware backend for the device path
+         * @param software backend for the CPU path
+         * @param cfg queue depths and estimator settings
+         */
+        hybrid_compress_scheduler(
+            compress_backend &hardware,
+            std::shared_ptr<compress_backend> software,
+            hybrid_compress_config const &cfg = {}
+        );
+
+        [[nodiscard]] auto supports(compress_operation op) const noexcept -> bool override {
+            return hardware_supports(op) || software_->supports(op);
+        }
+
+        /**
+         * @return counters and throughput estimates for both paths
+         */
+        [[nodiscard]] auto stats() const -> hybrid_compress_stats;
+
+        auto compress(
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable override;
+
+        auto decompress(
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable override;
+
+        auto decompress_lz4_block(
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable override;
+
+        auto decompress_lz4_stream(
+            bool has_block_checksum,
+            bool are_blocks_independent,
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums = nullptr
+        ) -> compress_awaitable override;
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        enum path_index : std::size_t {
+            hardware_path,
+            software_path
+        };
+
+        struct path {
+            compress_backend *backend;
+            std::uint32_t max_inflight;
+            compress_path_stats stats;
+            /// source bytes of the tasks in flight
+            std::uint64_t queued_bytes = 0;
+            clock::time_point busy_since;
+            clock::time_point last_completion;
+        };
+
+        /**
+         * Options of decompress_lz4_stream
+         */
+        struct lz4_stream_flags {
+            bool has_block_checksum = false;
+            bool are_blocks_independent = false;
+        };
+
+        /**
+         * A task that was submitted while no path it can go to had room
+         */
+        struct waiting_task {
+            compress_operation op;
+            lz4_stream_flags flags;
+            buffer const *src;
+            buffer *dest;
+            compress_awaitable::payload_type *receptable;
+            bool want_checksums;
+        };
+
+        [[nodiscard]] auto hardware_supports(compress_operation op) const noexcept -> bool {
+            return context_ != nullptr ? context_->hardware_supports(op) : hardware_->supports(op);
+        }
+
+        /**
+         * @return the path the task should go to, or nothing if it has to wait for room
+         */
+        [[nodiscard]] auto choose(compress_operation op, std::size_t bytes) const -> std::optional<path_index>;
+
+        /**
+         * Start waiting tasks, oldest first, for as long as there is room for them
+         */
+        auto start_waiting() -> void;
+
+        auto submit(
+            compress_operation op,
+            lz4_stream_flags flags,
+            buffer const &src,
+            buffer &dest,
+            compress_checksums *checksums
+        ) -> compress_awaitable;
+
+        /**
+         * Runs the task on the path and forwards the result to the caller's receptable
+         */
+        auto track(
+            path_index index,
+            compress_operation op,
+            lz4_stream_flags flags,
+            buffer const &src,
+            buffer &dest,
+            compress_awaitable::payload_type *receptable,
+            bool want_checksums
+        ) -> boost::cobalt::detached;
+
+        auto record_completion(path &p, std::size_t bytes, clock::time_point submitted, bool success) -> void;
+
+        compress_backend *hardware_;
+        // only set if the device path is a compress_context, whose supports() includes its
+        // software fallback
+        compress_context *context_ = nullptr;
+        std::shared_ptr<compress_backend> software_;
+        hybrid_compress_config cfg_;
+        std::array<path, 2> paths_;
+        std::deque<waiting_task> waiting_;
+    };
+}
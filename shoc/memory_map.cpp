@@ -8,7 +8,7 @@
 
 namespace shoc {
     memory_map::memory_map(
-        std::initializer_list<device> devices,
+        std::span<device const> devices,
         std::span<std::byte> range,
         std::uint32_t permissions
     ):
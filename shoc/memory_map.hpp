@@ -8,6 +8,7 @@
 #include <doca_mmap.h>
 
 #include <cstdint>
+#include <initializer_list>
 #include <span>
 
 namespace shoc {
@@ -38,11 +39,19 @@ namespace shoc {
          * @param permissions access permissions as per DOCA API
          */
         memory_map(
-            std::initializer_list<device> devices,
+            std::span<device const> devices,
             std::span<std::byte> range,
             std::uint32_t permissions = DOCA_ACCESS_FLAG_LOCAL_READ_WRITE
         );
 
+        memory_map(
+            std::initializer_list<device> devices,
+            std::span<std::byte> range,
+            std::uint32_t permissions = DOCA_ACCESS_FLAG_LOCAL_READ_WRITE
+        ):
+            memory_map { std::span { devices.begin(), devices.size() }, range, permissions }
+        {}
+
         memory_map(
             std::initializer_list<device> devices,
             std::span<std::byte const> range,
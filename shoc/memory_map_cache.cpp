@@ -0,0 +1,162 @@
+#include "memory_map_cache.hpp"
+
+#include "logger.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace shoc {
+    auto memory_map_cache::get(
+        std::span<device const> devices,
+        std::span<std::byte> range,
+        std::uint32_t permissions
+    ) -> std::shared_ptr<memory_map> {
+        auto key = group_key { {}, permissions };
+
+        for(auto &dev : devices) {
+            key.devices.push_back(dev.handle());
+        }
+
+        std::ranges::sort(key.devices);
+
+        auto [group_it, inserted] = groups_.try_emplace(std::move(key));
+        auto &grp = group_it->second;
+
+        if(inserted) {
+            grp.devices.assign(devices.begin(), devices.end());
+        }
+
+        auto base = reinterpret_cast<std::uintptr_t>(range.data());
+        auto end = base + range.size();
+
+        // the only candidate for covering [base, end) is the last registration starting at or before base.
+        auto candidate = grp.by_base.upper_bound(base);
+
+        if(candidate != grp.by_base.begin()) {
+            auto covering = std::prev(candidate);
+            auto it = covering->second;
+
+            if(it->end >= end) {
+                ++stats_.hits;
+                lru_.splice(lru_.begin(), lru_, it);
+                return it->mmap;
+            }
+
+            // overlaps the requested range without covering it; merge below.
+            if(it->end > base) {
+                candidate = covering;
+            }
+        }
+
+        ++stats_.misses;
+
+        // registrations overlapping [base, end) are replaced by one that covers all of them.
+        auto merged_base = base;
+        auto merged_end = end;
+        auto overlapping = std::vector<lru_list::iterator>{};
+
+        for(auto pos = candidate; pos != grp.by_base.end() && pos->first < end; ++pos) {
+            auto it = pos->second;
+
+            if(it->end > base) {
+                merged_base = std::min(merged_base, it->base);
+                merged_end = std::max(merged_end, it->end);
+                overlapping.push_back(it);
+            }
+        }
+
+        if(!overlapping.empty()) {
+            ++stats_.extensions;
+            logger->debug("memory_map_cache: merging {} registrations into one", overlapping.size());
+        }
+
+        auto mmap = std::shared_ptr<memory_map> {};
+
+        try {
+            mmap = std::make_shared<memory_map>(
+                std::span<device const> { grp.devices },
+                std::span { reinterpret_cast<std::byte*>(merged_base), merged_end - merged_base },
+                permissions
+            );
+        } catch(...) {
+            // don't leave a group without registrations behind
+            if(inserted) {
+                groups_.erase(group_it);
+            }
+
+            throw;
+        }
+
+        // unlink rather than erase so the group isn't dropped when it runs empty.
+        for(auto it : overlapping) {
+            unlink(it);
+        }
+
+        lru_.push_front(entry { group_it, merged_base, merged_end, mmap });
+        grp.by_base.emplace(merged_base, lru_.begin());
+
+        stats_.pinned_bytes += merged_end - merged_base;
+        ++stats_.entries;
+
+        enforce_budget(lru_.begin());
+
+        return mmap;
+    }
+
+    auto memory_map_cache::invalidate(std::span<std::byte const> range) -> void {
+        auto base = reinterpret_cast<std::uintptr_t>(range.data());
+        auto end = base + range.size();
+
+        for(auto it = lru_.begin(); it != lru_.end();) {
+            auto next = std::next(it);
+
+            if(it->base < end && it->end > base) {
+                erase(it);
+            }
+
+            it = next;
+        }
+    }
+
+    auto memory_map_cache::clear() -> void {
+        lru_.clear();
+        groups_.clear();
+        stats_.pinned_bytes = 0;
+        stats_.entries = 0;
+    }
+
+    auto memory_map_cache::unlink(lru_list::iterator it) -> void {
+        it->owner->second.by_base.erase(it->base);
+        stats_.pinned_bytes -= it->end - it->base;
+        --stats_.entries;
+        lru_.erase(it);
+    }
+
+    auto memory_map_cache::erase(lru_list::iterator it) -> void {
+        auto owner = it->owner;
+
+        unlink(it);
+
+        if(owner->second.by_base.empty()) {
+            groups_.erase(owner);
+        }
+    }
+
+    auto memory_map_cache::enforce_budget(lru_list::iterator keep) -> void {
+        // registrations that are still held elsewhere stay pinned whether we drop them or not,
+        // so only those held by nobody but the cache are worth evicting.
+        auto it = lru_.end();
+
+        while(stats_.pinned_bytes > budget_ && it != lru_.begin()) {
+            --it;
+
+            if(it == keep || it->mmap.use_count() > 1) {
+                continue;
+            }
+
+            auto victim = it++;
+            erase(victim);
+            ++stats_.evictions;
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "device.hpp"
+#include "memory_map.hpp"
+
+#include <doca_mmap.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <list>
+#include <map>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace shoc {
+    /**
+     * Counters of a memory_map_cache
+     */
+    struct memory_map_cache_stats {
+        /// lookups that were served by an existing registration
+        std::uint64_t hits = 0;
+        /// lookups that required a new registration
+        std::uint64_t misses = 0;
+        /// misses where the new registration replaced overlapping existing ones
+        std::uint64_t extensions = 0;
+        /// registrations dropped to stay within the pinned-bytes budget
+        std::uint64_t evictions = 0;
+        /// bytes covered by the registrations currently held by the cache
+        std::size_t pinned_bytes = 0;
+        /// number of registrations currently held by the cache
+        std::size_t entries = 0;
+    };
+
+    /**
+     * Cache of memory registrations. Creating a memory_map pins and registers memory with the
+     * device(s), which is too expensive to do on the hot path for every request buffer. The cache
+     * hands out shared memory_maps keyed by device set, address range, and permissions:
+     *
+     * - if a registration with the same devices and permissions covers the requested range, it is
+     *   reused, so a sub-span of an already-mapped region gets the parent's memory_map;
+     * - if the requested range overlaps existing registrations without being covered by one, a
+     *   new registration covering all of them is created and replaces them in the cache;
+     * - when the cached registrations exceed the pinned-bytes budget, least recently used ones
+     *   that nobody else holds on to anymore are dropped.
+     *
+     * The cache cannot know when memory is released. Before unmapping or freeing memory that may
+     * have been registered through it, call invalidate() so that a later allocation at the same
+     * address doesn't get a stale registration.
+     *
+     * Like the rest of the library, this is not threadsafe.
+     */
+    class memory_map_cache {
+    public:
+        /**
+         * @param pinned_bytes_budget upper bound for the bytes covered by cached registrations
+         */
+        explicit memory_map_cache(std::size_t pinned_bytes_budget = std::size_t { 1 } << 30):
+            budget_ { pinned_bytes_budget }
+        {}
+
+        memory_map_cache(memory_map_cache const &) = delete;
+        memory_map_cache(memory_map_cache &&) = delete;
+        memory_map_cache &operator=(memory_map_cache const &) = delete;
+        memory_map_cache &operator=(memory_map_cache &&) = delete;
+
+        /**
+         * Get a memory_map that covers range for the given devices and permissions, creating one
+         * if necessary.
+         *
+         * @param devices devices that'll have access to the memory
+         * @param range memory region that needs to be mapped
+         * @param permissions access permissions as per DOCA API
+         * @return a memory_map covering at least range
+         */
+        [[nodiscard]] auto get(
+            std::span<device const> devices,
+            std::span<std::byte> range,
+            std::uint32_t permissions = DOCA_ACCESS_FLAG_LOCAL_READ_WRITE
+        ) -> std::shared_ptr<memory_map>;
+
+        [[nodiscard]] auto get(
+            std::initializer_list<device> devices,
+            std::span<std::byte> range,
+            std::uint32_t permissions = DOCA_ACCESS_FLAG_LOCAL_READ_WRITE
+        ) -> std::shared_ptr<memory_map> {
+            return get(std::span { devices.begin(), devices.size() }, range, permissions);
+        }
+
+        [[nodiscard]] auto get(
+            device const &dev,
+            std::span<std::byte> range,
+            std::uint32_t permissions = DOCA_ACCESS_FLAG_LOCAL_READ_WRITE
+        ) -> std::shared_ptr<memory_map> {
+            return get(std::span { &dev, 1 }, range, permissions);
+        }
+
+        /**
+         * Drop all cached registrations that overlap range. memory_maps that were handed out stay
+         * valid as long as they are held.
+         */
+        auto invalidate(std::span<std::byte const> range) -> void;
+
+        /**
+         * Drop all cached registrations.
+         */
+        auto clear() -> void;
+
+        [[nodiscard]] auto stats() const noexcept -> memory_map_cache_stats const & {
+            return stats_;
+        }
+
+        [[nodiscard]] auto pinned_bytes_budget() const noexcept {
+            return budget_;
+        }
+
+    private:
+        /**
+         * Registrations are grouped by device set and permissions; only registrations in the same
+         * group can be reused for each other.
+         */
+        struct group_key {
+            std::vector<doca_dev*> devices;
+            std::uint32_t permissions;
+
+            auto operator<=>(group_key const &) const = default;
+        };
+
+        struct entry;
+        using lru_list = std::list<entry>;
+
+        struct group {
+            // keeps the devices open as long as registrations for them are cached
+            std::vector<device> devices;
+            // registrations by start address
+            std::map<std::uintptr_t, lru_list::iterator> by_base;
+        };
+
+        using group_map = std::map<group_key, group>;
+
+        struct entry {
+            group_map::iterator owner;
+            std::uintptr_t base;
+            std::uintptr_t end;
+            std::shared_ptr<memory_map> mmap;
+        };
+
+        auto unlink(lru_list::iterator it) -> void;
+        auto erase(lru_list::iterator it) -> void;
+        auto enforce_budget(lru_list::iterator keep) -> void;
+
+        std::size_t budget_;
+        group_map groups_;
+        // most recently used first
+        lru_list lru_;
+        memory_map_cache_stats stats_;
+    };
+}
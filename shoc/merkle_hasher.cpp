@@ -0,0 +1,275 @@
+#include "merkle_hasher.hpp"
+
+#include "error.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <exception>
+
+namespace shoc {
+    namespace {
+        constexpr auto leaf_prefix = std::byte { 0x00 };
+        constexpr auto interior_prefix = std::byte { 0x01 };
+
+        auto round_up(std::size_t value, std::size_t multiple) -> std::size_t {
+            return (value + multiple - 1) / multiple * multiple;
+        }
+
+        auto interior_hash(doca_sha_algorithm algorithm, sha_digest const &left, sha_digest const &right) -> sha_digest {
+            auto message = std::array<std::byte, 1 + 2 * 64> {};
+            auto out = message.begin();
+
+            *out++ = interior_prefix;
+            out = std::ranges::copy(left.data(), out).out;
+            out = std::ranges::copy(right.data(), out).out;
+
+            return sha_hash(algorithm, std::span { message.begin(), out });
+        }
+
+        /**
+         * Combines nodes into their parents as they come in. Leaves have to be added in order;
+         * then at most one node per level waits for its right sibling.
+         */
+        class tree_builder {
+        public:
+            tree_builder(doca_sha_algorithm algorithm, merkle_tree &tree, bool keep_tree):
+                algorithm_ { algorithm },
+                tree_ { tree },
+                keep_tree_ { keep_tree }
+            {}
+
+            auto add(std::size_t level, sha_digest const &node) -> void {
+                if(keep_tree_) {
+                    if(tree_.levels.size() <= level) {
+                        tree_.levels.resize(level + 1);
+                    }
+
+                    tree_.levels[level].insert(tree_.levels[level].end(), node.data().begin(), node.data().end());
+                }
+
+                if(waiting_.size() <= level) {
+                    waiting_.resize(level + 1);
+                }
+
+                if(waiting_[level]) {
+                    auto parent = interior_hash(algorithm_, *waiting_[level], node);
+                    waiting_[level].reset();
+                    add(level + 1, parent);
+                } else {
+                    waiting_[level] = node;
+                }
+            }
+
+            /**
+             * After the last leaf: nodes that are still waiting have no right sibling and move up
+             * until they meet a waiting left sibling or are the root.
+             */
+            auto finish() -> void {
+                for(auto level = std::size_t { 0 }; level < waiting_.size(); ++level) {
+                    if(!waiting_[level]) {
+                        continue;
+                    }
+
+                    auto is_root = std::none_of(waiting_.begin() + level + 1, waiting_.end(), [](auto const &node) {
+                        return node.has_value();
+                    });
+
+                    if(is_root) {
+                        if(!keep_tree_) {
+                            auto root = waiting_[level]->data();
+                            tree_.levels = { std::vector<std::byte>(root.begin(), root.end()) };
+                        }
+
+                        return;
+                    }
+
+                    auto node = *waiting_[level];
+                    waiting_[level].reset();
+                    add(level + 1, node);
+                }
+            }
+
+        private:
+            doca_sha_algorithm algorithm_;
+            merkle_tree &tree_;
+            bool keep_tree_;
+            std::vector<std::optional<sha_digest>> waiting_;
+        };
+    }
+
+    auto merkle_tree::root() const -> sha_digest {
+        auto digest = sha_digest {};
+        auto node = this->node(levels.size() - 1, 0);
+
+        digest.size = node.size();
+        std::ranges::copy(node, digest.bytes.begin());
+
+        return digest;
+    }
+
+    merkle_hasher::device_slots::device_slots(
+        sha_context &ctx,
+        device const &dev,
+        merkle_config const &cfg,
+        std::size_t result_size
+    ):
+        ctx { &ctx },
+        src_blocks { cfg.max_tasks, round_up(cfg.leaf_size + 1, 64), 64, cfg.memory },
+        dst_blocks { cfg.max_tasks, round_up(result_size, 64), 64, cfg.memory },
+        src_mmap { dev, src_blocks.as_writable_bytes() },
+        dst_mmap { dev, dst_blocks.as_writable_bytes() },
+        inventory { 2 * cfg.max_tasks },
+        src_buffers { inventory.buf_get_blocks(src_mmap, src_blocks) },
+        dst_buffers { inventory.buf_get_blocks(dst_mmap, dst_blocks) }
+    {}
+
+    merkle_hasher::merkle_hasher(sha_context &ctx, device const &dev, merkle_config const &cfg):
+        cfg_ { cfg }
+    {
+        enforce(cfg.leaf_size > 0 && cfg.max_tasks > 0, DOCA_ERROR_INVALID_VALUE);
+
+        auto devinfo = dev.as_devinfo();
+
+        if(doca_sha_cap_task_hash_get_supported(devinfo, cfg.algorithm) != DOCA_SUCCESS) {
+            logger->debug("merkle_hasher: device can't hash with algorithm {}, hashing in software", static_cast<int>(cfg.algorithm));
+            software_ = cfg.software != nullptr ? cfg.software : cpu_sha_backend::shared();
+            return;
+        }
+
+        auto max_src_size = std::uint64_t {};
+        auto min_dst_size = std::uint32_t {};
+        enforce_success(doca_sha_cap_get_max_src_buf_size(devinfo, &max_src_size));
+        enforce_success(doca_sha_cap_get_min_dst_buf_size(devinfo, cfg.algorithm, &min_dst_size));
+
+        // each leaf goes to the device with its prefix byte in front
+        enforce(cfg.leaf_size + 1 <= max_src_size, DOCA_ERROR_INVALID_VALUE);
+
+        auto result_size = std::max<std::size_t>(min_dst_size, sha_digest_size(cfg.algorithm));
+        device_ = std::make_unique<device_slots>(ctx, dev, cfg, result_size);
+    }
+
+    merkle_hasher::merkle_hasher(merkle_config const &cfg):
+        cfg_ { cfg },
+        software_ { cfg.software != nullptr ? cfg.software : cpu_sha_backend::shared() }
+    {
+        enforce(cfg.leaf_size > 0 && cfg.max_tasks > 0, DOCA_ERROR_INVALID_VALUE);
+    }
+
+    auto merkle_hasher::start_leaf(slot &s, std::size_t index, std::span<std::byte const> leaf) -> void {
+        if(device_ != nullptr) {
+            auto src = device_->src_blocks.writable_block(index);
+
+            src[0] = leaf_prefix;
+            std::ranges::copy(leaf, src.begin() + 1);
+
+            device_->src_buffers[index].set_data(leaf.size() + 1);
+            device_->dst_buffers[index].set_data(0);
+            s.task = device_->ctx->hash(cfg_.algorithm, device_->src_buffers[index], device_->dst_buffers[index]);
+
+            return;
+        }
+
+        auto block_size = sha_block_size(cfg_.algorithm);
+        auto &state = s.state ? *s.state : s.state.emplace(cfg_.algorithm);
+
+        state.reset();
+        s.head[0] = leaf_prefix;
+
+        if(leaf.size() + 1 < block_size) {
+            // not even a block; finished off in leaf_digest
+            std::ranges::copy(leaf, s.head.begin() + 1);
+            s.tail = std::span { s.head }.first(leaf.size() + 1);
+            s.task = coro::status_awaitable<>::from_value(DOCA_SUCCESS);
+            return;
+        }
+
+        // the prefix shifts the leaf by a byte, so the first block is put together here and the
+        // remaining whole blocks are hashed where they are
+        std::ranges::copy(leaf.first(block_size - 1), s.head.begin() + 1);
+        state.absorb(std::span { s.head }.first(block_size));
+
+        auto rest = leaf.subspan(block_size - 1);
+        auto whole = rest.size() - rest.size() % block_size;
+
+        s.tail = rest.subspan(whole);
+        s.task = whole > 0
+            ? software_->absorb(state, rest.first(whole))
+            : coro::status_awaitable<>::from_value(DOCA_SUCCESS);
+    }
+
+    auto merkle_hasher::leaf_digest(slot &s, std::size_t index) -> sha_digest {
+        if(device_ != nullptr) {
+            auto out = device_->dst_buffers[index].data<std::byte>();
+            auto digest = sha_digest {};
+
+            digest.size = sha_digest_size(cfg_.algorithm);
+            enforce(out.size() >= digest.size, DOCA_ERROR_UNEXPECTED);
+            std::ranges::copy(out.first(digest.size), digest.bytes.begin());
+
+            return digest;
+        }
+
+        return s.state->finish(s.tail);
+    }
+
+    auto merkle_hasher::hash(std::span<std::byte const> data) -> boost::cobalt::task<merkle_tree> {
+        auto tree = merkle_tree {};
+        tree.digest_size = sha_digest_size(cfg_.algorithm);
+        tree.leaf_count = (data.size() + cfg_.leaf_size - 1) / cfg_.leaf_size;
+
+        if(tree.leaf_count == 0) {
+            auto root = sha_hash(cfg_.algorithm, {});
+            tree.levels = { std::vector<std::byte>(root.data().begin(), root.data().end()) };
+            co_return tree;
+        }
+
+        auto builder = tree_builder { cfg_.algorithm, tree, cfg_.keep_tree };
+        auto slots = std::vector<slot>(cfg_.max_tasks);
+        auto submitted = std::uint64_t { 0 };
+        auto completed = std::uint64_t { 0 };
+        auto failure = std::exception_ptr {};
+
+        auto leaf = [&](std::uint64_t i) {
+            return data.subspan(i * cfg_.leaf_size, std::min<std::size_t>(cfg_.leaf_size, data.size() - i * cfg_.leaf_size));
+        };
+
+        try {
+            while(completed < tree.leaf_count) {
+                while(submitted < tree.leaf_count && submitted - completed < slots.size()) {
+                    auto index = submitted % slots.size();
+                    start_leaf(slots[index], index, leaf(submitted));
+                    ++submitted;
+                }
+
+                // leaves are taken in order, which is what tree_builder needs; the device works
+                // through them in about that order anyway
+                auto index = completed % slots.size();
+                auto status = co_await slots[index].task;
+                ++completed;
+
+                enforce_success(status);
+                builder.add(0, leaf_digest(slots[index], index));
+            }
+
+            builder.finish();
+        } catch(...) {
+            failure = std::current_exception();
+        }
+
+        if(failure) {
+            // the slots must not go away under the tasks in flight
+            for(; completed < submitted; ++completed) {
+                try {
+                    static_cast<void>(co_await slots[completed % slots.size()].task);
+                } catch(...) {
+                    // the first failure is the one reported
+                }
+            }
+
+            std::rethrow_exception(failure);
+        }
+
+        co_return tree;
+    }
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "aligned_memory.hpp"
+#include "buffer.hpp"
+#include "buffer_inventory.hpp"
+#include "coro/status_awaitable.hpp"
+#include "cpu_sha.hpp"
+#include "device.hpp"
+#include "memory_map.hpp"
+#include "sha.hpp"
+
+#include <doca_sha.h>
+
+#include <boost/cobalt/task.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace shoc {
+    /**
+     * Configuration for a merkle_hasher
+     */
+    struct merkle_config {
+        doca_sha_algorithm algorithm = DOCA_SHA_ALGORITHM_SHA256;
+        /// Size of the leaves the input is split into; the last leaf may be shorter
+        std::size_t leaf_size = 64 * 1024;
+        /// Maximum number of leaves being hashed at once. On a device, must not exceed the
+        /// context's max_tasks.
+        std::uint32_t max_tasks = 16;
+        /// Whether to return all nodes of the tree or only the root
+        bool keep_tree = false;
+        /// Where and how the leaf staging memory is allocated
+        memory_policy memory;
+        /// Backend for software hashing, the shared cpu_sha_backend if nullptr
+        std::shared_ptr<cpu_sha_backend> software;
+    };
+
+    /**
+     * Hashes of a Merkle tree, level by level
+     */
+    struct merkle_tree {
+        std::size_t digest_size = 0;
+        std::uint64_t leaf_count = 0;
+        /// levels[0] holds the leaf hashes and levels.back() the root, digest_size bytes per node.
+        /// The parent of node i is node i / 2 on the next level; a node without a sibling is
+        /// repeated there. Without merkle_config::keep_tree, only the root level is filled in.
+        std::vector<std::vector<std::byte>> levels;
+
+        [[nodiscard]] auto level_size(std::size_t level) const noexcept -> std::size_t {
+            return levels[level].size() / digest_size;
+        }
+
+        [[nodiscard]] auto node(std::size_t level, std::size_t index) const -> std::span<std::byte const> {
+            return std::span { levels[level] }.subspan(index * digest_size, digest_size);
+        }
+
+        [[nodiscard]] auto root() const -> sha_digest;
+    };
+
+    /**
+     * Computes the Merkle tree hash of an object as defined in RFC 6962: leaves are hashed as
+     * HASH(0x00 || leaf), interior nodes as HASH(0x01 || left || right), and a node without a
+     * sibling moves up a level unchanged. The prefixes keep a leaf from passing for an interior
+     * node. An empty object hashes to HASH().
+     *
+     * Up to max_tasks leaves are hashed at a time, on the device through sha_context::hash or
+     * in software through a cpu_sha_backend, where concurrent leaves share the multi-buffer
+     * kernel. Interior nodes are hashed on the calling thread as soon as both children are
+     * known: they are only a few blocks each, far less than a task round trip.
+     *
+     * On a device, each leaf is copied into a mapped staging slot behind its prefix byte. The
+     * slots are allocated and mapped once, so one hasher can be used for many objects (one at a
+     * time).
+     */
+    class merkle_hasher {
+    public:
+        /**
+         * Hash leaves on a device, or in software if it can't hash with the configured algorithm
+         *
+         * @param ctx running SHA context
+         * @param dev device the context runs on, which the staging slots are mapped to
+         * @param cfg leaf size, parallelism, tree retention
+         */
+        merkle_hasher(sha_context &ctx, device const &dev, merkle_config const &cfg = {});
+
+        /**
+         * Hash leaves in software
+         */
+        explicit merkle_hasher(merkle_config const &cfg = {});
+
+        [[nodiscard]] auto on_device() const noexcept -> bool { return device_ != nullptr; }
+        [[nodiscard]] auto config() const noexcept -> merkle_config const & { return cfg_; }
+
+        /**
+         * Throws doca_exception if hashing a leaf fails.
+         *
+         * @param data the object, which has to stay valid until the task completes
+         * @return the tree, or just its root
+         */
+        [[nodiscard]] auto hash(std::span<std::byte const> data) -> boost::cobalt::task<merkle_tree>;
+
+    private:
+        struct device_slots {
+            device_slots(
+                sha_context &ctx,
+                device const &dev,
+                merkle_config const &cfg,
+                std::size_t result_size
+            );
+
+            sha_context *ctx;
+            aligned_blocks src_blocks;
+            aligned_blocks dst_blocks;
+            memory_map src_mmap;
+            memory_map dst_mmap;
+            buffer_inventory inventory;
+            buffer_array src_buffers;
+            buffer_array dst_buffers;
+        };
+
+        struct slot {
+            coro::status_awaitable<> task;
+            /// software only: the leaf's hash state, its first block with the prefix in front,
+            /// and the bytes that are left for finish()
+            std::optional<cpu_sha_state> state;
+            std::array<std::byte, 128> head {};
+            std::span<std::byte const> tail;
+        };
+
+        /**
+         * Start hashing a leaf in a free slot
+         */
+        auto start_leaf(slot &s, std::size_t index, std::span<std::byte const> leaf) -> void;
+
+        /**
+         * @return the hash of a leaf whose task has completed successfully
+         */
+        [[nodiscard]] auto leaf_digest(slot &s, std::size_t index) -> sha_digest;
+
+        merkle_config cfg_;
+        std::unique_ptr<device_slots> device_;
+        std::shared_ptr<cpu_sha_backend> software_;
+    };
+}
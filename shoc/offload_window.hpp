@@ -0,0 +1,254 @@
+#pragma once
+
+#include "context.hpp"
+#include "coro/combinators.hpp"
+#include "error.hpp"
+#include "progress_engine.hpp"
+
+#include <boost/cobalt/generator.hpp>
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Sliding-window offload pipeline: keep a window of tasks in flight over a sequence of inputs
+ * and hand out their results as they complete, e.g.
+ *
+ * auto results = shoc::offload_window(
+ *     engine,
+ *     *compress,
+ *     std::views::iota(0u, chunks),
+ *     [&](std::uint32_t i) { return compress->compress(src[i], dst[i]); },
+ *     { .max_window = max_tasks }
+ * );
+ *
+ * while(auto result = co_await results) {
+ *     // result->index, result->value
+ * }
+ */
+namespace shoc {
+    /**
+     * Configuration of an offload window
+     */
+    struct offload_window_config {
+        /// Upper bound for the number of tasks in flight, usually the context's max_tasks
+        std::size_t max_window = 16;
+        /// Number of tasks in flight to start with; 0 means max_window
+        std::size_t initial_window = 0;
+        /// Lower bound the window never shrinks below
+        std::size_t min_window = 1;
+        /// Upper bound for tasks in flight on the whole engine (including other fibers'),
+        /// as reported by progress_engine::inflight_tasks(). 0 means no limit.
+        std::size_t engine_task_limit = 0;
+        /// Deliver results in input order instead of completion order
+        bool in_order = false;
+    };
+
+    /**
+     * Result of one offloaded task: index of its input in the input sequence and the
+     * awaitable's result.
+     */
+    template<typename T>
+    struct window_result {
+        std::size_t index;
+        T value;
+    };
+
+    /**
+     * Window size control for offload_window. The window shrinks by half when the context's task
+     * queue turns out to be full (its tasks land in the engine's retry queue or complete with
+     * DOCA_ERROR_AGAIN) and grows by one for every window's worth of tasks that completed
+     * without that happening.
+     */
+    class offload_window_controller {
+    public:
+        offload_window_controller(offload_window_config const &cfg):
+            max_ { std::max<std::size_t>(cfg.max_window, 1) },
+            min_ { std::clamp<std::size_t>(cfg.min_window, 1, max_) },
+            target_ { std::clamp(cfg.initial_window == 0 ? max_ : cfg.initial_window, min_, max_) }
+        {}
+
+        /**
+         * @return number of tasks that should be in flight right now
+         */
+        [[nodiscard]] auto target() const noexcept { return target_; }
+
+        /**
+         * The task queue was found full while inflight tasks were in flight.
+         */
+        auto on_congestion(std::size_t inflight) noexcept -> void {
+            target_ = std::max(min_, std::min(target_, inflight) / 2);
+            completions_since_growth_ = 0;
+        }
+
+        /**
+         * A task completed without signs of congestion.
+         */
+        auto on_completion() noexcept -> void {
+            if(target_ < max_ && ++completions_since_growth_ >= target_) {
+                ++target_;
+                completions_since_growth_ = 0;
+            }
+        }
+
+    private:
+        std::size_t max_;
+        std::size_t min_;
+        std::size_t target_;
+        std::size_t completions_since_growth_ = 0;
+    };
+
+    namespace detail {
+        template<typename Inputs, typename Offload>
+        using offload_awaitable_t = std::remove_cvref_t<std::invoke_result_t<Offload&, std::ranges::range_reference_t<Inputs>>>;
+
+        template<typename Inputs, typename Offload>
+        using offload_result_t = std::remove_cvref_t<decltype(std::declval<offload_awaitable_t<Inputs, Offload>&>().await_resume())>;
+    }
+
+    /**
+     * Offload one task per input through offload(input), keeping a window of tasks in flight,
+     * and yield a window_result for each of them, followed by std::nullopt when all inputs are
+     * done.
+     *
+     * The window adapts between config.min_window and config.max_window, see
+     * offload_window_controller, and is further limited by config.engine_task_limit when several
+     * fibers share the engine. Congestion is judged by the tasks of context alone, so that other
+     * contexts on the same engine running full don't shrink this window.
+     *
+     * If an awaitable throws, the remaining tasks in flight are awaited before the exception is
+     * passed on to the consumer, so that no receptable is destroyed while DOCA still references
+     * it. For the same reason, the generator must be consumed until it yields std::nullopt.
+     *
+     * @param engine progress engine the offloaded tasks run on
+     * @param context context that offload submits the tasks to
+     * @param inputs input range; pass std::views::all(container) or similar to avoid a copy
+     * @param offload function that starts a task for an input and returns its awaitable
+     * @param config window configuration
+     */
+    template<std::ranges::input_range Inputs, typename Offload>
+        requires coro::receptable_awaitable<detail::offload_awaitable_t<Inputs, Offload>>
+    auto offload_window(
+        progress_engine_lease engine,
+        context_base const &context,
+        Inputs inputs,
+        Offload offload,
+        offload_window_config config = {}
+    ) -> boost::cobalt::generator<std::optional<window_result<detail::offload_result_t<Inputs, Offload>>>> {
+        using awaitable_type = detail::offload_awaitable_t<Inputs, Offload>;
+        using result_type = detail::offload_result_t<Inputs, Offload>;
+
+        auto controller = offload_window_controller { config };
+        auto slots = std::vector<awaitable_type>(std::max<std::size_t>(config.max_window, 1));
+        auto slot_indices = std::vector<std::size_t>(slots.size());
+        auto submission_order = std::deque<std::size_t>{};
+
+        auto it = std::ranges::begin(inputs);
+        auto end = std::ranges::end(inputs);
+        std::size_t next_index = 0;
+        std::size_t inflight = 0;
+
+        auto engine_has_room = [&] {
+            return config.engine_task_limit == 0 || engine->inflight_tasks() < config.engine_task_limit;
+        };
+
+        // the context's task queue is full, so its tasks wait in the engine's retry queue.
+        auto ctx = context.as_ctx();
+        auto congested = [&] {
+            return engine->retry_queue_depth(ctx) > 0;
+        };
+
+        while(it != end || inflight > 0) {
+            // refill the window with a single doorbell.
+            auto batch = std::optional<submission_batch>{};
+
+            if(it != end && inflight < controller.target()) {
+                batch.emplace(engine);
+            }
+
+            auto congestion_seen = false;
+
+            while(it != end && inflight < controller.target() && (inflight == 0 || engine_has_room())) {
+                auto slot = static_cast<std::size_t>(std::ranges::find_if(slots, [](auto &awaitable) {
+                    return awaitable.receptable_ptr() == nullptr;
+                }) - slots.begin());
+
+                slots[slot] = std::invoke(offload, *it);
+                slot_indices[slot] = next_index++;
+                submission_order.push_back(slot);
+                ++inflight;
+                ++it;
+
+                if(congested()) {
+                    controller.on_congestion(inflight);
+                    congestion_seen = true;
+                }
+            }
+
+            if(batch) {
+                // the batch's last task only reaches the device now.
+                batch.reset();
+
+                if(!congestion_seen && congested()) {
+                    controller.on_congestion(inflight);
+                }
+            }
+
+            std::size_t slot;
+
+            if(config.in_order) {
+                slot = submission_order.front();
+            } else {
+                slot = co_await coro::when_any(slots);
+            }
+
+            std::erase(submission_order, slot);
+            --inflight;
+
+            auto &done = slots[slot];
+            auto index = slot_indices[slot];
+            std::exception_ptr error;
+            std::optional<window_result<result_type>> result;
+
+            try {
+                auto value = co_await done;
+                result = window_result<result_type> { index, std::move(value) };
+            } catch(...) {
+                error = std::current_exception();
+            }
+
+            done = {};
+
+            if(error) {
+                if(inflight > 0) {
+                    co_await coro::when_all(slots);
+                }
+
+                std::rethrow_exception(error);
+            }
+
+            if constexpr(std::same_as<result_type, doca_error_t>) {
+                if(result->value == DOCA_ERROR_AGAIN) {
+                    controller.on_congestion(inflight + 1);
+                } else {
+                    controller.on_completion();
+                }
+            } else {
+                controller.on_completion();
+            }
+
+            co_yield std::move(result);
+        }
+
+        co_return std::nullopt;
+    }
+}
@@ -4,10 +4,8 @@
 #include "logger.hpp"
 
 #include <boost/asio/as_tuple.hpp>
-#include <boost/asio/co_spawn.hpp>
 #include <boost/asio/error.hpp>
 #include <boost/asio/steady_timer.hpp>
-#include <boost/cobalt/detached.hpp>
 #include <boost/cobalt/run.hpp>
 
 #include <fcntl.h>
@@ -15,9 +13,11 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <cassert>
 #include <chrono>
 #include <ranges>
 #include <thread>
+#include <utility>
 
 namespace shoc {
     progress_engine::progress_engine(
@@ -26,7 +26,8 @@ namespace shoc {
     ):
         cfg_ { std::move(cfg) },
         executor_ { executor },
-        notifier_ { std::move(executor) }
+        notifier_ { std::move(executor) },
+        retry_timer_ { executor_ }
     {
         doca_pe *pe;
         enforce_success(doca_pe_create(&pe));
@@ -50,6 +51,24 @@ namespace shoc {
         } else {
             logger->debug("~pe: all contexts stopped.");
         }
+
+        // tasks that never made it to the device won't see a completion callback, so their
+        // waiters have to be told here. Resuming also disposes of orphaned receptables.
+        for(auto &entry : retry_queue_) {
+            cfg_.submission_ops.free(entry.task);
+            failed_submissions_.emplace_back(entry.reportee, DOCA_ERROR_SHUTDOWN);
+        }
+
+        for(auto &held : held_tasks_) {
+            cfg_.submission_ops.free(held.task);
+            failed_submissions_.emplace_back(held.reportee, DOCA_ERROR_SHUTDOWN);
+        }
+
+        retry_queue_.clear();
+        retry_queued_per_ctx_.clear();
+        held_tasks_.clear();
+
+        resume_failed_submissions();
     }
 
     auto progress_engine::notification_handle() const -> doca_event_handle_t {
@@ -82,39 +101,102 @@ namespace shoc {
         connected_contexts_.remove_stopped_context(ctx);
     }
 
+    auto progress_engine::drain_events() -> std::size_t {
+        std::size_t processed = 0;
+
+        while(doca_pe_progress(handle()) > 0) {
+            ++processed;
+
+            // a completion frees up a task slot, so this is the best time to resubmit.
+            if(!retry_queue_.empty()) {
+                drain_retry_queue();
+            }
+        }
+
+        return processed;
+    }
+
+    auto progress_engine::sleep_and_drain_events() -> boost::cobalt::task<bool> {
+        request_notification();
+        logger->trace("progress engine: waiting for notification");
+        ++poll_stats_.sleeps;
+        auto [ ec ] = co_await notifier_.async_wait(
+            boost::asio::posix::descriptor::wait_read,
+            boost::asio::as_tuple(boost::cobalt::use_op)
+        );
+        logger->trace("progress engine: got notification");
+        auto woken = std::chrono::steady_clock::now();
+        clear_notification();
+
+        if(doca_pe_progress(handle()) > 0) {
+            auto elapsed = std::chrono::steady_clock::now() - woken;
+            poll_stats_.total_first_progress_time += elapsed;
+            poll_stats_.max_first_progress_time = std::max<std::chrono::nanoseconds>(poll_stats_.max_first_progress_time, elapsed);
+
+            drain_events();
+        }
+
+        if(ec == boost::asio::error::operation_aborted) {
+            connected_contexts_.stop_all();
+            drain_events();
+            co_return false;
+        } else if(ec) {
+            logger->error("unexpected system error in DOCA event handle: {}", ec.message());
+            co_return false;
+        }
+
+        co_return true;
+    }
+
     auto progress_engine::run() -> boost::cobalt::task<void> {
         active_ = true;
 
+        auto last_completion = std::chrono::steady_clock::now();
+        std::uint32_t empty_spins = 0;
+
+        // a submission batch that is kept alive across a suspension point would otherwise hold
+        // back its last tasks indefinitely. Flushing may resume waiters whose fibers then finish,
+        // so it's done before the loop condition is checked.
+        flush_held_tasks();
+
         while(registered_fibers_ > 0 || !connected_contexts_.empty()) {
             if(cfg_.polling == polling_mode::busy) {
-                std::uint8_t num_popped;
-
-                do {
-                    num_popped = doca_pe_progress(handle());
-                    //logger->trace("processed {} doca tasks", num_popped);
-                } while(num_popped > 0);
-            } else {
-                request_notification();
-                logger->trace("progress engine: waiting for notification");
-                auto [ ec ] = co_await notifier_.async_wait(
-                    boost::asio::posix::descriptor::wait_read,
-                    boost::asio::as_tuple(boost::cobalt::use_op)
-                );
-                logger->trace("progress engine: got notification");
-                clear_notification();
-
-                while(doca_pe_progress(handle()) > 0) {
-                    // intentionally left blank
-                }
+                ++poll_stats_.spins;
 
-                if(ec == boost::asio::error::operation_aborted) {
-                    connected_contexts_.stop_all();
-                    while(doca_pe_progress(handle()) > 0) { }
-                    break;
-                } else if(ec) {
-                    logger->error("unexpected system error in DOCA event handle: {}", ec.message());
-                    break;
+                if(drain_events() == 0) {
+                    ++poll_stats_.empty_spins;
+                }
+            } else if(cfg_.polling == polling_mode::adaptive) {
+                // spin while completions are coming in or have come in recently; once the spin
+                // budget is exhausted, fall back to sleeping on the notification handle like
+                // polling_mode::epoll would.
+                ++poll_stats_.spins;
+
+                auto now = std::chrono::steady_clock::now();
+
+                if(drain_events() > 0) {
+                    last_completion = now;
+                    empty_spins = 0;
+                } else {
+                    ++poll_stats_.empty_spins;
+                    ++empty_spins;
+
+                    // a zero duration or iteration count disables that part of the budget
+                    bool budget_exhausted =
+                        (cfg_.adaptive_spin_duration.count() != 0 && now - last_completion >= cfg_.adaptive_spin_duration)
+                        || (cfg_.adaptive_spin_iterations != 0 && empty_spins >= cfg_.adaptive_spin_iterations);
+
+                    if(budget_exhausted) {
+                        if(!co_await sleep_and_drain_events()) {
+                            break;
+                        }
+
+                        last_completion = std::chrono::steady_clock::now();
+                        empty_spins = 0;
+                    }
                 }
+            } else if(!co_await sleep_and_drain_events()) {
+                break;
             }
 
             // yield before re-checking fiber states is necessary because some
@@ -122,6 +204,8 @@ namespace shoc {
             // this happens because some operations complain when they are
             // done directly from a callback (esp. eth_txq)
             co_await yield();
+
+            flush_held_tasks();
         }
 
         active_ = false;
@@ -144,53 +228,229 @@ namespace shoc {
         }
     }
 
+    auto progress_engine::begin_batch() -> void {
+        ++batch_depth_;
+    }
+
+    auto progress_engine::end_batch() -> void {
+        assert(batch_depth_ > 0);
+
+        if(--batch_depth_ == 0) {
+            flush_held_tasks();
+        }
+    }
+
+    auto progress_engine::flush_held_tasks() -> void {
+        while(!held_tasks_.empty()) {
+            auto held = held_tasks_.back();
+            held_tasks_.pop_back();
+
+            submit_task_with_retries(held.task, held.reportee, DOCA_TASK_SUBMIT_FLAG_FLUSH);
+        }
+
+        // the waiters of held tasks may well be suspended already, either because they didn't
+        // wait for the batch to end or because we're flushing from run().
+        resume_failed_submissions();
+    }
+
     auto progress_engine::submit_task(
         doca_task *task,
         coro::error_receptable *reportee
     ) -> void {
+        if(batch_depth_ == 0) {
+            submit_task_with_retries(task, reportee, DOCA_TASK_SUBMIT_FLAG_FLUSH);
+        } else {
+            hold_task(task, reportee);
+        }
+
+        resume_failed_submissions();
+    }
+
+    auto progress_engine::hold_task(
+        doca_task *task,
+        coro::error_receptable *reportee
+    ) -> void {
+        auto ctx = cfg_.submission_ops.get_ctx(task);
+        auto held = std::ranges::find(held_tasks_, ctx, &held_submission::ctx);
+
+        if(held == held_tasks_.end()) {
+            held_tasks_.push_back({ task, reportee, ctx });
+            return;
+        }
+
+        // the context's previously held-back task can now be submitted without ringing the
+        // doorbell because we know another one follows it.
+        auto deferred = std::exchange(*held, held_submission { task, reportee, ctx });
+
+        if(has_queued_retries(ctx)) {
+            enqueue_retry(deferred.task, deferred.reportee);
+            return;
+        }
+
+        auto err = cfg_.submission_ops.submit(deferred.task, DOCA_TASK_SUBMIT_FLAG_NONE);
+
+        if(err == DOCA_ERROR_AGAIN) {
+            // queue is full: ring the doorbell for the tasks deferred before this one and go
+            // through the regular retry logic.
+            submit_task_with_retries(deferred.task, deferred.reportee, DOCA_TASK_SUBMIT_FLAG_FLUSH);
+
+            if(has_queued_retries(ctx)) {
+                // the held task can't overtake the queued one anyway, so don't hold it back
+                // until the batch ends.
+                held_tasks_.erase(held);
+                enqueue_retry(task, reportee);
+            }
+        } else if(err != DOCA_SUCCESS) {
+            logger->debug("failed submitting: {}", doca_error_get_descr(err));
+            cfg_.submission_ops.free(deferred.task);
+            failed_submissions_.emplace_back(deferred.reportee, err);
+        }
+    }
+
+    auto progress_engine::submit_task_with_retries(
+        doca_task *task,
+        coro::error_receptable *reportee,
+        std::uint32_t flags
+    ) -> void {
+        if(has_queued_retries(cfg_.submission_ops.get_ctx(task))) {
+            // don't overtake tasks of the same context that are already waiting.
+            enqueue_retry(task, reportee);
+            return;
+        }
+
         doca_error_t err;
         std::uint32_t attempts = 0;
 
         do {
-            err = doca_task_submit(task);
+            err = cfg_.submission_ops.submit(task, flags);
             ++attempts;
         } while(err == DOCA_ERROR_AGAIN && attempts <= cfg_.immediate_submission_attempts);
         
         if(err == DOCA_ERROR_AGAIN) {
-            delayed_resubmission(task, reportee, cfg_.resubmission_attempts, cfg_.resubmission_interval, {}, executor_);
+            enqueue_retry(task, reportee);
         } else if(err != DOCA_SUCCESS) {
             logger->debug("failed submitting: {}", doca_error_get_descr(err));
-            doca_task_free(task);
+            cfg_.submission_ops.free(task);
+            failed_submissions_.emplace_back(reportee, err);
+        }
+    }
+
+    auto progress_engine::resume_failed_submissions() -> void {
+        // waiters may submit new tasks when resumed, and those may fail in turn. They are
+        // appended to the list and reported by the outermost call.
+        if(resuming_failed_submissions_) {
+            return;
+        }
+
+        resuming_failed_submissions_ = true;
+
+        for(std::size_t i = 0; i < failed_submissions_.size(); ++i) {
+            auto [reportee, err] = failed_submissions_[i];
             reportee->set_error(err);
+            reportee->resume();
         }
+
+        failed_submissions_.clear();
+        resuming_failed_submissions_ = false;
     }
 
-    auto progress_engine::delayed_resubmission(
+    auto progress_engine::enqueue_retry(
         doca_task *task,
-        coro::error_receptable *reportee,
-        std::uint32_t attempts,
-        std::chrono::microseconds interval,
-        boost::asio::executor_arg_t,
-        boost::cobalt::executor executor
-    ) -> boost::cobalt::detached {
-        using steady_timer = boost::cobalt::use_op_t::as_default_on_t<boost::asio::steady_timer>;
+        coro::error_receptable *reportee
+    ) -> void {
+        auto ctx = cfg_.submission_ops.get_ctx(task);
+        auto deadline = std::chrono::steady_clock::now() + cfg_.resubmission_interval * cfg_.resubmission_attempts;
 
-        doca_error_t err;
-        auto timer = steady_timer(std::move(executor));
+        retry_queue_.push_back({ task, reportee, ctx, deadline });
+        ++retry_queued_per_ctx_[ctx];
 
-        do {
-            timer.expires_after(interval);
-            co_await timer.async_wait();
+        ++submit_stats_.queued;
+        submit_stats_.retry_queue_depth = retry_queue_.size();
+        submit_stats_.max_retry_queue_depth = std::max(submit_stats_.max_retry_queue_depth, retry_queue_.size());
 
-            logger->trace("resubmitting task after delay of {} us, {} attempts left", interval.count(), attempts);
+        arm_retry_timer();
+    }
 
-            err = doca_task_submit(task);
-            --attempts;
-        } while(err == DOCA_ERROR_AGAIN && attempts > 0 && !connected_contexts_.empty());
+    auto progress_engine::drain_retry_queue() -> void {
+        if(retry_queue_.empty()) {
+            return;
+        }
 
-        if(err != DOCA_SUCCESS) {
-            doca_task_free(task);
-            reportee->set_error(err);
+        auto now = std::chrono::steady_clock::now();
+        auto is_blocked = [this](doca_ctx *ctx) {
+            return std::ranges::find(blocked_ctxs_, ctx) != blocked_ctxs_.end();
+        };
+
+        auto remove_from_ctx_count = [this](doca_ctx *ctx) {
+            auto it = retry_queued_per_ctx_.find(ctx);
+
+            if(--it->second == 0) {
+                retry_queued_per_ctx_.erase(it);
+            }
+        };
+
+        blocked_ctxs_.clear();
+
+        // compact the queue in place: entries that stay are moved to the front in their
+        // original order. Once the first task of a context was rejected with DOCA_ERROR_AGAIN,
+        // the context's other tasks are not attempted to preserve submission order.
+        std::size_t kept = 0;
+        std::size_t i = 0;
+
+        for(; i < retry_queue_.size(); ++i) {
+            if(blocked_ctxs_.size() == retry_queued_per_ctx_.size()) {
+                // every context that has tasks waiting is blocked, nothing more to do.
+                break;
+            }
+
+            auto entry = retry_queue_[i];
+
+            if(!is_blocked(entry.ctx)) {
+                auto err = cfg_.submission_ops.submit(entry.task, DOCA_TASK_SUBMIT_FLAG_FLUSH);
+
+                if(err == DOCA_SUCCESS) {
+                    ++submit_stats_.resubmitted;
+                    remove_from_ctx_count(entry.ctx);
+                    continue;
+                } else if(err != DOCA_ERROR_AGAIN || now >= entry.deadline) {
+                    logger->debug("failed resubmitting: {}", doca_error_get_descr(err));
+                    ++submit_stats_.failed;
+                    cfg_.submission_ops.free(entry.task);
+                    failed_submissions_.emplace_back(entry.reportee, err);
+                    remove_from_ctx_count(entry.ctx);
+                    continue;
+                }
+
+                blocked_ctxs_.push_back(entry.ctx);
+            }
+
+            retry_queue_[kept++] = entry;
         }
+
+        retry_queue_.erase(retry_queue_.begin() + kept, retry_queue_.begin() + i);
+        submit_stats_.retry_queue_depth = retry_queue_.size();
+
+        // resume failed waiters only after we're done with the queue because they might
+        // submit new tasks.
+        resume_failed_submissions();
+    }
+
+    auto progress_engine::arm_retry_timer() -> void {
+        if(retry_timer_armed_ || retry_queue_.empty()) {
+            return;
+        }
+
+        retry_timer_armed_ = true;
+        retry_timer_.expires_after(cfg_.resubmission_interval);
+        retry_timer_.async_wait([this](boost::system::error_code ec) {
+            if(ec == boost::asio::error::operation_aborted) {
+                // timer destroyed with the engine, don't touch it anymore.
+                return;
+            }
+
+            retry_timer_armed_ = false;
+            drain_retry_queue();
+            arm_retry_timer();
+        });
     }
 }
@@ -2,6 +2,7 @@
 
 #include "asio_descriptor.hpp"
 #include "context.hpp"
+#include "coro/receptable_pool.hpp"
 #include "coro/status_awaitable.hpp"
 #include "coro/value_awaitable.hpp"
 #include "error.hpp"
@@ -10,6 +11,7 @@
 #include <doca_pe.h>
 
 #include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/cobalt/detached.hpp>
 #include <boost/cobalt/task.hpp>
 #include <boost/cobalt/this_thread.hpp>
@@ -19,10 +21,12 @@
 #include <concepts>
 #include <coroutine>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <queue>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -31,7 +35,19 @@ namespace shoc {
         /// Use epoll to wait for events and sleep when idle
         epoll,
         /// Do not wait for events, just busily check and recheck and recheck
-        busy
+        busy,
+        /// Busily poll for a while after the last completion, then fall back to epoll and sleep
+        adaptive
+    };
+
+    /**
+     * The SDK functions through which the progress engine submits tasks. Only meant to be
+     * replaced in tests, which need submission errors on demand.
+     */
+    struct task_submission_ops {
+        doca_error_t (*submit)(doca_task *task, std::uint32_t flags) = doca_task_submit_ex;
+        doca_ctx *(*get_ctx)(doca_task const *task) = doca_task_get_ctx;
+        void (*free)(doca_task *task) = doca_task_free;
     };
 
     /**
@@ -40,12 +56,57 @@ namespace shoc {
     struct progress_engine_config {
         /// How often to immediately reattempt task submission when doca_task_submit returns DOCA_ERROR_AGAIN
         std::uint32_t immediate_submission_attempts = 64;
-        /// How often to reattempt task submission in regular intervals after the immediate resubmission attempts are exhausted
+        /// How many resubmission intervals a task may wait in the retry queue before it is failed
         std::uint32_t resubmission_attempts = 64;
-        /// Delay between resubmission attempts
+        /// Interval of the fallback timer that drains the retry queue when no events come in
         std::chrono::microseconds resubmission_interval = std::chrono::milliseconds(1);
         /// How to wait for events, see polling_mode
         polling_mode polling = polling_mode::epoll;
+        /// polling_mode::adaptive: how long to keep spinning after the last completion before going to sleep,
+        /// 0 for no time limit (only adaptive_spin_iterations applies; with both 0, the engine never sleeps)
+        std::chrono::microseconds adaptive_spin_duration = std::chrono::microseconds(50);
+        /// polling_mode::adaptive: how many consecutive empty polls to allow before going to sleep, 0 for no limit
+        std::uint32_t adaptive_spin_iterations = 0;
+        /// Task submission functions, see task_submission_ops
+        task_submission_ops submission_ops;
+    };
+
+    /**
+     * Counters for the retry queue in which tasks wait that could not be submitted immediately
+     * because the submission queue was full (DOCA_ERROR_AGAIN).
+     */
+    struct submission_stats {
+        /// number of tasks currently waiting in the retry queue
+        std::size_t retry_queue_depth = 0;
+        /// highest number of tasks that were waiting in the retry queue at the same time
+        std::size_t max_retry_queue_depth = 0;
+        /// number of tasks that were put in the retry queue
+        std::uint64_t queued = 0;
+        /// number of tasks that were successfully resubmitted from the retry queue
+        std::uint64_t resubmitted = 0;
+        /// number of tasks from the retry queue that failed, e.g. because they passed their deadline
+        std::uint64_t failed = 0;
+    };
+
+    /**
+     * Counters for the event loop, mainly to tune the adaptive polling budget
+     */
+    struct polling_stats {
+        /// number of polling rounds without sleeping in between
+        std::uint64_t spins = 0;
+        /// number of polling rounds in which no completion was processed
+        std::uint64_t empty_spins = 0;
+        /// number of times the event loop went to sleep on the notification handle
+        std::uint64_t sleeps = 0;
+        /**
+         * accumulated time from waking up on a notification until the first doca_pe_progress call
+         * that processed an event returned. Completion callbacks resume the waiting coroutines
+         * inline, so this includes the user code they run until they suspend again; it is an
+         * upper bound of the wakeup latency rather than the latency itself.
+         */
+        std::chrono::nanoseconds total_first_progress_time { 0 };
+        /// longest single first-progress time, see total_first_progress_time
+        std::chrono::nanoseconds max_first_progress_time { 0 };
     };
 
     /**
@@ -79,6 +140,39 @@ namespace shoc {
         [[nodiscard]] auto handle() const { return handle_.get(); }
         [[nodiscard]] auto inflight_tasks() const -> std::size_t;
 
+        /**
+         * @return event loop counters (spins, sleeps, time to the first progress after a wakeup)
+         */
+        [[nodiscard]] auto poll_stats() const -> polling_stats const & { return poll_stats_; }
+
+        /**
+         * @return retry queue counters, including the current queue depth
+         */
+        [[nodiscard]] auto submit_stats() const -> submission_stats const & { return submit_stats_; }
+
+        /**
+         * @return number of tasks of a single context waiting in the retry queue
+         */
+        [[nodiscard]] auto retry_queue_depth(doca_ctx *ctx) const -> std::size_t {
+            auto it = retry_queued_per_ctx_.find(ctx);
+            return it == retry_queued_per_ctx_.end() ? 0 : it->second;
+        }
+
+        /**
+         * Pool from which the receptables of offloaded tasks are allocated. Every context reserves
+         * its own share according to its max_tasks setting, so that offloading does not need to
+         * go to the heap in the steady state. Pooled receptables point back to the pool, so
+         * awaitables of offloaded tasks must not outlive the engine.
+         */
+        [[nodiscard]] auto receptables() -> coro::receptable_pool& { return receptables_; }
+
+        /**
+         * @return allocation counters of the receptable pool
+         */
+        [[nodiscard]] auto receptable_stats() const -> coro::receptable_pool_stats const & {
+            return receptables_.stats();
+        }
+
         auto connect(context_base *ctx) -> void;
         auto signal_stopped_child(context_base *ctx) -> void override;
 
@@ -111,6 +205,7 @@ namespace shoc {
 
     private:
         friend class progress_engine_lease;
+        friend class submission_batch;
 
         template<std::derived_from<context_base> Context, typename... Args>
         auto create_context(Args&&... args) {
@@ -121,44 +216,137 @@ namespace shoc {
         auto register_fiber() -> void;
         auto deregister_fiber() -> void;
 
+        auto begin_batch() -> void;
+        auto end_batch() -> void;
+
+        /**
+         * In a submission batch: hold the task back until the next task for the same context
+         * comes in or the batch ends, and submit the context's previously held task without
+         * ringing the doorbell.
+         */
+        auto hold_task(
+            doca_task *task,
+            coro::error_receptable *reportee
+        ) -> void;
+
+        /**
+         * Submit the tasks held back by the current submission batch (if any) with the flush
+         * flag, ringing each context's doorbell for its held task and all tasks deferred before it.
+         */
+        auto flush_held_tasks() -> void;
+
+        /**
+         * Submit a task with the given doca_task_submit_ex flags, retrying as configured
+         * in progress_engine_config if the submission queue is full. If submission fails for
+         * good, the failure is recorded in failed_submissions_ for resume_failed_submissions.
+         */
+        auto submit_task_with_retries(
+            doca_task *task,
+            coro::error_receptable *reportee,
+            std::uint32_t flags
+        ) -> void;
+
         [[nodiscard]] auto notification_handle() const -> doca_event_handle_t;
         auto request_notification() const -> void;
         auto clear_notification() const -> void;
 
         /**
-         * Some tasks can only be submitted when conditions are right, notably comch producer's
-         * send task can only be offloaded when there's a remote consumer waiting for it. In this
-         * case we might need to spin for a while to offload the task. Our strategy here is to
-         * immediately retry a couple of times (as in the DOCA comch samples) as configured in the
-         * progress_engine_config, then retry in regular intervals for another couple of times.
+         * Call doca_pe_progress until it reports no further progress.
+         *
+         * @return the number of processed events
+         */
+        auto drain_events() -> std::size_t;
+
+        /**
+         * Sleep on the notification handle until events come in, then process them.
          *
-         * delayed_submission is the background fiber that resubmits in regular intervals.
+         * @return false if the event loop should terminate
+         */
+        auto sleep_and_drain_events() -> boost::cobalt::task<bool>;
+
+        /**
+         * Some tasks can only be submitted when conditions are right, notably comch producer's
+         * send task can only be offloaded when there's a remote consumer waiting for it. Our
+         * strategy here is to immediately retry a couple of times (as in the DOCA comch samples)
+         * as configured in the progress_engine_config, then put the task in the retry queue.
          *
-         * @param task DOCA task to resubmit
-         * @param reportee receptable to report errors to in case of failure
-         * @param attempts how often to attempt resubmission
-         * @param delay Delay between resubmission attempts
-         * @param exec_tag Empty struct, tells boost.cobalt that the next argument is the executor
-        *                  for the coroutine.
-         * @param executor The Boost.Cobalt executor associated with the progress engine. Why this
-         *                 needs to be explictly passed is a bit of a mystery to me, but at time of
-         *                 writing, without it Boost.Cobalt fails to find the thread-local executor.
+         * The retry queue is drained whenever events have been processed (because that is when
+         * task slots free up) and, as a fallback, in regular intervals by a timer. Tasks are
+         * resubmitted in FIFO order, and tasks for a context that already has tasks waiting in
+         * the retry queue are queued behind them, so that submission order is preserved per
+         * context. A task that cannot be submitted before its deadline is failed with
+         * DOCA_ERROR_AGAIN.
          */
-        auto delayed_resubmission(
+        auto enqueue_retry(
             doca_task *task,
-            coro::error_receptable *reportee,
-            std::uint32_t attempts,
-            std::chrono::microseconds delay,
-            boost::asio::executor_arg_t exec_tag,
-            boost::cobalt::executor executor
-        ) -> boost::cobalt::detached;
+            coro::error_receptable *reportee
+        ) -> void;
+
+        /**
+         * Report recorded submission failures to their waiters. This is done only after the
+         * engine's bookkeeping is complete because resumed waiters might submit new tasks.
+         */
+        auto resume_failed_submissions() -> void;
 
+        /**
+         * Attempt to resubmit the tasks in the retry queue
+         */
+        auto drain_retry_queue() -> void;
+
+        /**
+         * Arm the fallback timer for the retry queue if it's non-empty and the timer isn't already armed.
+         */
+        auto arm_retry_timer() -> void;
+
+        /**
+         * @return true if tasks for ctx are waiting in the retry queue
+         */
+        [[nodiscard]] auto has_queued_retries(doca_ctx *ctx) const -> bool {
+            return retry_queued_per_ctx_.contains(ctx);
+        }
+
+        // declared first so that it outlives everything that might hold receptables
+        coro::receptable_pool receptables_;
         unique_handle<doca_pe, doca_pe_destroy> handle_;
         progress_engine_config cfg_;
 
         boost::cobalt::executor executor_;
         asio_descriptor<boost::cobalt::executor> notifier_;
         dependent_contexts<context_base> connected_contexts_;
+        polling_stats poll_stats_;
+
+        struct pending_submission {
+            doca_task *task;
+            coro::error_receptable *reportee;
+            doca_ctx *ctx;
+            std::chrono::steady_clock::time_point deadline;
+        };
+
+        std::deque<pending_submission> retry_queue_;
+        std::unordered_map<doca_ctx*, std::size_t> retry_queued_per_ctx_;
+        // scratch space for drain_retry_queue, kept around to avoid reallocation
+        std::vector<doca_ctx*> blocked_ctxs_;
+        boost::asio::steady_timer retry_timer_;
+        bool retry_timer_armed_ = false;
+        submission_stats submit_stats_;
+
+        // submission batching: doorbells are per context, so of every context's tasks in a batch,
+        // all but the last are submitted without ringing the doorbell. The last one is held back
+        // until the batch ends and then flushes all of them.
+        struct held_submission {
+            doca_task *task;
+            coro::error_receptable *reportee;
+            doca_ctx *ctx;
+        };
+
+        int batch_depth_ = 0;
+        std::vector<held_submission> held_tasks_;
+
+        // submissions that failed for good and whose waiters are yet to be told, kept around
+        // to avoid reallocation
+        std::vector<std::pair<coro::error_receptable*, doca_error_t>> failed_submissions_;
+        bool resuming_failed_submissions_ = false;
+
         int registered_fibers_ = 0;
         bool active_ = false;
     };
@@ -242,6 +430,53 @@ namespace shoc {
         progress_engine *engine_;
     };
 
+    /**
+     * Scope in which task submissions to a progress engine are batched: tasks offloaded while a
+     * submission_batch is alive are enqueued without ringing the doorbell, and each context's
+     * doorbell is rung once for all of its tasks when the batch ends. This saves a lot of
+     * doorbell overhead when many small tasks are offloaded in a row, e.g.
+     *
+     * {
+     *     auto batch = shoc::submission_batch { engine };
+     *
+     *     for(auto i : std::views::iota(0u, n)) {
+     *         pending[i] = dma->memcpy(src[i], dst[i]);
+     *     }
+     * }
+     *
+     * for(auto &p : pending) {
+     *     co_await p;
+     * }
+     *
+     * Batches can be nested, in which case only the outermost one rings the doorbell. Do not
+     * co_await tasks from a batch before the batch is over; as a safety net, the progress engine
+     * flushes pending batched tasks before it processes events.
+     */
+    class submission_batch {
+    public:
+        explicit submission_batch(progress_engine *engine):
+            engine_ { engine }
+        {
+            engine_->begin_batch();
+        }
+
+        explicit submission_batch(progress_engine_lease const &engine):
+            submission_batch { engine.get() }
+        {}
+
+        submission_batch(submission_batch const &) = delete;
+        submission_batch(submission_batch &&) = delete;
+        submission_batch &operator=(submission_batch const &) = delete;
+        submission_batch &operator=(submission_batch &&) = delete;
+
+        ~submission_batch() {
+            engine_->end_batch();
+        }
+
+    private:
+        progress_engine *engine_;
+    };
+
     namespace detail {
         template<auto AsTask>
         struct deduce_as_task_arg_type {};
@@ -349,7 +584,11 @@ namespace shoc {
             progress_engine *engine,
             Args&&... args
         ) {
-            return status_offload<AllocInit, AsTask>(engine, coro::status_awaitable<>::create_space(), std::forward<Args>(args)...);
+            return status_offload<AllocInit, AsTask>(
+                engine,
+                coro::status_awaitable<>::create_space(engine->receptables()),
+                std::forward<Args>(args)...
+            );
         }
     }
 
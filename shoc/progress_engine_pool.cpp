@@ -0,0 +1,126 @@
+#include "progress_engine_pool.hpp"
+
+#include "logger.hpp"
+
+#include <boost/cobalt/run.hpp>
+#include <boost/cobalt/task.hpp>
+#include <boost/cobalt/this_thread.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace shoc {
+    progress_engine_pool::progress_engine_pool(progress_engine_pool_config cfg):
+        cfg_ { std::move(cfg) }
+    {
+        enforce(cfg_.engine_count > 0, DOCA_ERROR_INVALID_VALUE);
+
+        auto ready = std::latch { static_cast<std::ptrdiff_t>(cfg_.engine_count) };
+
+        shards_.reserve(cfg_.engine_count);
+
+        for(std::size_t i = 0; i < cfg_.engine_count; ++i) {
+            auto cpu = std::optional<int>{};
+
+            if(cfg_.pin_threads) {
+                cpu = i < cfg_.cpus.size() ? cfg_.cpus[i] : static_cast<int>(i);
+            }
+
+            auto &new_shard = shards_.emplace_back(std::make_unique<shard>());
+            new_shard->thread = std::thread { &progress_engine_pool::shard_main, this, new_shard.get(), cpu, &ready };
+        }
+
+        // engines and their executors are created in the shard threads, so wait until all
+        // of them are there before anyone can post work to them.
+        ready.wait();
+
+        auto failed = std::ranges::find_if(shards_, [](auto const &s) { return s->startup_error != nullptr; });
+
+        if(failed != shards_.end()) {
+            // the destructor won't run, so wind down the engines that did start here.
+            shutdown();
+            std::rethrow_exception((*failed)->startup_error);
+        }
+    }
+
+    progress_engine_pool::~progress_engine_pool() {
+        shutdown();
+    }
+
+    auto progress_engine_pool::shutdown() -> void {
+        {
+            // waits for posts that are under way, see post_to
+            auto lock = std::unique_lock { shutdown_mutex_ };
+
+            if(shutting_down_.exchange(true, std::memory_order_acq_rel)) {
+                return;
+            }
+        }
+
+        for(auto &s : shards_) {
+            // a shard whose engine could not be created has no executor, and its thread is done
+            if(s->started) {
+                boost::asio::post(s->executor, [s = s.get()] { s->keepalive.clear(); });
+            }
+        }
+
+        for(auto &s : shards_) {
+            if(s->thread.joinable()) {
+                s->thread.join();
+            }
+        }
+    }
+
+    auto progress_engine_pool::shard_main(
+        shard *self,
+        std::optional<int> cpu,
+        std::latch *ready
+    ) -> void {
+        if(cpu.has_value()) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(*cpu, &cpuset);
+
+            auto err = pthread_setaffinity_np(pthread_self(), sizeof cpuset, &cpuset);
+
+            if(err != 0) {
+                logger->warn("unable to pin progress engine thread to cpu {}, error code {}", *cpu, err);
+            }
+        }
+
+        auto main_task = [](
+            shard *self,
+            progress_engine_config cfg,
+            std::latch *ready
+        ) -> boost::cobalt::task<void> {
+            auto engine = progress_engine { cfg, boost::cobalt::this_thread::get_executor() };
+
+            self->engine = &engine;
+            self->executor = engine.executor();
+            self->keepalive = progress_engine_lease { &engine };
+            self->started = true;
+            ready->count_down();
+
+            co_await engine.run();
+
+            self->engine = nullptr;
+        };
+
+        try {
+            boost::cobalt::run(main_task(self, cfg_.engine_config, ready));
+        } catch(std::exception &e) {
+            logger->error("progress engine thread finished with error: {}", e.what());
+
+            if(!self->started) {
+                // the engine could not be created. Hand the error to the constructor rather
+                // than leaving it waiting for this shard forever.
+                self->startup_error = std::current_exception();
+                ready->count_down();
+            }
+        }
+    }
+}
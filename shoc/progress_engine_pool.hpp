@@ -0,0 +1,154 @@
+#pragma once
+
+#include "progress_engine.hpp"
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace shoc {
+    /**
+     * Configuration for a progress_engine_pool
+     */
+    struct progress_engine_pool_config {
+        /// Number of progress engines (and threads) in the pool
+        std::size_t engine_count = std::max(1u, std::thread::hardware_concurrency());
+        /// Whether to pin each engine's thread to a CPU core
+        bool pin_threads = true;
+        /// CPU core for each engine. If shorter than engine_count, engine i is pinned to core i.
+        std::vector<int> cpus;
+        /// Configuration for the individual engines
+        progress_engine_config engine_config;
+    };
+
+    /**
+     * Pool of progress engines, each running in a thread of its own with its own Boost.Cobalt
+     * executor. Because doca_pe is not threadsafe, an engine and all contexts connected to it
+     * can only be used from the engine's thread; the pool takes care of that by handing out
+     * leases only inside the shard that owns the engine.
+     *
+     * Work is handed to a shard with post(), which is threadsafe and can be used from outside
+     * the pool as well as from one shard to another. The posted function is called in the
+     * target shard's thread with a lease on the shard's engine and will typically start a
+     * detached fiber, e.g.
+     *
+     * pool.post([](shoc::progress_engine_lease engine) { return compress_file(engine, ...); });
+     *
+     * Placement is either round-robin (post(fn)), by key (post_by_key(key, fn), so that work
+     * with the same key always ends up on the same engine), or explicit (post_to(shard, fn)).
+     *
+     * Upon destruction, the pool waits for all fibers holding leases to finish and for all
+     * contexts to be stopped before joining the threads.
+     */
+    class progress_engine_pool {
+    public:
+        progress_engine_pool(progress_engine_pool_config cfg = {});
+        ~progress_engine_pool();
+
+        progress_engine_pool(progress_engine_pool const &) = delete;
+        progress_engine_pool(progress_engine_pool &&) = delete;
+        progress_engine_pool &operator=(progress_engine_pool const &) = delete;
+        progress_engine_pool &operator=(progress_engine_pool &&) = delete;
+
+        /**
+         * @return number of engines in the pool
+         */
+        [[nodiscard]] auto size() const noexcept { return shards_.size(); }
+
+        /**
+         * @return the shard that work with a given key is placed on by post_by_key
+         */
+        [[nodiscard]] auto shard_for(std::size_t key) const noexcept -> std::size_t {
+            return std::hash<std::size_t>{}(key) % size();
+        }
+
+        /**
+         * Run fn with a lease on the engine of a specific shard, in that shard's thread. Threadsafe.
+         *
+         * @param shard index of the target engine
+         * @param fn function that accepts a progress_engine_lease
+         */
+        template<std::invocable<progress_engine_lease> Fn>
+        auto post_to(std::size_t shard, Fn &&fn) -> void {
+            // held until the work is posted, so that shutdown can't wind down the target's
+            // thread (and executor) in between.
+            auto lock = std::shared_lock { shutdown_mutex_ };
+
+            enforce(shard < size() && !shutting_down_.load(std::memory_order_acquire), DOCA_ERROR_BAD_STATE);
+
+            auto target = shards_[shard].get();
+
+            boost::asio::post(
+                target->executor,
+                [target, fn = std::forward<Fn>(fn)]() mutable {
+                    // only read in the shard's thread, which is the one that sets it
+                    if(target->engine == nullptr) {
+                        logger->error("work posted to progress engine pool after its engine finished");
+                        return;
+                    }
+
+                    try {
+                        static_cast<void>(fn(progress_engine_lease { target->engine }));
+                    } catch(std::exception &e) {
+                        logger->error("work posted to progress engine pool failed: {}", e.what());
+                    }
+                }
+            );
+        }
+
+        /**
+         * Run fn with a lease on the next engine in round-robin order. Threadsafe.
+         */
+        template<std::invocable<progress_engine_lease> Fn>
+        auto post(Fn &&fn) -> void {
+            auto shard = next_shard_.fetch_add(1, std::memory_order_relaxed) % size();
+            post_to(shard, std::forward<Fn>(fn));
+        }
+
+        /**
+         * Run fn with a lease on the engine that is responsible for key. Threadsafe.
+         */
+        template<std::invocable<progress_engine_lease> Fn>
+        auto post_by_key(std::size_t key, Fn &&fn) -> void {
+            post_to(shard_for(key), std::forward<Fn>(fn));
+        }
+
+        /**
+         * Release the pool's own hold on the engines, wait until all of them have wound down,
+         * and join their threads. Called by the destructor; no work can be posted afterwards.
+         */
+        auto shutdown() -> void;
+
+    private:
+        struct shard {
+            std::thread thread;
+            progress_engine *engine = nullptr;
+            boost::cobalt::executor executor;
+            // keeps the engine running while the pool is alive. Only touched in the shard's thread.
+            progress_engine_lease keepalive;
+            // set by the shard's thread before it counts down the ready latch
+            bool started = false;
+            std::exception_ptr startup_error;
+        };
+
+        auto shard_main(shard *self, std::optional<int> cpu, std::latch *ready) -> void;
+
+        progress_engine_pool_config cfg_;
+        std::vector<std::unique_ptr<shard>> shards_;
+        std::atomic<std::size_t> next_shard_ = 0;
+        std::atomic<bool> shutting_down_ = false;
+        std::shared_mutex shutdown_mutex_;
+    };
+}
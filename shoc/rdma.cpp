@@ -131,7 +131,7 @@ namespace shoc {
             doca_rdma_task_receive_as_task
         >(
             parent_->engine(),
-            coro::status_awaitable<std::uint32_t>::create_space(immediate_data),
+            coro::status_awaitable<std::uint32_t>::create_space(parent_->engine()->receptables(), immediate_data),
             parent_->handle(),
             dest.handle()
         );
@@ -358,6 +358,9 @@ namespace shoc {
             &plain_status_callback<doca_rdma_task_remote_net_sync_event_notify_add_as_task>,
             config.max_tasks
         ));
+
+        reserve_receptables<coro::status_awaitable<>::payload_type>(config.max_tasks);
+        reserve_receptables<coro::status_awaitable<std::uint32_t>::payload_type>(config.max_tasks);
     }
 
     auto rdma_context::receive_completion_callback(
@@ -29,6 +29,8 @@ namespace shoc {
             plain_status_callback<doca_sha_task_partial_hash_as_task>,
             max_tasks
         ));
+
+        reserve_receptables<coro::status_awaitable<>::payload_type>(2 * max_tasks);
     }
 
     auto sha_context::hash(
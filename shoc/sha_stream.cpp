@@ -0,0 +1,275 @@
+#include "sha_stream.hpp"
+
+#include "buffer.hpp"
+#include "buffer_inventory.hpp"
+#include "error.hpp"
+#include "logger.hpp"
+#include "memory_map.hpp"
+
+#include <boost/cobalt/detached.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+
+namespace shoc {
+    namespace {
+        /**
+         * Below this size, hashing on the calling thread is cheaper than the round trip through the
+         * worker pool.
+         */
+        constexpr auto inline_absorb_limit = std::size_t { 1024 };
+
+        struct partial_hash_caps {
+            std::uint32_t block_size = 0;
+            std::uint32_t min_dst_size = 0;
+        };
+
+        auto partial_hash_caps_of(device const &dev, doca_sha_algorithm algorithm) -> std::optional<partial_hash_caps> {
+            auto devinfo = dev.as_devinfo();
+
+            if(doca_sha_cap_task_partial_hash_get_supported(devinfo, algorithm) != DOCA_SUCCESS) {
+                return std::nullopt;
+            }
+
+            auto caps = partial_hash_caps {};
+            enforce_success(doca_sha_cap_get_partial_hash_block_size(devinfo, algorithm, &caps.block_size));
+            enforce_success(doca_sha_cap_get_min_dst_buf_size(devinfo, algorithm, &caps.min_dst_size));
+
+            return caps;
+        }
+    }
+
+    /**
+     * Staging segments, the digest buffer, and where the partial hash stands
+     */
+    struct sha_stream::device_path {
+        device_path(
+            sha_context &ctx,
+            device const &dev,
+            sha_stream_config const &cfg,
+            std::size_t result_size
+        ):
+            ctx { &ctx },
+            staging { 2, cfg.segment_size, 64, cfg.memory },
+            result { result_size, 64 },
+            staging_mmap { dev, staging.as_writable_bytes() },
+            result_mmap { dev, result.as_writable_bytes() },
+            inventory { 3 },
+            segments { inventory.buf_get_blocks(staging_mmap, staging) },
+            result_buffer { inventory.buf_get_by_addr(result_mmap, result.as_bytes()) }
+        {}
+
+        sha_context *ctx;
+        aligned_blocks staging;
+        aligned_memory result;
+        memory_map staging_mmap;
+        memory_map result_mmap;
+        buffer_inventory inventory;
+        buffer_array segments;
+        buffer result_buffer;
+
+        /// segment being filled, and how far
+        std::size_t current = 0;
+        std::size_t fill = 0;
+        /// partial hash of the other segment, if it is in flight
+        std::optional<coro::status_awaitable<>> pending;
+        /// whether segments of the current message have been submitted, i.e. the device expects a final one
+        bool open = false;
+
+        auto wait_pending() -> boost::cobalt::task<void> {
+            if(pending) {
+                auto status = co_await *pending;
+                pending.reset();
+                enforce_success(status);
+            }
+        }
+
+        /**
+         * Keep the staging memory and its mapping until the segment in flight is done with
+         * them, then let go
+         */
+        static auto release_when_idle(std::unique_ptr<device_path> self) -> boost::cobalt::detached {
+            try {
+                co_await self->wait_pending();
+            } catch(doca_exception &e) {
+                logger->debug("sha_stream: partial hash in flight at destruction failed: {}", e.what());
+            }
+        }
+    };
+
+    sha_stream::sha_stream(
+        sha_context &ctx,
+        device const &dev,
+        doca_sha_algorithm algorithm,
+        sha_stream_config const &cfg
+    ):
+        state_ { algorithm }
+    {
+        auto caps = partial_hash_caps_of(dev, algorithm);
+
+        if(!caps) {
+            logger->debug("sha_stream: device can't do partial hashes with algorithm {}, hashing in software", static_cast<int>(algorithm));
+            software_ = cfg.software != nullptr ? cfg.software : cpu_sha_backend::shared();
+            return;
+        }
+
+        enforce(cfg.segment_size > 0 && cfg.segment_size % caps->block_size == 0, DOCA_ERROR_INVALID_VALUE);
+
+        auto result_size = std::max<std::size_t>(caps->min_dst_size, sha_digest_size(algorithm));
+        device_ = std::make_unique<device_path>(ctx, dev, cfg, result_size);
+    }
+
+    sha_stream::sha_stream(
+        doca_sha_algorithm algorithm,
+        sha_stream_config const &cfg
+    ):
+        software_ { cfg.software != nullptr ? cfg.software : cpu_sha_backend::shared() },
+        state_ { algorithm }
+    {}
+
+    sha_stream::~sha_stream() {
+        if(device_ != nullptr && device_->pending) {
+            logger->warn("sha_stream destroyed with a partial hash in flight");
+            device_path::release_when_idle(std::move(device_));
+        }
+    }
+
+    auto sha_stream::update(std::span<std::byte const> data) -> boost::cobalt::task<void> {
+        return device_ != nullptr
+            ? update_on_device(data)
+            : update_in_software(data);
+    }
+
+    auto sha_stream::finish() -> boost::cobalt::task<sha_digest> {
+        if(device_ != nullptr) {
+            co_return co_await finish_on_device();
+        }
+
+        auto digest = state_.finish(std::span { tail_ }.first(tail_size_));
+        clear();
+
+        co_return digest;
+    }
+
+    auto sha_stream::reset() -> boost::cobalt::task<void> {
+        if(device_ != nullptr && (device_->open || device_->pending)) {
+            // the device only lets go of a partial hash with its final segment
+            try {
+                static_cast<void>(co_await finish_on_device());
+            } catch(doca_exception &e) {
+                logger->debug("sha_stream: closing the dropped message failed: {}", e.what());
+            }
+        }
+
+        clear();
+    }
+
+    auto sha_stream::clear() -> void {
+        size_ = 0;
+        tail_size_ = 0;
+        state_.reset();
+
+        if(device_ != nullptr) {
+            device_->fill = 0;
+            device_->open = false;
+        }
+    }
+
+    auto sha_stream::update_on_device(std::span<std::byte const> data) -> boost::cobalt::task<void> {
+        auto &dev = *device_;
+        auto segment_size = dev.staging.block_size();
+
+        size_ += data.size();
+
+        while(!data.empty()) {
+            // a full segment is only submitted once more data arrives, so that finish() always
+            // has something for the final segment
+            if(dev.fill == segment_size) {
+                co_await dev.wait_pending();
+
+                dev.segments[dev.current].set_data(dev.fill);
+                dev.pending = dev.ctx->partial_hash(algorithm(), dev.segments[dev.current], dev.result_buffer, false);
+                dev.open = true;
+                dev.current ^= 1;
+                dev.fill = 0;
+            }
+
+            auto n = std::min(data.size(), segment_size - dev.fill);
+            std::ranges::copy(data.first(n), dev.staging.writable_block(dev.current).begin() + dev.fill);
+            dev.fill += n;
+            data = data.subspan(n);
+        }
+    }
+
+    auto sha_stream::finish_on_device() -> boost::cobalt::task<sha_digest> {
+        auto &dev = *device_;
+        auto digest = sha_digest {};
+
+        try {
+            co_await dev.wait_pending();
+        } catch(doca_exception &) {
+            clear();
+            throw;
+        }
+
+        if(size_ == 0) {
+            // the final segment must not be empty, but the digest of nothing is well known
+            clear();
+            co_return sha_hash(algorithm(), {});
+        }
+
+        dev.segments[dev.current].set_data(dev.fill);
+        auto status = co_await dev.ctx->partial_hash(algorithm(), dev.segments[dev.current], dev.result_buffer, true);
+
+        if(status == DOCA_SUCCESS) {
+            auto out = dev.result_buffer.data<std::byte>();
+            digest.size = std::min(out.size(), sha_digest_size(algorithm()));
+            std::ranges::copy(out.first(digest.size), digest.bytes.begin());
+        }
+
+        // the next message starts with an empty digest buffer
+        dev.result_buffer.set_data(0);
+        clear();
+        enforce_success(status);
+
+        co_return digest;
+    }
+
+    auto sha_stream::update_in_software(std::span<std::byte const> data) -> boost::cobalt::task<void> {
+        auto block_size = sha_block_size(algorithm());
+
+        size_ += data.size();
+
+        if(tail_size_ > 0) {
+            auto n = std::min(data.size(), block_size - tail_size_);
+            std::ranges::copy(data.first(n), tail_.begin() + tail_size_);
+            tail_size_ += n;
+            data = data.subspan(n);
+
+            if(tail_size_ < block_size) {
+                co_return;
+            }
+
+            co_await absorb(std::span { tail_ }.first(block_size));
+            tail_size_ = 0;
+        }
+
+        auto whole = data.size() - data.size() % block_size;
+
+        if(whole > 0) {
+            co_await absorb(data.first(whole));
+        }
+
+        std::ranges::copy(data.subspan(whole), tail_.begin());
+        tail_size_ = data.size() - whole;
+    }
+
+    auto sha_stream::absorb(std::span<std::byte const> blocks) -> boost::cobalt::task<void> {
+        if(blocks.size() < inline_absorb_limit) {
+            state_.absorb(blocks);
+        } else {
+            enforce_success(co_await software_->absorb(state_, blocks));
+        }
+    }
+}
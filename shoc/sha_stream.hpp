@@ -0,0 +1,129 @@
+#pragma once
+
+#include "aligned_memory.hpp"
+#include "cpu_sha.hpp"
+#include "device.hpp"
+#include "sha.hpp"
+
+#include <doca_sha.h>
+
+#include <boost/cobalt/task.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace shoc {
+    /**
+     * Configuration for a sha_stream
+     */
+    struct sha_stream_config {
+        /// Size of the segments handed to the device, a multiple of its partial hash block size.
+        /// The stream stages data in two segments so that one can be filled while the device
+        /// hashes the other.
+        std::size_t segment_size = 64 * 1024;
+        /// Where and how the staging memory is allocated
+        memory_policy memory;
+        /// Backend for software hashing, the shared cpu_sha_backend if nullptr
+        std::shared_ptr<cpu_sha_backend> software;
+    };
+
+    /**
+     * Hashes a message that arrives in pieces of arbitrary size, e.g. a file read chunk by chunk.
+     *
+     * On a device, the stream copies the data into mapped staging segments and hashes them with
+     * sha_context::partial_hash, which needs all segments but the last to be whole blocks and
+     * the last one to be flagged. The stream takes care of both. Without a device, or if the
+     * device can't do partial hashes with the requested algorithm, the data is hashed in
+     * software through a cpu_sha_backend, whose multi-buffer kernel hashes the blocks of many
+     * concurrent streams together. Either way the caller sees the same update()/finish() API.
+     *
+     * One message at a time; after finish() or reset() the stream takes the next one and keeps
+     * its staging memory. update(), finish() and reset() must not overlap. On a device, a segment
+     * may still be in flight when update() returns, so the stream should be finished or reset
+     * before it is destroyed; otherwise the device's partial hash is left without its final
+     * segment, and the staging memory is only freed once the segment in flight completes.
+     */
+    class sha_stream {
+    public:
+        /**
+         * Hash on a device
+         *
+         * @param ctx running SHA context
+         * @param dev device the context runs on, which the staging memory is mapped to
+         * @param algorithm hash algorithm
+         * @param cfg segment size, staging memory, software backend
+         */
+        sha_stream(
+            sha_context &ctx,
+            device const &dev,
+            doca_sha_algorithm algorithm,
+            sha_stream_config const &cfg = {}
+        );
+
+        /**
+         * Hash in software
+         */
+        explicit sha_stream(
+            doca_sha_algorithm algorithm,
+            sha_stream_config const &cfg = {}
+        );
+
+        ~sha_stream();
+
+        sha_stream(sha_stream const &) = delete;
+        sha_stream(sha_stream &&) = delete;
+        sha_stream &operator=(sha_stream const &) = delete;
+        sha_stream &operator=(sha_stream &&) = delete;
+
+        [[nodiscard]] auto algorithm() const noexcept { return state_.algorithm(); }
+
+        /**
+         * @return whether the stream hashes on the device
+         */
+        [[nodiscard]] auto on_device() const noexcept -> bool { return device_ != nullptr; }
+
+        /**
+         * @return bytes of the current message fed so far
+         */
+        [[nodiscard]] auto size() const noexcept -> std::uint64_t { return size_; }
+
+        /**
+         * Feed the next piece of the message. data has to stay valid until the task completes,
+         * but not longer. Throws doca_exception if hashing fails.
+         */
+        [[nodiscard]] auto update(std::span<std::byte const> data) -> boost::cobalt::task<void>;
+
+        /**
+         * Hash whatever is left and get the digest. The stream is reset for the next message
+         * afterwards.
+         */
+        [[nodiscard]] auto finish() -> boost::cobalt::task<sha_digest>;
+
+        /**
+         * Drop the current message. On a device this waits for the segment in flight and closes
+         * the partial hash with a final segment, as the device expects.
+         */
+        [[nodiscard]] auto reset() -> boost::cobalt::task<void>;
+
+    private:
+        struct device_path;
+
+        [[nodiscard]] auto update_on_device(std::span<std::byte const> data) -> boost::cobalt::task<void>;
+        [[nodiscard]] auto finish_on_device() -> boost::cobalt::task<sha_digest>;
+        [[nodiscard]] auto update_in_software(std::span<std::byte const> data) -> boost::cobalt::task<void>;
+        [[nodiscard]] auto absorb(std::span<std::byte const> blocks) -> boost::cobalt::task<void>;
+
+        auto clear() -> void;
+
+        std::unique_ptr<device_path> device_;
+        std::shared_ptr<cpu_sha_backend> software_;
+        cpu_sha_state state_;
+        std::uint64_t size_ = 0;
+        /// software: bytes short of a whole block, held back until more data comes or finish()
+        std::array<std::byte, 128> tail_ {};
+        std::size_t tail_size_ = 0;
+    };
+}
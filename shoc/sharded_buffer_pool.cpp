@@ -0,0 +1,267 @@
+#include "sharded_buffer_pool.hpp"
+
+#include "error.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace shoc {
+    namespace {
+        struct attached_cache {
+            sharded_buffer_pool const *pool;
+            buffer_pool_cache *cache;
+        };
+
+        // caches of the current thread, by pool. Typically there's one or two.
+        thread_local std::vector<attached_cache> attached_caches;
+
+        auto magazine_count(std::size_t num_elements, std::size_t magazine_size) -> std::size_t {
+            // one more than could ever be full at once, so that a flush always finds an empty one
+            return num_elements / magazine_size + 2;
+        }
+    }
+
+    sharded_buffer_pool::sharded_buffer_pool(
+        device &dev,
+        std::size_t num_elements,
+        std::size_t element_size,
+        std::size_t element_alignment,
+        sharded_buffer_pool_config const &cfg
+    ):
+        memory_ { num_elements * element_size, std::max<std::size_t>(element_alignment, 64), cfg.memory },
+        mmap_ { dev, memory_.as_writable_bytes() },
+        magazine_size_ { std::max<std::size_t>(cfg.magazine_size, 1) },
+        depot_slots_ { std::make_unique<std::uint32_t[]>(magazine_count(num_elements, magazine_size_) * magazine_size_) },
+        full_magazines_ { magazine_count(num_elements, magazine_size_) },
+        empty_magazines_ { magazine_count(num_elements, magazine_size_) },
+        loose_buffers_ { num_elements }
+    {
+        enforce(num_elements < detail::index_stack::nil, DOCA_ERROR_INVALID_VALUE);
+
+        doca_buf_pool *pool;
+        enforce_success(doca_buf_pool_create(num_elements, element_size, mmap_.handle(), &pool));
+        handle_.reset(pool);
+
+        enforce_success(doca_buf_pool_set_element_alignment(handle_.get(), element_alignment));
+        enforce_success(doca_buf_pool_start(handle_.get()));
+
+        // this is the only time we talk to the doca_buf_pool; from here on, buffers are handed
+        // around by index.
+        buffers_.reserve(num_elements);
+
+        for(std::size_t i = 0; i < num_elements; ++i) {
+            doca_buf *buf_handle;
+            enforce_success(doca_buf_pool_buf_alloc(handle_.get(), &buf_handle));
+            buffers_.emplace_back(buf_handle);
+        }
+
+        auto magazines = magazine_count(num_elements, magazine_size_);
+        auto index = std::uint32_t { 0 };
+
+        for(std::uint32_t m = 0; m < magazines; ++m) {
+            if(num_elements - index >= magazine_size_) {
+                std::iota(&depot_slots_[m * magazine_size_], &depot_slots_[(m + 1) * magazine_size_], index);
+                index += magazine_size_;
+                full_magazines_.push(m);
+            } else {
+                empty_magazines_.push(m);
+            }
+        }
+
+        for(; index < num_elements; ++index) {
+            loose_buffers_.push(index);
+        }
+    }
+
+    auto sharded_buffer_pool::allocate_buffer() -> pooled_buffer {
+        auto buf = make_buffer(local_cache() != nullptr ? local_cache()->take() : take_uncached());
+        buf.get().set_data(0);
+
+        return buf;
+    }
+
+    auto sharded_buffer_pool::allocate_buffer(std::size_t data_length, std::size_t data_offset) -> pooled_buffer {
+        auto buf = allocate_buffer();
+        buf.get().set_data(data_length, data_offset);
+
+        return buf;
+    }
+
+    auto sharded_buffer_pool::allocate_buffers(std::size_t count) -> std::vector<pooled_buffer> {
+        auto cache = local_cache();
+        auto result = std::vector<pooled_buffer>{};
+        result.reserve(count);
+
+        // on failure, result's destructor returns what we got so far.
+        for(std::size_t i = 0; i < count; ++i) {
+            result.push_back(make_buffer(cache != nullptr ? cache->take() : take_uncached()));
+            result.back().get().set_data(0);
+        }
+
+        return result;
+    }
+
+    auto sharded_buffer_pool::release_buffers(std::span<pooled_buffer> buffers) noexcept -> void {
+        auto cache = local_cache();
+
+        for(auto &buf : buffers) {
+            if(buf.pool_ == nullptr) {
+                continue;
+            }
+
+            auto index = buf.index_;
+            buf.pool_ = nullptr;
+
+            if(cache != nullptr) {
+                cache->put(index);
+            } else {
+                put_uncached(index);
+            }
+        }
+    }
+
+    auto sharded_buffer_pool::local_cache() const noexcept -> buffer_pool_cache * {
+        for(auto &attached : attached_caches) {
+            if(attached.pool == this) {
+                return attached.cache;
+            }
+        }
+
+        return nullptr;
+    }
+
+    auto sharded_buffer_pool::make_buffer(std::uint32_t index) -> pooled_buffer {
+        enforce(index != detail::index_stack::nil, DOCA_ERROR_NO_MEMORY);
+        return { this, index };
+    }
+
+    auto sharded_buffer_pool::take_uncached() noexcept -> std::uint32_t {
+        auto index = loose_buffers_.pop();
+
+        if(index != detail::index_stack::nil) {
+            return index;
+        }
+
+        // break up a full magazine: take one buffer, leave the rest loose.
+        auto magazine = full_magazines_.pop();
+
+        if(magazine == detail::index_stack::nil) {
+            return detail::index_stack::nil;
+        }
+
+        auto slots = &depot_slots_[magazine * magazine_size_];
+
+        for(std::size_t i = 1; i < magazine_size_; ++i) {
+            loose_buffers_.push(slots[i]);
+        }
+
+        index = slots[0];
+        empty_magazines_.push(magazine);
+
+        return index;
+    }
+
+    auto sharded_buffer_pool::put_uncached(std::uint32_t index) noexcept -> void {
+        loose_buffers_.push(index);
+    }
+
+    auto sharded_buffer_pool::release(std::uint32_t index) noexcept -> void {
+        if(auto cache = local_cache(); cache != nullptr) {
+            cache->put(index);
+        } else {
+            put_uncached(index);
+        }
+    }
+
+    auto sharded_buffer_pool::refill(std::vector<std::uint32_t> &magazine) noexcept -> void {
+        auto full = full_magazines_.pop();
+
+        if(full != detail::index_stack::nil) {
+            auto slots = &depot_slots_[full * magazine_size_];
+            magazine.assign(slots, slots + magazine_size_);
+            empty_magazines_.push(full);
+            return;
+        }
+
+        while(magazine.size() < magazine_size_) {
+            auto index = loose_buffers_.pop();
+
+            if(index == detail::index_stack::nil) {
+                break;
+            }
+
+            magazine.push_back(index);
+        }
+    }
+
+    auto sharded_buffer_pool::flush(std::vector<std::uint32_t> &magazine) noexcept -> void {
+        auto empty = magazine.size() == magazine_size_ ? empty_magazines_.pop() : detail::index_stack::nil;
+
+        if(empty != detail::index_stack::nil) {
+            std::ranges::copy(magazine, &depot_slots_[empty * magazine_size_]);
+            full_magazines_.push(empty);
+        } else {
+            for(auto index : magazine) {
+                loose_buffers_.push(index);
+            }
+        }
+
+        magazine.clear();
+    }
+
+    auto pooled_buffer::reset() noexcept -> void {
+        if(pool_ != nullptr) {
+            std::exchange(pool_, nullptr)->release(index_);
+        }
+    }
+
+    buffer_pool_cache::buffer_pool_cache(sharded_buffer_pool &pool):
+        pool_ { &pool }
+    {
+        enforce(pool.local_cache() == nullptr, DOCA_ERROR_IN_USE);
+
+        loaded_.reserve(pool.magazine_size());
+        previous_.reserve(pool.magazine_size());
+
+        attached_caches.push_back({ pool_, this });
+    }
+
+    buffer_pool_cache::~buffer_pool_cache() {
+        std::erase_if(attached_caches, [this](attached_cache const &attached) { return attached.cache == this; });
+
+        pool_->flush(loaded_);
+        pool_->flush(previous_);
+    }
+
+    auto buffer_pool_cache::take() noexcept -> std::uint32_t {
+        if(loaded_.empty()) {
+            if(!previous_.empty()) {
+                std::swap(loaded_, previous_);
+            } else {
+                pool_->refill(loaded_);
+
+                if(loaded_.empty()) {
+                    return detail::index_stack::nil;
+                }
+            }
+        }
+
+        auto index = loaded_.back();
+        loaded_.pop_back();
+
+        return index;
+    }
+
+    auto buffer_pool_cache::put(std::uint32_t index) noexcept -> void {
+        if(loaded_.size() == pool_->magazine_size()) {
+            if(!previous_.empty()) {
+                pool_->flush(previous_);
+            }
+
+            std::swap(loaded_, previous_);
+        }
+
+        loaded_.push_back(index);
+    }
+}
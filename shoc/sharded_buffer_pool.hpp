@@ -0,0 +1,292 @@
+#pragma once
+
+#include "aligned_memory.hpp"
+#include "buffer.hpp"
+#include "device.hpp"
+#include "memory_map.hpp"
+#include "unique_handle.hpp"
+
+#include <doca_buf_pool.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace shoc {
+    class buffer_pool_cache;
+    class sharded_buffer_pool;
+
+    namespace detail {
+        /**
+         * Lock-free LIFO of indices into a fixed-size array (Treiber stack). The head carries a
+         * modification tag next to the index so that a concurrent pop/push sequence can't fool
+         * a compare-exchange into accepting a stale next link (ABA).
+         */
+        class index_stack {
+        public:
+            static constexpr auto nil = ~std::uint32_t {};
+
+            explicit index_stack(std::size_t capacity):
+                next_ { std::make_unique<std::atomic<std::uint32_t>[]>(capacity) }
+            {}
+
+            auto push(std::uint32_t index) noexcept -> void {
+                auto head = head_.load(std::memory_order_relaxed);
+
+                do {
+                    next_[index].store(index_of(head), std::memory_order_relaxed);
+                } while(!head_.compare_exchange_weak(
+                    head,
+                    pack(index, tag_of(head) + 1),
+                    std::memory_order_release,
+                    std::memory_order_relaxed
+                ));
+            }
+
+            /**
+             * @return the popped index, or nil if the stack is empty
+             */
+            [[nodiscard]] auto pop() noexcept -> std::uint32_t {
+                auto head = head_.load(std::memory_order_acquire);
+
+                while(index_of(head) != nil) {
+                    auto next = next_[index_of(head)].load(std::memory_order_relaxed);
+
+                    if(head_.compare_exchange_weak(
+                        head,
+                        pack(next, tag_of(head) + 1),
+                        std::memory_order_acquire,
+                        std::memory_order_acquire
+                    )) {
+                        return index_of(head);
+                    }
+                }
+
+                return nil;
+            }
+
+        private:
+            static constexpr auto pack(std::uint32_t index, std::uint32_t tag) noexcept -> std::uint64_t {
+                return (std::uint64_t { tag } << 32) | index;
+            }
+
+            static constexpr auto index_of(std::uint64_t head) noexcept -> std::uint32_t {
+                return static_cast<std::uint32_t>(head);
+            }
+
+            static constexpr auto tag_of(std::uint64_t head) noexcept -> std::uint32_t {
+                return static_cast<std::uint32_t>(head >> 32);
+            }
+
+            // own cache line, the head is what all threads fight over
+            alignas(64) std::atomic<std::uint64_t> head_ { pack(nil, 0) };
+            std::unique_ptr<std::atomic<std::uint32_t>[]> next_;
+        };
+    }
+
+    /**
+     * Configuration for a sharded_buffer_pool
+     */
+    struct sharded_buffer_pool_config {
+        /// Number of buffers a cache exchanges with the shared depot at once
+        std::size_t magazine_size = 64;
+        /// Where and how the pool's memory is allocated
+        memory_policy memory;
+    };
+
+    /**
+     * Buffer from a sharded_buffer_pool. Move-only; returns the buffer to the pool when destroyed
+     * (through the current thread's buffer_pool_cache, if there is one). Converts to buffer & so
+     * that it can be passed to offloading functions directly.
+     */
+    class pooled_buffer {
+    public:
+        pooled_buffer() = default;
+
+        ~pooled_buffer() {
+            reset();
+        }
+
+        pooled_buffer(pooled_buffer &&other) noexcept:
+            pool_ { std::exchange(other.pool_, nullptr) },
+            index_ { other.index_ }
+        {}
+
+        auto operator=(pooled_buffer &&other) noexcept -> pooled_buffer & {
+            if(this != &other) {
+                reset();
+                pool_ = std::exchange(other.pool_, nullptr);
+                index_ = other.index_;
+            }
+
+            return *this;
+        }
+
+        [[nodiscard]] auto has_value() const noexcept -> bool { return pool_ != nullptr; }
+
+        [[nodiscard]] auto get() const noexcept -> buffer &;
+
+        operator buffer &() const noexcept { return get(); }
+
+        /**
+         * Return the buffer to the pool early
+         */
+        auto reset() noexcept -> void;
+
+    private:
+        friend class buffer_pool_cache;
+        friend class sharded_buffer_pool;
+
+        pooled_buffer(sharded_buffer_pool *pool, std::uint32_t index):
+            pool_ { pool },
+            index_ { index }
+        {}
+
+        sharded_buffer_pool *pool_ = nullptr;
+        std::uint32_t index_ = 0;
+    };
+
+    /**
+     * Pool of equally-sized buffers in a single memory mapping that can be shared between threads,
+     * e.g. between the engines of a progress_engine_pool.
+     *
+     * All buffers are allocated from DOCA once, on construction; after that, allocating and
+     * releasing a buffer is a matter of passing an index around. Each thread that allocates or
+     * releases buffers at a high rate should attach a buffer_pool_cache, which keeps two
+     * magazines (small stacks) of free buffers, so that almost all operations touch only
+     * thread-local data. Only when both of its magazines run empty (or full) does a cache
+     * exchange a whole magazine with the shared depot, which is a lock-free stack. Buffers
+     * released on a different thread than the one that allocated them simply end up in the
+     * releasing thread's cache, and the depot rebalances them.
+     *
+     * Threads without a cache fall back to the depot directly, which is correct but contended.
+     *
+     * Like buffer_pool, needs to live longer than the buffers it allocates and its caches.
+     */
+    class sharded_buffer_pool {
+    public:
+        /**
+         * @param dev device to which the memory will be mapped.
+         * @param num_elements number of buffers in the pool
+         * @param element_size size of each buffer's memory region
+         * @param element_alignment min alignment of the buffers' memory
+         * @param cfg magazine size and memory policy
+         */
+        sharded_buffer_pool(
+            device &dev,
+            std::size_t num_elements,
+            std::size_t element_size,
+            std::size_t element_alignment = 1,
+            sharded_buffer_pool_config const &cfg = {}
+        );
+
+        sharded_buffer_pool(sharded_buffer_pool const &) = delete;
+        sharded_buffer_pool(sharded_buffer_pool &&) = delete;
+        sharded_buffer_pool &operator=(sharded_buffer_pool const &) = delete;
+        sharded_buffer_pool &operator=(sharded_buffer_pool &&) = delete;
+
+        [[nodiscard]] auto num_elements() const noexcept -> std::size_t { return buffers_.size(); }
+        [[nodiscard]] auto magazine_size() const noexcept -> std::size_t { return magazine_size_; }
+
+        /**
+         * Allocates an empty buffer (i.e., data region of length 0 at offset 0). Threadsafe.
+         */
+        [[nodiscard]] auto allocate_buffer() -> pooled_buffer;
+
+        /**
+         * Allocates a buffer with its data region set to a specific size and offset. Threadsafe.
+         */
+        [[nodiscard]] auto allocate_buffer(std::size_t data_length, std::size_t data_offset = 0) -> pooled_buffer;
+
+        /**
+         * Allocates count empty buffers at once. Throws if the pool cannot provide all of them, in
+         * which case none are allocated. Threadsafe.
+         */
+        [[nodiscard]] auto allocate_buffers(std::size_t count) -> std::vector<pooled_buffer>;
+
+        /**
+         * Returns a batch of buffers to the pool. Equivalent to resetting each of them, but looks
+         * up the thread's cache only once. Threadsafe.
+         */
+        auto release_buffers(std::span<pooled_buffer> buffers) noexcept -> void;
+
+    private:
+        friend class buffer_pool_cache;
+        friend class pooled_buffer;
+
+        [[nodiscard]] auto local_cache() const noexcept -> buffer_pool_cache *;
+
+        [[nodiscard]] auto make_buffer(std::uint32_t index) -> pooled_buffer;
+        [[nodiscard]] auto take_uncached() noexcept -> std::uint32_t;
+        auto put_uncached(std::uint32_t index) noexcept -> void;
+        auto release(std::uint32_t index) noexcept -> void;
+
+        /**
+         * Refill an empty magazine from the depot: a full magazine if there is one, otherwise
+         * whatever loose buffers are there.
+         */
+        auto refill(std::vector<std::uint32_t> &magazine) noexcept -> void;
+
+        /**
+         * Hand a magazine's buffers to the depot and empty it.
+         */
+        auto flush(std::vector<std::uint32_t> &magazine) noexcept -> void;
+
+        aligned_memory memory_;
+        memory_map mmap_;
+        unique_handle<doca_buf_pool, doca_buf_pool_destroy> handle_;
+        // declared after handle_ so that the buffers go back to the doca_buf_pool before it is destroyed
+        std::vector<buffer> buffers_;
+        std::size_t magazine_size_;
+
+        // depot: slots of magazine i are depot_slots_[i * magazine_size_, (i + 1) * magazine_size_)
+        std::unique_ptr<std::uint32_t[]> depot_slots_;
+        detail::index_stack full_magazines_;
+        detail::index_stack empty_magazines_;
+        // buffers that don't make up a full magazine
+        detail::index_stack loose_buffers_;
+    };
+
+    /**
+     * Thread-local front-end of a sharded_buffer_pool. While it exists, allocations from and
+     * releases to the pool on the thread that created it go through the cache.
+     *
+     * At most one cache per pool and thread. Must be destroyed on the thread that created it,
+     * e.g. by keeping it in the fiber/function that runs on a progress engine's thread. Hands its
+     * buffers back to the depot on destruction.
+     */
+    class buffer_pool_cache {
+    public:
+        explicit buffer_pool_cache(sharded_buffer_pool &pool);
+        ~buffer_pool_cache();
+
+        buffer_pool_cache(buffer_pool_cache const &) = delete;
+        buffer_pool_cache(buffer_pool_cache &&) = delete;
+        buffer_pool_cache &operator=(buffer_pool_cache const &) = delete;
+        buffer_pool_cache &operator=(buffer_pool_cache &&) = delete;
+
+        /**
+         * @return number of free buffers held by this cache
+         */
+        [[nodiscard]] auto size() const noexcept -> std::size_t { return loaded_.size() + previous_.size(); }
+
+    private:
+        friend class sharded_buffer_pool;
+
+        [[nodiscard]] auto take() noexcept -> std::uint32_t;
+        auto put(std::uint32_t index) noexcept -> void;
+
+        sharded_buffer_pool *pool_;
+        // previous_ is always either full or empty.
+        std::vector<std::uint32_t> loaded_;
+        std::vector<std::uint32_t> previous_;
+    };
+
+    inline auto pooled_buffer::get() const noexcept -> buffer & {
+        return pool_->buffers_[index_];
+    }
+}
@@ -1,4 +1,6 @@
 #include "aes_gcm.hpp"
+#include "aes_gcm_key_cache.hpp"
+#include "aes_gcm_stream.hpp"
 #include "aligned_memory.hpp"
 #include "asio_descriptor.hpp"
 #include "buffer.hpp"
@@ -13,22 +15,42 @@
 #include "common/overload.hpp"
 #include "common/raw_memory.hpp"
 #include "compress.hpp"
+#include "compress_stream.hpp"
 #include "context.hpp"
+#include "cpu_aes_gcm.hpp"
+#include "cpu_compress.hpp"
+#include "cpu_erasure_coding.hpp"
+#include "cpu_offload.hpp"
+#include "cpu_sha.hpp"
+#include "coro/combinators.hpp"
+#include "coro/deadline.hpp"
 #include "coro/error_receptable.hpp"
+#include "coro/receptable_pool.hpp"
 #include "coro/status_awaitable.hpp"
 #include "coro/value_awaitable.hpp"
 #include "devemu_pci.hpp"
 #include "device.hpp"
 #include "dma.hpp"
+#include "ec_matrix_cache.hpp"
+#include "ec_stripe_store.hpp"
 #include "erasure_coding.hpp"
 #include "error.hpp"
 #include "eth_rxq.hpp"
 #include "eth_txq.hpp"
 #include "flow.hpp"
+#include "gf256.hpp"
+#include "hybrid_compress.hpp"
 #include "logger.hpp"
 #include "memory_map.hpp"
+#include "memory_map_cache.hpp"
+#include "merkle_hasher.hpp"
+#include "offload_window.hpp"
 #include "progress_engine.hpp"
+#include "progress_engine_pool.hpp"
 #include "rdma.hpp"
 #include "sha.hpp"
+#include "sha_stream.hpp"
+#include "sharded_buffer_pool.hpp"
+#include "stream_file.hpp"
 #include "sync_event.hpp"
 #include "unique_handle.hpp"
@@ -0,0 +1,124 @@
+#include "stream_file.hpp"
+
+#include "logger.hpp"
+
+#include <boost/cobalt/op.hpp>
+#include <boost/cobalt/this_thread.hpp>
+
+#if defined(BOOST_ASIO_HAS_FILE)
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/buffer.hpp>
+#endif
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+
+namespace shoc {
+    stream_file::stream_file(int fd, stream_io io):
+        fd_ { fd }
+    {
+#if defined(BOOST_ASIO_HAS_FILE)
+        if(io == stream_io::io_uring) {
+            file_.emplace(boost::cobalt::this_thread::get_executor(), fd);
+        }
+#else
+        if(io == stream_io::io_uring) {
+            logger->warn("stream_file: Boost.Asio was built without io_uring support, using pread");
+        }
+#endif
+    }
+
+    stream_file::~stream_file() {
+#if defined(BOOST_ASIO_HAS_FILE)
+        if(file_) {
+            // the descriptor belongs to the caller
+            file_->release();
+        }
+#endif
+    }
+
+    auto stream_file::read_at(std::uint64_t offset, std::span<std::byte> out) -> boost::cobalt::task<std::size_t> {
+        auto total = std::size_t { 0 };
+
+        while(total < out.size()) {
+            auto chunk = out.subspan(total);
+            auto count = std::size_t { 0 };
+
+#if defined(BOOST_ASIO_HAS_FILE)
+            if(file_) {
+                auto [ec, n] = co_await file_->async_read_some_at(
+                    offset + total,
+                    boost::asio::buffer(chunk.data(), chunk.size()),
+                    boost::asio::as_tuple(boost::cobalt::use_op)
+                );
+
+                if(ec == boost::asio::error::eof) {
+                    break;
+                } else if(ec) {
+                    throw std::system_error(std::error_code(ec), "stream_file: read failed");
+                }
+
+                count = n;
+            } else
+#endif
+            {
+                auto n = ::pread(fd_, chunk.data(), chunk.size(), static_cast<off_t>(offset + total));
+
+                if(n < 0 && errno == EINTR) {
+                    continue;
+                } else if(n < 0) {
+                    throw std::system_error(errno, std::system_category(), "stream_file: read failed");
+                }
+
+                count = static_cast<std::size_t>(n);
+            }
+
+            if(count == 0) {
+                break;
+            }
+
+            total += count;
+        }
+
+        co_return total;
+    }
+
+    auto stream_file::write_at(std::uint64_t offset, std::span<std::byte const> data) -> boost::cobalt::task<void> {
+        while(!data.empty()) {
+            auto count = std::size_t { 0 };
+
+#if defined(BOOST_ASIO_HAS_FILE)
+            if(file_) {
+                auto [ec, n] = co_await file_->async_write_some_at(
+                    offset,
+                    boost::asio::buffer(data.data(), data.size()),
+                    boost::asio::as_tuple(boost::cobalt::use_op)
+                );
+
+                if(ec) {
+                    throw std::system_error(std::error_code(ec), "stream_file: write failed");
+                }
+
+                count = n;
+            } else
+#endif
+            {
+                auto n = ::pwrite(fd_, data.data(), data.size(), static_cast<off_t>(offset));
+
+                if(n < 0 && errno == EINTR) {
+                    continue;
+                } else if(n < 0) {
+                    throw std::system_error(errno, std::system_category(), "stream_file: write failed");
+                }
+
+                count = static_cast<std::size_t>(n);
+            }
+
+            offset += count;
+            data = data.subspan(count);
+        }
+    }
+}
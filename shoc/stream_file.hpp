@@ -0,0 +1,55 @@
+#pragma once
+
+#include <boost/cobalt/task.hpp>
+
+#if defined(BOOST_ASIO_HAS_FILE)
+#include <boost/asio/random_access_file.hpp>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace shoc {
+    /**
+     * How the file pipelines (compress_stream, aes_gcm_stream, ...) read their input and write
+     * their output
+     */
+    enum class stream_io {
+        /// blocking pread/pwrite. The device keeps working on the tasks in flight while we block.
+        pread,
+        /// asynchronous file I/O through Boost.Asio's io_uring backend, if it was compiled in
+        /// (configure with -DSHOC_WITH_IO_URING=ON); otherwise falls back to pread.
+        io_uring
+    };
+
+    /**
+     * Positional file I/O on a borrowed file descriptor, blocking or through io_uring. Throws
+     * std::system_error on I/O errors.
+     */
+    class stream_file {
+    public:
+        stream_file(int fd, stream_io io);
+
+        stream_file(stream_file const &) = delete;
+        stream_file &operator=(stream_file const &) = delete;
+
+        ~stream_file();
+
+        /**
+         * Fill out from offset on, short only at end of file
+         *
+         * @return number of bytes read
+         */
+        [[nodiscard]] auto read_at(std::uint64_t offset, std::span<std::byte> out) -> boost::cobalt::task<std::size_t>;
+
+        [[nodiscard]] auto write_at(std::uint64_t offset, std::span<std::byte const> data) -> boost::cobalt::task<void>;
+
+    private:
+        int fd_;
+#if defined(BOOST_ASIO_HAS_FILE)
+        std::optional<boost::asio::random_access_file> file_;
+#endif
+    };
+}
@@ -0,0 +1,152 @@
+#include <shoc/coro/combinators.hpp>
+#include <shoc/coro/status_awaitable.hpp>
+#include <shoc/coro/value_awaitable.hpp>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+namespace {
+    struct fiber {
+        struct promise_type {
+            auto get_return_object() const noexcept { return fiber{}; }
+            auto unhandled_exception() const noexcept {
+                try {
+                    std::rethrow_exception(std::current_exception());
+                } catch(std::exception &e) {
+                    EXPECT_TRUE(false) << "fiber exited with error: " << e.what();
+                } catch(...) {
+                    EXPECT_TRUE(false) << "fiber exited with unknown error";
+                }
+            }
+
+            auto return_void() const noexcept {}
+            auto initial_suspend() const noexcept { return std::suspend_never{}; }
+            auto final_suspend() const noexcept { return std::suspend_never{}; }
+        };
+    };
+
+    auto complete(shoc::coro::value_awaitable<int> &awaitable, int value) {
+        awaitable.receptable_ptr()->emplace_value(value);
+        awaitable.receptable_ptr()->resume();
+    }
+
+    auto wait_any(
+        std::vector<shoc::coro::value_awaitable<int>> &awaitables,
+        std::vector<std::size_t> *order
+    ) -> fiber {
+        while(order->size() < awaitables.size()) {
+            auto index = co_await shoc::coro::when_any(awaitables);
+            auto &completed = awaitables[index];
+            auto value = co_await completed;
+
+            EXPECT_EQ(value, static_cast<int>(index) * 10);
+            order->push_back(index);
+            completed = {};
+        }
+    }
+
+    auto wait_all(
+        std::array<shoc::coro::value_awaitable<int>, 3> &awaitables,
+        int *sum
+    ) -> fiber {
+        co_await shoc::coro::when_all(awaitables);
+
+        for(auto &awaitable : awaitables) {
+            *sum += co_await awaitable;
+        }
+    }
+
+    auto drain_inflight(
+        shoc::coro::bounded_inflight<shoc::coro::status_awaitable<>, 2> &inflight,
+        std::vector<std::size_t> *slots
+    ) -> fiber {
+        while(!inflight.empty()) {
+            auto done = co_await inflight.next();
+            EXPECT_EQ(done.value, DOCA_SUCCESS);
+            slots->push_back(done.slot);
+        }
+    }
+}
+
+TEST(docapp_coro_combinators, when_any_resumes_in_completion_order) {
+    auto awaitables = std::vector<shoc::coro::value_awaitable<int>>{};
+
+    for(int i = 0; i < 3; ++i) {
+        awaitables.push_back(shoc::coro::value_awaitable<int>::create_space());
+    }
+
+    auto order = std::vector<std::size_t>{};
+    wait_any(awaitables, &order);
+
+    ASSERT_TRUE(order.empty());
+
+    complete(awaitables[2], 20);
+    ASSERT_EQ(order, (std::vector<std::size_t>{ 2 }));
+
+    complete(awaitables[0], 0);
+    ASSERT_EQ(order, (std::vector<std::size_t>{ 2, 0 }));
+
+    complete(awaitables[1], 10);
+    ASSERT_EQ(order, (std::vector<std::size_t>{ 2, 0, 1 }));
+}
+
+TEST(docapp_coro_combinators, when_any_precomputed) {
+    auto awaitables = std::vector<shoc::coro::value_awaitable<int>>{};
+    awaitables.push_back(shoc::coro::value_awaitable<int>::create_space());
+    awaitables.push_back(shoc::coro::value_awaitable<int>::from_value(10));
+
+    auto order = std::vector<std::size_t>{};
+    wait_any(awaitables, &order);
+
+    ASSERT_EQ(order, (std::vector<std::size_t>{ 1 }));
+
+    complete(awaitables[0], 0);
+    ASSERT_EQ(order, (std::vector<std::size_t>{ 1, 0 }));
+}
+
+TEST(docapp_coro_combinators, when_all_waits_for_last) {
+    auto awaitables = std::array<shoc::coro::value_awaitable<int>, 3> {
+        shoc::coro::value_awaitable<int>::create_space(),
+        shoc::coro::value_awaitable<int>::create_space(),
+        shoc::coro::value_awaitable<int>::create_space()
+    };
+
+    int sum = 0;
+    wait_all(awaitables, &sum);
+
+    complete(awaitables[1], 2);
+    complete(awaitables[2], 3);
+    ASSERT_EQ(sum, 0);
+
+    complete(awaitables[0], 1);
+    ASSERT_EQ(sum, 6);
+}
+
+TEST(docapp_coro_combinators, bounded_inflight_frees_slots_out_of_order) {
+    using awaitable = shoc::coro::status_awaitable<>;
+
+    auto inflight = shoc::coro::bounded_inflight<awaitable, 2>{};
+    auto first = awaitable::create_space();
+    auto second = awaitable::create_space();
+    auto first_receptable = first.receptable_ptr();
+    auto second_receptable = second.receptable_ptr();
+
+    ASSERT_EQ(inflight.push(std::move(first)), 0);
+    ASSERT_EQ(inflight.push(std::move(second)), 1);
+    ASSERT_TRUE(inflight.full());
+    ASSERT_THROW(static_cast<void>(inflight.push(awaitable::create_space())), shoc::doca_exception);
+
+    auto slots = std::vector<std::size_t>{};
+    drain_inflight(inflight, &slots);
+
+    second_receptable->set_error(DOCA_SUCCESS);
+    second_receptable->resume();
+    ASSERT_EQ(slots, (std::vector<std::size_t>{ 1 }));
+    ASSERT_EQ(inflight.size(), 1);
+
+    first_receptable->set_error(DOCA_SUCCESS);
+    first_receptable->resume();
+    ASSERT_EQ(slots, (std::vector<std::size_t>{ 1, 0 }));
+    ASSERT_TRUE(inflight.empty());
+}
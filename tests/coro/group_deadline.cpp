@@ -0,0 +1,114 @@
+#include <shoc/coro/deadline.hpp>
+#include <shoc/coro/receptable_pool.hpp>
+#include <shoc/coro/status_awaitable.hpp>
+#include <shoc/coro/value_awaitable.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/cobalt.hpp>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+using namespace std::chrono_literals;
+
+TEST(docapp_coro_deadline, orphaned_receptable_is_reclaimed_on_completion) {
+    auto pool = shoc::coro::receptable_pool {};
+    auto awaitable = shoc::coro::value_awaitable<int>::create_space(pool);
+    auto receptable = awaitable.receptable_ptr();
+
+    awaitable.orphan();
+
+    EXPECT_EQ(awaitable.receptable_ptr(), nullptr);
+    EXPECT_TRUE(receptable->orphaned());
+    EXPECT_EQ(pool.stats().in_use, 1);
+
+    // the task completes after its waiter has given up.
+    receptable->emplace_value(42);
+    receptable->resume();
+
+    EXPECT_EQ(pool.stats().in_use, 0);
+}
+
+TEST(docapp_coro_deadline, orphaned_status_receptable_drops_additional_data) {
+    auto pool = shoc::coro::receptable_pool {};
+    auto checksum = 0;
+    auto awaitable = shoc::coro::status_awaitable<int>::create_space(pool, &checksum);
+    auto receptable = awaitable.receptable_ptr();
+
+    awaitable.orphan();
+
+    receptable->additional_data().overwrite(42);
+    receptable->set_error(DOCA_SUCCESS);
+    receptable->resume();
+
+    EXPECT_EQ(checksum, 0);
+    EXPECT_EQ(pool.stats().in_use, 0);
+}
+
+TEST(docapp_coro_deadline, times_out) {
+    auto pool = shoc::coro::receptable_pool {};
+    auto report = std::string { "not started" };
+
+    auto task = [](
+        shoc::coro::receptable_pool *pool,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto awaitable = shoc::coro::value_awaitable<int>::create_space(*pool);
+        auto receptable = awaitable.receptable_ptr();
+
+        try {
+            co_await shoc::coro::with_timeout(std::move(awaitable), 1ms);
+            *report = "did not time out";
+            co_return;
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() != DOCA_ERROR_TIME_OUT) {
+                *report = "unexpected error";
+                co_return;
+            }
+        }
+
+        receptable->emplace_value(42);
+        receptable->resume();
+
+        *report = "";
+    } (&pool, &report);
+
+    boost::cobalt::run(std::move(task));
+
+    EXPECT_EQ(report, "");
+    EXPECT_EQ(pool.stats().in_use, 0);
+}
+
+TEST(docapp_coro_deadline, completes_before_deadline) {
+    auto pool = shoc::coro::receptable_pool {};
+    auto report = std::string { "not started" };
+
+    auto task = [](
+        shoc::coro::receptable_pool *pool,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto awaitable = shoc::coro::value_awaitable<int>::create_space(*pool);
+        auto receptable = awaitable.receptable_ptr();
+
+        boost::asio::post(
+            boost::cobalt::this_thread::get_executor(),
+            [receptable] {
+                receptable->emplace_value(42);
+                receptable->resume();
+            }
+        );
+
+        try {
+            auto value = co_await shoc::coro::with_timeout(std::move(awaitable), 10s);
+            *report = value == 42 ? "" : "unexpected value";
+        } catch(std::exception &e) {
+            *report = e.what();
+        }
+    } (&pool, &report);
+
+    boost::cobalt::run(std::move(task));
+
+    EXPECT_EQ(report, "");
+    EXPECT_EQ(pool.stats().in_use, 0);
+}
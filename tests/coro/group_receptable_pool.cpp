@@ -0,0 +1,83 @@
+#include <shoc/coro/receptable_pool.hpp>
+#include <shoc/coro/status_awaitable.hpp>
+#include <shoc/coro/value_awaitable.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+TEST(docapp_coro_receptable_pool, steady_state_without_heap_allocations) {
+    using awaitable = shoc::coro::status_awaitable<>;
+
+    auto pool = shoc::coro::receptable_pool {};
+    pool.reserve<awaitable::payload_type>(&pool, 8);
+
+    auto const heap_allocations = pool.stats().heap_allocations;
+    EXPECT_EQ(pool.stats().capacity, 8);
+
+    for(int round = 0; round < 4; ++round) {
+        auto inflight = std::vector<awaitable>{};
+
+        for(int i = 0; i < 8; ++i) {
+            inflight.push_back(awaitable::create_space(pool));
+        }
+
+        EXPECT_EQ(pool.stats().in_use, 8);
+
+        for(auto &a : inflight) {
+            a.receptable_ptr()->set_value(DOCA_SUCCESS);
+            a.receptable_ptr()->resume();
+        }
+    }
+
+    EXPECT_EQ(pool.stats().in_use, 0);
+    EXPECT_EQ(pool.stats().pooled_allocations, 32);
+    EXPECT_EQ(pool.stats().heap_allocations, heap_allocations);
+}
+
+TEST(docapp_coro_receptable_pool, grows_on_demand) {
+    auto pool = shoc::coro::receptable_pool {};
+
+    {
+        auto a = shoc::coro::value_awaitable<int>::create_space(pool);
+        EXPECT_EQ(pool.stats().heap_allocations, 1);
+        EXPECT_EQ(pool.stats().capacity, shoc::coro::receptable_pool::default_chunk_blocks);
+        EXPECT_EQ(pool.stats().in_use, 1);
+    }
+
+    EXPECT_EQ(pool.stats().in_use, 0);
+}
+
+TEST(docapp_coro_receptable_pool, pooled_value_roundtrip) {
+    auto pool = shoc::coro::receptable_pool {};
+    auto awaitable = shoc::coro::value_awaitable<int>::create_space(pool);
+
+    ASSERT_FALSE(awaitable.await_ready());
+
+    awaitable.receptable_ptr()->emplace_value(42);
+
+    ASSERT_TRUE(awaitable.await_ready());
+    EXPECT_EQ(awaitable.await_resume(), 42);
+}
+
+TEST(docapp_coro_receptable_pool, reservations_add_up) {
+    using payload = shoc::coro::status_awaitable<>::payload_type;
+
+    auto pool = shoc::coro::receptable_pool {};
+    auto first = 0, second = 0, third = 0;
+
+    pool.reserve<payload>(&first, 8);
+    pool.reserve<payload>(&second, 8);
+    EXPECT_EQ(pool.stats().capacity, 16);
+
+    // the same owner again adds to its share
+    pool.reserve<payload>(&second, 4);
+    EXPECT_EQ(pool.stats().capacity, 20);
+
+    // released space is reused for later reservations
+    pool.release(&second);
+    pool.reserve<payload>(&third, 12);
+    EXPECT_EQ(pool.stats().capacity, 20);
+
+    pool.reserve<payload>(&third, 1);
+    EXPECT_EQ(pool.stats().capacity, 21);
+}
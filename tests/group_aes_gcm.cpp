@@ -65,6 +65,9 @@ TEST(docapp_aes_gcm, single_shot) {
             auto raw_key = "abcdefghijklmnopqrstuvwxyz123456";
             auto key_bytes = std::span { reinterpret_cast<std::byte const *>(raw_key), 32 };
             auto key = ctx->load_key(key_bytes, DOCA_AES_GCM_KEY_256);
+
+            // everything goes to the device by default, so a device key keeps no copy of its bytes
+            CO_ASSERT_EQ(ctx->hardware_supported(), key.material().empty(), "key material kept for a device-only key");
     
             auto err = co_await ctx->encrypt(src_buf, encrypted_buf, key, iv, tag_size, aad_size);
 
@@ -0,0 +1,320 @@
+#include <shoc/aes_gcm.hpp>
+#include <shoc/aes_gcm_key_cache.hpp>
+#include <shoc/aes_gcm_stream.hpp>
+#include <shoc/device.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define CO_FAIL(message) do { *report = (message); co_return; } while(false)
+#define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
+
+#define CO_ASSERT_EQ(val1, val2, message) CO_ASSERT((val1) == (val2), message)
+#define CO_ASSERT_NE(val1, val2, message) CO_ASSERT((val1) != (val2), message)
+#define CO_ASSERT_LT(val1, val2, message) CO_ASSERT((val1) <  (val2), message)
+#define CO_ASSERT_LE(val1, val2, message) CO_ASSERT((val1) <= (val2), message)
+#define CO_ASSERT_GT(val1, val2, message) CO_ASSERT((val1) >  (val2), message)
+#define CO_ASSERT_GE(val1, val2, message) CO_ASSERT((val1) >= (val2), message)
+
+namespace {
+    auto read_all(std::FILE *file) -> std::vector<std::byte> {
+        auto result = std::vector<std::byte> {};
+        auto chunk = std::array<std::byte, 4096> {};
+
+        std::rewind(file);
+
+        while(auto n = std::fread(chunk.data(), 1, chunk.size(), file)) {
+            result.insert(result.end(), chunk.begin(), chunk.begin() + n);
+        }
+
+        return result;
+    }
+
+    auto write_all(std::FILE *file, std::span<std::byte const> data) -> void {
+        std::rewind(file);
+        std::fwrite(data.data(), 1, data.size(), file);
+        std::fflush(file);
+    }
+}
+
+TEST(aes_gcm_stream_format, headers_round_trip) {
+    namespace format = shoc::aes_gcm_stream_format;
+
+    auto stream_bytes = std::array<std::byte, format::stream_header::encoded_size> {};
+    auto stream = format::stream_header {};
+    stream.record_size = 1 << 20;
+    stream.tag_size = 12;
+    stream.nonce_prefix = { std::byte { 1 }, std::byte { 2 }, std::byte { 3 }, std::byte { 4 }, std::byte { 5 }, std::byte { 6 }, std::byte { 7 } };
+    stream.encode(stream_bytes);
+
+    auto decoded_stream = format::stream_header::decode(stream_bytes);
+
+    ASSERT_TRUE(decoded_stream.has_value());
+    EXPECT_EQ(decoded_stream->version, format::version);
+    EXPECT_EQ(decoded_stream->record_size, 1 << 20);
+    EXPECT_EQ(decoded_stream->tag_size, 12);
+    EXPECT_EQ(decoded_stream->nonce_prefix, stream.nonce_prefix);
+
+    stream_bytes[0] = std::byte { 'X' };
+    EXPECT_FALSE(format::stream_header::decode(stream_bytes).has_value());
+
+    auto record_bytes = std::array<std::byte, format::record_header::encoded_size> {};
+    auto record = format::record_header { .plaintext_size = 1234, .flags = format::record_header::flag_last };
+    record.encode(record_bytes);
+
+    auto decoded_record = format::record_header::decode(record_bytes);
+
+    EXPECT_EQ(decoded_record.plaintext_size, 1234);
+    EXPECT_TRUE(decoded_record.is_last());
+    EXPECT_FALSE(format::record_header {}.is_last());
+}
+
+TEST(aes_gcm_stream_format, record_ivs_are_distinct) {
+    namespace format = shoc::aes_gcm_stream_format;
+
+    auto prefix = std::array<std::byte, format::nonce_prefix_size> { std::byte { 0xab } };
+    auto seen = std::set<std::array<std::byte, format::iv_size>> {};
+
+    for(auto index : { 0ull, 1ull, 255ull, 256ull, 0xffff'ffffull }) {
+        for(auto last : { false, true }) {
+            auto iv = format::record_iv(prefix, index, last);
+
+            EXPECT_TRUE(seen.insert(iv).second) << "IV of record " << index << " repeats";
+            EXPECT_TRUE(std::ranges::equal(std::span { iv }.first<format::nonce_prefix_size>(), prefix));
+            EXPECT_EQ(iv.back(), std::byte { last });
+        }
+    }
+
+    // big-endian counter
+    EXPECT_EQ(format::record_iv(prefix, 0x01020304, false)[7], std::byte { 0x01 });
+    EXPECT_EQ(format::record_iv(prefix, 0x01020304, false)[10], std::byte { 0x04 });
+
+    EXPECT_THROW(static_cast<void>(format::record_iv(prefix, format::max_records, false)), shoc::doca_exception);
+}
+
+TEST(aes_gcm_stream_format, nonce_prefix_is_the_stream_id) {
+    namespace format = shoc::aes_gcm_stream_format;
+
+    auto prefix = format::stream_nonce_prefix(0x01020304050607);
+    auto expected = std::array<std::byte, format::nonce_prefix_size> {
+        std::byte { 1 }, std::byte { 2 }, std::byte { 3 }, std::byte { 4 }, std::byte { 5 }, std::byte { 6 }, std::byte { 7 }
+    };
+
+    EXPECT_EQ(prefix, expected);
+    EXPECT_NE(format::stream_nonce_prefix(0), format::stream_nonce_prefix(format::max_streams - 1));
+    EXPECT_THROW(static_cast<void>(format::stream_nonce_prefix(format::max_streams)), shoc::doca_exception);
+}
+
+TEST(docapp_aes_gcm_stream, round_trip) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        namespace format = shoc::aes_gcm_stream_format;
+
+        try {
+            *report = "";
+
+            auto dev = shoc::device::find(shoc::device_capability::aes_gcm);
+            auto ctx = co_await shoc::aes_gcm_context::create(engine, dev, 4);
+
+            {
+                auto keys = shoc::aes_gcm_key_cache { *ctx, 4 };
+                auto key_bytes = std::as_bytes(std::span { "abcdefghijklmnopqrstuvwxyz123456", 32 });
+                auto key = keys.get("tenant-a", key_bytes, DOCA_AES_GCM_KEY_256);
+
+                auto cfg = shoc::aes_gcm_stream_config {};
+                cfg.record_size = 4096;
+                cfg.max_tasks = 3;
+
+                auto stream = shoc::aes_gcm_stream { dev, cfg };
+                auto stream_id = std::uint64_t { 0 };
+
+                // a partial last record, a full last record, and nothing at all
+                for(auto size : { std::size_t { 10 * 4096 + 1000 }, std::size_t { 4 * 4096 }, std::size_t { 0 } }) {
+                    auto plain_file = std::tmpfile();
+                    auto sealed_file = std::tmpfile();
+                    auto restored_file = std::tmpfile();
+
+                    auto text = std::string {};
+
+                    for(int i = 0; text.size() < size; ++i) {
+                        text += "line " + std::to_string(i) + ": Lorem ipsum dolor sit amet, consetetur sadipscing elitr\n";
+                    }
+
+                    text.resize(size);
+                    write_all(plain_file, std::as_bytes(std::span { text }));
+
+                    auto sealed_stats = co_await stream.encrypt(*ctx, *key, stream_id++, fileno(plain_file), fileno(sealed_file));
+                    auto records = std::max<std::size_t>(1, (size + 4095) / 4096);
+
+                    CO_ASSERT_EQ(sealed_stats.records, records, "unexpected number of records");
+                    CO_ASSERT_EQ(sealed_stats.bytes_in, size, "not all input was read");
+                    CO_ASSERT_EQ(
+                        sealed_stats.bytes_out,
+                        format::stream_header::encoded_size + records * (format::record_header::encoded_size + cfg.tag_size) + size,
+                        "unexpected output size"
+                    );
+
+                    auto sealed = read_all(sealed_file);
+                    CO_ASSERT(
+                        size == 0 || std::ranges::search(sealed, std::as_bytes(std::span { text }.first(64))).empty(),
+                        "plaintext shows up in the output"
+                    );
+
+                    auto restored_stats = co_await stream.decrypt(*ctx, *key, fileno(sealed_file), fileno(restored_file));
+                    auto restored = read_all(restored_file);
+
+                    CO_ASSERT_EQ(restored_stats.bytes_out, size, "decrypted to the wrong size");
+                    CO_ASSERT(std::ranges::equal(restored, std::as_bytes(std::span { text })), "decrypted data is different from source data");
+
+                    if(size > 4096) {
+                        // dropping the last record must not go unnoticed
+                        auto cut = std::tmpfile();
+                        auto last_record = format::record_header::encoded_size + (size % 4096 == 0 ? 4096 : size % 4096) + cfg.tag_size;
+                        write_all(cut, std::span { sealed }.first(sealed.size() - last_record));
+
+                        auto rejected = false;
+
+                        try {
+                            co_await stream.decrypt(*ctx, *key, fileno(cut), fileno(restored_file));
+                        } catch(shoc::doca_exception &) {
+                            rejected = true;
+                        }
+
+                        CO_ASSERT(rejected, "truncated stream was accepted");
+                        std::fclose(cut);
+                    }
+
+                    std::fclose(plain_file);
+                    std::fclose(sealed_file);
+                    std::fclose(restored_file);
+                }
+
+                CO_ASSERT_EQ(keys.stats().misses, 1, "key was loaded more than once");
+            }
+
+            co_await ctx->stop();
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                // crypto-disabled bluefield
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
+
+TEST(docapp_aes_gcm_key_cache, lru) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto dev = shoc::device::find(shoc::device_capability::aes_gcm);
+            auto ctx = co_await shoc::aes_gcm_context::create(engine, dev, 1);
+
+            {
+                auto keys = shoc::aes_gcm_key_cache { *ctx, 2 };
+                auto key_bytes = std::vector<std::byte>(16, std::byte { 0x42 });
+                auto fetches = 0;
+
+                auto fetch = [&](std::string_view) -> std::span<std::byte const> {
+                    ++fetches;
+                    return key_bytes;
+                };
+
+                auto a = keys.get("a", DOCA_AES_GCM_KEY_128, fetch);
+                a.reset();
+                static_cast<void>(keys.get("b", DOCA_AES_GCM_KEY_128, fetch));
+                static_cast<void>(keys.get("a", DOCA_AES_GCM_KEY_128, fetch));
+
+                CO_ASSERT_EQ(fetches, 2, "cached key was fetched again");
+                CO_ASSERT_EQ(keys.stats().hits, 1, "wrong hit count");
+
+                // "b" is the least recently used one and goes
+                auto held_a = keys.get("a", DOCA_AES_GCM_KEY_128, fetch);
+                static_cast<void>(keys.get("c", DOCA_AES_GCM_KEY_128, fetch));
+
+                CO_ASSERT_EQ(keys.stats().evictions, 1, "wrong eviction count");
+                CO_ASSERT(keys.find("b") == nullptr, "least recently used key was kept");
+                CO_ASSERT(keys.find("a") == held_a, "held key was evicted");
+
+                keys.erase("a");
+                CO_ASSERT(keys.find("a") == nullptr, "erased key is still there");
+                CO_ASSERT_EQ(keys.stats().entries, 1, "wrong entry count");
+
+                held_a.reset();
+                keys.clear();
+            }
+
+            co_await ctx->stop();
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                // crypto-disabled bluefield
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
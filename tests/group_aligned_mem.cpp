@@ -45,4 +45,47 @@ TEST(aligned_blocks, basic_operation) {
     EXPECT_NE(blocks.block(0).data(), nullptr);
     EXPECT_EQ(blocks.block(0).size(), 1024);
     EXPECT_TRUE(is_aligned(blocks.block(0)));
-}
\ No newline at end of file
+}
+
+TEST(aligned_mem, mapped_regular_pages) {
+    auto policy = shoc::memory_policy {};
+    policy.pages = shoc::page_kind::regular;
+    policy.prefault = true;
+    policy.numa_node = 0;
+
+    auto mem = shoc::aligned_memory { 3 * 4096 + 100, 128, policy };
+
+    EXPECT_EQ(mem.pages(), shoc::page_kind::regular);
+    EXPECT_EQ(mem.as_bytes().size(), 3 * 4096 + 100);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(mem.as_bytes().data()) % 128, 0);
+    EXPECT_EQ(mem.as_bytes()[0], std::byte{});
+    EXPECT_EQ(mem.as_bytes().back(), std::byte{});
+
+    auto mem2 = std::move(mem);
+
+    EXPECT_EQ(mem.as_bytes().size(), 0);
+    EXPECT_EQ(mem2.pages(), shoc::page_kind::regular);
+}
+
+TEST(aligned_mem, hugepages_or_fallback) {
+    auto mem = shoc::aligned_memory { 1 << 22, shoc::memory_policy::hugepages() };
+
+    // whether hugepages are reserved depends on the machine; either way we get usable memory.
+    EXPECT_TRUE(mem.pages() == shoc::page_kind::huge_2m || mem.pages() == shoc::page_kind::regular);
+    EXPECT_EQ(mem.as_bytes().size(), 1 << 22);
+    EXPECT_TRUE(is_aligned(mem.as_bytes()));
+
+    mem.as_writable_bytes().back() = std::byte { 42 };
+    EXPECT_EQ(mem.as_bytes().back(), std::byte { 42 });
+}
+
+TEST(aligned_blocks, with_policy) {
+    auto policy = shoc::memory_policy {};
+    policy.pages = shoc::page_kind::regular;
+
+    auto blocks = shoc::aligned_blocks(4, 1024, policy);
+
+    EXPECT_EQ(blocks.pages(), shoc::page_kind::regular);
+    EXPECT_EQ(blocks.block(3).size(), 1024);
+    EXPECT_TRUE(is_aligned(blocks.block(3)));
+}
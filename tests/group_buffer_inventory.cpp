@@ -0,0 +1,90 @@
+#include <shoc/aligned_memory.hpp>
+#include <shoc/buffer.hpp>
+#include <shoc/buffer_inventory.hpp>
+#include <shoc/device.hpp>
+#include <shoc/memory_map.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <span>
+#include <tuple>
+
+TEST(buffer_inventory, buf_get_blocks) {
+    auto dev = shoc::device::find(shoc::device_capability::dma);
+    auto blocks = shoc::aligned_blocks { 8, 512 };
+    auto mmap = shoc::memory_map { dev, blocks.as_writable_bytes() };
+    auto inv = shoc::buffer_inventory { 16 };
+
+    auto dst = inv.buf_get_blocks(mmap, blocks);
+    auto src = inv.buf_get_blocks_by_data(mmap, blocks);
+
+    ASSERT_EQ(dst.size(), 8);
+    ASSERT_EQ(src.size(), 8);
+    EXPECT_EQ(inv.get_num_free_elements(), 0);
+
+    for(std::size_t i = 0; i < 8; ++i) {
+        EXPECT_EQ(dst[i].memory<std::byte>().data(), blocks.block(i).data());
+        EXPECT_EQ(dst[i].memory().size(), 512);
+        EXPECT_EQ(dst[i].data().size(), 0);
+        EXPECT_EQ(src[i].data<std::byte>().data(), blocks.block(i).data());
+        EXPECT_EQ(src[i].data().size(), 512);
+    }
+
+    // the inventory is exhausted, so a batch that doesn't fit fails as a whole
+    dst.clear();
+    EXPECT_THROW(std::ignore = inv.buf_get_blocks(mmap, blocks.as_bytes(), 256), shoc::doca_exception);
+    EXPECT_EQ(inv.get_num_free_elements(), 8);
+
+    src.clear();
+    EXPECT_EQ(inv.get_num_free_elements(), 16);
+}
+
+TEST(buffer_inventory, buf_reuse) {
+    auto dev = shoc::device::find(shoc::device_capability::dma);
+    auto blocks = shoc::aligned_blocks { 4, 256 };
+    auto mmap = shoc::memory_map { dev, blocks.as_writable_bytes() };
+    auto inv = shoc::buffer_inventory { 1 };
+
+    auto buf = inv.buf_get_by_addr(mmap, blocks.block(0));
+
+    for(std::size_t i = 1; i < 4; ++i) {
+        shoc::buffer_inventory::buf_reuse_by_data(buf, mmap, blocks.block(i));
+
+        EXPECT_EQ(buf.data<std::byte>().data(), blocks.block(i).data());
+        EXPECT_EQ(buf.data().size(), 256);
+    }
+}
+
+TEST(buffer_view, snapshot_and_set_data) {
+    auto dev = shoc::device::find(shoc::device_capability::dma);
+    auto blocks = shoc::aligned_blocks { 1, 256 };
+    auto mmap = shoc::memory_map { dev, blocks.as_writable_bytes() };
+    auto inv = shoc::buffer_inventory { 1 };
+
+    auto buf = inv.buf_get_by_args(mmap, blocks.block(0), blocks.block(0).subspan(16, 32));
+    auto view = buf.view();
+
+    EXPECT_EQ(view.memory<std::byte>().data(), blocks.block(0).data());
+    EXPECT_EQ(view.memory_length(), 256);
+    EXPECT_EQ(view.data_offset(), 16);
+    EXPECT_EQ(view.data_length(), 32);
+    EXPECT_EQ(view.tail_room(), 208);
+
+    view.set_data(64, 8);
+
+    EXPECT_EQ(view.data_offset(), 8);
+    EXPECT_EQ(buf.data().data(), view.data().data());
+    EXPECT_EQ(buf.data().size(), 64);
+
+    buf.set_data(4);
+    view.invalidate();
+
+    EXPECT_FALSE(view.valid());
+
+    view.refresh();
+
+    EXPECT_TRUE(view.valid());
+    EXPECT_EQ(view.data_offset(), 0);
+    EXPECT_EQ(view.data_length(), 4);
+}
@@ -0,0 +1,320 @@
+#include <shoc/aligned_memory.hpp>
+#include <shoc/buffer_inventory.hpp>
+#include <shoc/compress.hpp>
+#include <shoc/compress_stream.hpp>
+#include <shoc/device.hpp>
+#include <shoc/memory_map.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <array>
+#include <cstdio>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#define CO_FAIL(message) do { *report = (message); co_return; } while(false)
+#define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
+
+#define CO_ASSERT_EQ(val1, val2, message) CO_ASSERT((val1) == (val2), message)
+#define CO_ASSERT_NE(val1, val2, message) CO_ASSERT((val1) != (val2), message)
+#define CO_ASSERT_LT(val1, val2, message) CO_ASSERT((val1) <  (val2), message)
+#define CO_ASSERT_LE(val1, val2, message) CO_ASSERT((val1) <= (val2), message)
+#define CO_ASSERT_GT(val1, val2, message) CO_ASSERT((val1) >  (val2), message)
+#define CO_ASSERT_GE(val1, val2, message) CO_ASSERT((val1) >= (val2), message)
+
+TEST(compress_stream_format, headers_round_trip) {
+    namespace format = shoc::compress_stream_format;
+
+    auto stream_bytes = std::array<std::byte, format::stream_header::encoded_size> {};
+    auto stream = format::stream_header {};
+    stream.chunk_size = 1 << 20;
+    stream.encode(stream_bytes);
+
+    auto decoded_stream = format::stream_header::decode(stream_bytes);
+
+    ASSERT_TRUE(decoded_stream.has_value());
+    EXPECT_EQ(decoded_stream->version, format::version);
+    EXPECT_EQ(decoded_stream->chunk_size, 1 << 20);
+
+    stream_bytes[0] = std::byte { 'X' };
+    EXPECT_FALSE(format::stream_header::decode(stream_bytes).has_value());
+
+    auto frame_bytes = std::array<std::byte, format::frame_header::encoded_size> {};
+    auto frame = format::frame_header { .compressed_size = 1234, .uncompressed_size = 4096, .crc = 0xdeadbeef, .adler = 42 };
+    frame.encode(frame_bytes);
+
+    auto decoded_frame = format::frame_header::decode(frame_bytes);
+
+    EXPECT_EQ(decoded_frame.compressed_size, 1234);
+    EXPECT_EQ(decoded_frame.uncompressed_size, 4096);
+    EXPECT_EQ(decoded_frame.crc, 0xdeadbeef);
+    EXPECT_EQ(decoded_frame.adler, 42);
+    EXPECT_FALSE(decoded_frame.is_end());
+    EXPECT_TRUE(format::frame_header {}.is_end());
+}
+
+TEST(compress_stream_format, index_round_trip) {
+    namespace format = shoc::compress_stream_format;
+
+    auto entry_bytes = std::array<std::byte, format::index_entry::encoded_size> {};
+    auto entry = format::index_entry {};
+    entry.offset = 0x1'0000'0010;
+    entry.compressed_size = 1234;
+    entry.uncompressed_size = 4096;
+    entry.crc = 0xdeadbeef;
+    entry.adler = 42;
+    entry.encode(entry_bytes);
+
+    auto decoded_entry = format::index_entry::decode(entry_bytes);
+
+    EXPECT_EQ(decoded_entry.offset, 0x1'0000'0010);
+    EXPECT_EQ(decoded_entry.compressed_size, 1234);
+    EXPECT_EQ(decoded_entry.uncompressed_size, 4096);
+    EXPECT_EQ(decoded_entry.crc, 0xdeadbeef);
+    EXPECT_EQ(decoded_entry.adler, 42);
+
+    auto footer_bytes = std::array<std::byte, format::stream_footer::encoded_size> {};
+    auto footer = format::stream_footer {};
+    footer.index_offset = 123456;
+    footer.chunk_count = 7;
+    footer.encode(footer_bytes);
+
+    auto decoded_footer = format::stream_footer::decode(footer_bytes);
+
+    ASSERT_TRUE(decoded_footer.has_value());
+    EXPECT_EQ(decoded_footer->index_offset, 123456);
+    EXPECT_EQ(decoded_footer->chunk_count, 7);
+
+    footer_bytes[16] = std::byte { 'X' };
+    EXPECT_FALSE(format::stream_footer::decode(footer_bytes).has_value());
+}
+
+TEST(docapp_compress_stream, compress_file) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        namespace format = shoc::compress_stream_format;
+
+        try {
+            *report = "";
+
+            auto in_file = std::tmpfile();
+            auto out_file = std::tmpfile();
+
+            auto text = std::string {};
+
+            for(int i = 0; text.size() < 3 * 4096 + 1000; ++i) {
+                text += "line " + std::to_string(i) + ": Lorem ipsum dolor sit amet, consetetur sadipscing elitr\n";
+            }
+
+            std::fwrite(text.data(), 1, text.size(), in_file);
+            std::fflush(in_file);
+
+            auto dev = shoc::device::find(shoc::device_capability::compress_deflate);
+            auto ctx = co_await shoc::compress_context::create(engine, dev, 4);
+
+            // not a multiple of the staging blocks' alignment
+            auto cfg = shoc::compress_stream_config {};
+            cfg.chunk_size = 4000;
+            cfg.max_tasks = 2;
+
+            auto stream = shoc::compress_stream { dev, cfg };
+            auto stats = co_await stream.run(*ctx, fileno(in_file), fileno(out_file));
+
+            CO_ASSERT_EQ(stats.chunks, 4, "unexpected number of chunks");
+            CO_ASSERT_EQ(stats.bytes_in, text.size(), "not all input was read");
+
+            auto compressed = std::vector<std::byte>(stats.bytes_out);
+            std::rewind(out_file);
+            CO_ASSERT_EQ(std::fread(compressed.data(), 1, compressed.size(), out_file), compressed.size(), "output file is too short");
+
+            auto header = format::stream_header::decode(std::span { compressed }.first<format::stream_header::encoded_size>());
+            CO_ASSERT(header.has_value(), "stream header missing");
+            CO_ASSERT_EQ(header->chunk_size, 4000, "wrong chunk size in stream header");
+
+            // decompress frame by frame and compare
+            auto src_mem = shoc::aligned_memory { 8192 };
+            auto dst_mem = shoc::aligned_memory { 4096 };
+            auto src_mmap = shoc::memory_map { dev, src_mem.as_writable_bytes() };
+            auto dst_mmap = shoc::memory_map { dev, dst_mem.as_writable_bytes() };
+            auto inv = shoc::buffer_inventory { 2 };
+
+            auto pos = format::stream_header::encoded_size;
+            auto restored = std::string {};
+
+            for(;;) {
+                auto frame = format::frame_header::decode(std::span { compressed }.subspan(pos).first<format::frame_header::encoded_size>());
+                pos += format::frame_header::encoded_size;
+
+                if(frame.is_end()) {
+                    break;
+                }
+
+                auto src_bytes = src_mem.as_writable_bytes();
+                std::ranges::copy(std::span { compressed }.subspan(pos, frame.compressed_size), src_bytes.begin());
+                pos += frame.compressed_size;
+
+                auto src = inv.buf_get_by_data(src_mmap, src_bytes.first(frame.compressed_size));
+                auto dst = inv.buf_get_by_addr(dst_mmap, dst_mem.as_writable_bytes());
+                auto status = co_await ctx->decompress(src, dst);
+
+                CO_ASSERT_EQ(DOCA_SUCCESS, status, std::string { "decompression failed: " } + doca_error_get_descr(status));
+                CO_ASSERT_EQ(dst.data().size(), frame.uncompressed_size, "frame decompressed to the wrong size");
+
+                restored.append(dst.data().data(), dst.data().size());
+            }
+
+            CO_ASSERT(restored == text, "decompressed data is different from source data");
+
+            auto footer = format::stream_footer::decode(std::span { compressed }.last<format::stream_footer::encoded_size>());
+            CO_ASSERT(footer.has_value(), "stream footer missing");
+            CO_ASSERT_EQ(footer->index_offset, pos, "index does not follow the end frame");
+            CO_ASSERT_EQ(footer->chunk_count, 4, "wrong number of index entries");
+            CO_ASSERT_EQ(
+                pos + 4 * format::index_entry::encoded_size + format::stream_footer::encoded_size,
+                compressed.size(),
+                "trailing data after footer"
+            );
+
+            co_await ctx->stop();
+
+            std::fclose(in_file);
+            std::fclose(out_file);
+        } catch(shoc::doca_exception &e) {
+            // Bluefield 3 has no compression device, only decompression
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
+
+TEST(docapp_compress_stream, read_range) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto in_file = std::tmpfile();
+            auto out_file = std::tmpfile();
+
+            auto text = std::string {};
+
+            for(int i = 0; text.size() < 10 * 4096 + 1000; ++i) {
+                text += "line " + std::to_string(i) + ": Lorem ipsum dolor sit amet, consetetur sadipscing elitr\n";
+            }
+
+            std::fwrite(text.data(), 1, text.size(), in_file);
+            std::fflush(in_file);
+
+            auto dev = shoc::device::find(shoc::device_capability::compress_deflate);
+            auto ctx = co_await shoc::compress_context::create(engine, dev, 4);
+
+            auto cfg = shoc::compress_stream_config {};
+            cfg.chunk_size = 4096;
+            cfg.max_tasks = 2;
+
+            auto stream = shoc::compress_stream { dev, cfg };
+            co_await stream.run(*ctx, fileno(in_file), fileno(out_file));
+
+            auto reader_cfg = shoc::compress_stream_reader_config {};
+            reader_cfg.max_tasks = 3;
+
+            auto reader = shoc::compress_stream_reader { dev, fileno(out_file), reader_cfg };
+
+            CO_ASSERT_EQ(reader.size(), text.size(), "wrong uncompressed size");
+            CO_ASSERT_EQ(reader.chunk_size(), 4096, "wrong chunk size");
+            CO_ASSERT_EQ(reader.index().size(), 11, "wrong number of chunks");
+
+            // a record in the middle of one chunk, one spanning several chunks, and one past the end
+            auto ranges = std::array<std::pair<std::size_t, std::size_t>, 3> {{
+                { 5 * 4096 + 100, 200 },
+                { 2 * 4096 - 10, 4 * 4096 + 20 },
+                { text.size() - 50, 100 }
+            }};
+
+            for(auto [offset, length] : ranges) {
+                auto out = std::vector<std::byte>(length);
+                auto count = co_await reader.read(*ctx, offset, out);
+                auto expected = std::string_view { text }.substr(offset, length);
+
+                CO_ASSERT_EQ(count, expected.size(), "wrong number of bytes read");
+                CO_ASSERT(
+                    std::string_view(reinterpret_cast<char const*>(out.data()), count) == expected,
+                    "read data is different from source data"
+                );
+            }
+
+            auto out = std::vector<std::byte>(10);
+            CO_ASSERT_EQ(co_await reader.read(*ctx, text.size(), out), 0, "read past the end");
+
+            co_await ctx->stop();
+
+            std::fclose(in_file);
+            std::fclose(out_file);
+        } catch(shoc::doca_exception &e) {
+            // Bluefield 3 has no compression device, only decompression
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
@@ -0,0 +1,249 @@
+#include <shoc/aes_gcm.hpp>
+#include <shoc/aes_gcm_stream.hpp>
+#include <shoc/buffer.hpp>
+#include <shoc/buffer_inventory.hpp>
+#include <shoc/cpu_aes_gcm.hpp>
+#include <shoc/device.hpp>
+#include <shoc/memory_map.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define CO_FAIL(message) do { *report = (message); co_return; } while(false)
+#define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
+
+#define CO_ASSERT_EQ(val1, val2, message) CO_ASSERT((val1) == (val2), message)
+#define CO_ASSERT_NE(val1, val2, message) CO_ASSERT((val1) != (val2), message)
+#define CO_ASSERT_LT(val1, val2, message) CO_ASSERT((val1) <  (val2), message)
+#define CO_ASSERT_LE(val1, val2, message) CO_ASSERT((val1) <= (val2), message)
+#define CO_ASSERT_GT(val1, val2, message) CO_ASSERT((val1) >  (val2), message)
+#define CO_ASSERT_GE(val1, val2, message) CO_ASSERT((val1) >= (val2), message)
+
+namespace {
+    auto from_hex(std::string_view hex) -> std::vector<std::byte> {
+        auto result = std::vector<std::byte> {};
+
+        for(auto i = std::size_t { 0 }; i + 1 < hex.size(); i += 2) {
+            result.push_back(static_cast<std::byte>(std::stoul(std::string { hex.substr(i, 2) }, nullptr, 16)));
+        }
+
+        return result;
+    }
+
+    // test case 16 of the GCM spec (McGrew & Viega): AES-256, 20 bytes AAD, 60 bytes plaintext
+    auto const nist_key = from_hex("feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308");
+    auto const nist_iv = from_hex("cafebabefacedbaddecaf888");
+    auto const nist_aad = from_hex("feedfacedeadbeeffeedfacedeadbeefabaddad2");
+    auto const nist_plaintext = from_hex(
+        "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+        "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39"
+    );
+    auto const nist_ciphertext = from_hex(
+        "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa"
+        "8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662"
+    );
+    auto const nist_tag = from_hex("76fc6ece0f4e1768cddf8853bb2d551b");
+}
+
+TEST(cpu_aes_gcm, keys) {
+    auto backend = shoc::cpu_aes_gcm_backend { { .threads = 1 } };
+
+    auto key = backend.load_key(nist_key, DOCA_AES_GCM_KEY_256);
+
+    EXPECT_EQ(key.handle(), nullptr);
+    EXPECT_TRUE(std::ranges::equal(key.material(), nist_key));
+
+    auto moved = std::move(key);
+
+    EXPECT_TRUE(key.material().empty());
+    EXPECT_TRUE(std::ranges::equal(moved.material(), nist_key));
+
+    moved.clear();
+    EXPECT_TRUE(moved.material().empty());
+
+    EXPECT_THROW(static_cast<void>(backend.load_key(nist_key, DOCA_AES_GCM_KEY_128)), shoc::doca_exception);
+}
+
+TEST(docapp_cpu_aes_gcm, known_answer) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            // the CPU backend needs no crypto device, only memory maps
+            auto dev = shoc::device::find(shoc::device_capability::dma);
+            auto backend = shoc::cpu_aes_gcm_backend { { .threads = 2 } };
+            auto key = backend.load_key(nist_key, DOCA_AES_GCM_KEY_256);
+
+            auto buf_inv = shoc::buffer_inventory { 4 };
+
+            auto src_data = nist_aad;
+            src_data.insert(src_data.end(), nist_plaintext.begin(), nist_plaintext.end());
+
+            auto expected = nist_aad;
+            expected.insert(expected.end(), nist_ciphertext.begin(), nist_ciphertext.end());
+            expected.insert(expected.end(), nist_tag.begin(), nist_tag.end());
+
+            auto src_mmap = shoc::memory_map { dev, src_data };
+            auto src_buf = buf_inv.buf_get_by_data(src_mmap, src_data);
+
+            auto dst_data = std::vector<std::byte>(512);
+            auto dst_mmap = shoc::memory_map { dev, dst_data };
+            auto dst_mid = dst_data.begin() + 256;
+
+            auto sealed_buf = buf_inv.buf_get_by_addr(dst_mmap, std::span { dst_data.begin(), dst_mid });
+            auto opened_buf = buf_inv.buf_get_by_addr(dst_mmap, std::span { dst_mid, dst_data.end() });
+
+            auto aad_size = static_cast<std::uint32_t>(nist_aad.size());
+
+            auto encrypt_status = co_await backend.encrypt(src_buf, sealed_buf, key, nist_iv, 16, aad_size);
+
+            CO_ASSERT_EQ(DOCA_SUCCESS, encrypt_status, std::string { "encryption failed: " } + doca_error_get_descr(encrypt_status));
+            CO_ASSERT(std::ranges::equal(sealed_buf.data<std::byte>(), expected), "output differs from the test vector");
+
+            auto decrypt_status = co_await backend.decrypt(sealed_buf, opened_buf, key, nist_iv, 16, aad_size);
+
+            CO_ASSERT_EQ(DOCA_SUCCESS, decrypt_status, std::string { "decryption failed: " } + doca_error_get_descr(decrypt_status));
+            CO_ASSERT(std::ranges::equal(opened_buf.data<std::byte>(), src_data), "decrypted data is different from source data");
+
+            // a flipped tag bit must fail and leave dest alone
+            opened_buf.set_data(0);
+            dst_data[expected.size() - 1] ^= std::byte { 1 };
+
+            auto tampered_status = co_await backend.decrypt(sealed_buf, opened_buf, key, nist_iv, 16, aad_size);
+
+            CO_ASSERT_EQ(DOCA_ERROR_INVALID_VALUE, tampered_status, "tampered ciphertext was accepted");
+            CO_ASSERT(opened_buf.data<std::byte>().empty(), "output of a failed decryption is visible");
+
+            // 12-byte tags are the first 12 bytes of the full one
+            sealed_buf.set_data(0);
+
+            auto short_tag_status = co_await backend.encrypt(src_buf, sealed_buf, key, nist_iv, 12, aad_size);
+
+            CO_ASSERT_EQ(DOCA_SUCCESS, short_tag_status, "encryption with 12-byte tag failed");
+            CO_ASSERT(
+                std::ranges::equal(sealed_buf.data<std::byte>(), std::span { expected }.first(expected.size() - 4)),
+                "12-byte tag differs from the truncated 16-byte tag"
+            );
+
+            auto bad_tag_status = co_await backend.encrypt(src_buf, sealed_buf, key, nist_iv, 8, aad_size);
+            CO_ASSERT_EQ(DOCA_ERROR_INVALID_VALUE, bad_tag_status, "8-byte tag was accepted");
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
+
+TEST(docapp_cpu_aes_gcm, stream) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto dev = shoc::device::find(shoc::device_capability::dma);
+            auto backend = shoc::cpu_aes_gcm_backend { { .threads = 2 } };
+            auto key = backend.load_key(nist_key, DOCA_AES_GCM_KEY_256);
+
+            auto cfg = shoc::aes_gcm_stream_config {};
+            cfg.record_size = 4096;
+            cfg.max_tasks = 4;
+
+            auto stream = shoc::aes_gcm_stream { dev, cfg };
+
+            auto plain_file = std::tmpfile();
+            auto sealed_file = std::tmpfile();
+            auto restored_file = std::tmpfile();
+
+            auto text = std::string {};
+
+            for(int i = 0; text.size() < 5 * 4096 + 17; ++i) {
+                text += "line " + std::to_string(i) + ": Lorem ipsum dolor sit amet, consetetur sadipscing elitr\n";
+            }
+
+            std::fwrite(text.data(), 1, text.size(), plain_file);
+            std::fflush(plain_file);
+
+            auto sealed_stats = co_await stream.encrypt(backend, key, 1, fileno(plain_file), fileno(sealed_file));
+            CO_ASSERT_EQ(sealed_stats.bytes_in, text.size(), "not all input was read");
+
+            auto restored_stats = co_await stream.decrypt(backend, key, fileno(sealed_file), fileno(restored_file));
+            CO_ASSERT_EQ(restored_stats.bytes_out, text.size(), "decrypted to the wrong size");
+
+            auto restored = std::string(text.size(), '\0');
+            std::rewind(restored_file);
+            CO_ASSERT_EQ(std::fread(restored.data(), 1, restored.size(), restored_file), text.size(), "could not read decrypted data");
+            CO_ASSERT_EQ(restored, text, "decrypted data is different from source data");
+
+            std::fclose(plain_file);
+            std::fclose(sealed_file);
+            std::fclose(restored_file);
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
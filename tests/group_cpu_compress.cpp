@@ -0,0 +1,129 @@
+#include <shoc/buffer.hpp>
+#include <shoc/buffer_inventory.hpp>
+#include <shoc/cpu_compress.hpp>
+#include <shoc/device.hpp>
+#include <shoc/memory_map.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <lz4.h>
+
+#include <algorithm>
+#include <ranges>
+#include <span>
+#include <string>
+#include <vector>
+
+#define CO_FAIL(message) do { *report = (message); co_return; } while(false)
+#define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
+
+#define CO_ASSERT_EQ(val1, val2, message) CO_ASSERT((val1) == (val2), message)
+#define CO_ASSERT_NE(val1, val2, message) CO_ASSERT((val1) != (val2), message)
+#define CO_ASSERT_LT(val1, val2, message) CO_ASSERT((val1) <  (val2), message)
+#define CO_ASSERT_LE(val1, val2, message) CO_ASSERT((val1) <= (val2), message)
+#define CO_ASSERT_GT(val1, val2, message) CO_ASSERT((val1) >  (val2), message)
+#define CO_ASSERT_GE(val1, val2, message) CO_ASSERT((val1) >= (val2), message)
+
+TEST(docapp_cpu_compress, round_trip) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            // the CPU backend needs no compression device, only memory maps
+            auto dev = shoc::device::find(shoc::device_capability::dma);
+            auto backend = shoc::cpu_compress_backend { { .threads = 2, .deflate_level = 6 } };
+
+            auto buf_inv = shoc::buffer_inventory { 8 };
+
+            auto src_data = std::string { "Lorem ipsum dolor sit amet, consetetur sadipscing elitr, sed diam nonumy eirmod tempor invidunt ut labore et dolore magna aliquyam erat, sed diam voluptua." };
+            auto src_mmap = shoc::memory_map { dev, src_data };
+            auto src_buf = buf_inv.buf_get_by_data(src_mmap, src_data);
+
+            auto dst_data = std::vector<char>(4096);
+            auto dst_mmap = shoc::memory_map { dev, dst_data };
+            auto dst_mid = dst_data.begin() + 2048;
+
+            auto compressed_buf = buf_inv.buf_get_by_addr(dst_mmap, std::span { dst_data.begin(), dst_mid });
+            auto decompressed_buf = buf_inv.buf_get_by_addr(dst_mmap, std::span { dst_mid, dst_data.end() });
+
+            // same checksums as the device reports for this text
+            auto checksums = shoc::compress_checksums {};
+            auto compress_status = co_await backend.compress(src_buf, compressed_buf, &checksums);
+
+            CO_ASSERT_EQ(DOCA_SUCCESS, compress_status, std::string { "compression failed: " } + doca_error_get_descr(compress_status));
+            CO_ASSERT_GT(compressed_buf.data().size(), 0, "compressed data is empty");
+            CO_ASSERT_LT(compressed_buf.data().size(), src_data.size(), "compressed data is larger than source data");
+            CO_ASSERT_EQ(checksums.crc, 4025347724, "unexpected crc checksum during compression");
+            CO_ASSERT_EQ(checksums.adler, 2629515667, "unexpected adler checksum during compression");
+
+            auto decompress_status = co_await backend.decompress(compressed_buf, decompressed_buf, &checksums);
+
+            CO_ASSERT_EQ(DOCA_SUCCESS, decompress_status, std::string { "decompression failed: " } + doca_error_get_descr(decompress_status));
+            CO_ASSERT(std::ranges::equal(src_data, decompressed_buf.data()), "decompressed data is different from source data");
+            CO_ASSERT_EQ(checksums.crc, 4025347724, "unexpected crc checksum during decompression");
+
+            // LZ4 block, compressed with liblz4 itself
+            auto lz4_data = std::vector<char>(LZ4_compressBound(static_cast<int>(src_data.size())));
+            auto lz4_size = LZ4_compress_default(src_data.data(), lz4_data.data(), static_cast<int>(src_data.size()), static_cast<int>(lz4_data.size()));
+            auto lz4_mmap = shoc::memory_map { dev, lz4_data };
+            auto lz4_buf = buf_inv.buf_get_by_data(lz4_mmap, std::span { lz4_data }.first(lz4_size));
+
+            decompressed_buf.set_data(0);
+            auto lz4_status = co_await backend.decompress_lz4_block(lz4_buf, decompressed_buf);
+
+            CO_ASSERT_EQ(DOCA_SUCCESS, lz4_status, std::string { "lz4 decompression failed: " } + doca_error_get_descr(lz4_status));
+            CO_ASSERT(std::ranges::equal(src_data, decompressed_buf.data()), "lz4-decompressed data is different from source data");
+
+            // garbage in, error out
+            decompressed_buf.set_data(0);
+            auto corrupt_status = co_await backend.decompress(src_buf, decompressed_buf);
+
+            CO_ASSERT_NE(DOCA_SUCCESS, corrupt_status, "decompressing garbage succeeded");
+            CO_ASSERT_EQ(decompressed_buf.data().size(), 0, "failed task changed the destination buffer");
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
+
+TEST(cpu_compress, shares_the_worker_pool_by_default) {
+    auto shared = shoc::cpu_compress_backend {};
+    auto own = shoc::cpu_compress_backend { { .threads = 2 } };
+
+    EXPECT_EQ(&shared.workers(), shoc::cpu_worker_pool::shared().get());
+    EXPECT_EQ(&shoc::cpu_compress_backend::shared()->workers(), shoc::cpu_worker_pool::shared().get());
+    EXPECT_NE(&own.workers(), shoc::cpu_worker_pool::shared().get());
+    EXPECT_EQ(own.workers().threads(), 2u);
+}
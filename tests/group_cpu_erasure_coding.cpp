@@ -0,0 +1,293 @@
+#include <shoc/aligned_memory.hpp>
+#include <shoc/buffer.hpp>
+#include <shoc/buffer_inventory.hpp>
+#include <shoc/cpu_erasure_coding.hpp>
+#include <shoc/device.hpp>
+#include <shoc/erasure_coding.hpp>
+#include <shoc/gf256.hpp>
+#include <shoc/memory_map.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#define CO_FAIL(message) do { *report = (message); co_return; } while(false)
+#define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
+
+#define CO_ASSERT_EQ(val1, val2, message) CO_ASSERT((val1) == (val2), message)
+#define CO_ASSERT_NE(val1, val2, message) CO_ASSERT((val1) != (val2), message)
+#define CO_ASSERT_LT(val1, val2, message) CO_ASSERT((val1) <  (val2), message)
+#define CO_ASSERT_LE(val1, val2, message) CO_ASSERT((val1) <= (val2), message)
+#define CO_ASSERT_GT(val1, val2, message) CO_ASSERT((val1) >  (val2), message)
+#define CO_ASSERT_GE(val1, val2, message) CO_ASSERT((val1) >= (val2), message)
+
+namespace {
+    using block_set = std::vector<std::vector<std::byte>>;
+
+    auto fill_random(std::span<std::byte> bytes, std::uint32_t seed) -> void {
+        auto rng = std::mt19937 { seed };
+
+        for(auto &b : bytes) {
+            b = static_cast<std::byte>(rng());
+        }
+    }
+
+    auto random_blocks(std::size_t count, std::size_t size, std::uint32_t seed) -> block_set {
+        auto blocks = block_set(count, std::vector<std::byte>(size));
+
+        for(auto &block : blocks) {
+            fill_random(block, seed++);
+        }
+
+        return blocks;
+    }
+
+    /**
+     * Multiply the matrix with the blocks
+     */
+    auto apply(
+        shoc::gf256_matrix const &matrix,
+        std::vector<std::vector<std::byte>> const &blocks,
+        shoc::gf256_kernel kernel = shoc::gf256_kernel::automatic
+    ) -> block_set {
+        auto size = blocks.front().size();
+        auto result = block_set(matrix.rows(), std::vector<std::byte>(size));
+        auto inputs = std::vector<std::byte const *> {};
+        auto outputs = std::vector<std::byte *> {};
+
+        for(auto const &block : blocks) {
+            inputs.push_back(block.data());
+        }
+
+        for(auto &block : result) {
+            outputs.push_back(block.data());
+        }
+
+        matrix.apply(inputs, outputs, size, kernel);
+
+        return result;
+    }
+}
+
+TEST(gf256, field) {
+    // shift-and-add reference
+    auto reference = [](unsigned a, unsigned b) {
+        auto product = 0u;
+
+        for(; b != 0; b >>= 1) {
+            if(b & 1) {
+                product ^= a;
+            }
+
+            a <<= 1;
+
+            if(a & 0x100) {
+                a ^= 0x11d;
+            }
+        }
+
+        return static_cast<std::uint8_t>(product);
+    };
+
+    for(auto a = 0u; a < 256; ++a) {
+        for(auto b = 0u; b < 256; ++b) {
+            ASSERT_EQ(shoc::gf256::mul(a, b), reference(a, b)) << a << " * " << b;
+        }
+
+        if(a != 0) {
+            ASSERT_EQ(shoc::gf256::mul(a, shoc::gf256::inv(a)), 1) << a;
+        }
+    }
+}
+
+TEST(gf256, kernels_agree) {
+    auto coding = shoc::gf256_matrix::encoding(DOCA_EC_MATRIX_TYPE_CAUCHY, 10, 6);
+
+    // a length that leaves a scalar tail after the 64-byte steps
+    auto data = random_blocks(10, 4096 + 64 + 17, 1);
+    auto expected = apply(coding, data, shoc::gf256_kernel::scalar);
+
+    for(auto kernel : {
+        shoc::gf256_kernel::ssse3,
+        shoc::gf256_kernel::avx2,
+        shoc::gf256_kernel::avx512,
+        shoc::gf256_kernel::avx2_gfni,
+        shoc::gf256_kernel::avx512_gfni,
+        shoc::gf256_kernel::automatic
+    }) {
+        if(!shoc::gf256_kernel_supported(kernel)) {
+            EXPECT_THROW(apply(coding, data, kernel), shoc::doca_exception);
+            continue;
+        }
+
+        EXPECT_EQ(apply(coding, data, kernel), expected) << shoc::gf256_kernel_name(kernel);
+    }
+}
+
+TEST(cpu_erasure_coding, recover_and_update) {
+    auto backend = shoc::cpu_ec_backend { { .threads = 1 } };
+
+    for(auto type : { DOCA_EC_MATRIX_TYPE_CAUCHY, DOCA_EC_MATRIX_TYPE_VANDERMONDE }) {
+        auto coding = backend.coding_matrix(type, 4, 3);
+
+        EXPECT_EQ(coding.handle(), nullptr);
+        EXPECT_EQ(coding.data_block_count(), 4);
+        EXPECT_EQ(coding.rdnc_block_count(), 3);
+
+        auto data = random_blocks(4, 256, 2);
+        auto rdnc = apply(coding.coefficients(), data);
+
+        // data blocks 1 and 3 and the last redundancy block are gone; the rest in ascending order
+        auto missing = std::vector<std::uint32_t> { 1, 3, 6 };
+        auto recover = backend.recover_matrix(coding, missing);
+        auto recovered = apply(recover.coefficients(), { data[0], data[2], rdnc[0], rdnc[1] });
+
+        EXPECT_EQ(recovered, (block_set { data[1], data[3], rdnc[2] }));
+
+        // new redundancy from the change of block 2 is the same as re-encoding
+        auto changed = random_blocks(1, 256, 3).front();
+        auto updated_data = data;
+        updated_data[2] = changed;
+
+        auto update_indices = std::vector<std::uint32_t> { 2 };
+        auto update = backend.update_matrix(coding, update_indices);
+        auto updated_rdnc = apply(update.coefficients(), { data[2], changed, rdnc[0], rdnc[1], rdnc[2] });
+
+        EXPECT_EQ(updated_rdnc, apply(coding.coefficients(), updated_data));
+    }
+
+    auto coding = backend.coding_matrix(DOCA_EC_MATRIX_TYPE_CAUCHY, 4, 2);
+    auto too_many = std::vector<std::uint32_t> { 0, 1, 2 };
+    auto out_of_range = std::vector<std::uint32_t> { 6 };
+    auto twice = std::vector<std::uint32_t> { 1, 1 };
+
+    EXPECT_THROW(static_cast<void>(backend.recover_matrix(coding, too_many)), shoc::doca_exception);
+    EXPECT_THROW(static_cast<void>(backend.recover_matrix(coding, out_of_range)), shoc::doca_exception);
+    EXPECT_THROW(static_cast<void>(backend.update_matrix(coding, twice)), shoc::doca_exception);
+}
+
+TEST(docapp_cpu_erasure_coding, matches_device) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto dev = shoc::device::find(shoc::device_capability::erasure_coding);
+            auto ctx = co_await shoc::ec_context::create(engine, dev, 4);
+            auto software = shoc::cpu_ec_backend { { .threads = 2 } };
+            auto buf_inv = shoc::buffer_inventory { 16 };
+
+            std::size_t const block_size = 1024;
+
+            auto data = shoc::aligned_blocks { 5, block_size };
+            fill_random(data.as_writable_bytes(), 4);
+
+            auto data_mmap = shoc::memory_map { dev, data.as_writable_bytes() };
+            auto data_buf = buf_inv.buf_get_by_data(data_mmap, data.as_writable_bytes());
+
+            for(auto type : { DOCA_EC_MATRIX_TYPE_CAUCHY, DOCA_EC_MATRIX_TYPE_VANDERMONDE }) {
+                auto coding = ctx->coding_matrix(type, 5, 3);
+
+                auto hw_rdnc = shoc::aligned_blocks { 3, block_size };
+                auto sw_rdnc = shoc::aligned_blocks { 3, block_size };
+                auto hw_mmap = shoc::memory_map { dev, hw_rdnc.as_writable_bytes() };
+                auto sw_mmap = shoc::memory_map { dev, sw_rdnc.as_writable_bytes() };
+                auto hw_buf = buf_inv.buf_get_by_addr(hw_mmap, hw_rdnc.as_writable_bytes());
+                auto sw_buf = buf_inv.buf_get_by_addr(sw_mmap, sw_rdnc.as_writable_bytes());
+
+                auto hw_status = co_await ctx->create(coding, data_buf, hw_buf);
+                CO_ASSERT_EQ(DOCA_SUCCESS, hw_status, std::string { "device encoding failed: " } + doca_error_get_descr(hw_status));
+
+                auto sw_status = co_await software.create(coding, data_buf, sw_buf);
+                CO_ASSERT_EQ(DOCA_SUCCESS, sw_status, std::string { "software encoding failed: " } + doca_error_get_descr(sw_status));
+
+                CO_ASSERT_EQ(sw_buf.data<std::byte>().size(), 3 * block_size, "software encoding has the wrong size");
+                CO_ASSERT(std::ranges::equal(hw_rdnc.as_bytes(), sw_rdnc.as_bytes()), "software and device redundancy blocks differ");
+
+                // the software backend recovers from the device's blocks with the device's matrix
+                auto missing = std::vector<std::uint32_t> { 0, 3 };
+                auto recover = ctx->recover_matrix(coding, missing);
+
+                auto available = shoc::aligned_blocks { 5, block_size };
+                std::ranges::copy(data.block(1), available.writable_block(0).begin());
+                std::ranges::copy(data.block(2), available.writable_block(1).begin());
+                std::ranges::copy(data.block(4), available.writable_block(2).begin());
+                std::ranges::copy(hw_rdnc.block(0), available.writable_block(3).begin());
+                std::ranges::copy(hw_rdnc.block(1), available.writable_block(4).begin());
+
+                auto recovered = shoc::aligned_blocks { 2, block_size };
+                auto available_mmap = shoc::memory_map { dev, available.as_writable_bytes() };
+                auto recovered_mmap = shoc::memory_map { dev, recovered.as_writable_bytes() };
+                auto available_buf = buf_inv.buf_get_by_data(available_mmap, available.as_writable_bytes());
+                auto recovered_buf = buf_inv.buf_get_by_addr(recovered_mmap, recovered.as_writable_bytes());
+
+                auto recover_status = co_await software.recover(recover, available_buf, recovered_buf);
+                CO_ASSERT_EQ(DOCA_SUCCESS, recover_status, std::string { "software recovery failed: " } + doca_error_get_descr(recover_status));
+                CO_ASSERT(std::ranges::equal(recovered.block(0), data.block(0)), "first recovered block contains bad data");
+                CO_ASSERT(std::ranges::equal(recovered.block(1), data.block(3)), "second recovered block contains bad data");
+
+                // and both compute the same new redundancy for a changed block
+                auto update_indices = std::vector<std::uint32_t> { 1 };
+                auto update = ctx->update_matrix(coding, update_indices);
+
+                auto update_input = shoc::aligned_blocks { 5, block_size };
+                fill_random(update_input.writable_block(1), 5);
+                std::ranges::copy(data.block(1), update_input.writable_block(0).begin());
+                std::ranges::copy(hw_rdnc.as_bytes(), update_input.writable_block(2).begin());
+
+                auto hw_updated = shoc::aligned_blocks { 3, block_size };
+                auto sw_updated = shoc::aligned_blocks { 3, block_size };
+                auto update_mmap = shoc::memory_map { dev, update_input.as_writable_bytes() };
+                auto hw_updated_mmap = shoc::memory_map { dev, hw_updated.as_writable_bytes() };
+                auto sw_updated_mmap = shoc::memory_map { dev, sw_updated.as_writable_bytes() };
+                auto update_buf = buf_inv.buf_get_by_data(update_mmap, update_input.as_writable_bytes());
+                auto hw_updated_buf = buf_inv.buf_get_by_addr(hw_updated_mmap, hw_updated.as_writable_bytes());
+                auto sw_updated_buf = buf_inv.buf_get_by_addr(sw_updated_mmap, sw_updated.as_writable_bytes());
+
+                auto hw_update_status = co_await ctx->update(update, update_buf, hw_updated_buf);
+                CO_ASSERT_EQ(DOCA_SUCCESS, hw_update_status, std::string { "device update failed: " } + doca_error_get_descr(hw_update_status));
+
+                auto sw_update_status = co_await software.update(update, update_buf, sw_updated_buf);
+                CO_ASSERT_EQ(DOCA_SUCCESS, sw_update_status, std::string { "software update failed: " } + doca_error_get_descr(sw_update_status));
+
+                CO_ASSERT(std::ranges::equal(hw_updated.as_bytes(), sw_updated.as_bytes()), "software and device updates differ");
+            }
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
@@ -0,0 +1,74 @@
+#include <shoc/cpu_erasure_coding.hpp>
+#include <shoc/ec_matrix_cache.hpp>
+#include <shoc/error.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+TEST(ec_matrix_cache, keys_ignore_index_order) {
+    auto backend = shoc::cpu_ec_backend { { .threads = 1 } };
+    auto cache = shoc::ec_matrix_cache { backend, DOCA_EC_MATRIX_TYPE_CAUCHY, 4, 2 };
+
+    auto first = cache.recover_matrix(std::vector<std::uint32_t> { 4, 1 });
+    auto second = cache.recover_matrix(std::vector<std::uint32_t> { 1, 4 });
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(std::vector<std::uint32_t>(first->missing_indices().begin(), first->missing_indices().end()), (std::vector<std::uint32_t> { 1, 4 }));
+    EXPECT_EQ(cache.stats().hits, 1);
+    EXPECT_EQ(cache.stats().misses, 1);
+    EXPECT_EQ(cache.stats().entries, 1);
+    EXPECT_DOUBLE_EQ(cache.stats().hit_rate(), 0.5);
+}
+
+TEST(ec_matrix_cache, recover_and_update_matrices_are_separate) {
+    auto backend = shoc::cpu_ec_backend { { .threads = 1 } };
+    auto cache = shoc::ec_matrix_cache { backend, DOCA_EC_MATRIX_TYPE_VANDERMONDE, 4, 2 };
+    auto indices = std::vector<std::uint32_t> { 0, 2 };
+
+    auto recover = cache.recover_matrix(indices);
+    auto update = cache.update_matrix(indices);
+
+    EXPECT_EQ(cache.stats().misses, 2);
+    EXPECT_EQ(cache.stats().entries, 2);
+    EXPECT_EQ(recover->coefficients().rows(), 2);
+    EXPECT_EQ(update->coefficients().cols(), 2 * indices.size() + 2);
+    EXPECT_EQ(cache.update_matrix(std::vector<std::uint32_t> { 2, 0 }), update);
+    EXPECT_EQ(cache.stats().hits, 1);
+}
+
+TEST(ec_matrix_cache, evicts_least_recently_used) {
+    auto backend = shoc::cpu_ec_backend { { .threads = 1 } };
+    auto cache = shoc::ec_matrix_cache { backend, DOCA_EC_MATRIX_TYPE_CAUCHY, 4, 2, 2 };
+
+    auto zero = cache.recover_matrix(std::vector<std::uint32_t> { 0 });
+    auto one = cache.recover_matrix(std::vector<std::uint32_t> { 1 });
+    static_cast<void>(cache.recover_matrix(std::vector<std::uint32_t> { 0 }));
+    static_cast<void>(cache.recover_matrix(std::vector<std::uint32_t> { 2 }));
+
+    EXPECT_EQ(cache.stats().evictions, 1);
+    EXPECT_EQ(cache.stats().entries, 2);
+
+    // still cached
+    EXPECT_EQ(cache.recover_matrix(std::vector<std::uint32_t> { 0 }), zero);
+
+    // dropped from the cache, but still usable by its holder
+    auto misses = cache.stats().misses;
+    EXPECT_NE(cache.recover_matrix(std::vector<std::uint32_t> { 1 }), one);
+    EXPECT_EQ(cache.stats().misses, misses + 1);
+    EXPECT_EQ(one->missing_indices().size(), 1);
+}
+
+TEST(ec_matrix_cache, rejects_invalid_indices) {
+    auto backend = shoc::cpu_ec_backend { { .threads = 1 } };
+    auto cache = shoc::ec_matrix_cache { backend, DOCA_EC_MATRIX_TYPE_CAUCHY, 4, 2 };
+
+    EXPECT_THROW(static_cast<void>(cache.recover_matrix(std::vector<std::uint32_t> { 6 })), shoc::doca_exception);
+    EXPECT_THROW(static_cast<void>(cache.recover_matrix(std::vector<std::uint32_t> { 1, 1 })), shoc::doca_exception);
+    EXPECT_THROW(static_cast<void>(cache.update_matrix(std::vector<std::uint32_t> { 4 })), shoc::doca_exception);
+    EXPECT_EQ(cache.stats().entries, 0);
+
+    EXPECT_THROW(shoc::ec_matrix_cache(backend, DOCA_EC_MATRIX_TYPE_CAUCHY, 4, 2, 0), shoc::doca_exception);
+}
@@ -0,0 +1,341 @@
+#include <shoc/cpu_erasure_coding.hpp>
+#include <shoc/device.hpp>
+#include <shoc/ec_stripe_store.hpp>
+#include <shoc/erasure_coding.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define CO_FAIL(message) do { *report = (message); co_return; } while(false)
+#define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
+
+#define CO_ASSERT_EQ(val1, val2, message) CO_ASSERT((val1) == (val2), message)
+#define CO_ASSERT_NE(val1, val2, message) CO_ASSERT((val1) != (val2), message)
+#define CO_ASSERT_LT(val1, val2, message) CO_ASSERT((val1) <  (val2), message)
+#define CO_ASSERT_LE(val1, val2, message) CO_ASSERT((val1) <= (val2), message)
+#define CO_ASSERT_GT(val1, val2, message) CO_ASSERT((val1) >  (val2), message)
+#define CO_ASSERT_GE(val1, val2, message) CO_ASSERT((val1) >= (val2), message)
+
+TEST(ec_stripe_format, header_round_trip) {
+    namespace format = shoc::ec_stripe_format;
+
+    auto bytes = std::array<std::byte, format::shard_header::encoded_size> {};
+    auto header = format::shard_header {};
+    header.shard_index = 5;
+    header.data_blocks = 4;
+    header.rdnc_blocks = 2;
+    header.block_size = 4096;
+    header.matrix_type = DOCA_EC_MATRIX_TYPE_VANDERMONDE;
+    header.object_size = 5 * 4 * 4096 + 1;
+    header.encode(bytes);
+
+    auto decoded = format::shard_header::decode(bytes);
+
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->shard_index, 5);
+    EXPECT_EQ(decoded->object_size, header.object_size);
+    EXPECT_EQ(decoded->stripe_count(), 6);
+    EXPECT_TRUE(decoded->same_object(header));
+
+    // another shard of the same object
+    decoded->shard_index = 0;
+    EXPECT_TRUE(decoded->same_object(header));
+
+    decoded->object_size = 0;
+    EXPECT_FALSE(decoded->same_object(header));
+    EXPECT_EQ(decoded->stripe_count(), 0);
+
+    bytes[0] = std::byte { 'X' };
+    EXPECT_FALSE(format::shard_header::decode(bytes).has_value());
+}
+
+TEST(docapp_ec_stripe_store, round_trip) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        auto root = std::filesystem::temp_directory_path() / ("shoc-ec-test-" + std::to_string(::getpid()));
+
+        try {
+            *report = "";
+
+            auto dev = shoc::device::find(shoc::device_capability::erasure_coding);
+            auto ctx = co_await shoc::ec_context::create(engine, dev, 4);
+
+            auto cfg = shoc::ec_stripe_config {};
+            cfg.data_blocks = 3;
+            cfg.rdnc_blocks = 2;
+            cfg.block_size = 4096;
+            cfg.max_tasks = 4;
+
+            auto store = shoc::ec_stripe_store { *ctx, dev, cfg };
+            auto shard_count = std::size_t { cfg.data_blocks + cfg.rdnc_blocks };
+
+            auto text = std::string {};
+
+            for(int i = 0; text.size() < 10 * 3 * 4096 + 1234; ++i) {
+                text += "line " + std::to_string(i) + ": Lorem ipsum dolor sit amet, consetetur sadipscing elitr\n";
+            }
+
+            auto plain_file = std::tmpfile();
+            std::fwrite(text.data(), 1, text.size(), plain_file);
+            std::fflush(plain_file);
+
+            auto stripes = (text.size() + 3 * 4096 - 1) / (3 * 4096);
+
+            // nothing, a data and a redundancy shard, two data shards, only redundancy, and the
+            // same data shards again for a cache hit
+            auto scenarios = std::vector<std::vector<std::size_t>> { {}, { 1, 4 }, { 0, 2 }, { 3, 4 }, { 0, 2 } };
+
+            for(auto const &lost : scenarios) {
+                {
+                    auto shards = shoc::ec_shard_files::create(root, "object", shard_count);
+                    auto written = co_await store.write(fileno(plain_file), shards.fds());
+
+                    CO_ASSERT_EQ(written.stripes, stripes, "unexpected number of stripes");
+                    CO_ASSERT_EQ(written.bytes_in, text.size(), "not all input was read");
+                }
+
+                for(auto index : lost) {
+                    std::filesystem::remove(shoc::ec_shard_files::path(root, "object", index));
+                }
+
+                auto shards = shoc::ec_shard_files::open(root, "object", shard_count);
+                auto restored_file = std::tmpfile();
+                auto read = co_await store.read(shards.fds(), fileno(restored_file));
+
+                // one byte more than expected, to catch trailing garbage
+                auto restored = std::string(text.size() + 1, '\0');
+                std::rewind(restored_file);
+                restored.resize(std::fread(restored.data(), 1, restored.size(), restored_file));
+                std::fclose(restored_file);
+
+                auto data_lost = std::ranges::any_of(lost, [&](auto index) { return index < cfg.data_blocks; });
+
+                CO_ASSERT_EQ(read.missing_shards, lost.size(), "wrong number of missing shards");
+                CO_ASSERT_EQ(read.recovered_stripes, data_lost ? stripes : 0, "wrong number of recovered stripes");
+                CO_ASSERT_EQ(restored.size(), text.size(), "restored object has the wrong size");
+                CO_ASSERT(restored == text, "restored object is different from the original");
+            }
+
+            CO_ASSERT_EQ(store.matrix_cache_stats().misses, 2, "recover matrix was built more than once per missing set");
+            CO_ASSERT_EQ(store.matrix_cache_stats().hits, 1, "recover matrix was not reused");
+
+            // shards 0 and 2 are gone already, one more is more than the code can make up for
+            std::filesystem::remove(shoc::ec_shard_files::path(root, "object", 1));
+
+            auto rejected = false;
+
+            try {
+                auto shards = shoc::ec_shard_files::open(root, "object", shard_count);
+                auto restored_file = std::tmpfile();
+
+                co_await store.read(shards.fds(), fileno(restored_file));
+                std::fclose(restored_file);
+            } catch(shoc::doca_exception &e) {
+                rejected = e.doca_error() == DOCA_ERROR_IO_FAILED;
+            }
+
+            CO_ASSERT(rejected, "object with too many missing shards was read");
+
+            std::fclose(plain_file);
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+
+        std::filesystem::remove_all(root);
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
+
+TEST(docapp_ec_stripe_store, delta_updates) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        auto root = std::filesystem::temp_directory_path() / ("shoc-ec-update-test-" + std::to_string(::getpid()));
+
+        try {
+            *report = "";
+
+            // the software backend needs the device only for the memory maps
+            auto dev = shoc::device::find(shoc::device_capability::dma);
+            auto backend = shoc::cpu_ec_backend { { .threads = 2 } };
+
+            auto cfg = shoc::ec_stripe_config {};
+            cfg.data_blocks = 6;
+            cfg.rdnc_blocks = 2;
+            cfg.block_size = 4096;
+            cfg.max_tasks = 4;
+
+            auto store = shoc::ec_stripe_store { backend, dev, cfg };
+            auto shard_count = std::size_t { cfg.data_blocks + cfg.rdnc_blocks };
+            auto stripe_size = std::size_t { cfg.data_blocks } * cfg.block_size;
+
+            auto text = std::string {};
+
+            for(int i = 0; text.size() < 8 * stripe_size + 1234; ++i) {
+                text += "line " + std::to_string(i) + ": Lorem ipsum dolor sit amet, consetetur sadipscing elitr\n";
+            }
+
+            auto plain_file = std::tmpfile();
+            std::fwrite(text.data(), 1, text.size(), plain_file);
+            std::fflush(plain_file);
+
+            // two overlapping writes and one next to them in the first stripe, one across the
+            // first stripe boundary, and a whole block in the sixth
+            auto writes = std::vector<std::pair<std::size_t, std::string>> {
+                { 100, "first write" },
+                { 105, "WRITE OVER IT" },
+                { 5000, "second block" },
+                { stripe_size - 10, "across the stripe boundary" },
+                { 5 * stripe_size + 2 * cfg.block_size, std::string(cfg.block_size, '#') }
+            };
+
+            auto modes = { shoc::ec_update_mode::delta, shoc::ec_update_mode::full_stripe, shoc::ec_update_mode::automatic };
+
+            for(auto mode : modes) {
+                {
+                    auto shards = shoc::ec_shard_files::create(root, "object", shard_count);
+                    co_await store.write(fileno(plain_file), shards.fds());
+                }
+
+                auto writer = shoc::ec_stripe_writer { backend, dev, cfg, mode };
+                auto expected = text;
+
+                for(auto const &[offset, data] : writes) {
+                    writer.write(offset, std::as_bytes(std::span { data }));
+                    expected.replace(offset, data.size(), data);
+                }
+
+                CO_ASSERT_EQ(writer.pending_stripes(), 3, "writes were not batched by stripe");
+
+                auto stats = shoc::ec_stripe_write_stats {};
+
+                {
+                    auto shards = shoc::ec_shard_files::open(root, "object", shard_count, true);
+                    stats = co_await writer.flush(shards.fds());
+                }
+
+                CO_ASSERT_EQ(writer.pending_stripes(), 0, "flush left writes queued");
+                CO_ASSERT_EQ(stats.writes, writes.size(), "wrong number of writes");
+                CO_ASSERT_EQ(stats.stripes, 3, "wrong number of stripes");
+                CO_ASSERT_EQ(stats.delta_stripes + stats.full_stripes, stats.stripes, "stripes were neither updated nor encoded");
+
+                if(mode == shoc::ec_update_mode::delta) {
+                    CO_ASSERT_EQ(stats.delta_stripes, 3, "stripes were encoded again in delta mode");
+                } else if(mode == shoc::ec_update_mode::full_stripe) {
+                    CO_ASSERT_EQ(stats.full_stripes, 3, "stripes were updated in full_stripe mode");
+                }
+
+                // without the first two data shards, the changes only come back if the redundancy
+                // blocks were brought up to date
+                for(auto index : { 0, 1 }) {
+                    std::filesystem::remove(shoc::ec_shard_files::path(root, "object", index));
+                }
+
+                auto shards = shoc::ec_shard_files::open(root, "object", shard_count);
+                auto restored_file = std::tmpfile();
+                co_await store.read(shards.fds(), fileno(restored_file));
+
+                auto restored = std::string(expected.size() + 1, '\0');
+                std::rewind(restored_file);
+                restored.resize(std::fread(restored.data(), 1, restored.size(), restored_file));
+                std::fclose(restored_file);
+
+                CO_ASSERT(restored == expected, "updated object is different from the expected one");
+            }
+
+            // writes must not change the object size
+            {
+                auto shards = shoc::ec_shard_files::create(root, "object", shard_count);
+                co_await store.write(fileno(plain_file), shards.fds());
+            }
+
+            auto writer = shoc::ec_stripe_writer { backend, dev, cfg };
+            auto tail = std::string { "past the end" };
+            writer.write(text.size() - 1, std::as_bytes(std::span { tail }));
+
+            auto rejected = false;
+
+            try {
+                auto shards = shoc::ec_shard_files::open(root, "object", shard_count, true);
+                co_await writer.flush(shards.fds());
+            } catch(shoc::doca_exception &e) {
+                rejected = e.doca_error() == DOCA_ERROR_INVALID_VALUE;
+            }
+
+            CO_ASSERT(rejected, "write past the end of the object was applied");
+
+            std::fclose(plain_file);
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+
+        std::filesystem::remove_all(root);
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
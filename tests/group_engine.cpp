@@ -6,8 +6,13 @@
 
 #include <boost/cobalt.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
 #include <string>
+#include <vector>
 
 #define CO_FAIL(message) do { *report = (message); co_return; } while(false)
 #define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
@@ -37,6 +42,93 @@ namespace {
     };
 }
 
+namespace {
+    /**
+     * Stand-in for the SDK's task submission, to provoke submission errors on demand. Tasks
+     * are never executed, so only their submission can be observed.
+     */
+    namespace fake_submission {
+        struct fake_task {
+            doca_ctx *ctx;
+            // how often submission fails with DOCA_ERROR_AGAIN before it gets to result
+            int again = 0;
+            doca_error_t result = DOCA_SUCCESS;
+            bool freed = false;
+
+            auto handle() -> doca_task* {
+                return reinterpret_cast<doca_task*>(this);
+            }
+        };
+
+        struct attempt {
+            fake_task *task;
+            std::uint32_t flags;
+            doca_error_t result;
+        };
+
+        std::vector<attempt> attempts;
+
+        auto submit(doca_task *task, std::uint32_t flags) -> doca_error_t {
+            auto fake = reinterpret_cast<fake_task*>(task);
+            auto result = fake->result;
+
+            if(fake->again > 0) {
+                --fake->again;
+                result = DOCA_ERROR_AGAIN;
+            }
+
+            attempts.push_back({ fake, flags, result });
+            return result;
+        }
+
+        auto get_ctx(doca_task const *task) -> doca_ctx* {
+            return reinterpret_cast<fake_task const*>(task)->ctx;
+        }
+
+        auto free_task(doca_task *task) -> void {
+            reinterpret_cast<fake_task*>(task)->freed = true;
+        }
+
+        /**
+         * Opaque context handle; the engine only uses it to tell contexts apart
+         */
+        auto context(std::size_t index) -> doca_ctx* {
+            static std::byte contexts[4];
+            return reinterpret_cast<doca_ctx*>(&contexts[index]);
+        }
+
+        auto config() -> shoc::progress_engine_config {
+            attempts.clear();
+
+            return {
+                .immediate_submission_attempts = 2,
+                .submission_ops = { submit, get_ctx, free_task }
+            };
+        }
+
+        /**
+         * @return number of times task was submitted successfully
+         */
+        auto submissions(fake_task const *task) -> int {
+            return static_cast<int>(std::ranges::count_if(attempts, [task](attempt const &a) {
+                return a.task == task && a.result == DOCA_SUCCESS;
+            }));
+        }
+
+        /**
+         * @return whether the last successful submission for ctx rang the doorbell
+         */
+        auto doorbell_rung(doca_ctx *ctx) -> bool {
+            auto reversed = attempts | std::views::reverse;
+            auto last = std::ranges::find_if(reversed, [ctx](attempt const &a) {
+                return a.task->ctx == ctx && a.result == DOCA_SUCCESS;
+            });
+
+            return last != reversed.end() && last->flags == DOCA_TASK_SUBMIT_FLAG_FLUSH;
+        }
+    }
+}
+
 #define CO_ASSERT_YIELDS(y1, y2) \
     do { \
         CO_ASSERT_EQ((y1), counters[0].yields(), fmt::format("unexpected yields in fiber 1: {} != {}", (y1), counters[0].yields())); \
@@ -139,3 +231,358 @@ TEST(docapp_engine, yielding) {
     EXPECT_EQ(counters[0].wakeups(), 1);
     EXPECT_EQ(counters[1].wakeups(), 1);
 }
+
+TEST(docapp_engine, adaptive_polling) {
+    auto report = std::string { "not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            for(int i = 0; i < 4; ++i) {
+                co_await engine->yield();
+            }
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto stats = shoc::polling_stats {};
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report,
+        shoc::polling_stats *stats
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine {
+            shoc::progress_engine_config {
+                .polling = shoc::polling_mode::adaptive,
+                .adaptive_spin_duration = std::chrono::milliseconds(10)
+            }
+        };
+
+        fiber_fn(&engine, report);
+
+        co_await engine.run();
+
+        *stats = engine.poll_stats();
+    } (
+        fiber_fn,
+        &report,
+        &stats
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    EXPECT_EQ("", report);
+    EXPECT_GT(stats.spins, 0);
+    EXPECT_EQ(stats.sleeps, 0);
+}
+
+TEST(docapp_engine, adaptive_polling_goes_to_sleep) {
+    auto report = std::string { "not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            for(int i = 0; i < 8; ++i) {
+                co_await engine->yield();
+            }
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto stats = shoc::polling_stats {};
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report,
+        shoc::polling_stats *stats
+    ) -> boost::cobalt::task<void> {
+        // no time limit, only the iteration budget: without completions, the engine has to
+        // fall asleep after two empty polls.
+        auto engine = shoc::progress_engine {
+            shoc::progress_engine_config {
+                .polling = shoc::polling_mode::adaptive,
+                .adaptive_spin_duration = std::chrono::microseconds(0),
+                .adaptive_spin_iterations = 2
+            }
+        };
+
+        fiber_fn(&engine, report);
+
+        co_await engine.run();
+
+        *stats = engine.poll_stats();
+    } (
+        fiber_fn,
+        &report,
+        &stats
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    EXPECT_EQ("", report);
+    EXPECT_GE(stats.empty_spins, 2);
+    EXPECT_GT(stats.sleeps, 0);
+    EXPECT_LE(stats.sleeps, stats.empty_spins / 2);
+}
+
+TEST(docapp_engine, batch_rings_every_context_doorbell) {
+    using fake_submission::fake_task;
+
+    auto a = fake_submission::context(0);
+    auto b = fake_submission::context(1);
+    fake_task tasks[] = { { a }, { b }, { a }, { b }, { a } };
+
+    auto task = [](fake_task *tasks) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine { fake_submission::config() };
+        auto pending = std::vector<shoc::coro::status_awaitable<>> {};
+
+        auto batch = shoc::submission_batch { &engine };
+
+        for(int i = 0; i < 5; ++i) {
+            pending.push_back(shoc::coro::status_awaitable<>::create_space(engine.receptables()));
+            engine.submit_task(tasks[i].handle(), pending.back().receptable_ptr());
+        }
+
+        co_return;
+    } (tasks);
+
+    boost::cobalt::run(std::move(task));
+
+    // within the batch, only tasks that another one of the same context follows are submitted
+    ASSERT_EQ(fake_submission::attempts.size(), 5);
+
+    for(int i = 0; i < 3; ++i) {
+        EXPECT_EQ(fake_submission::attempts[i].flags, DOCA_TASK_SUBMIT_FLAG_NONE);
+    }
+
+    for(auto &t : tasks) {
+        EXPECT_EQ(fake_submission::submissions(&t), 1);
+    }
+
+    EXPECT_TRUE(fake_submission::doorbell_rung(a));
+    EXPECT_TRUE(fake_submission::doorbell_rung(b));
+}
+
+TEST(docapp_engine, batch_falls_back_to_retry_queue) {
+    using fake_submission::fake_task;
+
+    auto report = std::string { "not started" };
+    auto a = fake_submission::context(0);
+    auto b = fake_submission::context(1);
+
+    // the first task's deferred submission and all its immediate resubmissions find the queue full
+    fake_task tasks[] = { { a, 4 }, { b }, { a } };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        fake_task *tasks,
+        shoc::submission_stats *in_batch,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto pending = std::vector<shoc::coro::status_awaitable<>> {};
+
+            {
+                auto batch = shoc::submission_batch { engine };
+
+                for(int i = 0; i < 3; ++i) {
+                    pending.push_back(shoc::coro::status_awaitable<>::create_space(engine->receptables()));
+                    engine->submit_task(tasks[i].handle(), pending.back().receptable_ptr());
+                }
+            }
+
+            *in_batch = engine->submit_stats();
+
+            while(engine->submit_stats().retry_queue_depth > 0) {
+                co_await engine->yield();
+            }
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto in_batch = shoc::submission_stats {};
+    auto after = shoc::submission_stats {};
+
+    auto task = [](
+        auto fiber_fn,
+        fake_task *tasks,
+        shoc::submission_stats *in_batch,
+        shoc::submission_stats *after,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine { fake_submission::config() };
+
+        fiber_fn(&engine, tasks, in_batch, report);
+
+        co_await engine.run();
+
+        *after = engine.submit_stats();
+    } (
+        fiber_fn,
+        tasks,
+        &in_batch,
+        &after,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    EXPECT_EQ("", report);
+
+    // the first task went to the retry queue, and the second one of its context behind it
+    EXPECT_EQ(in_batch.queued, 2);
+    EXPECT_EQ(after.resubmitted, 2);
+    EXPECT_EQ(after.retry_queue_depth, 0);
+
+    for(auto &t : tasks) {
+        EXPECT_EQ(fake_submission::submissions(&t), 1);
+    }
+
+    auto first_submitted = std::ranges::find_if(fake_submission::attempts, [&](auto const &attempt) {
+        return attempt.task->ctx == a && attempt.result == DOCA_SUCCESS;
+    });
+
+    ASSERT_NE(first_submitted, fake_submission::attempts.end());
+    EXPECT_EQ(first_submitted->task, &tasks[0]);
+    EXPECT_TRUE(fake_submission::doorbell_rung(a));
+    EXPECT_TRUE(fake_submission::doorbell_rung(b));
+}
+
+TEST(docapp_engine, failed_batch_submissions_resume_waiters) {
+    using fake_submission::fake_task;
+
+    auto report = std::string { "not started" };
+    auto a = fake_submission::context(0);
+    fake_task tasks[] = { { a, 0, DOCA_ERROR_INVALID_VALUE }, { a, 0, DOCA_ERROR_NOT_PERMITTED } };
+    doca_error_t statuses[] = { DOCA_SUCCESS, DOCA_SUCCESS };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        fake_task *tasks,
+        doca_error_t *statuses,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto batch = shoc::submission_batch { engine };
+
+            auto first = shoc::coro::status_awaitable<>::create_space(engine->receptables());
+            engine->submit_task(tasks[0].handle(), first.receptable_ptr());
+            auto second = shoc::coro::status_awaitable<>::create_space(engine->receptables());
+            engine->submit_task(tasks[1].handle(), second.receptable_ptr());
+
+            // the first task was submitted when the second one came in and failed right there.
+            statuses[0] = co_await first;
+
+            // the second one is held back while we wait for it, until the engine flushes it.
+            statuses[1] = co_await second;
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        fake_task *tasks,
+        doca_error_t *statuses,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine { fake_submission::config() };
+
+        fiber_fn(&engine, tasks, statuses, report);
+
+        co_await engine.run();
+    } (
+        fiber_fn,
+        tasks,
+        statuses,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    EXPECT_EQ("", report);
+    EXPECT_EQ(statuses[0], DOCA_ERROR_INVALID_VALUE);
+    EXPECT_EQ(statuses[1], DOCA_ERROR_NOT_PERMITTED);
+    EXPECT_TRUE(tasks[0].freed);
+    EXPECT_TRUE(tasks[1].freed);
+}
+
+TEST(docapp_engine, destruction_fails_queued_retries) {
+    using fake_submission::fake_task;
+
+    auto report = std::string { "not started" };
+
+    // never gets a slot, so it stays in the retry queue until the engine goes away
+    auto stuck = fake_task { fake_submission::context(0), 1 << 20 };
+    auto status = DOCA_SUCCESS;
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        fake_task *task,
+        doca_error_t *status,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto awaitable = shoc::coro::status_awaitable<>::create_space(engine->receptables());
+            engine->submit_task(task->handle(), awaitable.receptable_ptr());
+
+            CO_ASSERT_EQ(engine->submit_stats().retry_queue_depth, 1, "task was not queued for retry");
+
+            *status = co_await awaitable;
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        fake_task *task,
+        doca_error_t *status,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine { fake_submission::config() };
+
+        fiber_fn(&engine, task, status, report);
+
+        co_return;
+    } (
+        fiber_fn,
+        &stuck,
+        &status,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    EXPECT_EQ("", report);
+    EXPECT_EQ(status, DOCA_ERROR_SHUTDOWN);
+    EXPECT_TRUE(stuck.freed);
+}
@@ -0,0 +1,84 @@
+#include <shoc/progress_engine_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace {
+    auto record_thread(
+        shoc::progress_engine_lease engine,
+        std::mutex *mutex,
+        std::set<std::thread::id> *threads,
+        std::atomic<int> *ran
+    ) -> boost::cobalt::detached {
+        co_await engine.yield();
+
+        auto lock = std::lock_guard { *mutex };
+        threads->insert(std::this_thread::get_id());
+        ++*ran;
+    }
+}
+
+TEST(docapp_engine_pool, round_robin_placement) {
+    auto ran = std::atomic<int> { 0 };
+    auto mutex = std::mutex {};
+    auto threads = std::set<std::thread::id> {};
+
+    {
+        auto pool = shoc::progress_engine_pool {
+            shoc::progress_engine_pool_config {
+                .engine_count = 2,
+                .pin_threads = false
+            }
+        };
+
+        ASSERT_EQ(pool.size(), 2);
+
+        for(int i = 0; i < 4; ++i) {
+            pool.post([&](shoc::progress_engine_lease engine) {
+                return record_thread(std::move(engine), &mutex, &threads, &ran);
+            });
+        }
+    }
+
+    EXPECT_EQ(ran, 4);
+    EXPECT_EQ(threads.size(), 2);
+    EXPECT_EQ(threads.count(std::this_thread::get_id()), 0);
+}
+
+TEST(docapp_engine_pool, cross_shard_post) {
+    auto done = std::atomic<bool> { false };
+
+    {
+        auto pool = shoc::progress_engine_pool {
+            shoc::progress_engine_pool_config {
+                .engine_count = 2,
+                .pin_threads = false
+            }
+        };
+
+        auto key = std::size_t { 42 };
+        auto home = pool.shard_for(key);
+
+        pool.post_to(1 - home, [&](shoc::progress_engine_lease) {
+            auto origin = std::this_thread::get_id();
+
+            pool.post_by_key(key, [&, origin](shoc::progress_engine_lease engine) {
+                EXPECT_TRUE(static_cast<bool>(engine));
+                EXPECT_NE(origin, std::this_thread::get_id());
+                done = true;
+                done.notify_all();
+            });
+        });
+
+        // the pool must not shut down before the second post happened
+        done.wait(false);
+    }
+
+    EXPECT_TRUE(done);
+}
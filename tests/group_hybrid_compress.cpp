@@ -0,0 +1,341 @@
+#include <shoc/aligned_memory.hpp>
+#include <shoc/buffer_inventory.hpp>
+#include <shoc/compress.hpp>
+#include <shoc/cpu_compress.hpp>
+#include <shoc/device.hpp>
+#include <shoc/hybrid_compress.hpp>
+#include <shoc/memory_map.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CO_FAIL(message) do { *report = (message); co_return; } while(false)
+#define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
+
+#define CO_ASSERT_EQ(val1, val2, message) CO_ASSERT((val1) == (val2), message)
+#define CO_ASSERT_NE(val1, val2, message) CO_ASSERT((val1) != (val2), message)
+#define CO_ASSERT_LT(val1, val2, message) CO_ASSERT((val1) <  (val2), message)
+#define CO_ASSERT_LE(val1, val2, message) CO_ASSERT((val1) <= (val2), message)
+#define CO_ASSERT_GT(val1, val2, message) CO_ASSERT((val1) >  (val2), message)
+#define CO_ASSERT_GE(val1, val2, message) CO_ASSERT((val1) >= (val2), message)
+
+namespace {
+    /**
+     * Backend whose tasks complete only when the test says so, oldest first
+     */
+    class stub_compress_backend:
+        public shoc::compress_backend
+    {
+    public:
+        explicit stub_compress_backend(bool supports_lz4_stream = true):
+            supports_lz4_stream_ { supports_lz4_stream }
+        {}
+
+        [[nodiscard]] auto supports(shoc::compress_operation op) const noexcept -> bool override {
+            return op != shoc::compress_operation::decompress_lz4_stream || supports_lz4_stream_;
+        }
+
+        auto compress(shoc::buffer const &, shoc::buffer &, shoc::compress_checksums *) -> shoc::compress_awaitable override {
+            return submit();
+        }
+
+        auto decompress(shoc::buffer const &, shoc::buffer &, shoc::compress_checksums *) -> shoc::compress_awaitable override {
+            return submit();
+        }
+
+        auto decompress_lz4_block(shoc::buffer const &, shoc::buffer &, shoc::compress_checksums *) -> shoc::compress_awaitable override {
+            return submit();
+        }
+
+        auto decompress_lz4_stream(bool, bool, shoc::buffer const &, shoc::buffer &, shoc::compress_checksums *) -> shoc::compress_awaitable override {
+            return submit();
+        }
+
+        [[nodiscard]] auto submitted() const noexcept { return submitted_; }
+        [[nodiscard]] auto pending() const noexcept { return pending_.size(); }
+
+        auto complete_oldest(doca_error_t status = DOCA_SUCCESS) -> void {
+            auto receptable = pending_.front();
+            pending_.pop_front();
+
+            receptable->emplace_value(status);
+            receptable->resume();
+        }
+
+    private:
+        auto submit() -> shoc::compress_awaitable {
+            auto result = shoc::compress_awaitable::create_space();
+
+            pending_.push_back(result.receptable_ptr());
+            ++submitted_;
+
+            return result;
+        }
+
+        bool supports_lz4_stream_;
+        std::size_t submitted_ = 0;
+        std::deque<shoc::compress_awaitable::payload_type *> pending_;
+    };
+}
+
+TEST(hybrid_compress, waits_for_room_instead_of_overcommitting) {
+    auto report = std::string { "fiber not started" };
+
+    auto task = [](
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        *report = "";
+
+        auto dev = shoc::device::find(shoc::device_capability::dma);
+        auto blocks = shoc::aligned_blocks { 6, 4096 };
+        auto mmap = shoc::memory_map { dev, blocks.as_writable_bytes() };
+        auto inv = shoc::buffer_inventory { 12 };
+        auto src = inv.buf_get_blocks_by_data(mmap, blocks);
+        auto dst = inv.buf_get_blocks(mmap, blocks);
+
+        auto hw = stub_compress_backend {};
+        auto sw = std::make_shared<stub_compress_backend>(false);
+
+        auto cfg = shoc::hybrid_compress_config {};
+        cfg.hardware_max_inflight = 2;
+        cfg.software_max_inflight = 2;
+
+        auto hybrid = shoc::hybrid_compress_scheduler { hw, sw, cfg };
+        auto pending = std::vector<shoc::compress_awaitable> {};
+
+        // with equal rates, the tasks alternate between the paths until both are full
+        for(auto i = std::size_t { 0 }; i < 5; ++i) {
+            pending.push_back(hybrid.compress(src[i], dst[i]));
+        }
+
+        pending.push_back(hybrid.decompress_lz4_stream(false, false, src[5], dst[5]));
+
+        CO_ASSERT_EQ(hw.submitted(), 2, "device got more than its queue depth");
+        CO_ASSERT_EQ(sw->submitted(), 2, "CPU got more than its queue depth");
+        CO_ASSERT_EQ(hybrid.stats().waiting, 2, "tasks were not held back");
+
+        // the oldest waiting task takes the slot; the next one only fits on the device
+        sw->complete_oldest();
+
+        CO_ASSERT_EQ(sw->submitted(), 3, "waiting task did not take the free slot");
+        CO_ASSERT_EQ(hw.submitted(), 2, "device got more than its queue depth");
+        CO_ASSERT_EQ(hybrid.stats().waiting, 1, "device-only task did not wait for the device");
+
+        hw.complete_oldest();
+
+        CO_ASSERT_EQ(hw.submitted(), 3, "device-only task did not start");
+        CO_ASSERT_EQ(hybrid.stats().waiting, 0, "tasks still waiting");
+        CO_ASSERT_EQ(hybrid.stats().hardware.inflight, 2, "wrong in-flight count");
+
+        hw.complete_oldest();
+        hw.complete_oldest(DOCA_ERROR_IO_FAILED);
+        sw->complete_oldest();
+        sw->complete_oldest();
+
+        for(auto i = std::size_t { 0 }; i < 5; ++i) {
+            auto status = co_await pending[i];
+            CO_ASSERT_EQ(DOCA_SUCCESS, status, std::string { "task failed: " } + doca_error_get_descr(status));
+        }
+
+        CO_ASSERT_EQ(DOCA_ERROR_IO_FAILED, co_await pending[5], "failure was not passed on");
+
+        auto stats = hybrid.stats();
+
+        CO_ASSERT_EQ(stats.hardware.tasks, 3, "wrong device task count");
+        CO_ASSERT_EQ(stats.software.tasks, 3, "wrong CPU task count");
+        CO_ASSERT_EQ(stats.hardware.failed, 1, "failure was not counted");
+        CO_ASSERT_EQ(stats.hardware.bytes + stats.software.bytes, 5 * blocks.block_size(), "wrong byte count");
+        CO_ASSERT_EQ(stats.hardware.inflight + stats.software.inflight, 0, "tasks still counted as in flight");
+    }(
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
+
+TEST(hybrid_compress, routes_by_measured_rate) {
+    auto report = std::string { "fiber not started" };
+
+    auto task = [](
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        *report = "";
+
+        auto dev = shoc::device::find(shoc::device_capability::dma);
+        auto blocks = shoc::aligned_blocks { 4, 4096 };
+        auto mmap = shoc::memory_map { dev, blocks.as_writable_bytes() };
+        auto inv = shoc::buffer_inventory { 8 };
+        auto src = inv.buf_get_blocks_by_data(mmap, blocks);
+        auto dst = inv.buf_get_blocks(mmap, blocks);
+
+        auto hw = stub_compress_backend {};
+        auto sw = std::make_shared<stub_compress_backend>();
+
+        auto cfg = shoc::hybrid_compress_config {};
+        cfg.hardware_max_inflight = 2;
+        cfg.software_max_inflight = 2;
+        cfg.smoothing = 1;
+        cfg.initial_rate = 1e9;
+
+        auto hybrid = shoc::hybrid_compress_scheduler { hw, sw, cfg };
+
+        // a 4 KiB task that takes at least 10 ms makes the device look slower than 410 KB/s
+        auto first = hybrid.compress(src[0], dst[0]);
+        CO_ASSERT_EQ(hw.submitted(), 1, "tie did not go to the device");
+
+        std::this_thread::sleep_for(std::chrono::milliseconds { 10 });
+        hw.complete_oldest();
+        CO_ASSERT_EQ(DOCA_SUCCESS, co_await first, "task failed");
+
+        CO_ASSERT_LT(hybrid.stats().hardware.rate, 4096 / 0.01 + 1, "device rate was not measured");
+        CO_ASSERT_EQ(hybrid.stats().software.rate, cfg.initial_rate, "CPU rate changed without completions");
+
+        // the CPU is predicted to finish first until it is full
+        auto pending = std::vector<shoc::compress_awaitable> {};
+
+        for(auto i = std::size_t { 1 }; i < 4; ++i) {
+            pending.push_back(hybrid.compress(src[i], dst[i]));
+        }
+
+        CO_ASSERT_EQ(sw->submitted(), 2, "CPU did not get the work");
+        CO_ASSERT_EQ(hw.submitted(), 2, "full CPU did not spill over to the device");
+
+        hw.complete_oldest();
+        sw->complete_oldest();
+        sw->complete_oldest();
+
+        for(auto &pending_task : pending) {
+            CO_ASSERT_EQ(DOCA_SUCCESS, co_await pending_task, "task failed");
+        }
+
+        auto stats = hybrid.stats();
+
+        CO_ASSERT_EQ(stats.software.bytes, 2 * blocks.block_size(), "wrong CPU byte count");
+        CO_ASSERT_EQ(stats.hardware.bytes, 2 * blocks.block_size(), "wrong device byte count");
+        CO_ASSERT_GT(stats.hardware.busy_time.count(), 0, "device busy time was not measured");
+    }(
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
+
+
+TEST(docapp_hybrid_compress, splits_between_paths) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto constexpr chunks = std::size_t { 16 };
+            auto constexpr chunk_size = std::size_t { 4096 };
+
+            auto text = std::string {};
+
+            for(int i = 0; text.size() < chunks * chunk_size; ++i) {
+                text += "line " + std::to_string(i) + ": Lorem ipsum dolor sit amet, consetetur sadipscing elitr\n";
+            }
+
+            text.resize(chunks * chunk_size);
+
+            auto dev = shoc::device::find(shoc::device_capability::compress_deflate);
+
+            auto src_blocks = shoc::aligned_blocks { chunks, chunk_size };
+            auto dst_blocks = shoc::aligned_blocks { chunks, 2 * chunk_size };
+            auto out_blocks = shoc::aligned_blocks { chunks, chunk_size };
+            src_blocks.assign(std::as_bytes(std::span { text }));
+
+            auto src_mmap = shoc::memory_map { dev, src_blocks.as_writable_bytes() };
+            auto dst_mmap = shoc::memory_map { dev, dst_blocks.as_writable_bytes() };
+            auto out_mmap = shoc::memory_map { dev, out_blocks.as_writable_bytes() };
+            auto inv = shoc::buffer_inventory { 3 * chunks };
+
+            auto src = inv.buf_get_blocks_by_data(src_mmap, src_blocks);
+            auto dst = inv.buf_get_blocks(dst_mmap, dst_blocks);
+            auto out = inv.buf_get_blocks(out_mmap, out_blocks);
+
+            auto ctx = co_await shoc::compress_context::create(engine, dev, 4);
+
+            auto cfg = shoc::hybrid_compress_config {};
+            cfg.hardware_max_inflight = 2;
+            cfg.software_max_inflight = 2;
+
+            auto cpu = std::make_shared<shoc::cpu_compress_backend>(shoc::cpu_compress_config { .threads = 2, .deflate_level = 1 });
+            auto hybrid = shoc::hybrid_compress_scheduler { *ctx, cpu, cfg };
+
+            auto pending = std::vector<shoc::compress_awaitable>{};
+
+            for(auto i = std::size_t { 0 }; i < chunks; ++i) {
+                pending.push_back(hybrid.compress(src[i], dst[i]));
+            }
+
+            for(auto &task : pending) {
+                auto status = co_await task;
+                CO_ASSERT_EQ(DOCA_SUCCESS, status, std::string { "compression failed: " } + doca_error_get_descr(status));
+            }
+
+            auto stats = hybrid.stats();
+
+            CO_ASSERT_EQ(stats.hardware.tasks + stats.software.tasks, chunks, "tasks went missing");
+            CO_ASSERT_GT(stats.hardware.tasks, 0, "device got no work");
+            CO_ASSERT_GT(stats.software.tasks, 0, "CPU got no work");
+            CO_ASSERT_EQ(stats.hardware.inflight + stats.software.inflight, 0, "tasks still counted as in flight");
+            CO_ASSERT_EQ(stats.hardware.bytes + stats.software.bytes, text.size(), "wrong byte count");
+
+            // whichever path compressed a chunk, the output is plain deflate
+            for(auto i = std::size_t { 0 }; i < chunks; ++i) {
+                auto status = co_await cpu->decompress(dst[i], out[i]);
+
+                CO_ASSERT_EQ(DOCA_SUCCESS, status, std::string { "decompression failed: " } + doca_error_get_descr(status));
+                CO_ASSERT(std::ranges::equal(out[i].data<std::byte>(), src_blocks.block(i)), "decompressed data is different from source data");
+            }
+
+            co_await ctx->stop();
+        } catch(shoc::doca_exception &e) {
+            // Bluefield 3 has no compression device, only decompression
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
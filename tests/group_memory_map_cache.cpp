@@ -0,0 +1,78 @@
+#include <shoc/aligned_memory.hpp>
+#include <shoc/device.hpp>
+#include <shoc/memory_map_cache.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <span>
+#include <tuple>
+
+TEST(memory_map_cache, reuses_covering_registration) {
+    auto dev = shoc::device::find(shoc::device_capability::dma);
+    auto mem = shoc::aligned_memory { 1 << 16 };
+    auto cache = shoc::memory_map_cache {};
+
+    auto whole = cache.get(dev, mem.as_writable_bytes());
+    auto part = cache.get(dev, mem.as_writable_bytes().subspan(4096, 4096));
+
+    EXPECT_EQ(whole, part);
+    EXPECT_EQ(cache.stats().hits, 1);
+    EXPECT_EQ(cache.stats().misses, 1);
+    EXPECT_EQ(cache.stats().entries, 1);
+    EXPECT_EQ(cache.stats().pinned_bytes, mem.as_bytes().size());
+
+    // different permissions need a registration of their own
+    auto read_only = cache.get(dev, mem.as_writable_bytes(), DOCA_ACCESS_FLAG_LOCAL_READ_ONLY);
+
+    EXPECT_NE(whole, read_only);
+    EXPECT_EQ(cache.stats().misses, 2);
+    EXPECT_EQ(cache.stats().entries, 2);
+}
+
+TEST(memory_map_cache, merges_overlapping_registrations) {
+    auto dev = shoc::device::find(shoc::device_capability::dma);
+    auto mem = shoc::aligned_memory { 1 << 16 };
+    auto bytes = mem.as_writable_bytes();
+    auto cache = shoc::memory_map_cache {};
+
+    auto front = cache.get(dev, bytes.subspan(0, 8192));
+    auto back = cache.get(dev, bytes.subspan(16384, 8192));
+
+    EXPECT_EQ(cache.stats().entries, 2);
+
+    auto middle = cache.get(dev, bytes.subspan(4096, 16384));
+
+    EXPECT_EQ(cache.stats().extensions, 1);
+    EXPECT_EQ(cache.stats().entries, 1);
+    EXPECT_EQ(middle->span().data(), bytes.data());
+    EXPECT_EQ(middle->span().size(), 24576);
+
+    // the replaced registrations stay valid for those holding them
+    EXPECT_EQ(front->span().size(), 8192);
+    EXPECT_EQ(back->span().size(), 8192);
+
+    EXPECT_EQ(cache.get(dev, bytes.subspan(16384, 4096)), middle);
+}
+
+TEST(memory_map_cache, evicts_unused_registrations_over_budget) {
+    auto dev = shoc::device::find(shoc::device_capability::dma);
+    auto mem = shoc::aligned_memory { 1 << 16 };
+    auto bytes = mem.as_writable_bytes();
+    auto cache = shoc::memory_map_cache { 16384 };
+
+    auto held = cache.get(dev, bytes.subspan(0, 8192));
+    std::ignore = cache.get(dev, bytes.subspan(16384, 8192));
+    std::ignore = cache.get(dev, bytes.subspan(32768, 8192));
+
+    // the second registration is the least recently used one that isn't held
+    EXPECT_EQ(cache.stats().evictions, 1);
+    EXPECT_EQ(cache.stats().entries, 2);
+    EXPECT_EQ(cache.stats().pinned_bytes, 16384);
+    EXPECT_EQ(cache.get(dev, bytes.subspan(0, 4096)), held);
+
+    cache.invalidate(bytes);
+
+    EXPECT_EQ(cache.stats().entries, 0);
+    EXPECT_EQ(cache.stats().pinned_bytes, 0);
+}
@@ -0,0 +1,250 @@
+#include <shoc/cpu_sha.hpp>
+#include <shoc/device.hpp>
+#include <shoc/merkle_hasher.hpp>
+#include <shoc/progress_engine.hpp>
+#include <shoc/sha.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#define CO_FAIL(message) do { *report = (message); co_return; } while(false)
+#define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
+
+#define CO_ASSERT_EQ(val1, val2, message) CO_ASSERT((val1) == (val2), message)
+#define CO_ASSERT_NE(val1, val2, message) CO_ASSERT((val1) != (val2), message)
+#define CO_ASSERT_LT(val1, val2, message) CO_ASSERT((val1) <  (val2), message)
+#define CO_ASSERT_LE(val1, val2, message) CO_ASSERT((val1) <= (val2), message)
+#define CO_ASSERT_GT(val1, val2, message) CO_ASSERT((val1) >  (val2), message)
+#define CO_ASSERT_GE(val1, val2, message) CO_ASSERT((val1) >= (val2), message)
+
+namespace {
+    auto random_bytes(std::size_t size, std::uint32_t seed) -> std::vector<std::byte> {
+        auto rng = std::mt19937 { seed };
+        auto result = std::vector<std::byte>(size);
+
+        for(auto &b : result) {
+            b = static_cast<std::byte>(rng());
+        }
+
+        return result;
+    }
+
+    auto prefixed_hash(std::byte prefix, std::span<std::byte const> a, std::span<std::byte const> b = {}) -> shoc::sha_digest {
+        auto message = std::vector<std::byte> { prefix };
+        message.insert(message.end(), a.begin(), a.end());
+        message.insert(message.end(), b.begin(), b.end());
+
+        return shoc::sha_hash(DOCA_SHA_ALGORITHM_SHA256, message);
+    }
+
+    /**
+     * MTH from RFC 6962, section 2.1, written down as directly as possible
+     */
+    auto reference_root(std::span<std::byte const> data, std::size_t leaf_size) -> shoc::sha_digest {
+        if(data.size() <= leaf_size) {
+            return prefixed_hash(std::byte { 0x00 }, data);
+        }
+
+        auto leaves = (data.size() + leaf_size - 1) / leaf_size;
+        auto k = std::size_t { 1 };
+
+        while(k * 2 < leaves) {
+            k *= 2;
+        }
+
+        auto left = reference_root(data.first(k * leaf_size), leaf_size);
+        auto right = reference_root(data.subspan(k * leaf_size), leaf_size);
+
+        return prefixed_hash(std::byte { 0x01 }, left.data(), right.data());
+    }
+}
+
+TEST(docapp_merkle_hasher, software) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        [[maybe_unused]] shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto backend = std::make_shared<shoc::cpu_sha_backend>(shoc::cpu_sha_config { .threads = 2 });
+            auto data = random_bytes(100000, 3);
+
+            // leaves shorter than a block, exactly a block with the prefix, and many blocks
+            for(auto leaf_size : { std::size_t { 10 }, std::size_t { 63 }, std::size_t { 1000 }, std::size_t { 4096 } }) {
+                auto hasher = shoc::merkle_hasher { { .leaf_size = leaf_size, .max_tasks = 4, .software = backend } };
+
+                CO_ASSERT(!hasher.on_device(), "software hasher claims to be on a device");
+
+                // no leaves, one leaf, and leaf counts that are and aren't powers of two
+                for(auto size : { std::size_t { 0 }, leaf_size / 2 + 1, 4 * leaf_size, 7 * leaf_size - 3, data.size() }) {
+                    auto input = std::span { data }.first(size);
+                    auto tree = co_await hasher.hash(input);
+                    auto expected = size == 0
+                        ? shoc::sha_hash(DOCA_SHA_ALGORITHM_SHA256, {})
+                        : reference_root(input, leaf_size);
+
+                    CO_ASSERT_EQ(tree.root(), expected, "root differs from the RFC 6962 reference");
+                    CO_ASSERT_EQ(tree.levels.size(), 1u, "tree has levels without keep_tree");
+                }
+            }
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
+
+TEST(docapp_merkle_hasher, keep_tree) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        [[maybe_unused]] shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            // five leaves: ((0 1) (2 3)) 4, so leaf 4 moves up two levels unchanged and shows up
+            // on both
+            auto data = random_bytes(5 * 256 - 100, 9);
+            auto hasher = shoc::merkle_hasher { { .leaf_size = 256, .max_tasks = 2, .keep_tree = true } };
+            auto tree = co_await hasher.hash(data);
+
+            auto leaf = [&](std::size_t i) {
+                auto input = std::span<std::byte const> { data }.subspan(i * 256);
+                return prefixed_hash(std::byte { 0x00 }, input.first(std::min<std::size_t>(256, input.size())));
+            };
+
+            auto node = [&](std::size_t level, std::size_t i) {
+                auto node = tree.node(level, i);
+                return std::vector<std::byte>(node.begin(), node.end());
+            };
+
+            auto bytes = [](shoc::sha_digest const &digest) {
+                return std::vector<std::byte>(digest.data().begin(), digest.data().end());
+            };
+
+            CO_ASSERT_EQ(tree.leaf_count, 5u, "wrong leaf count");
+            CO_ASSERT_EQ(tree.levels.size(), 4u, "wrong number of levels");
+            CO_ASSERT_EQ(tree.level_size(0), 5u, "wrong number of leaves");
+            CO_ASSERT_EQ(tree.level_size(1), 3u, "wrong number of nodes on level 1");
+            CO_ASSERT_EQ(tree.level_size(2), 2u, "wrong number of nodes on level 2");
+            CO_ASSERT_EQ(tree.level_size(3), 1u, "more than one root");
+
+            for(auto i = std::size_t { 0 }; i < 5; ++i) {
+                CO_ASSERT_EQ(node(0, i), bytes(leaf(i)), "wrong leaf hash");
+            }
+
+            auto n01 = prefixed_hash(std::byte { 0x01 }, leaf(0).data(), leaf(1).data());
+            auto n23 = prefixed_hash(std::byte { 0x01 }, leaf(2).data(), leaf(3).data());
+            auto n0123 = prefixed_hash(std::byte { 0x01 }, n01.data(), n23.data());
+
+            CO_ASSERT_EQ(node(1, 0), bytes(n01), "wrong interior node");
+            CO_ASSERT_EQ(node(1, 1), bytes(n23), "wrong interior node");
+            CO_ASSERT_EQ(node(1, 2), bytes(leaf(4)), "unpaired node was not promoted as is");
+            CO_ASSERT_EQ(node(2, 0), bytes(n0123), "wrong interior node");
+            CO_ASSERT_EQ(node(2, 1), bytes(leaf(4)), "unpaired node was not promoted as is");
+            CO_ASSERT_EQ(tree.root(), reference_root(data, 256), "root differs from the RFC 6962 reference");
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
+
+TEST(docapp_merkle_hasher, device) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto dev = shoc::device::find(shoc::device_capability::sha);
+            auto ctx = co_await shoc::sha_context::create(engine, dev, 8);
+            auto hasher = shoc::merkle_hasher { *ctx, dev, { .leaf_size = 16 * 1024, .max_tasks = 8 } };
+
+            // more leaves than slots, and a short last one
+            auto data = random_bytes(37 * 16 * 1024 + 500, 5);
+            auto tree = co_await hasher.hash(data);
+
+            CO_ASSERT(hasher.on_device(), "hasher fell back to software on a SHA device");
+            CO_ASSERT_EQ(tree.root(), reference_root(data, 16 * 1024), "device root differs from the RFC 6962 reference");
+
+            co_await ctx->stop();
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                // no doca_sha on BF-3, and crypto-disabled BF-2s
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
@@ -0,0 +1,173 @@
+#include <shoc/buffer.hpp>
+#include <shoc/buffer_inventory.hpp>
+#include <shoc/device.hpp>
+#include <shoc/dma.hpp>
+#include <shoc/memory_map.hpp>
+#include <shoc/offload_window.hpp>
+#include <shoc/progress_engine.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <string>
+#include <vector>
+
+#define CO_FAIL(message) do { *report = (message); co_return; } while(false)
+#define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
+
+#define CO_ASSERT_EQ(val1, val2, message) CO_ASSERT((val1) == (val2), message)
+#define CO_ASSERT_NE(val1, val2, message) CO_ASSERT((val1) != (val2), message)
+#define CO_ASSERT_LT(val1, val2, message) CO_ASSERT((val1) <  (val2), message)
+#define CO_ASSERT_LE(val1, val2, message) CO_ASSERT((val1) <= (val2), message)
+#define CO_ASSERT_GT(val1, val2, message) CO_ASSERT((val1) >  (val2), message)
+#define CO_ASSERT_GE(val1, val2, message) CO_ASSERT((val1) >= (val2), message)
+
+TEST(docapp_offload_window, controller_starts_at_configured_window) {
+    auto full = shoc::offload_window_controller { { .max_window = 8 } };
+    EXPECT_EQ(full.target(), 8);
+
+    auto partial = shoc::offload_window_controller { { .max_window = 8, .initial_window = 3 } };
+    EXPECT_EQ(partial.target(), 3);
+
+    auto clamped = shoc::offload_window_controller { { .max_window = 8, .initial_window = 20 } };
+    EXPECT_EQ(clamped.target(), 8);
+}
+
+TEST(docapp_offload_window, controller_halves_on_congestion) {
+    auto controller = shoc::offload_window_controller { { .max_window = 16, .min_window = 2 } };
+
+    controller.on_congestion(16);
+    EXPECT_EQ(controller.target(), 8);
+
+    // congestion with fewer tasks in flight than the window is based on what was in flight.
+    controller.on_congestion(6);
+    EXPECT_EQ(controller.target(), 3);
+
+    controller.on_congestion(3);
+    EXPECT_EQ(controller.target(), 2);
+
+    controller.on_congestion(2);
+    EXPECT_EQ(controller.target(), 2);
+}
+
+TEST(docapp_offload_window, controller_grows_by_one_per_window) {
+    auto controller = shoc::offload_window_controller { { .max_window = 6, .initial_window = 4 } };
+
+    for(int i = 0; i < 3; ++i) {
+        controller.on_completion();
+    }
+
+    EXPECT_EQ(controller.target(), 4);
+
+    controller.on_completion();
+    EXPECT_EQ(controller.target(), 5);
+
+    for(int i = 0; i < 5; ++i) {
+        controller.on_completion();
+    }
+
+    EXPECT_EQ(controller.target(), 6);
+
+    for(int i = 0; i < 20; ++i) {
+        controller.on_completion();
+    }
+
+    EXPECT_EQ(controller.target(), 6);
+}
+
+TEST(docapp_offload_window, drives_dma_copies) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto constexpr chunk_count = std::size_t { 64 };
+            auto constexpr chunk_size = std::size_t { 256 };
+            auto constexpr max_tasks = std::uint32_t { 4 };
+
+            auto dev = shoc::device::find(shoc::device_capability::dma);
+            auto ctx = co_await shoc::dma_context::create(engine, dev, max_tasks);
+
+            auto src_data = std::vector<char>(chunk_count * chunk_size);
+            auto dst_data = std::vector<char>(src_data.size());
+
+            for(std::size_t i = 0; i < src_data.size(); ++i) {
+                src_data[i] = static_cast<char>(i * 7 + i / chunk_size);
+            }
+
+            auto src_mmap = shoc::memory_map { dev, src_data };
+            auto dst_mmap = shoc::memory_map { dev, dst_data };
+            auto buf_inv = shoc::buffer_inventory { 2 * chunk_count };
+            auto src = std::vector<shoc::buffer> {};
+            auto dst = std::vector<shoc::buffer> {};
+
+            for(std::size_t i = 0; i < chunk_count; ++i) {
+                src.push_back(buf_inv.buf_get_by_data(src_mmap, std::span<char const> { src_data }.subspan(i * chunk_size, chunk_size)));
+                dst.push_back(buf_inv.buf_get_by_addr(dst_mmap, std::span<char const> { dst_data }.subspan(i * chunk_size, chunk_size)));
+            }
+
+            auto results = shoc::offload_window(
+                engine,
+                *ctx,
+                std::views::iota(std::size_t { 0 }, chunk_count),
+                [&](std::size_t i) { return ctx->memcpy(src[i], dst[i]); },
+                { .max_window = max_tasks }
+            );
+
+            // the generator has to be consumed to the end, so failures are only counted here.
+            auto seen = std::vector<int>(chunk_count);
+            auto failed = 0;
+
+            while(auto result = co_await results) {
+                ++seen[result->index];
+
+                if(result->value != DOCA_SUCCESS) {
+                    ++failed;
+                }
+            }
+
+            CO_ASSERT_EQ(failed, 0, "dma memcpy failed");
+            CO_ASSERT(std::ranges::all_of(seen, [](int n) { return n == 1; }), "not every chunk was delivered exactly once");
+            CO_ASSERT(std::ranges::equal(src_data, dst_data), "destination data is different from source data");
+
+            co_await ctx->stop();
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                // no dma-capable device
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
@@ -0,0 +1,222 @@
+#include <shoc/cpu_sha.hpp>
+#include <shoc/device.hpp>
+#include <shoc/progress_engine.hpp>
+#include <shoc/sha.hpp>
+#include <shoc/sha_stream.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/cobalt.hpp>
+
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#define CO_FAIL(message) do { *report = (message); co_return; } while(false)
+#define CO_ASSERT(condition, message) do { if(!(condition)) { CO_FAIL(message); } } while(false)
+
+#define CO_ASSERT_EQ(val1, val2, message) CO_ASSERT((val1) == (val2), message)
+#define CO_ASSERT_NE(val1, val2, message) CO_ASSERT((val1) != (val2), message)
+#define CO_ASSERT_LT(val1, val2, message) CO_ASSERT((val1) <  (val2), message)
+#define CO_ASSERT_LE(val1, val2, message) CO_ASSERT((val1) <= (val2), message)
+#define CO_ASSERT_GT(val1, val2, message) CO_ASSERT((val1) >  (val2), message)
+#define CO_ASSERT_GE(val1, val2, message) CO_ASSERT((val1) >= (val2), message)
+
+namespace {
+    auto hex(shoc::sha_digest const &digest) -> std::string {
+        auto result = std::string {};
+
+        for(auto b : digest.data()) {
+            result += fmt::format("{:02x}", static_cast<unsigned>(b));
+        }
+
+        return result;
+    }
+
+    auto random_bytes(std::size_t size, std::uint32_t seed) -> std::vector<std::byte> {
+        auto rng = std::mt19937 { seed };
+        auto result = std::vector<std::byte>(size);
+
+        for(auto &b : result) {
+            b = static_cast<std::byte>(rng());
+        }
+
+        return result;
+    }
+}
+
+TEST(cpu_sha, known_answers) {
+    auto abc = std::as_bytes(std::span { "abc", 3 });
+    auto million_a = std::vector<std::byte>(1000000, std::byte { 'a' });
+
+    EXPECT_EQ(hex(shoc::sha_hash(DOCA_SHA_ALGORITHM_SHA1, abc)), "a9993e364706816aba3e25717850c26c9cd0d89d");
+    EXPECT_EQ(hex(shoc::sha_hash(DOCA_SHA_ALGORITHM_SHA256, {})), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(hex(shoc::sha_hash(DOCA_SHA_ALGORITHM_SHA256, abc)), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(hex(shoc::sha_hash(DOCA_SHA_ALGORITHM_SHA256, million_a)), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+    EXPECT_EQ(
+        hex(shoc::sha_hash(DOCA_SHA_ALGORITHM_SHA512, abc)),
+        "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+        "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"
+    );
+}
+
+TEST(cpu_sha, kernels_agree) {
+    auto messages = std::vector<std::vector<std::byte>> {};
+
+    // more messages than lanes, of different lengths, so that lanes are refilled mid-way
+    for(auto i = 0u; i < 37; ++i) {
+        messages.push_back(random_bytes(64 * ((i * 7919) % 70), i));
+    }
+
+    for(auto kernel : { shoc::sha_kernel::scalar, shoc::sha_kernel::sha_ni, shoc::sha_kernel::avx2_multi_buffer }) {
+        if(!shoc::sha_kernel_supported(kernel)) {
+            continue;
+        }
+
+        auto states = std::vector<shoc::cpu_sha_state>(messages.size());
+        auto jobs = std::vector<shoc::sha_absorb_job> {};
+
+        for(auto i = std::size_t { 0 }; i < messages.size(); ++i) {
+            jobs.push_back({ &states[i], messages[i] });
+        }
+
+        shoc::sha_absorb_many(jobs, kernel);
+
+        for(auto i = std::size_t { 0 }; i < messages.size(); ++i) {
+            EXPECT_EQ(states[i].finish({}), shoc::sha_hash(DOCA_SHA_ALGORITHM_SHA256, messages[i]))
+                << "kernel " << static_cast<int>(kernel) << ", message " << i;
+        }
+    }
+}
+
+TEST(docapp_sha_stream, software) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        [[maybe_unused]] shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto data = random_bytes(300000, 42);
+            auto backend = std::make_shared<shoc::cpu_sha_backend>(shoc::cpu_sha_config { .threads = 2 });
+
+            for(auto algorithm : { DOCA_SHA_ALGORITHM_SHA1, DOCA_SHA_ALGORITHM_SHA256, DOCA_SHA_ALGORITHM_SHA512 }) {
+                auto stream = shoc::sha_stream { algorithm, { .software = backend } };
+                auto expected = shoc::sha_hash(algorithm, data);
+
+                CO_ASSERT(!stream.on_device(), "software stream claims to be on a device");
+
+                // pieces of odd sizes, some smaller than a block, some spanning many
+                auto rest = std::span<std::byte const> { data };
+
+                for(auto piece = std::size_t { 1 }; !rest.empty(); piece = piece * 3 + 1) {
+                    auto n = std::min(piece, rest.size());
+                    co_await stream.update(rest.first(n));
+                    rest = rest.subspan(n);
+                }
+
+                CO_ASSERT_EQ(stream.size(), data.size(), "stream lost count of the data");
+                CO_ASSERT_EQ(co_await stream.finish(), expected, "streamed digest differs from one-shot digest");
+
+                // the stream starts over after finish(), and after reset()
+                co_await stream.update(std::span { data }.first(1000));
+                co_await stream.reset();
+                co_await stream.update(data);
+                CO_ASSERT_EQ(co_await stream.finish(), expected, "digest of a reused stream is wrong");
+            }
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
+
+TEST(docapp_sha_stream, device) {
+    auto report = std::string { "fiber not started" };
+
+    auto fiber_fn = [](
+        shoc::progress_engine_lease engine,
+        std::string *report
+    ) -> boost::cobalt::detached {
+        try {
+            *report = "";
+
+            auto dev = shoc::device::find(shoc::device_capability::sha);
+            auto ctx = co_await shoc::sha_context::create(engine, dev, 4);
+            auto stream = shoc::sha_stream { *ctx, dev, DOCA_SHA_ALGORITHM_SHA256 };
+
+            // several segments' worth, fed in pieces that don't line up with them
+            auto data = random_bytes(5 * 64 * 1024 + 1000, 7);
+            auto rest = std::span<std::byte const> { data };
+
+            while(!rest.empty()) {
+                auto n = std::min<std::size_t>(10007, rest.size());
+                co_await stream.update(rest.first(n));
+                rest = rest.subspan(n);
+            }
+
+            auto digest = co_await stream.finish();
+
+            CO_ASSERT_EQ(hex(digest), hex(shoc::sha_hash(DOCA_SHA_ALGORITHM_SHA256, data)), "device digest differs from software digest");
+
+            // a stream dropped with a segment in flight keeps its staging memory until the
+            // device is done with it
+            {
+                auto dropped = shoc::sha_stream { *ctx, dev, DOCA_SHA_ALGORITHM_SHA256 };
+                co_await dropped.update(std::span { data }.first(2 * 64 * 1024 + 1));
+            }
+
+            co_await ctx->stop();
+        } catch(shoc::doca_exception &e) {
+            if(e.doca_error() == DOCA_ERROR_NOT_FOUND) {
+                // no doca_sha on BF-3, and crypto-disabled BF-2s
+                co_return;
+            }
+
+            CO_FAIL(e.what());
+        } catch(std::exception &ex) {
+            CO_FAIL(ex.what());
+        } catch(...) {
+            CO_FAIL("unknown error");
+        }
+    };
+
+    auto task = [](
+        auto fiber_fn,
+        std::string *report
+    ) -> boost::cobalt::task<void> {
+        auto engine = shoc::progress_engine{};
+        fiber_fn(&engine, report);
+        co_await engine.run();
+    } (
+        fiber_fn,
+        &report
+    );
+
+    boost::cobalt::run(std::move(task));
+
+    ASSERT_EQ("", report);
+}
@@ -0,0 +1,95 @@
+#include <shoc/device.hpp>
+#include <shoc/sharded_buffer_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+TEST(sharded_buffer_pool, allocates_all_elements) {
+    auto dev = shoc::device::find(shoc::device_capability::dma);
+    auto cfg = shoc::sharded_buffer_pool_config {};
+    cfg.magazine_size = 16;
+
+    auto pool = shoc::sharded_buffer_pool { dev, 100, 256, 64, cfg };
+
+    auto buffers = pool.allocate_buffers(100);
+    auto handles = std::set<doca_buf*>{};
+
+    for(auto &buf : buffers) {
+        EXPECT_TRUE(buf.has_value());
+        EXPECT_EQ(buf.get().data().size(), 0);
+        EXPECT_EQ(buf.get().memory().size(), 256);
+        handles.insert(buf.get().handle());
+    }
+
+    EXPECT_EQ(handles.size(), 100);
+    EXPECT_THROW(std::ignore = pool.allocate_buffer(), shoc::doca_exception);
+
+    pool.release_buffers(buffers);
+
+    EXPECT_TRUE(std::ranges::none_of(buffers, [](auto &buf) { return buf.has_value(); }));
+
+    auto buf = pool.allocate_buffer(64, 32);
+
+    EXPECT_EQ(buf.get().data().size(), 64);
+    EXPECT_EQ(buf.get().data().data(), buf.get().memory().data() + 32);
+}
+
+TEST(sharded_buffer_pool, caches_rebalance_between_threads) {
+    auto dev = shoc::device::find(shoc::device_capability::dma);
+    auto cfg = shoc::sharded_buffer_pool_config {};
+    cfg.magazine_size = 8;
+
+    auto pool = shoc::sharded_buffer_pool { dev, 256, 64, 64, cfg };
+
+    constexpr auto thread_count = 4;
+    constexpr auto rounds = 2000;
+
+    auto slot_of = std::map<doca_buf*, std::size_t>{};
+
+    {
+        auto all = pool.allocate_buffers(pool.num_elements());
+
+        for(auto &buf : all) {
+            slot_of.emplace(buf.get().handle(), slot_of.size());
+        }
+    }
+
+    auto in_use = std::vector<std::atomic<int>>(pool.num_elements());
+    auto overlaps = std::atomic<int> { 0 };
+    auto threads = std::vector<std::jthread>{};
+
+    for(int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            auto cache = shoc::buffer_pool_cache { pool };
+
+            for(int round = 0; round < rounds; ++round) {
+                auto buffers = pool.allocate_buffers(1 + (round + t) % 40);
+
+                for(auto &buf : buffers) {
+                    if(in_use[slot_of.at(buf.get().handle())].fetch_add(1) != 0) {
+                        ++overlaps;
+                    }
+                }
+
+                for(auto &buf : buffers) {
+                    in_use[slot_of.at(buf.get().handle())].fetch_sub(1);
+                }
+
+                pool.release_buffers(buffers);
+            }
+        });
+    }
+
+    threads.clear();
+
+    EXPECT_EQ(overlaps.load(), 0);
+    EXPECT_EQ(pool.allocate_buffers(256).size(), 256);
+}